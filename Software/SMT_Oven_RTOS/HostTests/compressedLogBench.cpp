@@ -0,0 +1,301 @@
+/**
+ * @file    compressedLogBench.cpp
+ * @brief   Compression and random access of the plot logs
+ *
+ * Hour long (MAX_PROFILE_TIME) sessions are recorded in a TemperaturePlot:
+ *  - Reflow      One reflow followed by the oven cooling and idling (two thermocouples)
+ *  - Manual      Heater and fan set by the user (two thermocouples)
+ *  - Monitor     Oven idle with four thermocouples
+ *  - Repeated    Stress case - reflows back to back with four thermocouples. This exceeds
+ *                the pool and checks that the plot reports it is full.
+ * Thermocouples are sampled at 10 Hz with Gaussian noise and 0.25 C quantisation (MAX31855
+ * resolution) and pass through the default filter (median of 5) as in TemperatureSensors.
+ * The heater duty-cycle follows a noisy proportional controller. For each trace the
+ * following are reported:
+ *  - Encoded size (bytes per point) - the pools must hold the worst session
+ *  - Host time for sequential (cursor) and random access
+ *
+ * The reader/writer interaction (run extension, replacement of the last point) is also checked.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "hostTest.h"
+#include "temperaturePlot.h"
+#include "thermocoupleFilter.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr unsigned POINTS = TemperaturePlot::MAX_PROFILE_TIME;
+
+enum Trace {
+   Trace_Reflow,
+   Trace_Manual,
+   Trace_Monitor,
+   Trace_Repeated,
+};
+
+static const char *const traceNames[] = {"Reflow", "Manual", "Monitor", "Repeated"};
+
+/**
+ * Oven temperature set-point following a reflow profile
+ *
+ * @param[in] time Time since start of reflow (s)
+ *
+ * @return Set-point (C) and state
+ */
+static float reflowSetpoint(unsigned time, State &state) {
+   // preheat 25->140 in 115s, soak 140->183 in 90s, ramp 183->210 at 1.4C/s, dwell 15s, cool at -3C/s
+   if (time<115) {
+      state = s_preheat;
+      return 25+time*(140-25)/115.0f;
+   }
+   time -= 115;
+   if (time<90) {
+      state = s_soak;
+      return 140+time*(183-140)/90.0f;
+   }
+   time -= 90;
+   if (time<20) {
+      state = s_ramp_up;
+      return 183+time*1.4f;
+   }
+   time -= 20;
+   if (time<15) {
+      state = s_dwell;
+      return 210;
+   }
+   time -= 15;
+   state = s_ramp_down;
+   float setpoint = 210-3*time;
+   if (setpoint<25) {
+      state = s_complete;
+      setpoint = 25;
+   }
+   return setpoint;
+}
+
+/**
+ * Generate trace
+ *
+ * @param[in]  trace  Trace to generate
+ * @param[out] points Data points for each second
+ */
+static void makeTrace(Trace trace, std::vector<DataPoint> &points) {
+   std::mt19937 random(4321);
+   std::normal_distribution<float> noise(0.0f, 0.25f);
+   ThermocoupleFilter filters[DataPoint::NUM_THERMOCOUPLES];
+
+   unsigned thermocouples = ((trace == Trace_Reflow)||(trace == Trace_Manual))?2:4;
+   float    oven          = 25;
+   points.clear();
+   for (unsigned time=0; time<POINTS; time++) {
+      State state    = s_off;
+      float setpoint = 0;
+      float heater   = 0;
+      float fan      = 0;
+      // Temperature the oven is approaching
+      float final    = 25;
+      switch(trace) {
+         case Trace_Reflow:
+            setpoint = reflowSetpoint(time, state);
+            if (state == s_complete) {
+               state = s_off;
+            }
+            break;
+         case Trace_Repeated:
+            // Each cycle is 360 s (reflow and cool to ~50C)
+            setpoint = reflowSetpoint(time%360, state);
+            break;
+         case Trace_Manual:
+            // Heater and fan set by the user
+            state  = s_manual;
+            heater = 40;
+            fan    = 30;
+            final  = 25+3*heater;
+            break;
+         case Trace_Monitor:
+            break;
+      }
+      if ((state != s_off) && (state != s_manual)) {
+         // Noisy proportional controller
+         heater = 5*(setpoint-oven)+25+5*noise(random);
+         fan    = 30;
+         if (heater<0) {
+            fan    = 30-heater;
+            heater = 0;
+         }
+         heater = std::min(heater, 100.0f);
+         fan    = std::min(fan, 100.0f);
+         final  = setpoint;
+      }
+      float temperatures[DataPoint::NUM_THERMOCOUPLES];
+      for (unsigned sample=0; sample<10; sample++) {
+         oven += ((state == s_off)?0.001f:0.02f)*(final-oven);
+         for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+            float measured = 0.25f*roundf(4*(oven+index+noise(random)));
+            temperatures[index] = filters[index].filter(measured, Filter_Median, 5, 1.0f);
+         }
+      }
+      DataPoint point;
+      point.setState(state);
+      point.setTargetTemperature(setpoint);
+      point.setHeater((uint8_t)round(heater));
+      point.setFan((uint8_t)round(fan));
+      for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+         if (index<thermocouples) {
+            point.setStatus(index, Max31855::TH_ENABLED);
+            point.setTemperature(index, temperatures[index]);
+         }
+         else {
+            point.setStatus(index, Max31855::TH_OPEN);
+         }
+      }
+      points.push_back(point);
+   }
+}
+
+/**
+ * Compare data points
+ */
+static bool same(const DataPoint &a, const DataPoint &b) {
+   DataPoint::FieldArray fieldsA, fieldsB;
+   a.getFields(fieldsA);
+   b.getFields(fieldsB);
+   return memcmp(fieldsA, fieldsB, sizeof(fieldsA)) == 0;
+}
+
+/**
+ * Check interaction of a reader holding a cursor with the writer
+ */
+static void checkReaderWriter() {
+   using Log = CompressedLog<2, 0b01, 100, 1000>;
+   static Log log;
+   Log::Record record;
+   Log::Cursor cursor;
+
+   // Reader positioned at the end of a run that is then extended
+   for (uint16_t index=0; index<5; index++) {
+      Log::Record value = {(uint16_t)(10*index), 7};
+      log.append(value);
+   }
+   CHECK(log.get(4, record, cursor) && (record[0] == 40) && (record[1] == 7));
+   Log::Record predicted = {50, 7};
+   log.append(predicted);
+   Log::Record different = {55, 9};
+   log.append(different);
+   CHECK(log.get(5, record, cursor) && (record[0] == 50) && (record[1] == 7));
+   CHECK(log.get(6, record, cursor) && (record[0] == 55) && (record[1] == 9));
+
+   // Reader holding the last record which is then replaced
+   Log::Record replacement = {60, 9};
+   log.append(replacement);
+   CHECK(log.get(7, record, cursor) && (record[0] == 60));
+   replacement[0] = 66;
+   replacement[1] = 3;
+   log.replaceLast(replacement);
+   CHECK(log.get(7, record, cursor) && (record[0] == 66) && (record[1] == 3));
+
+   // Replacement that removes the last record from a run
+   Log::Record runValue = {72, 3};
+   log.append(runValue);
+   CHECK(log.get(8, record, cursor) && (record[0] == 72));
+   Log::Record breakRun = {70, 4};
+   log.replaceLast(breakRun);
+   Log::Record next = {71, 4};
+   log.append(next);
+   CHECK(log.get(8, record, cursor) && (record[0] == 70) && (record[1] == 4));
+   CHECK(log.get(9, record, cursor) && (record[0] == 71) && (record[1] == 4));
+
+   // Full log is reported
+   CHECK(!log.isFull());
+   for (unsigned index=log.size(); index<=100; index++) {
+      log.append(next);
+   }
+   CHECK(log.isFull());
+   CHECK(log.size() == 100);
+   log.reset();
+   CHECK(!log.isFull());
+}
+
+int main() {
+   static TemperaturePlot plot;
+   std::vector<DataPoint> points;
+   unsigned worstBytes        = 0;
+   unsigned worstProfileBytes = 0;
+
+   printf("%-10s %8s %8s %8s %8s %12s %12s\n",
+         "Trace", "Points", "Bytes", "B/point", "Profile", "Seq ns/pt", "Random ns");
+   for (Trace trace : {Trace_Reflow, Trace_Manual, Trace_Monitor, Trace_Repeated}) {
+      makeTrace(trace, points);
+      plot.reset();
+      for (unsigned time=0; time<points.size(); time++) {
+         plot.addProfilePoint(time, points[time].getTargetTemperature());
+         plot.addDataPoint(time, points[time]);
+      }
+      unsigned bytes;
+      plot.getEncodedData(bytes);
+      unsigned profileBytes = plot.getBytesUsed()-bytes;
+      unsigned recorded     = plot.getLastValid()+1;
+
+      if (trace == Trace_Repeated) {
+         // Stress case - not a single session. Recording stops and this is reported.
+         CHECK(plot.isLogFull());
+      }
+      else {
+         // Sessions supported for MAX_PROFILE_TIME
+         worstBytes        = std::max(worstBytes, bytes);
+         worstProfileBytes = std::max(worstProfileBytes, profileBytes);
+         CHECK(!plot.isLogFull());
+         CHECK(recorded == POINTS);
+      }
+
+      // Sequential access
+      bool ok = true;
+      auto start = Clock::now();
+      TemperaturePlot::Cursor cursor;
+      for (unsigned index=0; index<recorded; index++) {
+         ok = same(plot.getDataPoint(index, cursor), points[index]) && ok;
+      }
+      double sequential = std::chrono::duration<double, std::nano>(Clock::now()-start).count()/recorded;
+      CHECK(ok);
+
+      // Random access
+      std::mt19937 random(99);
+      std::uniform_int_distribution<unsigned> pick(0, recorded-1);
+      ok = true;
+      static constexpr unsigned GETS = 20000;
+      start = Clock::now();
+      for (unsigned count=0; count<GETS; count++) {
+         unsigned index = pick(random);
+         ok = same(plot.getDataPoint(index), points[index]) && ok;
+      }
+      double randomAccess = std::chrono::duration<double, std::nano>(Clock::now()-start).count()/GETS;
+      CHECK(ok);
+
+      printf("%-10s %8u %8u %8.2f %8u %12.1f %12.1f%s\n",
+            traceNames[trace], recorded, bytes, (double)bytes/recorded, profileBytes, sequential, randomAccess,
+            plot.isLogFull()?" (full)":"");
+   }
+   printf("Worst session %u bytes (pool %u), profile %u bytes (pool %u) for %u points\n",
+         worstBytes, TemperaturePlot::DATA_POOL_SIZE, worstProfileBytes, TemperaturePlot::PROFILE_POOL_SIZE, POINTS);
+
+   // Pools hold the worst session with at least 5% margin
+   CHECK(worstBytes*105/100 <= TemperaturePlot::DATA_POOL_SIZE);
+   CHECK(worstProfileBytes*105/100 <= TemperaturePlot::PROFILE_POOL_SIZE);
+
+   // Points beyond the end are discarded and reported
+   plot.reset();
+   plot.addDataPoint(POINTS, points.back());
+   CHECK(plot.isLogFull());
+   plot.reset();
+   CHECK(!plot.isLogFull());
+
+   checkReaderWriter();
+
+   return HostTest::report("compressedLogBench");
+}
@@ -0,0 +1,106 @@
+/**
+ * @file    dutyPatternTest.cpp
+ * @brief   Host test of the zero-crossing PWM duty-cycle patterns
+ *
+ * For every per-mille duty-cycle a DutyPattern is set and read back a half-cycle at a
+ * time as the zero-crossing ISR does. The following are checked:
+ *  - Energy delivered over the whole pattern is the requested duty-cycle to within
+ *    half a half-cycle (the pattern resolution)
+ *  - Energy delivered over every window of every length, starting at every half-cycle
+ *    (including windows that wrap), is within one half-cycle of the pattern average and
+ *    so within 1.5 half-cycles of the requested duty-cycle
+ *  - 0 and 1000 per-mille are fully off and fully on and set() clamps its argument
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include "hostTest.h"
+#include "ZeroCrossingPwm.h"
+
+static constexpr unsigned BITS = DutyPattern::PATTERN_BITS;
+
+/**
+ * Check pattern for a duty-cycle
+ *
+ * @param[in]  pattern   Pattern to check
+ * @param[in]  duty      Duty-cycle that was set (per-mille)
+ * @param[out] worstTotal     Largest error over the whole pattern (half-cycles)
+ * @param[out] worstWindow    Largest error over any window compared with the pattern average (half-cycles)
+ * @param[out] worstRequested Largest error over any window compared with the duty-cycle (half-cycles)
+ */
+static void checkPattern(const DutyPattern &pattern, unsigned duty,
+      double &worstTotal, double &worstWindow, double &worstRequested) {
+   // Prefix sums over two repeats of the pattern so windows may wrap
+   static unsigned sums[2*BITS+1];
+   sums[0] = 0;
+   for (unsigned position=0; position<2*BITS; position++) {
+      sums[position+1] = sums[position]+(pattern.isOn(position%BITS)?1:0);
+   }
+   unsigned ones = sums[BITS];
+
+   // Whole pattern
+   double ideal = (double)duty*BITS/DutyPattern::RESOLUTION;
+   worstTotal = fabs(ones-ideal);
+
+   // Every window
+   worstWindow    = 0;
+   worstRequested = 0;
+   for (unsigned length=1; length<=BITS; length++) {
+      double average   = (double)ones*length/BITS;
+      double requested = ideal*length/BITS;
+      for (unsigned start=0; start<BITS; start++) {
+         unsigned delivered = sums[start+length]-sums[start];
+         worstWindow    = std::max(worstWindow,    fabs(delivered-average));
+         worstRequested = std::max(worstRequested, fabs(delivered-requested));
+      }
+   }
+}
+
+int main() {
+   static DutyPattern pattern;
+
+   double worstTotal     = 0;
+   double worstWindow    = 0;
+   double worstRequested = 0;
+   bool   totalOk        = true;
+   bool   windowOk       = true;
+   bool   requestedOk    = true;
+   bool   getOk          = true;
+   for (unsigned duty=0; duty<=DutyPattern::RESOLUTION; duty++) {
+      pattern.set(duty);
+      getOk = getOk && (pattern.get() == duty);
+
+      double total, window, requested;
+      checkPattern(pattern, duty, total, window, requested);
+      totalOk     = totalOk     && (total <= 0.5);
+      windowOk    = windowOk    && (window < 1.0);
+      requestedOk = requestedOk && (requested < 1.5);
+      worstTotal     = std::max(worstTotal, total);
+      worstWindow    = std::max(worstWindow, window);
+      worstRequested = std::max(worstRequested, requested);
+   }
+   printf("Worst error (half-cycles): whole pattern %.3f (%.3f%%), any window %.3f from average, %.3f from requested\n",
+         worstTotal, 100*worstTotal/BITS, worstWindow, worstRequested);
+   CHECK(getOk);
+   CHECK(totalOk);
+   CHECK(windowOk);
+   CHECK(requestedOk);
+
+   // Off and fully on
+   bool allOff = true;
+   bool allOn  = true;
+   pattern.set(0);
+   for (unsigned position=0; position<BITS; position++) {
+      allOff = allOff && !pattern.isOn(position);
+   }
+   pattern.set(DutyPattern::RESOLUTION+500);
+   CHECK(pattern.get() == DutyPattern::RESOLUTION);
+   for (unsigned position=0; position<BITS; position++) {
+      allOn = allOn && pattern.isOn(position);
+   }
+   CHECK(allOff);
+   CHECK(allOn);
+
+   return HostTest::report("dutyPatternTest");
+}
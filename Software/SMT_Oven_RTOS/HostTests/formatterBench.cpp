@@ -0,0 +1,156 @@
+/**
+ * @file    formatterBench.cpp
+ * @brief   Time and stack used by Formatter compared with snprintf()
+ *
+ * Typical lines from the LCD, remote interface and step response are formatted both ways.
+ * The output is checked to be identical and for each the following are reported:
+ *  - Host time per line (ns)
+ *  - Peak stack used (bytes) measured on a painted thread stack
+ * snprintf() is the host C library rather than newlib so its figures are indicative only.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "hostTest.h"
+#include "formatter.h"
+
+/** Size of painted stack used to measure stack use */
+static constexpr size_t STACK_SIZE = 64*1024;
+
+/** Fill pattern for stack */
+static constexpr uint8_t PAINT = 0xA5;
+
+/** Buffer receiving each line */
+static char output[80];
+
+/** Values formatted */
+static volatile int   timeValue   = 123;
+static volatile int   fanValue    = 30;
+static volatile int   heaterValue = 87;
+static volatile float temperature = 183.46f;
+static volatile float setpoint    = -12.5f;
+
+/** Step response line (stepResponse.cpp) */
+static void stepLineFormatter() {
+   FormattedString<30> buff;
+   buff.writeInt(timeValue, 4).writeString(", ").writeInt(fanValue, 4).writeString(", ")
+       .writeInt(heaterValue, 4).writeString(", ").writeFixed(temperature, 1, 5).writeChar('\n');
+   strcpy(output, buff.toString());
+}
+static void stepLineSnprintf() {
+   snprintf(output, sizeof(output), "%4d, %4d, %4d, %5.1f\n", timeValue, fanValue, heaterValue, temperature);
+}
+
+/** Status line (remote interface) */
+static void statusLineFormatter() {
+   FormattedString<80> buff;
+   buff.writeString("Running").writeChar(',').writeInt(timeValue).writeChar(',')
+       .writeFixed(setpoint, 1).writeChar(',').writeFixed(temperature, 2).writeChar(',')
+       .writeHex(0x3A, 2).writeChar(';');
+   strcpy(output, buff.toString());
+}
+static void statusLineSnprintf() {
+   snprintf(output, sizeof(output), "%s,%d,%.1f,%.2f,%02X;", "Running", timeValue, setpoint, temperature, 0x3A);
+}
+
+/** Does nothing - measures overhead of the stack measurement */
+static void emptyFunction() {
+}
+
+/**
+ * Thread running the function being measured
+ */
+static void *runFunction(void *function) {
+   ((void (*)())function)();
+   return nullptr;
+}
+
+/**
+ * Measure peak stack used by a function
+ *
+ * @param[in] function Function to measure
+ *
+ * @return Bytes of stack used (including thread overhead)
+ */
+static size_t stackUsed(void (*function)()) {
+   static uint8_t stack[STACK_SIZE] __attribute__((aligned(4096)));
+   memset(stack, PAINT, sizeof(stack));
+
+   pthread_attr_t attributes;
+   pthread_attr_init(&attributes);
+   pthread_attr_setstack(&attributes, stack, sizeof(stack));
+   pthread_t thread;
+   pthread_create(&thread, &attributes, runFunction, (void *)function);
+   pthread_join(thread, nullptr);
+   pthread_attr_destroy(&attributes);
+
+   // Stack grows down so the untouched area is at the bottom
+   size_t untouched = 0;
+   while ((untouched<sizeof(stack)) && (stack[untouched] == PAINT)) {
+      untouched++;
+   }
+   return sizeof(stack)-untouched;
+}
+
+/**
+ * Measure host time for a function
+ *
+ * @param[in] function Function to measure
+ *
+ * @return Time per call (ns)
+ */
+static double timePerCall(void (*function)()) {
+   static constexpr unsigned CALLS = 200000;
+   auto start = std::chrono::steady_clock::now();
+   for (unsigned count=0; count<CALLS; count++) {
+      function();
+   }
+   return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count()/CALLS;
+}
+
+struct Result {
+   double nsPerCall;
+   size_t stack;
+};
+
+/**
+ * Measure and report a function
+ */
+static Result report(const char *name, void (*function)(), size_t overhead) {
+   Result result{timePerCall(function), stackUsed(function)-overhead};
+   printf("%-20s %10.1f %10u\n", name, result.nsPerCall, (unsigned)result.stack);
+   return result;
+}
+
+int main() {
+   size_t overhead = stackUsed(emptyFunction);
+
+   // Identical output
+   char expected[sizeof(output)];
+   stepLineSnprintf();
+   strcpy(expected, output);
+   stepLineFormatter();
+   CHECK(strcmp(output, expected) == 0);
+   statusLineSnprintf();
+   strcpy(expected, output);
+   statusLineFormatter();
+   CHECK(strcmp(output, expected) == 0);
+
+   printf("%-20s %10s %10s\n", "Line", "ns/line", "Stack(B)");
+   Result stepFormatter   = report("Step Formatter", stepLineFormatter, overhead);
+   Result stepSnprintf    = report("Step snprintf",  stepLineSnprintf,  overhead);
+   Result statusFormatter = report("Status Formatter", statusLineFormatter, overhead);
+   Result statusSnprintf  = report("Status snprintf",  statusLineSnprintf,  overhead);
+
+   // Formatter uses less stack than the float printf code it replaces
+   CHECK(stepFormatter.stack < stepSnprintf.stack);
+   CHECK(statusFormatter.stack < statusSnprintf.stack);
+   CHECK(stepFormatter.nsPerCall < stepSnprintf.nsPerCall);
+   CHECK(statusFormatter.nsPerCall < statusSnprintf.nsPerCall);
+
+   return HostTest::report("formatterBench");
+}
@@ -0,0 +1,58 @@
+/**
+ * @file    hostTest.h
+ * @brief   Minimal checking support for host tests
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_HOSTTEST_H_
+#define HOSTTESTS_HOSTTEST_H_
+
+#include <stdio.h>
+
+namespace HostTest {
+
+/** Number of failed checks */
+inline unsigned failures = 0;
+
+/** Number of checks */
+inline unsigned checks = 0;
+
+/**
+ * Record result of a check
+ *
+ * @param[in] condition   Result of check
+ * @param[in] description Text of check
+ * @param[in] file        File containing check
+ * @param[in] line        Line of check
+ *
+ * @return condition
+ */
+inline bool check(bool condition, const char *description, const char *file, int line) {
+   checks++;
+   if (!condition) {
+      failures++;
+      fprintf(stderr, "%s:%d: Check failed: %s\n", file, line, description);
+   }
+   return condition;
+}
+
+/**
+ * Report results
+ *
+ * @param[in] name Name of test
+ *
+ * @return Exit code for test program
+ */
+inline int report(const char *name) {
+   printf("%s: %u checks, %u failures\n", name, checks, failures);
+   return (failures == 0)?0:1;
+}
+
+}; // end namespace HostTest
+
+/** Check a condition and report failure */
+#define CHECK(condition) HostTest::check((condition), #condition, __FILE__, __LINE__)
+
+#endif /* HOSTTESTS_HOSTTEST_H_ */
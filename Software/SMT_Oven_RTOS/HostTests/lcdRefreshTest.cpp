@@ -0,0 +1,149 @@
+/**
+ * @file    lcdRefreshTest.cpp
+ * @brief   Host test of the bytes sent to the LCD by LCD_ST7920::refreshImage()
+ *
+ * LCD_ST7920 drives a simulated ST7920 through the SPI stand-in with the LCD transport
+ * running as on the target. A typical menu screen is drawn and the bytes sent are counted for:
+ *  - The first refresh (every word of every row is written)
+ *  - A refresh with no drawing and a refresh after redrawing an identical screen (nothing sent)
+ *  - A refresh after one line of text changes (only the changed words of that line are sent)
+ * After each refresh the decoded GDRAM must match the frame buffer.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "hostHardware.h"
+#include "simulatedSt7920.h"
+#include "lcd_st7920.h"
+
+using namespace USBDM;
+using namespace HostHardware;
+
+USBDM::Spi0 spi;
+
+/** PCS used by LCD (same as configure.h) */
+static constexpr int lcdPcsNum = 4;
+
+SimulatedSt7920 lcdDevice;
+
+/**
+ * LCD with frame buffer visible to test
+ */
+class TestLcd : public LCD_ST7920 {
+public:
+   using LCD_ST7920::LCD_ST7920;
+   using LCD_ST7920::frameBuffer;
+   using LCD_ST7920::BYTES_PER_ROW;
+};
+
+/** Bytes sent to set instruction set, GDRAM address and the sync byte of a row burst */
+static constexpr unsigned MODE_BYTES = 2*3;
+static constexpr unsigned ROW_BYTES  = 2*3+1;
+
+/**
+ * Draw menu screen
+ *
+ * @param[in] lcd         LCD to draw on
+ * @param[in] temperature Temperature shown on one line
+ */
+static void drawScreen(TestLcd &lcd, int temperature) {
+   char line[30];
+   lcd.clearFrameBuffer();
+   lcd.putString("  Solder Profile  \n");
+   lcd.putString("4300 63SN/37PB-a\n");
+   lcd.putString("Liquidus  183C\n");
+   lcd.putString("Preheat    90s\n");
+   lcd.putString("Soak  150-180C\n");
+   snprintf(line, sizeof(line), "Oven      %3dC\n", temperature);
+   lcd.putString(line);
+   lcd.putString("Peak      225C\n");
+   lcd.putString("Run  Edit  Exit\n");
+}
+
+/**
+ * Refresh LCD and count bytes sent
+ *
+ * @param[in] lcd LCD to refresh
+ *
+ * @return Number of bytes sent to LCD
+ */
+static unsigned refresh(TestLcd &lcd) {
+   unsigned before = lcdDevice.bytes;
+   lcd.refreshImage();
+   // Allow the transport to drain (a full screen takes ~100ms)
+   osDelay(1000);
+   return lcdDevice.bytes-before;
+}
+
+/**
+ * Check LCD GDRAM matches frame buffer
+ */
+static bool gdramMatches(TestLcd &lcd) {
+   return memcmp(lcdDevice.gdram, lcd.frameBuffer, sizeof(lcdDevice.gdram)) == 0;
+}
+
+int main() {
+   attachSpiDevice(lcdPcsNum, &lcdDevice);
+
+   static TestLcd lcd(spi, lcdPcsNum);
+   lcd.startTransport();
+   lcd.setGraphicMode();
+   osDelay(100);
+   CHECK(lcdDevice.graphicsOn);
+
+   // First refresh writes all 64 rows of 8 words
+   drawScreen(lcd, 123);
+   unsigned fullBytes = refresh(lcd);
+   CHECK(fullBytes == MODE_BYTES+SimulatedSt7920::ROWS*(ROW_BYTES+2*TestLcd::BYTES_PER_ROW));
+   CHECK(gdramMatches(lcd));
+
+   // Nothing drawn
+   unsigned idleBytes = refresh(lcd);
+   CHECK(idleBytes == 0);
+
+   // Identical screen redrawn - rows are marked changed but no word differs
+   drawScreen(lcd, 123);
+   unsigned sameBytes = refresh(lcd);
+   CHECK(sameBytes == 0);
+   CHECK(gdramMatches(lcd));
+
+   // One line of text changes - only the span of changed words in each pixel row is sent
+   uint8_t before[SimulatedSt7920::ROWS][SimulatedSt7920::BYTES_PER_ROW];
+   memcpy(before, lcdDevice.gdram, sizeof(before));
+   drawScreen(lcd, 124);
+   unsigned lineBytes = refresh(lcd);
+   CHECK(gdramMatches(lcd));
+
+   unsigned expected    = MODE_BYTES;
+   unsigned changedRows = 0;
+   for (unsigned row=0; row<SimulatedSt7920::ROWS; row++) {
+      int first = -1;
+      int last  = -1;
+      for (unsigned word=0; word<SimulatedSt7920::BYTES_PER_ROW/2; word++) {
+         if (memcmp(before[row]+2*word, lcdDevice.gdram[row]+2*word, 2) != 0) {
+            if (first<0) {
+               first = word;
+            }
+            last = word;
+         }
+      }
+      if (first>=0) {
+         // Changes are confined to the pixel rows of the line
+         CHECK((row>=5*LCD_ST7920::FONT_HEIGHT) && (row<6*LCD_ST7920::FONT_HEIGHT));
+         expected += ROW_BYTES+4*(last-first+1);
+         changedRows++;
+      }
+   }
+   CHECK(changedRows>0);
+   CHECK(lineBytes == expected);
+   CHECK(lineBytes*10 < fullBytes);
+
+   printf("Bytes sent: full screen %u, unchanged %u, identical redraw %u, one line changed %u (%u pixel rows)\n",
+         fullBytes, idleBytes, sameBytes, lineBytes, changedRows);
+   CHECK(lcdDevice.errors == 0);
+   CHECK(spiStatistics.txOverflows == 0);
+
+   return HostTest::report("lcdRefreshTest");
+}
@@ -0,0 +1,270 @@
+/**
+ * @file    lcdTransportTest.cpp
+ * @brief   Host test of the PIT paced LCD transport
+ *
+ * A simulated ST7920 serial interface decodes the frames sent by LcdTransport and
+ * records the virtual time each instruction completes. A full screen is written
+ * while a high priority thread uses the shared SPI every 100ms as the thermocouple
+ * sampler does.
+ *
+ * The same frame buffer contents are also refreshed through LCD_ST7920 before the
+ * transport is started (a {sync,high,low} frame per byte) and with it running (a single
+ * sync byte per row burst). The GDRAM decoded by the simulated ST7920 must be identical.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <random>
+#include <vector>
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "hostHardware.h"
+#include "simulatedSt7920.h"
+#include "spi.h"
+#include "lcdTransport.h"
+#include "lcd_st7920.h"
+
+using namespace USBDM;
+using namespace HostHardware;
+
+USBDM::Spi0 spi;
+
+/** PCS used by LCD (same as configure.h) */
+static constexpr int lcdPcsNum = 4;
+
+/** PCS used by the sampler (no device attached) */
+static constexpr int samplerPcsNum = 0;
+
+/**
+ * LCD with frame buffer visible to test
+ */
+class TestLcd : public LCD_ST7920 {
+public:
+   using LCD_ST7920::LCD_ST7920;
+   using LCD_ST7920::frameBuffer;
+};
+
+SimulatedSt7920 lcdDevice;
+
+/** Longest time the sampler waited for the SPI (us) */
+static uint64_t samplerMaxWait = 0;
+
+/** Number of sampler accesses */
+static unsigned samplerCount = 0;
+
+/**
+ * Uses the SPI every 100ms as the thermocouple sampler does
+ */
+static void samplerThreadFunction(const void *) {
+   for(;;) {
+      uint64_t start = HostKernel::getTime();
+      spi.startTransaction();
+      uint64_t wait = HostKernel::getTime()-start;
+      if (wait>samplerMaxWait) {
+         samplerMaxWait = wait;
+      }
+      samplerCount++;
+      static const uint8_t txData[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+      spi.setPushrValue(SPI_PUSHR_PCS(1<<samplerPcsNum));
+      spi.txRxBytes(sizeof(txData), txData);
+      spi.endTransaction();
+      osDelay(100);
+   }
+}
+
+static CMSIS::Thread samplerThread{samplerThreadFunction, osPriorityHigh, 512};
+
+/**
+ * Wait until the LCD has received the given number of instructions
+ *
+ * @param[in] count Number of instructions
+ *
+ * @return true if received within 1s
+ */
+static bool waitForInstructions(unsigned count) {
+   return HostKernel::block([count]{ return lcdDevice.instructions.size() >= count; }, 1000);
+}
+
+/** Screen image as decoded from GDRAM */
+using Screen = uint8_t[SimulatedSt7920::ROWS][SimulatedSt7920::BYTES_PER_ROW];
+
+/**
+ * Draw random full screen image
+ */
+static void drawScreen(TestLcd &lcd) {
+   static uint8_t image[LCD_ST7920::LCD_HEIGHT*LCD_ST7920::LCD_WIDTH/8];
+   std::mt19937 random(1);
+   for (uint8_t &data : image) {
+      data = (uint8_t)random();
+   }
+   lcd.writeImage(image);
+}
+
+/**
+ * Invert region of frame buffer (x and width multiples of 8)
+ */
+static void invertRegion(TestLcd &lcd, int x, int y, int width, int height) {
+   uint8_t patch[LCD_ST7920::LCD_HEIGHT*LCD_ST7920::LCD_WIDTH/8];
+   uint8_t *patchPtr = patch;
+   for (int row=y; row<y+height; row++) {
+      for (int col=x/8; col<(x+width)/8; col++) {
+         *patchPtr++ = ~lcd.frameBuffer[row*(LCD_ST7920::LCD_WIDTH/8)+col];
+      }
+   }
+   lcd.writeImage(patch, x, y, width, height);
+}
+
+/**
+ * Change parts of some rows in both halves of the screen (GDRAM horizontal words 0-7 and 8-15)
+ */
+static void drawChanges(TestLcd &lcd) {
+   invertRegion(lcd,  40,  3, 16, 1);
+   invertRegion(lcd,  80, 40, 32, 2);
+   invertRegion(lcd, 120, 63,  8, 1);
+}
+
+/**
+ * Refresh LCD and count bytes sent
+ *
+ * @return Number of bytes sent to LCD
+ */
+static unsigned refresh(TestLcd &lcd) {
+   unsigned before = lcdDevice.bytes;
+   lcd.refreshImage();
+   if (LcdTransport::isRunning()) {
+      // Allow the transport to drain (a full screen takes ~100ms)
+      osDelay(1000);
+   }
+   return lcdDevice.bytes-before;
+}
+
+int main() {
+   attachSpiDevice(lcdPcsNum, &lcdDevice);
+
+   // Reference images written a byte at a time {0xFA,high,low} before the transport is started
+   static TestLcd lcd(spi, lcdPcsNum);
+   static Screen byteFull, byteChanged;
+   drawScreen(lcd);
+   unsigned byteFullBytes = refresh(lcd);
+   memcpy(byteFull, lcdDevice.gdram, sizeof(Screen));
+   drawChanges(lcd);
+   unsigned byteChangedBytes = refresh(lcd);
+   memcpy(byteChanged, lcdDevice.gdram, sizeof(Screen));
+   CHECK(memcmp(byteChanged, lcd.frameBuffer, sizeof(Screen)) == 0);
+   CHECK(memcmp(byteChanged, byteFull, sizeof(Screen)) != 0);
+   CHECK(lcdDevice.errors == 0);
+   lcdDevice.instructions.clear();
+
+   spi.startTransaction();
+   spi.setSpeed(5000000);
+   spi.setMode(USBDM::SpiMode3);
+   spi.setFrameSize(8);
+   uint32_t spiConfig = spi.getCTAR0Value();
+   spi.endTransaction();
+
+   LcdTransport::initialise(spi, spiConfig, lcdPcsNum);
+   CHECK(LcdTransport::isRunning());
+
+   static constexpr uint64_t interval = (uint64_t)(LcdTransport::INTERVAL/us+0.5);
+
+   // Single instructions and a pause are paced by the PIT
+   {
+      LcdTransport::write(LcdTransport::Entry_Command|0x01);
+      LcdTransport::write(LcdTransport::Entry_Pause|20);
+      LcdTransport::write(LcdTransport::Entry_Command|0x06);
+      LcdTransport::write(LcdTransport::Entry_Data|0xA5);
+      CHECK(waitForInstructions(3));
+
+      const auto &received = lcdDevice.instructions;
+      CHECK(received.size() == 3);
+      CHECK(received[0].entry == (LcdTransport::Entry_Command|0x01));
+      CHECK(received[1].entry == (LcdTransport::Entry_Command|0x06));
+      CHECK(received[2].entry == (LcdTransport::Entry_Data|0xA5));
+      CHECK(received[1].time-received[0].time >= 21*interval);
+      CHECK(received[2].time-received[1].time >= interval);
+
+      // Every frame ends the queue (EOQ) so the ISR must clear EOQF for the next to be sent
+      CHECK(spiStatistics.txOverflows == 0);
+      CHECK(lcdDevice.errors == 0);
+   }
+
+   // Full screen while the sampler shares the SPI
+   {
+      samplerThread.run();
+      lcdDevice.instructions.clear();
+      SpiStatistics before = spiStatistics;
+      uint64_t start = HostKernel::getTime();
+
+      static constexpr unsigned ROWS = 64;
+      static constexpr unsigned ROW_SIZE = LcdTransport::MAX_BURST;
+      for (unsigned row=0; row<ROWS; row++) {
+         LcdTransport::write(LcdTransport::Entry_Command|0x80|(row&0x1F));
+         LcdTransport::write(LcdTransport::Entry_Command|0x80|((row/32)*8));
+         uint8_t data[ROW_SIZE];
+         for (unsigned index=0; index<ROW_SIZE; index++) {
+            data[index] = (uint8_t)(row+index);
+         }
+         LcdTransport::writeBurst(data, ROW_SIZE);
+      }
+      CHECK(waitForInstructions(ROWS*(2+ROW_SIZE)));
+      uint64_t elapsed = HostKernel::getTime()-start;
+
+      const auto &received = lcdDevice.instructions;
+      CHECK(received.size() == ROWS*(2+ROW_SIZE));
+      bool orderOk  = true;
+      bool pacingOk = true;
+      for (unsigned index=0; index<received.size(); index++) {
+         unsigned row    = index/(2+ROW_SIZE);
+         unsigned column = index%(2+ROW_SIZE);
+         uint16_t expected;
+         if (column == 0) {
+            expected = LcdTransport::Entry_Command|0x80|(row&0x1F);
+         }
+         else if (column == 1) {
+            expected = LcdTransport::Entry_Command|0x80|((row/32)*8);
+         }
+         else {
+            expected = LcdTransport::Entry_Data|(uint8_t)(row+column-2);
+         }
+         orderOk = orderOk && (received[index].entry == expected);
+         // ST7920 instruction time is 72us
+         pacingOk = pacingOk && ((index == 0) || (received[index].time-received[index-1].time >= 72));
+      }
+      CHECK(orderOk);
+      CHECK(pacingOk);
+      CHECK(lcdDevice.errors == 0);
+      CHECK(spiStatistics.txOverflows == before.txOverflows);
+      CHECK(spiStatistics.pcsChanges == before.pcsChanges);
+
+      // The SPI is released between rows so the sampler is not held off for the whole screen
+      printf("Screen of %u instructions in %.1f ms, sampler %u accesses, longest wait %u us\n",
+            (unsigned)received.size(), elapsed/1000.0, samplerCount, (unsigned)samplerMaxWait);
+      CHECK(elapsed > 100000);
+      CHECK(samplerCount >= elapsed/100000);
+      CHECK(samplerMaxWait <= (LcdTransport::MAX_BURST+3)*interval);
+   }
+
+   // Same images written as a burst per row while the sampler shares the SPI
+   {
+      memset(lcdDevice.gdram, 0, sizeof(lcdDevice.gdram));
+      lcd.initialise();
+      osDelay(1000);
+      drawScreen(lcd);
+      unsigned burstFullBytes = refresh(lcd);
+      CHECK(memcmp(lcdDevice.gdram, byteFull, sizeof(Screen)) == 0);
+      drawChanges(lcd);
+      unsigned burstChangedBytes = refresh(lcd);
+      CHECK(memcmp(lcdDevice.gdram, byteChanged, sizeof(Screen)) == 0);
+      CHECK(lcdDevice.errors == 0);
+
+      // Mode and address instructions and then {sync,high,low} per byte or a sync per row
+      static constexpr unsigned ROWS = SimulatedSt7920::ROWS;
+      static constexpr unsigned ROW_SIZE = SimulatedSt7920::BYTES_PER_ROW;
+      printf("Full screen %u bytes per-byte, %u bytes burst. Changes %u bytes per-byte, %u bytes burst\n",
+            byteFullBytes, burstFullBytes, byteChangedBytes, burstChangedBytes);
+      CHECK(byteFullBytes  == 2*3+ROWS*(2*3+3*ROW_SIZE));
+      CHECK(burstFullBytes == 2*3+ROWS*(2*3+1+2*ROW_SIZE));
+      CHECK(burstChangedBytes < byteChangedBytes);
+   }
+   return HostTest::report("lcdTransportTest");
+}
@@ -0,0 +1,165 @@
+/**
+ * @file    max31855BatchTest.cpp
+ * @brief   Host test of the DMA driven MAX31855 batch reader
+ *
+ * The PUSHR words pushed by DMA are recorded by the simulated SPI and checked for
+ * order, PCS, CONT and EOQ. The decoded readings are compared with the simulated devices.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <vector>
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "hostHardware.h"
+#include "simulatedMax31855.h"
+#include "spi.h"
+#include "flash.h"
+#include "max31855Batch.h"
+
+using namespace USBDM;
+using namespace HostHardware;
+
+USBDM::Spi0 spi;
+
+__attribute__ ((section(".flexRAM")))
+Nonvolatile<int>  offsets[4];
+__attribute__ ((section(".flexRAM")))
+Nonvolatile<bool> enables[4];
+
+/** PCS used by each device (same assignment as configure.h) */
+static constexpr int pcsNums[] = {2, 3, 1, 0};
+
+/**
+ * Check the frames of one batch
+ *
+ * @param[in] frames     Frames recorded
+ * @param[in] numDevices Number of devices in batch
+ */
+static void checkFrames(const std::vector<SpiFrame> &frames, unsigned numDevices) {
+   CHECK(frames.size() == numDevices*Max31855Batch::FRAME_SIZE);
+   if (frames.size() != numDevices*Max31855Batch::FRAME_SIZE) {
+      return;
+   }
+   for (unsigned device=0; device<numDevices; device++) {
+      for (unsigned byte=0; byte<Max31855Batch::FRAME_SIZE; byte++) {
+         uint32_t pushr = frames[device*Max31855Batch::FRAME_SIZE+byte].pushr;
+         bool last = (device == numDevices-1) && (byte == Max31855Batch::FRAME_SIZE-1);
+
+         CHECK((pushr&SPI_PUSHR_PCS_MASK) == SPI_PUSHR_PCS(1<<pcsNums[device]));
+         CHECK((pushr&SPI_PUSHR_CTAS(7)) == SPI_PUSHR_CTAS(0));
+         CHECK((pushr&SPI_PUSHR_TXDATA_MASK) == 0xFF);
+         CHECK(((pushr&SPI_PUSHR_CONT_MASK) != 0) == (byte < Max31855Batch::FRAME_SIZE-1));
+         CHECK(((pushr&SPI_PUSHR_EOQ_MASK) != 0) == last);
+      }
+   }
+}
+
+int main() {
+   NonvolatileShadow::load();
+
+   Max31855 devices[] = {
+      Max31855(spi, pcsNums[0], offsets[0], enables[0]),
+      Max31855(spi, pcsNums[1], offsets[1], enables[1]),
+      Max31855(spi, pcsNums[2], offsets[2], enables[2]),
+      Max31855(spi, pcsNums[3], offsets[3], enables[3]),
+   };
+   SimulatedMax31855 simulated[] = {
+      {21.0625f, 150.25f, 0},
+      {22.5f,    -10.75f, 0},
+      {23.0f,    240.0f,  0},
+      {24.125f,  180.5f,  0},
+   };
+   for (unsigned index=0; index<4; index++) {
+      offsets[index] = 0;
+      enables[index] = true;
+      attachSpiDevice(pcsNums[index], &simulated[index]);
+   }
+
+   // Full batch
+   {
+      Max31855Batch batch(spi, devices, 4);
+      batch.initialise();
+
+      // Leave junk in the transmit FIFO and EOQF set as a previous user might
+      spi.spi->MCR |= SPI_MCR_HALT_MASK;
+      spi.spi->PUSHR = SPI_PUSHR_PCS(1<<pcsNums[0])|SPI_PUSHR_EOQ_MASK|0x55;
+
+      std::vector<SpiFrame> frames;
+      recordSpiFrames(&frames);
+      Max31855::ThermocoupleStatus status[4];
+      float temperatures[4], coldReferences[4];
+      SpiStatistics before = spiStatistics;
+      CHECK(batch.read(status, temperatures, coldReferences));
+      recordSpiFrames(nullptr);
+
+      checkFrames(frames, 4);
+      CHECK(spiStatistics.transactions-before.transactions == 1);
+      CHECK(spiStatistics.selects-before.selects == 4);
+      CHECK(spiStatistics.pcsChanges == before.pcsChanges);
+      CHECK(spiStatistics.rxOverflows == before.rxOverflows);
+      for (unsigned index=0; index<4; index++) {
+         CHECK(status[index] == Max31855::TH_ENABLED);
+         CHECK(temperatures[index] == simulated[index].probeStart);
+         CHECK(coldReferences[index] == simulated[index].coldReference);
+         CHECK(simulated[index].shortFrames == 0);
+      }
+
+      // Faults are decoded per device
+      simulated[1].fault = 0b001;
+      simulated[2].fault = 0b010;
+      enables[3] = false;
+      CHECK(batch.read(status, temperatures, coldReferences));
+      CHECK(status[0] == Max31855::TH_ENABLED);
+      CHECK(status[1] == Max31855::TH_OPEN);
+      CHECK(isnan(temperatures[1]));
+      CHECK(status[2] == Max31855::TH_SHORT_GND);
+      CHECK(status[3] == Max31855::TH_DISABLED);
+      simulated[1].fault = 0;
+      simulated[2].fault = 0;
+      enables[3] = true;
+
+      // SPI is left usable for polled transfers
+      float temperature, coldReference;
+      frames.clear();
+      recordSpiFrames(&frames);
+      CHECK(devices[2].getReading(temperature, coldReference) == Max31855::TH_ENABLED);
+      recordSpiFrames(nullptr);
+      CHECK(temperature == simulated[2].probeStart);
+      CHECK(frames.size() == 4);
+   }
+
+   // Partial batch - EOQ moves to the last device
+   {
+      Max31855Batch batch(spi, devices, 2);
+      batch.initialise();
+      std::vector<SpiFrame> frames;
+      recordSpiFrames(&frames);
+      Max31855::ThermocoupleStatus status[2];
+      float temperatures[2], coldReferences[2];
+      CHECK(batch.read(status, temperatures, coldReferences));
+      recordSpiFrames(nullptr);
+      checkFrames(frames, 2);
+      CHECK(temperatures[1] == simulated[1].probeStart);
+   }
+
+   // Repeated reads do not leak frames or time
+   {
+      Max31855Batch batch(spi, devices, 4);
+      batch.initialise();
+      Max31855::ThermocoupleStatus status[4];
+      float temperatures[4], coldReferences[4];
+      SpiStatistics before = spiStatistics;
+      uint64_t start = HostKernel::getTime();
+      bool ok = true;
+      for (unsigned count=0; count<1000; count++) {
+         ok = batch.read(status, temperatures, coldReferences) && ok;
+      }
+      CHECK(ok);
+      CHECK(spiStatistics.frames-before.frames == 1000*16);
+      CHECK(spiStatistics.txOverflows == before.txOverflows);
+      CHECK(HostKernel::getTime() == start);
+   }
+   return HostTest::report("max31855BatchTest");
+}
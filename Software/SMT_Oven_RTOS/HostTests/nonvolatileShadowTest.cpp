@@ -0,0 +1,345 @@
+/**
+ * @file    nonvolatileShadowTest.cpp
+ * @brief   Host test of the RAM shadow of the non-volatile variables
+ *
+ * The firmware's NonvolatileShadow is used with variables placed in the simulated FlexRAM
+ * (see flexRam.ld). The following are checked:
+ *  - load() copies the FlexRAM contents present at start-up to the shadow
+ *  - Writes go to the shadow and FlexRAM unless unchanged or a transaction is open
+ *  - Within a transaction FlexRAM is unchanged until the outermost transaction commits and
+ *    only the words that differ are written
+ *  - A transaction open in one thread delays writes and transactions of other threads
+ *    until it commits rather than including them
+ *  - Writes are counted for each variable that changed, including variables sharing a word
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "cmsis.h"
+#include "flash.h"
+
+using namespace USBDM;
+
+/**
+ * Non-volatile variables\n
+ * A structure is used so the variables sharing FlexRAM words are known.
+ */
+struct Variables {
+   Nonvolatile<int>              count;   // Word 0
+   Nonvolatile<uint16_t>         limit;   // Word 1
+   Nonvolatile<uint8_t>          mode;    // Word 1
+   Nonvolatile<uint8_t>          flags;   // Word 1
+   NonvolatileArray<uint8_t, 10> name;    // Words 2-4
+   NonvolatileArray<int, 4>      offsets; // Words 5-8
+};
+
+__attribute__ ((section(".flexRAM")))
+static Variables nv;
+
+static Nonvolatile<int>              &count   = nv.count;
+static Nonvolatile<uint16_t>         &limit   = nv.limit;
+static Nonvolatile<uint8_t>          &mode    = nv.mode;
+static Nonvolatile<uint8_t>          &flags   = nv.flags;
+static NonvolatileArray<uint8_t, 10> &name    = nv.name;
+static NonvolatileArray<int, 4>      &offsets = nv.offsets;
+
+/**
+ * Get value of non-volatile variable held in FlexRAM (rather than the shadow)
+ *
+ * @param[in] variable Variable
+ *
+ * @return Value in FlexRAM
+ */
+template<typename T>
+static T inFlexRam(const Nonvolatile<T> &variable) {
+   return *(const volatile T *)&variable;
+}
+
+/**
+ * Get value of non-volatile array element held in FlexRAM (rather than the shadow)
+ *
+ * @param[in] array Array
+ * @param[in] index Index of element
+ *
+ * @return Value in FlexRAM
+ */
+template<typename T, int dimension>
+static T inFlexRam(const NonvolatileArray<T, dimension> &array, int index) {
+   return ((const volatile T *)&array)[index];
+}
+
+/**
+ * Get number of writes to FlexRAM
+ */
+static uint32_t getWrites() {
+   NonvolatileStatistics statistics;
+   NonvolatileShadow::getStatistics(statistics);
+   return statistics.writes;
+}
+
+/**
+ * Check load() takes the values in FlexRAM at start-up
+ */
+static void checkLoad() {
+   // Values retained in FlexRAM from before reset
+   *(volatile int *)&count        = 1234;
+   *(volatile uint16_t *)&limit   = 250;
+   *(volatile uint8_t *)&mode     = 3;
+   memcpy((void *)&name, "Oven", 5);
+   memset((void *)&offsets, 0, sizeof(offsets));
+
+   NonvolatileShadow::load();
+
+   CHECK(count == 1234);
+   CHECK(limit == 250);
+   CHECK(mode  == 3);
+   CHECK(memcmp((const uint8_t *)name, "Oven", 5) == 0);
+   CHECK(name[3] == 'n');
+}
+
+/**
+ * Check writes outside a transaction
+ */
+static void checkWrites() {
+   NonvolatileShadow::resetStatistics();
+
+   count = 42;
+   CHECK(count == 42);
+   CHECK(inFlexRam(count) == 42);
+
+   // Bytes sharing a word are written individually
+   flags = 0x81;
+   CHECK(inFlexRam(flags) == 0x81);
+   CHECK(inFlexRam(mode)  == 3);
+
+   count += 8;
+   CHECK(inFlexRam(count) == 50);
+
+   NonvolatileStatistics statistics;
+   NonvolatileShadow::getStatistics(statistics);
+   CHECK(statistics.writes       == 3);
+   CHECK(statistics.bytesWritten == 4+1+4);
+   CHECK(statistics.commits      == 0);
+
+   // Unchanged values are not written
+   count = 50;
+   flags = 0x81;
+   NonvolatileShadow::getStatistics(statistics);
+   CHECK(statistics.writes    == 3);
+   CHECK(statistics.unchanged == 2);
+}
+
+/**
+ * Check changes in a transaction are written when committed
+ */
+static void checkTransactions() {
+   NonvolatileShadow::resetStatistics();
+   {
+      NonvolatileTransaction transaction;
+      limit = 260;
+      mode  = 4;
+      {
+         // Nested transaction commits with the outer one
+         NonvolatileTransaction nested;
+         offsets.set(1, -5);
+         offsets.set(2, 7);
+      }
+      CHECK(limit == 260);
+      CHECK(offsets[1] == -5);
+      CHECK(inFlexRam(limit) == 250);
+      CHECK(inFlexRam(mode)  == 3);
+      CHECK(inFlexRam(offsets, 1) == 0);
+      CHECK(getWrites() == 0);
+   }
+   CHECK(inFlexRam(limit) == 260);
+   CHECK(inFlexRam(mode)  == 4);
+   CHECK(inFlexRam(offsets, 1) == -5);
+   CHECK(inFlexRam(offsets, 2) == 7);
+
+   // limit and mode share a word, offsets[1] and offsets[2] a word each
+   NonvolatileStatistics statistics;
+   NonvolatileShadow::getStatistics(statistics);
+   CHECK(statistics.writes  == 3);
+   CHECK(statistics.commits == 1);
+
+   // Changes that are reverted within the transaction are not written
+   NonvolatileShadow::beginTransaction();
+   count  = 99;
+   count  = 50;
+   limit  = 1;
+   limit  = 260;
+   CHECK(NonvolatileShadow::commitTransaction() == 0);
+
+   // Whole array is written as one transaction
+   NonvolatileShadow::resetStatistics();
+   name.set((uint8_t)'x');
+   NonvolatileShadow::getStatistics(statistics);
+   CHECK(statistics.commits == 1);
+   CHECK(statistics.writes  == 3);
+   for (int index=0; index<10; index++) {
+      CHECK(inFlexRam(name, index) == 'x');
+   }
+   static const uint8_t newName[10] = "Reflow";
+   name = newName;
+   CHECK(memcmp((const uint8_t *)name, newName, sizeof(newName)) == 0);
+   CHECK(inFlexRam(name, 9) == 0);
+}
+
+/** Progress of the threads changing variables while a transaction is open */
+static volatile bool     writerDone       = false;
+static volatile bool     transactionDone  = false;
+static volatile unsigned committedWords   = ~0U;
+
+/**
+ * Writes a variable while another thread has a transaction open
+ */
+static void writerThreadFunction(const void *) {
+   count = 77;
+   writerDone = true;
+   for(;;) {
+      osDelay(osWaitForever);
+   }
+}
+
+/**
+ * Opens a transaction while another thread has a transaction open
+ */
+static void transactionThreadFunction(const void *) {
+   NonvolatileShadow::beginTransaction();
+   offsets.set(3, 33);
+   committedWords  = NonvolatileShadow::commitTransaction();
+   transactionDone = true;
+   for(;;) {
+      osDelay(osWaitForever);
+   }
+}
+
+static CMSIS::Thread writerThread{writerThreadFunction, osPriorityHigh, 1000};
+static CMSIS::Thread transactionThread{transactionThreadFunction, osPriorityAboveNormal, 1000};
+
+/**
+ * Check a transaction only includes changes made by the thread that opened it
+ */
+static void checkThreads() {
+   NonvolatileShadow::resetStatistics();
+   unsigned written;
+   {
+      NonvolatileTransaction transaction;
+      limit = 300;
+
+      // Higher priority threads change variables while the transaction is open
+      writerThread.run();
+      transactionThread.run();
+      osDelay(10);
+
+      // They wait for the transaction
+      CHECK(!writerDone);
+      CHECK(!transactionDone);
+      CHECK(count == 50);
+      CHECK(offsets[3] == 0);
+      CHECK(inFlexRam(count) == 50);
+
+      NonvolatileShadow::beginTransaction();
+      mode = 5;
+      written = NonvolatileShadow::commitTransaction();
+      CHECK(written == 0);
+      CHECK(inFlexRam(limit) == 260);
+   }
+   osDelay(10);
+   CHECK(writerDone);
+   CHECK(transactionDone);
+
+   // Each change was written by the thread making it
+   CHECK(inFlexRam(limit) == 300);
+   CHECK(inFlexRam(mode)  == 5);
+   CHECK(inFlexRam(count) == 77);
+   CHECK(inFlexRam(offsets, 3) == 33);
+   CHECK(committedWords == 1);
+
+   NonvolatileStatistics statistics;
+   NonvolatileShadow::getStatistics(statistics);
+   CHECK(statistics.commits == 2);
+   CHECK(statistics.writes  == 3);
+}
+
+/**
+ * Get number of writes to variable
+ *
+ * @param[in]  variable      Variable
+ * @param[out] maxWordWrites Most writes to a word occupied by the variable
+ */
+template<typename T>
+static uint32_t getWriteCount(const T &variable, unsigned &maxWordWrites) {
+   return NonvolatileShadow::getWriteCount(&variable, sizeof(variable), maxWordWrites);
+}
+
+/**
+ * Check writes are counted for each variable rather than each FlexRAM word
+ */
+static void checkWriteCounters() {
+   static NonvolatileWriteCounter counters[] = {
+         {&limit, sizeof(limit), 0},
+         {&mode,  sizeof(mode),  0},
+         {&flags, sizeof(flags), 0},
+         {&name,  sizeof(name),  0},
+   };
+   NonvolatileShadow::setWriteCounters(counters, sizeof(counters)/sizeof(counters[0]));
+   NonvolatileShadow::resetStatistics();
+
+   // Writes to bytes sharing a word
+   flags = 1;
+   flags = 2;
+   flags = 3;
+   mode  = 9;
+   unsigned maxWordWrites;
+   CHECK(getWriteCount(flags, maxWordWrites) == 3);
+   CHECK(maxWordWrites == 4);
+   CHECK(getWriteCount(mode,  maxWordWrites) == 1);
+   CHECK(maxWordWrites == 4);
+   CHECK(getWriteCount(limit, maxWordWrites) == 0);
+   CHECK(maxWordWrites == 4);
+
+   // Committed word is counted for the variables that changed
+   {
+      NonvolatileTransaction transaction;
+      mode  = 10;
+      flags = 3;
+   }
+   CHECK(getWriteCount(mode,  maxWordWrites) == 2);
+   CHECK(getWriteCount(flags, maxWordWrites) == 3);
+   {
+      NonvolatileTransaction transaction;
+      limit = 400;
+      flags = 4;
+   }
+   CHECK(getWriteCount(limit, maxWordWrites) == 1);
+   CHECK(getWriteCount(flags, maxWordWrites) == 4);
+   CHECK(getWriteCount(mode,  maxWordWrites) == 2);
+   CHECK(maxWordWrites == 6);
+
+   // Array counts element writes and committed words
+   name.set(1, (uint8_t)'E');
+   static const uint8_t newName[10] = "Reflow";
+   name = newName;
+   CHECK(getWriteCount(name, maxWordWrites) == 2);
+   CHECK(maxWordWrites == 2);
+
+   // Variables without a counter
+   CHECK(getWriteCount(count, maxWordWrites) == 0);
+
+   NonvolatileShadow::resetStatistics();
+   CHECK(getWriteCount(flags, maxWordWrites) == 0);
+   CHECK(maxWordWrites == 0);
+}
+
+int main() {
+   checkLoad();
+   checkWrites();
+   checkTransactions();
+   checkThreads();
+   checkWriteCounters();
+
+   return HostTest::report("nonvolatileShadowTest");
+}
@@ -0,0 +1,249 @@
+/**
+ * @file    ovenSimulator.cpp
+ * @brief   Runs a complete reflow profile on the host against the oven model
+ *
+ * The firmware is built with OVEN_SIMULATION so the thermocouple readings are generated
+ * by OvenModel from the heater and fan duty-cycles. Everything else is the firmware
+ * running on the HAL stand-ins in stubs/:
+ *  - CMSIS-RTOS threads, timers and queues on the virtual-time kernel
+ *  - SPI shared by the LCD transport and thermocouples
+ *  - Mains zero-crossings (CMP0) driving the heater and fan GPIOs through ZeroCrossingPwm
+ *  - Flash and non-volatile settings (a new device i.e. factory defaults)
+ *
+ * The profile is started and monitored over the remote (USB CDC) command interface as
+ * the PC application would. The run takes several minutes of virtual time but only a
+ * fraction of that in real time. A further run ends while the host has stopped reading
+ * the points of an archived run to check the control loop is not held up.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "configure.h"
+#include "controlLoop.h"
+#include "ovenModel.h"
+#include "RemoteInterface.h"
+#include "rtc.h"
+#include "runArchive.h"
+
+using namespace USBDM;
+
+/** Command interface as seen by the USB end-points */
+class RemoteHost : public RemoteInterface {
+
+public:
+   static void initialise() {
+      RemoteInterface::initialise();
+   }
+
+   /**
+    * Send command and collect the response as the USB host would
+    *
+    * @param[in] command Command to send (without terminator)
+    *
+    * @return Response with terminator removed
+    */
+   static std::string transact(const char *command) {
+      sendCommand(command);
+      return receive();
+   }
+
+   /**
+    * Send command as the USB host would
+    *
+    * @param[in] command Command to send (without terminator)
+    */
+   static void sendCommand(const char *command) {
+      std::string line(command);
+      line += '\n';
+      putData(line.size(), (const uint8_t *)line.data());
+   }
+
+   /**
+    * Collect the response to a command as the USB host would
+    *
+    * @return Response with terminator removed
+    */
+   static std::string receive() {
+      std::string response;
+      for(;;) {
+         uint8_t  packet[64];
+         unsigned size = getTxData(packet, sizeof(packet));
+         response.append((const char *)packet, size);
+         if ((response.size()>=2) && (response.compare(response.size()-2, 2, "\n\r") == 0)) {
+            break;
+         }
+         // Next USB IN transaction
+         osDelay(1);
+      }
+      return response.substr(0, response.size()-2);
+   }
+};
+
+/**
+ * Initialise as done by main()
+ */
+static void initialise() {
+   Rtc::initialise();
+   Buzzer::init();
+   OvenFanLed::init();
+   HeaterLed::init();
+   Spare::enable();
+   Spare::setDutyCycle(0);
+   temperatureSensors.initialise();
+   ControlLoop::initialise();
+   RunProfile::initialise();
+   lcd.startTransport();
+   RemoteHost::initialise();
+}
+
+int main() {
+   auto wallStart = std::chrono::steady_clock::now();
+
+   initialise();
+
+   // Let the sampler and filters settle
+   osDelay(2000);
+
+   const NvSolderProfile &profile = profiles[currentProfileIndex];
+   printf("Profile: %s (soak %d-%dC, peak %dC)\n",
+         (const char *)profile.description, (int)profile.soakTemp1, (int)profile.soakTemp2, (int)profile.peakTemp);
+
+   CHECK(RemoteHost::transact("IDN?").find("SMT-Oven") != std::string::npos);
+   CHECK(RemoteHost::transact("RUN") == "OK");
+
+   // States in the order first entered
+   State    states[20];
+   unsigned stateCount = 0;
+
+   float    peakTemperature   = -INFINITY;
+   unsigned heaterSamples     = 0;
+   unsigned heaterOnSamples   = 0;
+   double   heaterDutySum     = 0;
+   uint64_t startTime         = HostKernel::getTime();
+   uint64_t lastQuery         = startTime;
+   std::string result;
+
+   // Sample the oven between mains zero-crossings and query the run each second
+   for(;;) {
+      osDelay(5);
+      State state = RunProfile::remoteCheckRunProfile();
+      if ((stateCount == 0) || (states[stateCount-1] != state)) {
+         if (stateCount < sizeof(states)/sizeof(states[0])) {
+            states[stateCount++] = state;
+         }
+      }
+      if (OvenModel::getOvenTemperature()>peakTemperature) {
+         peakTemperature = OvenModel::getOvenTemperature();
+      }
+      heaterSamples++;
+      heaterOnSamples += Heater::readState()?1:0;
+      heaterDutySum   += ovenControl.getHeaterDutycycle();
+
+      if ((HostKernel::getTime()-lastQuery) >= 1000000) {
+         lastQuery = HostKernel::getTime();
+         result = RemoteHost::transact("RUN?");
+         if (result != "Running") {
+            break;
+         }
+      }
+      if ((HostKernel::getTime()-startTime) > 1800*1000000ULL) {
+         result = "Timeout";
+         break;
+      }
+   }
+   double virtualTime = (HostKernel::getTime()-startTime)/1E6;
+
+   printf("Result: %s after %.0f s\nStates:", result.c_str(), virtualTime);
+   for (unsigned index=0; index<stateCount; index++) {
+      printf(" %s", Reporter::getStateName(states[index]));
+   }
+   printf("\nPeak oven temperature %.1fC\n", peakTemperature);
+
+   CHECK(result == "OK");
+   // s_init may be passed within a single control loop tick so is not required
+   static const State expected[] = {s_preheat, s_soak, s_ramp_up, s_dwell, s_ramp_down, s_complete};
+   unsigned expectedCount = sizeof(expected)/sizeof(expected[0]);
+   unsigned matched = 0;
+   bool sequenceOk = true;
+   for (unsigned index=0; index<stateCount; index++) {
+      if ((states[index] == s_off) || (states[index] == s_init)) {
+         continue;
+      }
+      sequenceOk = sequenceOk && (matched<expectedCount) && (states[index] == expected[matched]);
+      matched++;
+   }
+   CHECK(sequenceOk);
+   CHECK(matched == expectedCount);
+   CHECK(states[stateCount-1] == s_complete);
+   CHECK(peakTemperature >= profile.peakTemp-5);
+   CHECK(peakTemperature <= profile.peakTemp+15);
+
+   // The heater output driven at mains zero-crossings follows the requested duty-cycle
+   double heaterOnFraction = (double)heaterOnSamples/heaterSamples;
+   double heaterDuty       = heaterDutySum/(100.0*heaterSamples);
+   printf("Heater: duty-cycle %.3f, output on %.3f of samples\n", heaterDuty, heaterOnFraction);
+   CHECK(heaterDuty > 0.05);
+   CHECK(fabs(heaterOnFraction-heaterDuty) < 0.02);
+
+   // Run is archived and metrics are available
+   std::string runs = RemoteHost::transact("RUNS?");
+   std::string metrics = RemoteHost::transact("METRICS?");
+   printf("RUNS?    -> %s\nMETRICS? -> %s\n", runs.c_str(), metrics.c_str());
+   CHECK(runs.compare(0, 2, "1,") == 0);
+   CHECK(runs.find(",complete,") != std::string::npos);
+   CHECK(metrics.compare(0, 6, "Failed") != 0);
+
+   // Aborted run is archived as failed without being queried
+   CHECK(RemoteHost::transact("RUN") == "OK");
+   osDelay(30000);
+   CHECK(RemoteHost::transact("ABORT") == "OK");
+   runs = RemoteHost::transact("RUNS?");
+   printf("RUNS?    -> %s\n", runs.c_str());
+   CHECK(runs.compare(0, 2, "2,") == 0);
+   CHECK(runs.find(",fail,") != std::string::npos);
+
+   // Host stops reading the points of a run while the next run ends
+   CHECK(RemoteHost::transact("RUN") == "OK");
+   uint32_t ticks = ControlLoop::getTickCount();
+   osDelay(10000);
+   uint32_t runningTicks = ControlLoop::getTickCount()-ticks;
+   RemoteHost::sendCommand("RUNS? 1");
+   startTime = HostKernel::getTime();
+   State state;
+   do {
+      osDelay(1000);
+      state = RunProfile::remoteCheckRunProfile();
+   } while ((state != s_complete) && (state != s_fail) && ((HostKernel::getTime()-startTime) < 1800*1000000ULL));
+   CHECK(state == s_complete);
+
+   // Control loop continues while the response is stalled
+   ticks = ControlLoop::getTickCount();
+   osDelay(10000);
+   uint32_t stalledTicks = ControlLoop::getTickCount()-ticks;
+   printf("Control loop ticks in 10 s: running %u, response stalled %u\n", runningTicks, stalledTicks);
+   CHECK(stalledTicks >= runningTicks-1);
+
+   // Response completes once the host resumes and the run is archived
+   std::string points = RemoteHost::receive();
+   RunSummary summary;
+   bool       valid;
+   CHECK(runArchive.findSummary(1, summary, valid));
+   CHECK(std::count(points.begin(), points.end(), ';') == summary.points+2);
+   runs = RemoteHost::transact("RUNS?");
+   printf("RUNS?    -> %s\n", runs.c_str());
+   CHECK(runs.compare(0, 2, "3,") == 0);
+
+   double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now()-wallStart).count();
+   printf("Virtual time %.0f s, wall-clock time %.2f s (x%.0f)\n",
+         HostKernel::getTime()/1E6, wallTime, HostKernel::getTime()/1E6/wallTime);
+   CHECK(wallTime*10 < virtualTime);
+
+   return HostTest::report("ovenSimulator");
+}
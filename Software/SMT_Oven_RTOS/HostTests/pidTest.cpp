@@ -0,0 +1,192 @@
+/**
+ * @file    pidTest.cpp
+ * @brief   Equivalence of the Pid_T numeric policies
+ *
+ * Each policy is run over the same input trajectories and the outputs are compared
+ * with the double precision controller (the original implementation):
+ *  - Open loop: identical recorded input sequence for every policy
+ *  - Closed loop: controller driving a first order oven model through a reflow profile
+ *  - Saturation: errors and terms beyond the Q16.16 range clamp rather than wrap
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <vector>
+#include "hostTest.h"
+#include "pid.h"
+
+/** Control interval as used by the oven (s) */
+static constexpr float INTERVAL = 0.25f;
+
+/** Oven PID defaults (settings.cpp) */
+static constexpr float KP = 20.0f;
+static constexpr float KI = 0.016f;
+static constexpr float KD = 62.5f;
+
+static float input = 25.0f;
+
+static float getInput() {
+   return input;
+}
+static void setOutput(float) {
+}
+
+/**
+ * Simple oven - first order lag with heater power proportional to output
+ */
+struct OvenModel {
+   float temperature = 25.0f;
+
+   void step(float output) {
+      float power = fmaxf(output, 0.0f);
+      temperature += INTERVAL*(power*0.04f - (temperature-25.0f)*0.008f);
+   }
+};
+
+/**
+ * Setpoint of a reflow-like profile
+ */
+static float profile(unsigned tick) {
+   float time = tick*INTERVAL;
+   if (time < 90) {
+      return 25+time*1.4f;
+   }
+   if (time < 180) {
+      return 150+(time-90)*0.3f;
+   }
+   if (time < 240) {
+      return 177+(time-180)*0.8f;
+   }
+   return 60;
+}
+
+/**
+ * Run controller open loop over a fixed input sequence
+ */
+template<typename Numeric>
+static std::vector<float> runOpenLoop(const std::vector<float> &inputs, float setpoint) {
+   Pid_T<getInput, setOutput, Numeric> pid(KP, KI, KD, INTERVAL, -100, 100);
+   input = inputs[0];
+   pid.setSetpoint(setpoint);
+   pid.enable();
+   std::vector<float> outputs;
+   for (float value:inputs) {
+      pid.update(value);
+      outputs.push_back(pid.getOutput());
+   }
+   return outputs;
+}
+
+/**
+ * Run controller closed loop with oven model
+ */
+template<typename Numeric>
+static std::vector<float> runClosedLoop(unsigned ticks) {
+   Pid_T<getInput, setOutput, Numeric> pid(KP, KI, KD, INTERVAL, 0, 100);
+   OvenModel oven;
+   input = oven.temperature;
+   pid.setSetpoint(profile(0));
+   pid.enable();
+   std::vector<float> temperatures;
+   for (unsigned tick=0; tick<ticks; tick++) {
+      pid.setSetpoint(profile(tick));
+      pid.update(oven.temperature);
+      oven.step(pid.getOutput());
+      temperatures.push_back(oven.temperature);
+   }
+   return temperatures;
+}
+
+static float maxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+   float difference = 0;
+   for (unsigned index=0; index<a.size(); index++) {
+      difference = fmaxf(difference, fabsf(a[index]-b[index]));
+   }
+   return difference;
+}
+
+/**
+ * Check a policy against double
+ *
+ * @param[in] name               Name of policy
+ * @param[in] openLoopTolerance  Allowed output difference (% of output range)
+ * @param[in] closedLoopTolerance Allowed temperature difference (C)
+ */
+template<typename Numeric>
+static void checkPolicy(const char *name, float openLoopTolerance, float closedLoopTolerance) {
+   // Noisy input wandering about the setpoint so the output is mostly not clamped
+   std::vector<float> inputs;
+   for (unsigned tick=0; tick<2000; tick++) {
+      inputs.push_back(200+1.0f*sinf(tick*0.05f)+0.1f*sinf(tick*0.7f));
+   }
+   std::vector<float> reference = runOpenLoop<PidDouble>(inputs, 200);
+   unsigned unclamped = 0;
+   for (float output:reference) {
+      if (fabsf(output)<100) {
+         unclamped++;
+      }
+   }
+   CHECK(unclamped > reference.size()/2);
+   float openLoop = maxDifference(runOpenLoop<Numeric>(inputs, 200), reference);
+
+   unsigned ticks = 300/INTERVAL;
+   float closedLoop = maxDifference(runClosedLoop<Numeric>(ticks), runClosedLoop<PidDouble>(ticks));
+
+   printf("%-9s open loop max output difference = %.5f%%, closed loop max temperature difference = %.5f C\n",
+         name, openLoop, closedLoop);
+   CHECK(openLoop <= openLoopTolerance);
+   CHECK(closedLoop <= closedLoopTolerance);
+}
+
+/**
+ * Check clamping when values exceed the fixed point range
+ */
+template<typename Numeric>
+static void checkSaturation(const char *name) {
+   Pid_T<getInput, setOutput, Numeric> pid(KP, KI, KD, INTERVAL, -100, 100);
+
+   // Error (60000) exceeds Q16.16 range - must clamp to positive full scale
+   input = -30000;
+   pid.setSetpoint(30000);
+   pid.enable();
+   pid.update(-30000);
+   CHECK(pid.getOutput() == 100);
+   CHECK(pid.getError() > 0);
+
+   // Large negative derivative kick - must clamp to negative full scale
+   pid.setSetpoint(0);
+   pid.update(30000);
+   CHECK(pid.getOutput() == -100);
+
+   // Integral stays clamped (anti-windup) and recovers at once when the error reverses
+   for (unsigned count=0; count<100; count++) {
+      pid.update(-30000);
+   }
+   pid.setSetpoint(-30000);
+   pid.update(-29999);
+   float output = pid.getOutput();
+   CHECK(output >= -100 && output <= 100);
+   printf("%-9s saturation checked\n", name);
+}
+
+int main() {
+   checkPolicy<PidDouble>("PidDouble", 0.0f,   0.0f);
+   checkPolicy<PidFloat> ("PidFloat",  0.01f,  0.01f);
+   checkPolicy<PidFixed> ("PidFixed",  0.5f,   0.5f);
+
+   checkSaturation<PidDouble>("PidDouble");
+   checkSaturation<PidFloat> ("PidFloat");
+   checkSaturation<PidFixed> ("PidFixed");
+
+   // Saturating arithmetic of fixed point policy
+   CHECK(PidFixed::add(INT32_MAX, 1) == INT32_MAX);
+   CHECK(PidFixed::add(INT32_MIN, -1) == INT32_MIN);
+   CHECK(PidFixed::subtract(INT32_MIN, 1) == INT32_MIN);
+   CHECK(PidFixed::subtract(INT32_MAX, -1) == INT32_MAX);
+   CHECK(PidFixed::subtract(PidFixed::fromFloat(1.5f), PidFixed::fromFloat(0.25f)) == PidFixed::fromFloat(1.25f));
+   CHECK(PidFixed::multiply(PidFixed::fromFloat(30000), PidFixed::fromFloat(20)) == INT32_MAX);
+   CHECK(PidFixed::fromFloat(NAN) == 0);
+
+   return HostTest::report("pidTest");
+}
@@ -0,0 +1,278 @@
+/**
+ * @file    reflowMetricsTest.cpp
+ * @brief   Host test of the incremental reflow metrics against a batch calculation
+ *
+ * Runs resembling a reflow profile are generated with noisy thermocouples, thermocouples
+ * dropping out, missing samples and repeated times. After every sample the metrics
+ * accumulated by ReflowMetrics are compared with a calculation over the whole run so far.
+ * The following are also checked:
+ *  - Time above liquidus and soak time follow sample times rather than sample counts
+ *  - reset() discards accumulated values but keeps the liquidus
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <random>
+#include <vector>
+#include "hostTest.h"
+#include "reflowMetrics.h"
+
+/** Sample as added to the metrics */
+struct Sample {
+   int       time;
+   DataPoint point;
+};
+
+/**
+ * Calculate metrics over a complete run
+ *
+ * @param[in] samples  Samples in order added
+ * @param[in] count    Number of samples to use
+ * @param[in] liquidus Liquidus temperature
+ *
+ * @return Metric values
+ */
+static ReflowMetrics::Values batchMetrics(const std::vector<Sample> &samples, unsigned count, float liquidus) {
+   ReflowMetrics::Values values{};
+   values.liquidus        = liquidus;
+   values.peakTemperature = NAN;
+   for (float &peak:values.thermocouplePeaks) {
+      peak = NAN;
+   }
+   // Samples accepted - later than preceding sample and with an oven temperature
+   std::vector<int>   times;
+   std::vector<float> averages;
+   int lastTime = -1;
+   for (unsigned index=0; index<count; index++) {
+      const Sample &sample = samples[index];
+      if (sample.time<=lastTime) {
+         continue;
+      }
+      lastTime = sample.time;
+      float average = sample.point.getAverageTemperature();
+      if (isnan(average)) {
+         continue;
+      }
+      float minimum = INFINITY;
+      float maximum = -INFINITY;
+      for (unsigned tc=0; tc<DataPoint::NUM_THERMOCOUPLES; tc++) {
+         float temperature;
+         if (sample.point.getTemperature(tc, temperature) == Max31855::TH_ENABLED) {
+            values.thermocouplePeaks[tc] = isnan(values.thermocouplePeaks[tc])?temperature:fmaxf(values.thermocouplePeaks[tc], temperature);
+            minimum = fminf(minimum, temperature);
+            maximum = fmaxf(maximum, temperature);
+         }
+      }
+      values.maxSpread = fmaxf(values.maxSpread, maximum-minimum);
+      if (isnan(values.peakTemperature) || (average>values.peakTemperature)) {
+         values.peakTemperature = average;
+         values.peakTime        = sample.time;
+      }
+      if (!times.empty()) {
+         if (average>=liquidus) {
+            values.timeAboveLiquidus += sample.time-times.back();
+         }
+         if (sample.point.getState() == s_soak) {
+            values.soakTime += sample.time-times.back();
+         }
+      }
+      times.push_back(sample.time);
+      averages.push_back(average);
+   }
+   values.samples = times.size();
+   for (unsigned index=ReflowMetrics::SLOPE_INTERVAL; index<times.size(); index++) {
+      unsigned earlier = index-ReflowMetrics::SLOPE_INTERVAL;
+      float slope = (averages[index]-averages[earlier])/(times[index]-times[earlier]);
+      values.maxRiseSlope = fmaxf(values.maxRiseSlope, slope);
+      values.maxFallSlope = fminf(values.maxFallSlope, slope);
+   }
+   return values;
+}
+
+/**
+ * Check floats agree (both may be NAN)
+ */
+static bool same(float a, float b) {
+   return (isnan(a) && isnan(b)) || (fabsf(a-b) <= 1E-4f*fmaxf(1.0f, fabsf(b)));
+}
+
+/**
+ * Check metric values agree
+ */
+static bool same(const ReflowMetrics::Values &a, const ReflowMetrics::Values &b) {
+   bool ok = (a.samples == b.samples) && same(a.liquidus, b.liquidus) &&
+         same(a.peakTemperature, b.peakTemperature) && (a.peakTime == b.peakTime) &&
+         (a.timeAboveLiquidus == b.timeAboveLiquidus) && (a.soakTime == b.soakTime) &&
+         same(a.maxRiseSlope, b.maxRiseSlope) && same(a.maxFallSlope, b.maxFallSlope) &&
+         same(a.maxSpread, b.maxSpread) && same(a.getPeakSpread(), b.getPeakSpread());
+   for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+      ok = ok && same(a.thermocouplePeaks[index], b.thermocouplePeaks[index]);
+   }
+   return ok;
+}
+
+/**
+ * Create data point
+ *
+ * @param[in] state       Profile state
+ * @param[in] temperature Temperature of all active thermocouples
+ * @param[in] active      Mask of active thermocouples
+ */
+static DataPoint makePoint(State state, float temperature, unsigned active=0b1111) {
+   DataPoint point;
+   point.setState(state);
+   for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+      point.setTemperature(index, temperature);
+      point.setStatus(index, (active&(1<<index))?Max31855::TH_ENABLED:Max31855::TH_OPEN);
+   }
+   return point;
+}
+
+/**
+ * Generate a run resembling a reflow profile
+ *
+ * @param[in] seed Seed for random variations
+ *
+ * @return Samples in order added
+ */
+static std::vector<Sample> makeRun(unsigned seed) {
+   std::mt19937 random(seed);
+   std::uniform_real_distribution<float> noise(-1.5f, 1.5f);
+   std::uniform_int_distribution<int>    percent(0, 99);
+   std::uniform_int_distribution<int>    gap(2, 8);
+
+   std::vector<Sample> samples;
+   int time = 0;
+   while (time<400) {
+      // Preheat 0-90s, soak 90-180s, ramp-up 180-240s, dwell 240-260s, ramp-down after
+      State state;
+      float temperature;
+      if (time<90) {
+         state = s_preheat;   temperature = 25+time*(150-25)/90.0f;
+      }
+      else if (time<180) {
+         state = s_soak;      temperature = 150+(time-90)*(180-150)/90.0f;
+      }
+      else if (time<240) {
+         state = s_ramp_up;   temperature = 180+(time-180)*(225-180)/60.0f;
+      }
+      else if (time<260) {
+         state = s_dwell;     temperature = 225;
+      }
+      else {
+         state = s_ramp_down; temperature = fmaxf(40, 225-(time-260)*1.5f);
+      }
+      Sample sample;
+      sample.time = time;
+      sample.point.setState(state);
+      for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+         // Thermocouples are placed at different points in the oven
+         sample.point.setTemperature(index, temperature+2.0f*index+noise(random));
+         sample.point.setStatus(index, (percent(random)<10)?Max31855::TH_OPEN:Max31855::TH_ENABLED);
+      }
+      if (percent(random)<3) {
+         // No active thermocouples
+         for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+            sample.point.setStatus(index, Max31855::TH_SHORT_GND);
+         }
+      }
+      samples.push_back(sample);
+      if (percent(random)<3) {
+         // Repeated or earlier time - ignored
+         Sample repeated = sample;
+         repeated.time -= percent(random)%3;
+         repeated.point.setTemperature(0, 500);
+         samples.push_back(repeated);
+      }
+      // Usually a sample each second but occasionally missed
+      time += (percent(random)<5)?gap(random):1;
+   }
+   return samples;
+}
+
+/**
+ * Check the incremental metrics agree with a batch calculation after every sample
+ */
+static void checkAgainstBatch() {
+   unsigned runs       = 0;
+   unsigned mismatches = 0;
+   for (unsigned seed=1; seed<=50; seed++) {
+      std::vector<Sample> samples = makeRun(seed);
+      float liquidus = (seed&1)?183:217;
+
+      ReflowMetrics metrics(liquidus);
+      for (unsigned count=1; count<=samples.size(); count++) {
+         metrics.addPoint(samples[count-1].time, samples[count-1].point);
+         if (!same(metrics.getValues(), batchMetrics(samples, count, liquidus))) {
+            if (mismatches++ == 0) {
+               fprintf(stderr, "First mismatch: seed %u, sample %u\n", seed, count);
+            }
+         }
+      }
+      // Results of the run are independent of prior use
+      metrics.reset();
+      for (const Sample &sample:samples) {
+         metrics.addPoint(sample.time, sample.point);
+      }
+      if (!same(metrics.getValues(), batchMetrics(samples, samples.size(), liquidus))) {
+         mismatches++;
+      }
+      runs++;
+   }
+   std::vector<Sample> samples = makeRun(1);
+   ReflowMetrics::Values values = batchMetrics(samples, samples.size(), 183);
+   printf("Run: %u samples, peak %.1fC at %ds, %us above %.0fC, soak %us, slope +%.2f/%.2fC/s, spread %.1fC\n",
+         values.samples, values.peakTemperature, values.peakTime, values.timeAboveLiquidus, values.liquidus,
+         values.soakTime, values.maxRiseSlope, values.maxFallSlope, values.maxSpread);
+   CHECK(runs == 50);
+   CHECK(mismatches == 0);
+}
+
+/**
+ * Check times follow sample times
+ */
+static void checkTimes() {
+   ReflowMetrics metrics(183);
+
+   // Regular samples - above liquidus from 100s to 160s inclusive
+   for (int time=0; time<200; time++) {
+      metrics.addPoint(time, makePoint(((time>=20)&&(time<80))?s_soak:s_preheat, ((time>=100)&&(time<=160))?200:100));
+   }
+   CHECK(metrics.getValues().samples == 200);
+   CHECK(metrics.getValues().timeAboveLiquidus == 61);
+   CHECK(metrics.getValues().soakTime == 60);
+
+   // Missing samples are included in the time of the following sample
+   metrics.reset();
+   CHECK(metrics.getValues().liquidus == 183);
+   CHECK(metrics.getValues().samples == 0);
+   CHECK(isnan(metrics.getValues().peakTemperature));
+   metrics.addPoint(10, makePoint(s_soak, 150));
+   CHECK(metrics.getValues().soakTime == 0);
+   metrics.addPoint(11, makePoint(s_soak, 190));
+   metrics.addPoint(20, makePoint(s_soak, 190));
+   CHECK(metrics.getValues().soakTime == 10);
+   CHECK(metrics.getValues().timeAboveLiquidus == 10);
+
+   // Samples without an active thermocouple do not end the interval
+   metrics.addPoint(25, makePoint(s_soak, 190, 0));
+   metrics.addPoint(30, makePoint(s_soak, 190));
+   CHECK(metrics.getValues().samples == 4);
+   CHECK(metrics.getValues().soakTime == 20);
+   CHECK(metrics.getValues().timeAboveLiquidus == 20);
+
+   // Samples that are not later are ignored
+   metrics.addPoint(30, makePoint(s_soak, 300));
+   metrics.addPoint(29, makePoint(s_soak, 300));
+   CHECK(metrics.getValues().samples == 4);
+   CHECK(metrics.getValues().peakTemperature == 190);
+   CHECK(metrics.getValues().peakTime == 11);
+}
+
+int main() {
+   checkAgainstBatch();
+   checkTimes();
+
+   return HostTest::report("reflowMetricsTest");
+}
@@ -0,0 +1,294 @@
+/**
+ * @file    remoteCommandBench.cpp
+ * @brief   Host test and benchmark of remote command lookup and the Tokenizer
+ *
+ * The following are checked over the remote command set:
+ *  - Every keyword is found by the compile-time perfect hash in any case
+ *  - Prefixes, extensions and other words are rejected exactly as a linear search would
+ *  - Tokenizer parses typical command lines and rejects malformed fields
+ *  - Commands are dispatched through doCommand() as received from the USB end-point
+ * Host time per lookup is reported for the hash and for a linear search of the table,
+ * and for tokenizing a typical command line.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <string.h>
+#include <strings.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "hostTest.h"
+#include "keywordHash.h"
+#include "tokenizer.h"
+#include "RemoteInterface.h"
+
+using Clock = std::chrono::steady_clock;
+
+/** Command interface as seen by the USB end-points */
+class RemoteHost : public RemoteInterface {
+
+public:
+   using RemoteInterface::findCommand;
+   using RemoteInterface::getCommandKeyword;
+
+   static void initialise() {
+      RemoteInterface::initialise();
+   }
+
+   /**
+    * Send command and collect the response as the USB host would
+    *
+    * @param[in] command Command to send (without terminator)
+    *
+    * @return Response with terminator removed
+    */
+   static std::string transact(const char *command) {
+      std::string line(command);
+      line += '\n';
+      putData(line.size(), (const uint8_t *)line.data());
+
+      std::string response;
+      for(;;) {
+         uint8_t  packet[64];
+         unsigned size = getTxData(packet, sizeof(packet));
+         response.append((const char *)packet, size);
+         if ((response.size()>=2) && (response.compare(response.size()-2, 2, "\n\r") == 0)) {
+            break;
+         }
+         // Next USB IN transaction
+         osDelay(1);
+      }
+      return response.substr(0, response.size()-2);
+   }
+};
+
+/** Command keywords in table order */
+static std::vector<std::string> keywords;
+
+/**
+ * Locate keyword by linear search as the reference
+ *
+ * @return Index of keyword or -1 if not found
+ */
+static int linearFind(const char *keyword, unsigned length) {
+   for (unsigned index=0; index<keywords.size(); index++) {
+      if ((keywords[index].size() == length) && (strncasecmp(keywords[index].c_str(), keyword, length) == 0) &&
+            (memchr(keyword, '\0', length) == nullptr)) {
+         return index;
+      }
+   }
+   return -1;
+}
+
+/** Keyword set larger than the command set to check the seed search is general */
+struct TestKeywords {
+   static constexpr const char *names[] = {
+      "A","B","C","D","E","F","G","H","I","J","K","L","M","N","O","P","Q","R","S","T",
+      "AA","AB","AC","AD","AE","AF","AG","AH","AI","AJ","AK","AL","AM","AN","AO","AP","AQ","AR","AS","AT",
+   };
+   static constexpr unsigned count = sizeof(names)/sizeof(names[0]);
+   static constexpr const char *keyword(unsigned index) {
+      return names[index];
+   }
+};
+
+/**
+ * Check lookup of every keyword and of words that are near to keywords
+ */
+static void checkLookup() {
+   for (unsigned index=0; index<keywords.size(); index++) {
+      std::string keyword = keywords[index];
+      CHECK(RemoteHost::findCommand(keyword.c_str(), keyword.size()) == (int)index);
+
+      // Case is ignored
+      std::string lower = keyword;
+      for (char &ch : lower) {
+         ch = tolower(ch);
+      }
+      CHECK(RemoteHost::findCommand(lower.c_str(), lower.size()) == (int)index);
+
+      // Keyword need not be terminated
+      std::string line = keyword+" 1,2;\n";
+      CHECK(RemoteHost::findCommand(line.c_str(), keyword.size()) == (int)index);
+
+      // Prefixes and extensions only match if they are themselves keywords e.g. "RUN" of "RUN?"
+      for (unsigned length=0; length<keyword.size(); length++) {
+         CHECK(RemoteHost::findCommand(keyword.c_str(), length) == linearFind(keyword.c_str(), length));
+      }
+      for (char extra : {'?', 'X', ' ', '\0'}) {
+         std::string extended = keyword+extra;
+         int expected = linearFind(extended.c_str(), extended.size());
+         CHECK(RemoteHost::findCommand(extended.c_str(), extended.size()) == expected);
+         CHECK((extra != '\0') || (expected == -1));
+      }
+   }
+
+   // Random words from the characters used in keywords agree with a linear search
+   std::mt19937 random(1234);
+   std::uniform_int_distribution<unsigned> pickKeyword(0, keywords.size()-1);
+   std::uniform_int_distribution<unsigned> pickLength(1, 8);
+   unsigned mismatches = 0;
+   for (unsigned count=0; count<200000; count++) {
+      char word[8];
+      unsigned length = pickLength(random);
+      for (unsigned index=0; index<length; index++) {
+         const std::string &source = keywords[pickKeyword(random)];
+         word[index] = source[index%source.size()];
+      }
+      if (RemoteHost::findCommand(word, length) != linearFind(word, length)) {
+         mismatches++;
+      }
+   }
+   CHECK(mismatches == 0);
+
+   // Other keyword sets
+   static KeywordHash<TestKeywords, 8> testHash;
+   testHash.initialise();
+   bool ok = true;
+   for (unsigned index=0; index<TestKeywords::count; index++) {
+      const char *keyword = TestKeywords::keyword(index);
+      ok = ok && (testHash.find(keyword, strlen(keyword)) == (int)index);
+   }
+   CHECK(ok);
+   CHECK(testHash.find("AU", 2) == testHash.NOT_FOUND);
+   CHECK(testHash.find("", 0) == testHash.NOT_FOUND);
+}
+
+/**
+ * Check parsing of command lines
+ */
+static void checkTokenizer() {
+   const char *word;
+   unsigned    length;
+   int         intValue;
+   float       floatValue;
+   char        buffer[8];
+
+   // Keyword and fields as sent by the PC application
+   {
+      Tokenizer tokenizer("PROF 4,My Profile,FF,140.5,;\n");
+      CHECK(tokenizer.getWord(word, length) && (length == 4) && (strncmp(word, "PROF", 4) == 0));
+      CHECK(!tokenizer.atEnd());
+      CHECK(tokenizer.getInt(intValue) && (intValue == 4));
+      CHECK(tokenizer.getString(buffer, sizeof(buffer)) && (strcmp(buffer, "My Prof") == 0));
+      CHECK(tokenizer.getInt(intValue, 16) && (intValue == 0xFF));
+      CHECK(tokenizer.getFloat(floatValue) && (floatValue == 140.5f));
+      // Empty field
+      CHECK(tokenizer.getField(word, length) && (length == 0));
+      CHECK(!tokenizer.getField(word, length));
+      CHECK(tokenizer.atEnd());
+   }
+   // Spaces around keyword and values
+   {
+      Tokenizer tokenizer("  PLOT?   0 , 10 \r\n");
+      CHECK(tokenizer.getWord(word, length) && (length == 5));
+      CHECK(tokenizer.getInt(intValue) && (intValue == 0));
+      CHECK(tokenizer.getInt(intValue) && (intValue == 10));
+      CHECK(tokenizer.atEnd());
+   }
+   // Keyword only
+   {
+      Tokenizer tokenizer("IDN?\n");
+      CHECK(tokenizer.getWord(word, length) && (length == 4));
+      CHECK(tokenizer.atEnd());
+      CHECK(!tokenizer.getWord(word, length) && (length == 0));
+   }
+   // Malformed numbers are rejected
+   for (const char *field : {"", " ", "1x", "x1", "1 2", "-"}) {
+      std::string line = std::string(field)+";";
+      Tokenizer intTokenizer(line.c_str());
+      CHECK(!intTokenizer.getInt(intValue));
+      Tokenizer floatTokenizer(line.c_str());
+      CHECK(!floatTokenizer.getFloat(floatValue));
+   }
+   // Fields after the terminator are not parsed
+   {
+      Tokenizer tokenizer("1;2");
+      CHECK(tokenizer.getInt(intValue) && (intValue == 1));
+      CHECK(!tokenizer.getInt(intValue));
+   }
+}
+
+/**
+ * Check commands are dispatched as received from the USB end-point
+ */
+static void checkDispatch() {
+   CHECK(RemoteHost::transact("IDN?").find("SMT-Oven") != std::string::npos);
+   CHECK(RemoteHost::transact("idn?").find("SMT-Oven") != std::string::npos);
+   CHECK(RemoteHost::transact("IDN").compare("Failed - unrecognized command") == 0);
+   CHECK(RemoteHost::transact("IDN?X").compare("Failed - unrecognized command") == 0);
+   // Arguments checked against the schema before the handler is called
+   CHECK(RemoteHost::transact("IDN? 1").compare(0, 6, "Failed") == 0);
+   CHECK(RemoteHost::transact("PID").compare(0, 6, "Failed") == 0);
+   // Streamed response completes once the transmit buffer has drained
+   std::string bench = RemoteHost::transact("BENCH 2000");
+   CHECK((bench.size()>2000) && (bench[2000] == ';') && (bench.compare(0, 4, "ABCD") == 0));
+}
+
+/**
+ * Measure host time per call
+ *
+ * @return Time per call (ns)
+ */
+template<typename Function>
+static double timePerCall(unsigned calls, Function function) {
+   auto start = Clock::now();
+   for (unsigned count=0; count<calls; count++) {
+      function(count);
+   }
+   return std::chrono::duration<double, std::nano>(Clock::now()-start).count()/calls;
+}
+
+int main() {
+   for (unsigned index=0; RemoteHost::getCommandKeyword(index) != nullptr; index++) {
+      keywords.push_back(RemoteHost::getCommandKeyword(index));
+   }
+   printf("%u commands\n", (unsigned)keywords.size());
+   RemoteHost::initialise();
+
+   checkLookup();
+   checkTokenizer();
+   checkDispatch();
+
+   // Mix of every keyword (found) and near misses (not found)
+   std::vector<std::string> words;
+   for (const std::string &keyword : keywords) {
+      words.push_back(keyword);
+      words.push_back(keyword+"X");
+   }
+   static constexpr unsigned CALLS = 1000000;
+   volatile int sink = 0;
+   double hashTime = timePerCall(CALLS, [&](unsigned count) {
+      const std::string &word = words[count%words.size()];
+      sink = sink + RemoteHost::findCommand(word.c_str(), word.size());
+   });
+   double linearTime = timePerCall(CALLS, [&](unsigned count) {
+      const std::string &word = words[count%words.size()];
+      sink = sink + linearFind(word.c_str(), word.size());
+   });
+   double tokenizeTime = timePerCall(CALLS, [&](unsigned) {
+      Tokenizer   tokenizer("PROF 4,My Profile,FF,140,183,60,90,210,20,-3;\n");
+      const char *word;
+      unsigned    length;
+      char        description[20];
+      int         value;
+      tokenizer.getWord(word, length);
+      int result = RemoteHost::findCommand(word, length);
+      tokenizer.getInt(value);
+      tokenizer.getString(description, sizeof(description));
+      tokenizer.getInt(value, 16);
+      while (tokenizer.getInt(value)) {
+         result += value;
+      }
+      sink = sink + result;
+   });
+   printf("%-24s %10s\n", "Operation", "ns/call");
+   printf("%-24s %10.1f\n", "Hash lookup",    hashTime);
+   printf("%-24s %10.1f\n", "Linear search",  linearTime);
+   printf("%-24s %10.1f\n", "Tokenize PROF line", tokenizeTime);
+   CHECK(hashTime < linearTime);
+
+   return HostTest::report("remoteCommandBench");
+}
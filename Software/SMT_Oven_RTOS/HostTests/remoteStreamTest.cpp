@@ -0,0 +1,168 @@
+/**
+ * @file    remoteStreamTest.cpp
+ * @brief   Host test of streaming remote responses through the transmit ring buffer
+ *
+ * A responder thread streams a response many times the size of the transmit buffer through
+ * RemoteInterface::send() in writes of varying size (some larger than the buffer). The test
+ * thread acts as the USB IN end-point and removes data with getTxData() in full and partial
+ * packets. It periodically stalls (as when the host stops reading) and then resumes.
+ * The following are checked:
+ *  - The response is reassembled byte for byte
+ *  - While the end-point is stalled the buffer fills and the responder stays blocked in send()
+ *  - The end-point is notified of new data
+ *  - trySend() queues data in its entirety or not at all
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <random>
+#include <vector>
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "RemoteInterface.h"
+
+/** Command interface as seen by the USB IN end-point */
+class RemoteHost : public RemoteInterface {
+
+public:
+   /**
+    * Get number of bytes waiting in transmit buffer
+    */
+   static unsigned available() {
+      return txBuffer.available();
+   }
+
+   /**
+    * Set function notifying USB IN end-point of data
+    */
+   static void setNotify(bool (*notify)()) {
+      setUsbInNotifyCallback(notify);
+   }
+};
+
+/** Size of response streamed */
+static constexpr unsigned RESPONSE_SIZE = 40*RemoteInterface::TX_BUFFER_SIZE;
+
+/** Maximum packet size of USB IN end-point */
+static constexpr unsigned PACKET_SIZE = 64;
+
+/** Response sent */
+static std::vector<uint8_t> response;
+
+/** Number of calls to send() completed by the responder */
+static volatile unsigned sendsCompleted = 0;
+
+/** Responder has sent the whole response */
+static volatile bool responseDone = false;
+
+/** Number of times the end-point was notified of new data */
+static unsigned notifications = 0;
+
+/**
+ * Notify USB IN end-point of data
+ */
+static bool notify() {
+   notifications++;
+   return true;
+}
+
+/**
+ * Streams the response in writes of varying size as a command handler would
+ */
+static void responderThreadFunction(const void *) {
+   std::mt19937 random(2);
+   std::uniform_int_distribution<unsigned> pickSize(1, 3*RemoteInterface::TX_BUFFER_SIZE);
+   RemoteInterface::lockResponse();
+   unsigned position = 0;
+   while (position<RESPONSE_SIZE) {
+      unsigned size = std::min(pickSize(random), RESPONSE_SIZE-position);
+      RemoteInterface::send(response.data()+position, size);
+      position += size;
+      sendsCompleted = sendsCompleted+1;
+   }
+   RemoteInterface::unlockResponse();
+   responseDone = true;
+   for(;;) {
+      osDelay(osWaitForever);
+   }
+}
+
+static CMSIS::Thread responderThread{responderThreadFunction, osPriorityNormal, 1000};
+
+/**
+ * Check trySend() with the buffer nearly full
+ */
+static void checkTrySend() {
+   static uint8_t data[RemoteInterface::TX_BUFFER_SIZE];
+   for (unsigned index=0; index<sizeof(data); index++) {
+      data[index] = (uint8_t)index;
+   }
+   // One entry of the ring buffer is never used
+   static constexpr unsigned CAPACITY = RemoteInterface::TX_BUFFER_SIZE-1;
+   CHECK(RemoteInterface::trySend(data, CAPACITY-10));
+   CHECK(!RemoteInterface::trySend(data, 11));
+   CHECK(RemoteHost::available() == CAPACITY-10);
+   CHECK(RemoteInterface::trySend(data+CAPACITY-10, 10));
+   CHECK(!RemoteInterface::trySend(data, 1));
+
+   uint8_t  received[RemoteInterface::TX_BUFFER_SIZE];
+   unsigned size = 0;
+   while (unsigned count = RemoteInterface::getTxData(received+size, PACKET_SIZE)) {
+      size += count;
+   }
+   CHECK(size == CAPACITY);
+   CHECK(memcmp(received, data, CAPACITY) == 0);
+}
+
+int main() {
+   std::mt19937 random(1);
+   for (unsigned index=0; index<RESPONSE_SIZE; index++) {
+      response.push_back((uint8_t)random());
+   }
+   RemoteHost::setNotify(notify);
+
+   checkTrySend();
+
+   responderThread.run();
+
+   std::uniform_int_distribution<unsigned> pickPacket(1, PACKET_SIZE);
+   std::uniform_int_distribution<unsigned> pickPercent(0, 99);
+   std::vector<uint8_t> received;
+   unsigned stalls        = 0;
+   unsigned stallsBlocked = 0;
+   unsigned partial       = 0;
+   for (unsigned transaction=0; !responseDone || !RemoteInterface::isTxEmpty(); transaction++) {
+      if ((transaction%50) == 49) {
+         // Host stops reading - the responder fills the buffer and then blocks
+         unsigned sends = sendsCompleted;
+         osDelay(50);
+         stalls++;
+         if (responseDone ||
+               ((RemoteHost::available() == RemoteInterface::TX_BUFFER_SIZE-1) && (sendsCompleted-sends <= 1))) {
+            stallsBlocked++;
+         }
+         continue;
+      }
+      // Full packets or short packets e.g. from a partly filled double-buffer
+      uint8_t  packet[PACKET_SIZE];
+      unsigned maxSize = (pickPercent(random)<50)?PACKET_SIZE:pickPacket(random);
+      unsigned size    = RemoteInterface::getTxData(packet, maxSize);
+      if ((size>0) && (size<PACKET_SIZE)) {
+         partial++;
+      }
+      received.insert(received.end(), packet, packet+size);
+      // Next USB frame
+      osDelay(1);
+   }
+   printf("%u bytes in %u stalls, %u partial packets, %u notifications\n",
+         (unsigned)received.size(), stalls, partial, notifications);
+
+   CHECK(received.size() == RESPONSE_SIZE);
+   CHECK(received == response);
+   CHECK(stalls >= 5);
+   CHECK(stallsBlocked == stalls);
+   CHECK(partial > 0);
+   CHECK(notifications > 0);
+
+   return HostTest::report("remoteStreamTest");
+}
@@ -0,0 +1,170 @@
+/**
+ * @file    ringBufferStressTest.cpp
+ * @brief   Stress test of the lock-free single-producer/single-consumer RingBuffer
+ *
+ * A producer and a consumer run concurrently as host threads (on separate cores where
+ * available) rather than on the virtual-time kernel, so the accesses genuinely overlap.
+ * The producer writes a pseudo-random byte stream in randomly sized chunks and the
+ * consumer reads it back in randomly sized chunks (or byte-by-byte with get() as the
+ * command thread does). The following are checked:
+ *  - Every byte is received exactly once and in order
+ *  - A write or read never transfers more than the space or data available
+ *  - available() and space() seen by each side stay within the buffer size
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "hostTest.h"
+#include "ringBuffer.h"
+#include "RemoteInterface.h"
+
+/** Bytes transferred in each run */
+static constexpr unsigned long TRANSFER_SIZE = 8*1024*1024;
+
+/**
+ * Byte at position in the stream
+ */
+static uint8_t streamByte(unsigned long position) {
+   return (uint8_t)((position*2654435761UL)>>13);
+}
+
+/** Results of a run */
+struct Result {
+   unsigned long received;      //!< Bytes received
+   unsigned long errors;        //!< Bytes received out of order or corrupted
+   unsigned long overruns;      //!< Transfers larger than available data/space
+   unsigned long emptyReads;    //!< Reads that found the buffer empty
+   unsigned long fullWrites;    //!< Writes that found the buffer full
+   double        seconds;       //!< Host time for run
+};
+
+/**
+ * Transfer the stream through a ring buffer
+ *
+ * @tparam SIZE Size of ring buffer
+ *
+ * @param[in] maxChunk Largest chunk written or read
+ * @param[in] useGet   Consumer removes single bytes with get()
+ *
+ * @return Results of run
+ */
+template<unsigned SIZE>
+static Result run(unsigned maxChunk, bool useGet) {
+   static RingBuffer<SIZE> buffer;
+   Result result{};
+
+   std::atomic<bool> producerDone{false};
+   std::atomic<unsigned long> producerOverruns{0};
+   std::atomic<unsigned long> fullWrites{0};
+
+   auto start = std::chrono::steady_clock::now();
+
+   std::thread producer([&] {
+      std::mt19937 random(1);
+      std::uniform_int_distribution<unsigned> pickSize(1, maxChunk);
+      uint8_t       chunk[SIZE];
+      unsigned long position = 0;
+      unsigned long overruns = 0;
+      unsigned long full     = 0;
+      while (position<TRANSFER_SIZE) {
+         unsigned size = pickSize(random);
+         if (size>TRANSFER_SIZE-position) {
+            size = TRANSFER_SIZE-position;
+         }
+         for (unsigned index=0; index<size; index++) {
+            chunk[index] = streamByte(position+index);
+         }
+         // Space can only grow while the producer is not writing
+         unsigned space   = buffer.space();
+         unsigned written = buffer.write(chunk, size);
+         if ((written<std::min(size, space)) || (buffer.space()>SIZE-1)) {
+            overruns++;
+         }
+         if (written == 0) {
+            full++;
+            std::this_thread::yield();
+         }
+         position += written;
+      }
+      producerOverruns = overruns;
+      fullWrites       = full;
+      producerDone     = true;
+   });
+
+   std::thread consumer([&] {
+      std::mt19937 random(2);
+      std::uniform_int_distribution<unsigned> pickSize(1, maxChunk);
+      uint8_t       chunk[SIZE];
+      unsigned long position = 0;
+      while (position<TRANSFER_SIZE) {
+         // Data can only grow while the consumer is not reading
+         unsigned available = buffer.available();
+         unsigned size;
+         if (useGet) {
+            size = buffer.get(chunk[0])?1:0;
+         }
+         else {
+            size = buffer.read(chunk, pickSize(random));
+         }
+         if ((available>SIZE-1) || ((available>0) && (size == 0))) {
+            result.overruns++;
+         }
+         if (size == 0) {
+            result.emptyReads++;
+            if (producerDone && buffer.isEmpty()) {
+               break;
+            }
+            std::this_thread::yield();
+            continue;
+         }
+         for (unsigned index=0; index<size; index++) {
+            if (chunk[index] != streamByte(position+index)) {
+               result.errors++;
+            }
+         }
+         position += size;
+      }
+      result.received = position;
+   });
+
+   producer.join();
+   consumer.join();
+
+   result.seconds     = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+   result.overruns   += producerOverruns;
+   result.fullWrites  = fullWrites;
+   CHECK(buffer.isEmpty());
+   return result;
+}
+
+/**
+ * Run and check a configuration
+ */
+template<unsigned SIZE>
+static void check(const char *name, unsigned maxChunk, bool useGet) {
+   Result result = run<SIZE>(maxChunk, useGet);
+   printf("%-28s %6u %6u %10lu %10lu %8.1f\n",
+         name, SIZE, maxChunk, result.emptyReads, result.fullWrites, TRANSFER_SIZE/result.seconds/1E6);
+   CHECK(result.received == TRANSFER_SIZE);
+   CHECK(result.errors == 0);
+   CHECK(result.overruns == 0);
+}
+
+int main() {
+   printf("%u hardware threads\n", std::thread::hardware_concurrency());
+   printf("%-28s %6s %6s %10s %10s %8s\n", "Configuration", "Size", "Chunk", "Empty", "Full", "MB/s");
+
+   // Small buffer so the indices wrap often and both sides meet at full and empty
+   check<16>("Small buffer, byte chunks", 1, false);
+   check<16>("Small buffer, random chunks", 15, false);
+   // Sizes used by RemoteInterface
+   check<RemoteInterface::RX_BUFFER_SIZE>("Receive buffer, get()", 64, true);
+   check<RemoteInterface::TX_BUFFER_SIZE>("Transmit buffer, USB packets", 64, false);
+   check<RemoteInterface::TX_BUFFER_SIZE>("Large chunks", RemoteInterface::TX_BUFFER_SIZE-1, false);
+
+   return HostTest::report("ringBufferStressTest");
+}
@@ -0,0 +1,86 @@
+/**
+ * @file    simulatedMax31855.h
+ * @brief   Simulated MAX31855 thermocouple interface attached to the simulated SPI
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_SIMULATEDMAX31855_H_
+#define HOSTTESTS_SIMULATEDMAX31855_H_
+
+#include <stdint.h>
+#include "hostKernel.h"
+#include "hostHardware.h"
+
+/**
+ * Simulated MAX31855\n
+ * A conversion is latched when selected and shifted out MSB first.
+ * The probe temperature changes in 1 second steps at the given rate.
+ */
+class SimulatedMax31855 : public HostHardware::SpiDevice {
+
+   uint32_t fFrame = 0;
+   unsigned fByte  = 0;
+
+public:
+   /** Cold junction temperature */
+   float    coldReference;
+
+   /** Probe temperature at time 0 */
+   float    probeStart;
+
+   /** Change in probe temperature per second */
+   float    probeRate;
+
+   /** Fault bits reported (0b001 open, 0b010 short to Gnd, 0b100 short to Vcc) */
+   uint8_t  fault       = 0;
+
+   /** Number of times selected */
+   unsigned conversions = 0;
+
+   /** Number of times deselected before all 4 bytes were read */
+   unsigned shortFrames = 0;
+
+   SimulatedMax31855(float coldReference, float probeStart=20.0f, float probeRate=1.0f) :
+      coldReference(coldReference), probeStart(probeStart), probeRate(probeRate) {
+   }
+
+   /**
+    * Get probe temperature
+    *
+    * @param[in] time Virtual time (us)
+    */
+   float probeTemperature(uint64_t time) const {
+      return probeStart + probeRate*(time/1000000);
+   }
+
+   /**
+    * Get the 32-bit frame the device produces
+    */
+   uint32_t makeFrame(uint64_t time) const {
+      int32_t probe = (int32_t)(probeTemperature(time)*4);
+      int32_t cold  = (int32_t)(coldReference*16);
+      uint32_t frame = ((uint32_t)(probe&0x3FFF)<<18)|((uint32_t)(cold&0xFFF)<<4)|(fault&0x7);
+      if (fault != 0) {
+         frame |= 1<<16;
+      }
+      return frame;
+   }
+
+   virtual void select() override {
+      fFrame = makeFrame(HostKernel::getTime());
+      fByte  = 0;
+      conversions++;
+   }
+   virtual uint8_t transfer(uint8_t) override {
+      return (uint8_t)(fFrame>>(8*(3-(fByte++&3))));
+   }
+   virtual void deselect() override {
+      if (fByte != 4) {
+         shortFrames++;
+      }
+   }
+};
+
+#endif /* HOSTTESTS_SIMULATEDMAX31855_H_ */
@@ -0,0 +1,164 @@
+/**
+ * @file    simulatedSt7920.h
+ * @brief   Simulated ST7920 LCD serial interface attached to the simulated SPI
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_SIMULATEDST7920_H_
+#define HOSTTESTS_SIMULATEDST7920_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "hostKernel.h"
+#include "hostHardware.h"
+#include "lcdTransport.h"
+
+/**
+ * Simulated ST7920 serial interface
+ *
+ * Each transfer is a sync byte (RS in bit 1) followed by nibble pairs while CS is held.
+ * Instructions are decoded as the LCD would:
+ *  - Function set selects the basic or extended (RE) instruction set
+ *  - In the extended set 0b1xxxxxxx sets the GDRAM vertical then horizontal address
+ *  - Data written in the extended set goes to GDRAM as 16-bit words (high byte first) and
+ *    the horizontal address increments after each word
+ *
+ * GDRAM is presented as the screen image i.e. horizontal words 8-15 are the lower 32 rows.
+ */
+class SimulatedSt7920 : public HostHardware::SpiDevice {
+
+public:
+   /** Width of screen in bytes */
+   static constexpr unsigned BYTES_PER_ROW = 16;
+
+   /** Height of screen in pixels */
+   static constexpr unsigned ROWS = 64;
+
+private:
+   enum Phase {Sync, High, Low} fPhase = Sync;
+   bool    fData = false;
+   uint8_t fHigh = 0;
+
+   /** Extended instruction set selected (RE) */
+   bool     fExtended    = false;
+
+   /** Next GDRAM address instruction sets the horizontal address */
+   bool     fHorizontal  = false;
+
+   /** GDRAM address */
+   unsigned fVertical    = 0;
+   unsigned fWord        = 0;
+
+   /** Next data byte is the low byte of the word */
+   bool     fLowByte     = false;
+
+   /**
+    * Execute instruction
+    *
+    * @param[in] data  true for data, false for instruction
+    * @param[in] value Value
+    */
+   void execute(bool data, uint8_t value) {
+      if (data) {
+         if (!fExtended) {
+            // DDRAM (text) is not modelled
+            textWrites++;
+            return;
+         }
+         unsigned row = (fVertical&0x1F)+((fWord&0x08)?32:0);
+         gdram[row][2*(fWord&0x07)+(fLowByte?1:0)] = value;
+         if (fLowByte) {
+            fWord = (fWord+1)&0x0F;
+         }
+         fLowByte = !fLowByte;
+         return;
+      }
+      if ((value&0xE0) == 0x20) {
+         // Function set
+         fExtended = (value&0x04) != 0;
+         if (fExtended) {
+            graphicsOn = (value&0x02) != 0;
+         }
+         fHorizontal = false;
+      }
+      else if (fExtended && (value&0x80)) {
+         // Set GDRAM address - vertical then horizontal
+         if (fHorizontal) {
+            fWord = value&0x0F;
+         }
+         else {
+            fVertical = value&0x7F;
+         }
+         fHorizontal = !fHorizontal;
+         fLowByte    = false;
+      }
+   }
+
+public:
+   struct Instruction {
+      uint64_t time;  //!< Time instruction completed (us)
+      uint16_t entry; //!< LcdTransport::Entry_Command or Entry_Data combined with value
+   };
+
+   /** Instructions received */
+   std::vector<Instruction> instructions;
+
+   /** Screen image from GDRAM */
+   uint8_t gdram[ROWS][BYTES_PER_ROW];
+
+   /** Graphics display on (G) */
+   bool graphicsOn = false;
+
+   /** Bytes received over SPI */
+   unsigned bytes = 0;
+
+   /** Data written to DDRAM (text) */
+   unsigned textWrites = 0;
+
+   /** Frames that did not follow the protocol */
+   unsigned errors = 0;
+
+   SimulatedSt7920() {
+      memset(gdram, 0, sizeof(gdram));
+   }
+
+   virtual void select() override {
+      fPhase = Sync;
+   }
+   virtual uint8_t transfer(uint8_t data) override {
+      bytes++;
+      switch(fPhase) {
+         case Sync:
+            if ((data&0xFD) != 0xF8) {
+               errors++;
+            }
+            fData  = (data&0x02) != 0;
+            fPhase = High;
+            break;
+         case High:
+            if ((data&0x0F) != 0) {
+               errors++;
+            }
+            fHigh  = data;
+            fPhase = Low;
+            break;
+         case Low:
+            if ((data&0x0F) != 0) {
+               errors++;
+            }
+            uint8_t value = fHigh|(data>>4);
+            instructions.push_back(Instruction{
+               HostKernel::getTime(),
+               (uint16_t)((fData?LcdTransport::Entry_Data:LcdTransport::Entry_Command)|value)});
+            execute(fData, value);
+            fPhase = High;
+            break;
+      }
+      return 0xFF;
+   }
+};
+
+#endif /* HOSTTESTS_SIMULATEDST7920_H_ */
@@ -0,0 +1,5 @@
+/*
+ * CaseTemperatureMonitor.h (HostTests/stubs)
+ * Sources are included with this spelling but the file name is lower case.
+ */
+#include "../../Sources/caseTemperatureMonitor.h"
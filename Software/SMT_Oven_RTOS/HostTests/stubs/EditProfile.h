@@ -0,0 +1,5 @@
+/*
+ * EditProfile.h (HostTests/stubs)
+ * Sources are included with this spelling but the file name is lower case.
+ */
+#include "../../Sources/editProfile.h"
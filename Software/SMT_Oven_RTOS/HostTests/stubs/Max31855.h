@@ -0,0 +1,5 @@
+/*
+ * Max31855.h (HostTests/stubs)
+ * Sources are included with this spelling but the file name is lower case.
+ */
+#include "../../Sources/max31855.h"
@@ -0,0 +1,86 @@
+/**
+ * @file    cmp.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM analogue comparator interface
+ *
+ * The comparator input is the simulated mains supply (see HostHardware::startMains())
+ * so enabled edge interrupts occur at each mains zero-crossing.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_CMP_H_
+#define HOSTTESTS_STUBS_CMP_H_
+
+#include <stdint.h>
+#include "hardware.h"
+#include "hostHardware.h"
+
+#define CMP_SCR_CFF_MASK (0x2U)
+#define CMP_SCR_CFR_MASK (0x4U)
+
+namespace USBDM {
+
+/**
+ * Type definition for CMP interrupt call back
+ *
+ * @param[in] status Struct indicating interrupt source and state
+ */
+typedef void (*CMPCallbackFunction)(int status);
+
+/**
+ * Comparator connected to the simulated mains supply
+ */
+class Cmp0 {
+
+private:
+   static inline CMPCallbackFunction callback      = nullptr;
+   static inline bool                risingEnabled  = false;
+   static inline bool                fallingEnabled = false;
+
+   /**
+    * Mains zero-crossing
+    *
+    * @param[in] rising Polarity of crossing
+    */
+   static void crossing(bool rising) {
+      if (rising?!risingEnabled:!fallingEnabled) {
+         return;
+      }
+      if (callback == nullptr) {
+         setAndCheckErrorCode(E_NO_HANDLER);
+      }
+      callback(rising?CMP_SCR_CFR_MASK:CMP_SCR_CFF_MASK);
+   }
+
+public:
+   static void enable() {
+      HostHardware::startMains(crossing);
+   }
+   static void configure() {
+      enable();
+   }
+   static void disable() {
+      risingEnabled  = false;
+      fallingEnabled = false;
+   }
+   static void enableNvicInterrupts(bool =true) {
+   }
+   static void enableRisingEdgeInterrupts(bool enable=true) {
+      risingEnabled = enable;
+   }
+   static void enableFallingEdgeInterrupts(bool enable=true) {
+      fallingEnabled = enable;
+   }
+   static void setDacLevel(uint8_t, uint8_t =0, bool =true) {
+   }
+   static void selectInputs(uint8_t, uint8_t) {
+   }
+   static void setCallback(CMPCallbackFunction theCallback) {
+      callback = theCallback;
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_CMP_H_ */
@@ -0,0 +1,372 @@
+/**
+ * @file    cmsis.h (HostTests/stubs)
+ * @brief   Host stand-in for the CMSIS-RTX wrapper classes
+ *
+ * Provides the same interface as Project_Headers/cmsis.h implemented on the
+ * virtual-time kernel (see hostKernel.h).
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_CMSIS_H_
+#define HOSTTESTS_STUBS_CMSIS_H_
+
+#include <assert.h>
+#include <math.h>
+#include <deque>
+#include "cmsis_os.h"
+#include "hostKernel.h"
+#include "hardware.h"
+
+namespace CMSIS {
+
+using Callback = void (*)(const void *);
+
+/**
+ * Timer executing a call-back in 'interrupt' context
+ */
+class Timer {
+
+private:
+   Callback       fCallback;
+   void          *fArgument;
+   os_timer_type  fTimerType;
+   unsigned       fEvent    = 0;
+   bool           fRunning  = false;
+   uint64_t       fInterval = 0;
+
+   void schedule() {
+      fEvent = HostKernel::scheduleEvent(HostKernel::getTime()+fInterval, [this] {
+         if (fTimerType == osTimerPeriodic) {
+            schedule();
+         }
+         else {
+            fRunning = false;
+         }
+         fCallback(fArgument);
+      });
+   }
+
+public:
+   Timer(Callback callback, void *argument, os_timer_type timerType) :
+      fCallback(callback), fArgument(argument), fTimerType(timerType) {
+   }
+   Timer(Callback callback, os_timer_type timerType) :
+      Timer(callback, nullptr, timerType) {
+   }
+   Timer(Callback callback, void *argument=nullptr) :
+      Timer(callback, argument, osTimerPeriodic){
+   }
+   ~Timer() {
+      stop();
+   }
+   bool create(void *argument=nullptr, os_timer_type timerType=osTimerPeriodic) {
+      stop();
+      fArgument  = argument;
+      fTimerType = timerType;
+      return true;
+   }
+   osStatus destroy() {
+      stop();
+      return osOK;
+   }
+   void stop() {
+      if (fRunning) {
+         HostKernel::cancelEvent(fEvent);
+         fRunning = false;
+      }
+   }
+   void start(int millisec) {
+      stop();
+      fInterval = 1000ULL*millisec;
+      fRunning  = true;
+      schedule();
+   }
+   void start(double interval) {
+      start((int)round(interval*1000.0));
+   }
+};
+
+/**
+ * Timer incorporating call-back
+ */
+class TimerClass : Timer {
+
+private:
+   virtual void callback() = 0;
+
+   static void shim(const void *arg) {
+      TimerClass *This = static_cast<TimerClass *>(const_cast<void *>(arg));
+      This->callback();
+   }
+
+public:
+   using Timer::start;
+   using Timer::stop;
+
+   TimerClass(os_timer_type timerType=osTimerPeriodic) : Timer(shim, this, timerType) {
+   }
+   virtual ~TimerClass() {
+   }
+};
+
+/**
+ * Recursive mutex\n
+ * As in RTX, releasing the mutex passes ownership to the highest priority waiting thread.
+ */
+class Mutex {
+
+private:
+   static constexpr unsigned MAX_WAITERS = 8;
+
+   osThreadId fOwner   = nullptr;
+   unsigned   fCount   = 0;
+   osThreadId fWaiters[MAX_WAITERS] = {};
+   unsigned   fWaiting = 0;
+
+   void removeWaiter(unsigned index) {
+      fWaiting--;
+      for (; index<fWaiting; index++) {
+         fWaiters[index] = fWaiters[index+1];
+      }
+   }
+
+public:
+   constexpr Mutex() {
+   }
+   ~Mutex() {
+   }
+   osStatus wait(uint32_t millisec=osWaitForever) {
+      osThreadId me = osThreadGetId();
+      if ((fOwner == nullptr)||(fOwner == me)) {
+         fOwner = me;
+         fCount++;
+         return osOK;
+      }
+      if (millisec == 0) {
+         return osErrorResource;
+      }
+      assert(fWaiting<MAX_WAITERS);
+      fWaiters[fWaiting++] = me;
+      if (!HostKernel::block([this, me]{ return fOwner == me; }, millisec)) {
+         for (unsigned index=0; index<fWaiting; index++) {
+            if (fWaiters[index] == me) {
+               removeWaiter(index);
+            }
+         }
+         return osErrorTimeoutResource;
+      }
+      // Ownership (fCount=1) given by release()
+      return osOK;
+   }
+   osStatus release() {
+      if ((fOwner != osThreadGetId()) || (fCount == 0)) {
+         return osErrorResource;
+      }
+      if (--fCount == 0) {
+         fOwner = nullptr;
+         if (fWaiting>0) {
+            // Highest priority, longest waiting
+            unsigned best = 0;
+            for (unsigned index=1; index<fWaiting; index++) {
+               if (osThreadGetPriority(fWaiters[index]) > osThreadGetPriority(fWaiters[best])) {
+                  best = index;
+               }
+            }
+            fOwner = fWaiters[best];
+            fCount = 1;
+            removeWaiter(best);
+         }
+         HostKernel::reschedule();
+      }
+      return osOK;
+   }
+   osStatus lock(uint32_t millisec=osWaitForever) {
+      return wait(millisec);
+   }
+   osStatus unlock() {
+      return release();
+   }
+   osStatus tryLock() {
+      return wait(0);
+   }
+};
+
+/**
+ * Thread
+ */
+class Thread {
+
+private:
+   Callback   fFunction;
+   osPriority fPriority;
+   osThreadId thread_id = nullptr;
+
+public:
+   void run(void *argument=nullptr) {
+      thread_id = HostKernel::createThread(fFunction, argument, fPriority);
+   }
+   osThreadId getId() {
+      return thread_id;
+   }
+   static osThreadId getMyId() {
+      return osThreadGetId();
+   }
+   osPriority getPriority() {
+      return osThreadGetPriority(thread_id);
+   }
+   osStatus setPriority(osPriority priority) {
+      return osThreadSetPriority(thread_id, priority);
+   }
+   static osStatus yield() {
+      return osThreadYield();
+   }
+   int32_t signalSet(int32_t signals) {
+      return osSignalSet(thread_id, signals);
+   }
+   int32_t signalClear(int32_t signals) {
+      return osSignalClear(thread_id, signals);
+   }
+   static osEvent signalWait(int32_t signals, uint32_t millisec=osWaitForever) {
+      return osSignalWait(signals, millisec);
+   }
+   osStatus terminate() {
+      return osThreadTerminate(thread_id);
+   }
+   static osStatus delay(uint32_t millisec) {
+      return osDelay(millisec);
+   }
+   Thread(osThreadId thread_id) : fFunction(nullptr), fPriority(osPriorityNormal), thread_id(thread_id) {
+   }
+   Thread(
+         Callback    threadFunction,
+         osPriority  priority=osPriorityNormal,
+         uint32_t    =0) : fFunction(threadFunction), fPriority(priority) {
+   }
+   ~Thread() {
+   }
+};
+
+/**
+ * Message queue passing small values
+ */
+template <typename T, size_t size, Thread *thread=nullptr>
+class MessageQueue {
+
+   static_assert(sizeof(T)<=sizeof(int), "Object is too large to pass as message");
+
+private:
+   std::deque<T> fQueue;
+
+public:
+   void create() {
+   }
+   osStatus putISR(T info) {
+      return put(info, 0);
+   }
+   osStatus put(T info, uint32_t millisec=osWaitForever) {
+      if (!HostKernel::block([this]{ return fQueue.size()<size; }, millisec)) {
+         return (millisec == 0)?osErrorResource:osErrorTimeoutResource;
+      }
+      fQueue.push_back(info);
+      HostKernel::reschedule();
+      return osOK;
+   }
+   osEvent get(uint32_t millisec=osWaitForever) {
+      osEvent event;
+      if (!HostKernel::block([this]{ return !fQueue.empty(); }, millisec)) {
+         event.status = (millisec == 0)?osOK:osEventTimeout;
+         return event;
+      }
+      event.status  = osEventMessage;
+      event.value.v = (uint32_t)fQueue.front();
+      fQueue.pop_front();
+      return event;
+   }
+   osEvent getISR() {
+      return get(0);
+   }
+};
+
+/**
+ * Mail queue passing objects by reference
+ */
+template <typename T, size_t size, Thread *thread=nullptr>
+class MailQueue {
+
+private:
+   T              fMessages[size];
+   bool           fAllocated[size] = {false};
+   std::deque<T*> fQueue;
+
+   T *allocate() {
+      for (unsigned index=0; index<size; index++) {
+         if (!fAllocated[index]) {
+            fAllocated[index] = true;
+            return &fMessages[index];
+         }
+      }
+      return nullptr;
+   }
+
+   bool isFull() {
+      for (bool allocated:fAllocated) {
+         if (!allocated) {
+            return false;
+         }
+      }
+      return true;
+   }
+
+public:
+   void create() {
+   }
+   T *alloc(uint32_t millisec=osWaitForever) {
+      if (!HostKernel::block([this]{ return !isFull(); }, millisec)) {
+         return nullptr;
+      }
+      return allocate();
+   }
+   T *allocISR() {
+      return alloc(0);
+   }
+   T *calloc(uint32_t millisec=osWaitForever) {
+      T *mail = alloc(millisec);
+      if (mail != nullptr) {
+         *mail = T();
+      }
+      return mail;
+   }
+   T *callocISR(uint32_t) {
+      return calloc(0);
+   }
+   osStatus free(T *mail) {
+      fAllocated[mail-fMessages] = false;
+      HostKernel::reschedule();
+      return osOK;
+   }
+   osEvent get(uint32_t millisec=osWaitForever) {
+      osEvent event;
+      if (!HostKernel::block([this]{ return !fQueue.empty(); }, millisec)) {
+         event.status = (millisec == 0)?osOK:osEventTimeout;
+         return event;
+      }
+      event.status  = osEventMail;
+      event.value.p = fQueue.front();
+      fQueue.pop_front();
+      return event;
+   }
+   osEvent getISR() {
+      return get(0);
+   }
+   osStatus put(T *mail) {
+      fQueue.push_back(mail);
+      HostKernel::reschedule();
+      return osOK;
+   }
+};
+
+}; // end namespace CMSIS
+
+#endif /* HOSTTESTS_STUBS_CMSIS_H_ */
@@ -0,0 +1,56 @@
+/**
+ * @file    cmsis_gcc.h (HostTests/stubs)
+ * @brief   Host stand-in for the Cortex-M intrinsics
+ *
+ * Only one kernel thread runs at a time and events never interrupt a running
+ * thread so masking interrupts is not required on the host.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_CMSIS_GCC_H_
+#define HOSTTESTS_STUBS_CMSIS_GCC_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include "hostKernel.h"
+
+/** Data memory barrier - also used by lock-free code shared with host threads */
+static inline void __DMB() {
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+static inline uint32_t __get_PRIMASK() {
+   return 0;
+}
+
+static inline void __set_PRIMASK(uint32_t) {
+}
+
+static inline void __disable_irq() {
+}
+
+static inline void __enable_irq() {
+}
+
+/** Wait for interrupt - blocks until the next event */
+static inline void __WFI() {
+   HostKernel::waitForEvent();
+}
+
+static inline void __BKPT(int = 0) {
+   abort();
+}
+
+static inline uint32_t __LDREXW(volatile long unsigned *address) {
+   return (uint32_t)*address;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile long unsigned *address) {
+   *address = value;
+   return 0;
+}
+
+#endif /* HOSTTESTS_STUBS_CMSIS_GCC_H_ */
@@ -0,0 +1,104 @@
+/**
+ * @file    cmsis_os.h (HostTests/stubs)
+ * @brief   Host stand-in for the CMSIS-RTOS API
+ *
+ * Only the subset of the API used by the oven sources is provided.
+ * The functions are implemented by the virtual-time kernel (see hostKernel.h).
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_CMSIS_OS_H_
+#define HOSTTESTS_STUBS_CMSIS_OS_H_
+
+#include <stdint.h>
+
+/** Timeout value */
+#define osWaitForever     0xFFFFFFFFU
+
+/** Feature flag for osWait() */
+#define osFeature_Wait    0
+
+/** Status code values returned by CMSIS-RTOS functions */
+typedef enum  {
+  osOK                    =     0,
+  osEventSignal           =  0x08,
+  osEventMessage          =  0x10,
+  osEventMail             =  0x20,
+  osEventTimeout          =  0x40,
+  osErrorParameter        =  0x80,
+  osErrorResource         =  0x81,
+  osErrorTimeoutResource  =  0xC1,
+  osErrorISR              =  0x82,
+  osErrorISRRecursive     =  0x83,
+  osErrorPriority         =  0x84,
+  osErrorNoMemory         =  0x85,
+  osErrorValue            =  0x86,
+  osErrorOS               =  0xFF,
+  os_status_reserved      =  0x7FFFFFFF
+} osStatus;
+
+/** Thread priority */
+typedef enum  {
+  osPriorityIdle          = -3,
+  osPriorityLow           = -2,
+  osPriorityBelowNormal   = -1,
+  osPriorityNormal        =  0,
+  osPriorityAboveNormal   = +1,
+  osPriorityHigh          = +2,
+  osPriorityRealtime      = +3,
+  osPriorityError         =  0x84
+} osPriority;
+
+/** Timer type */
+typedef enum  {
+  osTimerOnce             =     0,
+  osTimerPeriodic         =     1
+} os_timer_type;
+
+/** Thread ID (a kernel task) */
+typedef struct os_thread_cb *osThreadId;
+
+/** Message queue ID (not used by host kernel) */
+typedef struct os_messageQ_cb *osMessageQId;
+
+/** Mail queue ID (not used by host kernel) */
+typedef struct os_mailQ_cb *osMailQId;
+
+/** Event returned by wait functions */
+typedef struct  {
+  osStatus                 status;
+  union  {
+    uint32_t                    v;
+    void                       *p;
+    int32_t               signals;
+  } value;
+  union  {
+    osMailQId             mail_id;
+    osMessageQId       message_id;
+  } def;
+} osEvent;
+
+/** Kernel tick frequency - ticks are microseconds of virtual time */
+#define osKernelSysTickFrequency 1000000U
+
+/** Convert microseconds to kernel ticks */
+#define osKernelSysTickMicroSec(microsec) ((uint32_t)(microsec))
+
+/**
+ * Get kernel tick count (virtual time in microseconds)
+ */
+uint32_t   osKernelSysTick();
+
+osStatus   osDelay(uint32_t millisec);
+osThreadId osThreadGetId();
+osStatus   osThreadYield();
+osStatus   osThreadTerminate(osThreadId thread_id);
+osPriority osThreadGetPriority(osThreadId thread_id);
+osStatus   osThreadSetPriority(osThreadId thread_id, osPriority priority);
+int32_t    osSignalSet(osThreadId thread_id, int32_t signals);
+int32_t    osSignalClear(osThreadId thread_id, int32_t signals);
+osEvent    osSignalWait(int32_t signals, uint32_t millisec);
+
+#endif /* HOSTTESTS_STUBS_CMSIS_OS_H_ */
@@ -0,0 +1,46 @@
+/**
+ * @file    delay.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM busy-wait delays
+ *
+ * The delays take the requested virtual time. Unlike the target, other threads
+ * may run during a delay as the host thread blocks (see HostHardware::busyWait()).
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_DELAY_H_
+#define HOSTTESTS_STUBS_DELAY_H_
+
+#include <stdint.h>
+#include "hostHardware.h"
+
+namespace USBDM {
+
+inline void waitUS(uint32_t usToWait) {
+   HostHardware::busyWait(usToWait, nullptr);
+}
+
+inline void waitMS(uint32_t msToWait) {
+   HostHardware::busyWait(1000ULL*msToWait, nullptr);
+}
+
+inline void wait(float seconds) {
+   HostHardware::busyWait((uint64_t)(seconds*1000000), nullptr);
+}
+
+inline bool waitUS(uint32_t usToWait, bool testFn(void)) {
+   return HostHardware::busyWait(usToWait, testFn);
+}
+
+inline bool waitMS(uint32_t msToWait, bool testFn(void)) {
+   return HostHardware::busyWait(1000ULL*msToWait, testFn);
+}
+
+inline bool wait(float seconds, bool testFn(void)) {
+   return HostHardware::busyWait((uint64_t)(seconds*1000000), testFn);
+}
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_DELAY_H_ */
@@ -0,0 +1,134 @@
+/**
+ * @file    derivative.h (HostTests/stubs)
+ * @brief   Host stand-in for the MK22DX256M5 peripheral definitions
+ *
+ * Only the peripherals accessed directly by the oven sources are provided.
+ * Registers with side-effects are objects that pass accesses to the simulation
+ * in hostHardware.cpp e.g. writing SPI.PUSHR transmits a frame.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_DERIVATIVE_H_
+#define HOSTTESTS_STUBS_DERIVATIVE_H_
+
+#include <stdint.h>
+#include "cmsis_gcc.h"
+#include "system.h"
+
+#define MK22DX256M5
+
+struct SPI_Type;
+
+/**
+ * SPI register with side-effects on access
+ */
+class HostSpiRegister {
+
+public:
+   enum Id {
+      MCR,
+      SR,
+      PUSHR,
+      POPR,
+   };
+
+   /** Register value */
+   uint32_t        value = 0;
+
+private:
+   SPI_Type *const fSpi;
+   const Id        fId;
+
+public:
+   constexpr HostSpiRegister(SPI_Type *spi, Id id) : fSpi(spi), fId(id) {
+   }
+   HostSpiRegister(const HostSpiRegister &) = delete;
+
+   SPI_Type *getSpi() const volatile {
+      return fSpi;
+   }
+   Id getId() const volatile {
+      return fId;
+   }
+   /** Read register (see hostHardware.cpp) */
+   operator uint32_t() const volatile;
+
+   /** Write register (see hostHardware.cpp) */
+   void operator=(uint32_t value) volatile;
+
+   void operator|=(uint32_t mask) volatile {
+      *this = (uint32_t)*this|mask;
+   }
+   void operator&=(uint32_t mask) volatile {
+      *this = (uint32_t)*this&mask;
+   }
+};
+
+/**
+ * SPI (DSPI) registers
+ */
+struct SPI_Type {
+   HostSpiRegister MCR{this, HostSpiRegister::MCR};
+   uint32_t        TCR = 0;
+   uint32_t        CTAR[2] = {};
+   HostSpiRegister SR{this, HostSpiRegister::SR};
+   uint32_t        RSER = 0;
+   HostSpiRegister PUSHR{this, HostSpiRegister::PUSHR};
+   HostSpiRegister POPR{this, HostSpiRegister::POPR};
+};
+
+/**
+ * Flash Memory Controller registers (cache control has no effect on the host)
+ */
+struct FMC_Type {
+   uint32_t PFAPR;
+   uint32_t PFB0CR;
+};
+
+/** Simulated FMC (defined by hostHardware.cpp) */
+extern FMC_Type hostFmc;
+
+#define FMC (&hostFmc)
+
+#define FMC_PFB0CR_S_B_INV_MASK                  (0x80000U)
+#define FMC_PFB0CR_CINV_WAY_MASK                 (0xF00000U)
+
+#define SPI_MCR_HALT_MASK                        (0x1U)
+#define SPI_MCR_CLR_RXF_MASK                     (0x400U)
+#define SPI_MCR_CLR_TXF_MASK                     (0x800U)
+#define SPI_CTAR_LSBFE(x)                        (((uint32_t)(((uint32_t)(x))<<24U))&0x1000000UL)
+#define SPI_CTAR_CPHA(x)                         (((uint32_t)(((uint32_t)(x))<<25U))&0x2000000UL)
+#define SPI_CTAR_CPOL(x)                         (((uint32_t)(((uint32_t)(x))<<26U))&0x4000000UL)
+#define SPI_CTAR_FMSZ_MASK                       (0x78000000U)
+#define SPI_CTAR_FMSZ(x)                         (((uint32_t)(((uint32_t)(x))<<27U))&0x78000000UL)
+#define SPI_SR_RFDF_MASK                         (0x20000U)
+#define SPI_SR_RFOF_MASK                         (0x80000U)
+#define SPI_SR_TFFF_MASK                         (0x2000000U)
+#define SPI_SR_TFUF_MASK                         (0x8000000U)
+#define SPI_SR_EOQF_MASK                         (0x10000000U)
+#define SPI_SR_TCF_MASK                          (0x80000000U)
+#define SPI_RSER_RFDF_DIRS_MASK                  (0x10000U)
+#define SPI_RSER_RFDF_RE_MASK                    (0x20000U)
+#define SPI_RSER_TFFF_DIRS_MASK                  (0x1000000U)
+#define SPI_RSER_TFFF_RE_MASK                    (0x2000000U)
+#define SPI_PUSHR_TXDATA_MASK                    (0xFFFFU)
+#define SPI_PUSHR_PCS_MASK                       (0x3F0000U)
+#define SPI_PUSHR_PCS_SHIFT                      (16U)
+#define SPI_PUSHR_PCS(x)                         (((uint32_t)(((uint32_t)(x))<<16U))&0x3F0000UL)
+#define SPI_PUSHR_EOQ_MASK                       (0x8000000U)
+#define SPI_PUSHR_CTAS(x)                        (((uint32_t)(((uint32_t)(x))<<28U))&0x70000000UL)
+#define SPI_PUSHR_CONT_MASK                      (0x80000000U)
+
+#define DMA_ATTR_DSIZE_MASK                      (0x7U)
+#define DMA_ATTR_DSIZE(x)                        (((uint16_t)(((uint16_t)(x))<<0U))&0x7UL)
+#define DMA_ATTR_SSIZE_MASK                      (0x700U)
+#define DMA_ATTR_SSIZE_SHIFT                     (8U)
+#define DMA_ATTR_SSIZE(x)                        (((uint16_t)(((uint16_t)(x))<<8U))&0x700UL)
+#define DMA_CSR_START_MASK                       (0x1U)
+#define DMA_CSR_INTMAJOR_MASK                    (0x2U)
+#define DMA_CSR_DREQ_MASK                        (0x8U)
+#define DMA_CSR_DONE_MASK                        (0x80U)
+
+#endif /* HOSTTESTS_STUBS_DERIVATIVE_H_ */
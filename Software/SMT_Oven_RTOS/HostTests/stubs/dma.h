@@ -0,0 +1,149 @@
+/**
+ * @file    dma.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM DMA interface
+ *
+ * Transfers are performed by the simulation in hostHardware.cpp.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_DMA_H_
+#define HOSTTESTS_STUBS_DMA_H_
+
+#include <stdint.h>
+#include "derivative.h"
+#include "hardware.h"
+#include "hostHardware.h"
+
+namespace USBDM {
+
+typedef void (*DmaCallbackFunction)(void);
+
+enum DmaChannelNum {
+   DmaChannelNum_0 = 0,
+   DmaChannelNum_1 = 1,
+   DmaChannelNum_2 = 2,
+   DmaChannelNum_3 = 3,
+};
+
+enum DmaSize {
+   DmaSize_8bit    = 0,
+   DmaSize_16bit   = 1,
+   DmaSize_32bit   = 2,
+};
+
+enum DmaSlot {
+   DmaSlot_Disabled      = 0,
+   DmaSlot_SPI0_Receive  = 16,
+   DmaSlot_SPI0_Transmit = 17,
+};
+
+enum DmaMuxEnable {
+   DmaMuxEnable_Disable,
+   DmaMuxEnable_Continuous,
+};
+
+/**
+ * Transfer Control Descriptor
+ */
+struct DmaTcd {
+   uint32_t  SADDR;    //!< Source address
+   uint16_t  SOFF;     //!< SADDR offset
+   uint16_t  ATTR;     //!< Transfer attributes
+   uint32_t  NBYTES;   //!< Minor loop byte count
+   uint32_t  SLAST;    //!< Last SADDR adjustment
+   uint32_t  DADDR;    //!< Destination address
+   uint16_t  DOFF;     //!< DADDR offset
+   uint16_t  CITER;    //!< Major loop count
+   uint32_t  DLAST;    //!< Last DADDR adjustment
+   uint16_t  CSR;      //!< Control and Status
+};
+
+/**
+ * Simulated clock gate register
+ */
+extern volatile uint32_t hostDmaClockReg;
+
+struct Dma0Info {
+   static constexpr unsigned           NumChannels = 4;
+   static constexpr volatile uint32_t *clockReg    = &hostDmaClockReg;
+   static constexpr uint32_t           clockMask   = 1;
+};
+
+/**
+ * DMA multiplexor
+ */
+class DmaMux0 {
+
+public:
+   /** Slot connected to each channel */
+   static DmaSlot slots[Dma0Info::NumChannels];
+
+   static void configure(DmaChannelNum dmaChannel, DmaSlot dmaSlot, DmaMuxEnable dmaMuxEnable=DmaMuxEnable_Continuous) {
+      slots[dmaChannel] = (dmaMuxEnable == DmaMuxEnable_Disable)?DmaSlot_Disabled:dmaSlot;
+   }
+   static void disable(DmaChannelNum dmaChannel) {
+      slots[dmaChannel] = DmaSlot_Disabled;
+   }
+};
+
+/**
+ * DMA controller
+ */
+class Dma0 {
+
+public:
+   /** TCD of each channel (CITER counts down as transfers complete) */
+   static DmaTcd              tcds[Dma0Info::NumChannels];
+
+   /** Hardware requests enabled for each channel */
+   static bool                requestsEnabled[Dma0Info::NumChannels];
+
+   /** Interrupt enabled in NVIC for each channel */
+   static bool                nvicEnabled[Dma0Info::NumChannels];
+
+   /** Call-back for each channel */
+   static DmaCallbackFunction callbacks[Dma0Info::NumChannels];
+
+   static void enable() {
+   }
+   static void configureTransfer(DmaChannelNum channel, const DmaTcd &tcd) {
+      tcds[channel] = tcd;
+   }
+   static void enableRequests(DmaChannelNum channel, bool enable=true) {
+      requestsEnabled[channel] = enable;
+      if (enable) {
+         HostHardware::requestDmaService();
+      }
+   }
+   static ErrorCode enableNvicInterrupts(DmaChannelNum channel, bool enable=true) {
+      nvicEnabled[channel] = enable;
+      return E_NO_ERROR;
+   }
+   static void setCallback(DmaChannelNum channel, DmaCallbackFunction callback) {
+      callbacks[channel] = callback;
+   }
+   static void irqHandler(unsigned channel) {
+      if (callbacks[channel] == nullptr) {
+         HostHardware::fail("DMA interrupt without call-back");
+      }
+      callbacks[channel]();
+   }
+   static void irq0Handler() {
+      irqHandler(0);
+   }
+   static void irq1Handler() {
+      irqHandler(1);
+   }
+   static void irq2Handler() {
+      irqHandler(2);
+   }
+   static void irq3Handler() {
+      irqHandler(3);
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_DMA_H_ */
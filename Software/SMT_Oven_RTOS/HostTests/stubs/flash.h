@@ -0,0 +1,8 @@
+/**
+ * @file    flash.h (HostTests/stubs)
+ * @brief   Flash support
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include "ftfl.h"
@@ -0,0 +1,158 @@
+/**
+ * @file    ftfl.h (HostTests/stubs)
+ * @brief   Host stand-in for the Flash and non-volatile variable support
+ *
+ * Program Flash is ordinary host memory with NOR behaviour i.e. programming can only
+ * clear bits and erasing sets them. FlexRAM is ordinary host memory that is always ready.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_FTFL_H_
+#define HOSTTESTS_STUBS_FTFL_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "hardware.h"
+
+namespace USBDM {
+
+enum FlashDriverError_t {
+   FLASH_ERR_OK                = (0),
+   FLASH_ERR_LOCKED            = (1),  // Flash is still locked
+   FLASH_ERR_ILLEGAL_PARAMS    = (2),  // Parameters illegal
+   FLASH_ERR_PROG_FAILED       = (3),  // STM - Programming operation failed - general
+   FLASH_ERR_PROG_WPROT        = (4),  // STM - Programming operation failed - write protected
+   FLASH_ERR_VERIFY_FAILED     = (5),  // Verify failed
+   FLASH_ERR_ERASE_FAILED      = (6),  // Erase or Blank Check failed
+   FLASH_ERR_TRAP              = (7),  // Program trapped (illegal instruction/location etc.)
+   FLASH_ERR_PROG_ACCERR       = (8),  // Kinetis/CFVx - Programming operation failed - ACCERR
+   FLASH_ERR_PROG_FPVIOL       = (9),  // Kinetis/CFVx - Programming operation failed - FPVIOL
+   FLASH_ERR_PROG_MGSTAT0      = (10), // Kinetis - Programming operation failed - MGSTAT0
+   FLASH_ERR_CLKDIV            = (11), // CFVx - Clock divider not set
+   FLASH_ERR_ILLEGAL_SECURITY  = (12), // Kinetis/CFV1+ - Illegal value for security location
+   FLASH_ERR_UNKNOWN           = (13), // Unspecified error
+   FLASH_ERR_PROG_RDCOLERR     = (14), // Read Collision
+   FLASH_ERR_NEW_EEPROM        = (15), // Indicates EEPROM has just bee partitioned and need initialisation
+};
+
+class FtflInfo {
+public:
+   // Sector size for program flash (minimum erase element)
+   static constexpr unsigned programFlashSectorSize = 2048;
+
+   // Phrase size for program flash (minimum programming element)
+   static constexpr unsigned programFlashPhraseSize = 4;
+};
+
+/**
+ * Class representing Flash interface
+ */
+class Flash : public FtflInfo {
+
+public:
+   Flash() {
+   }
+
+   /**
+    * Initialise EEPROM\n
+    * The host is a new device so the first call reports the EEPROM has just been partitioned
+    */
+   static FlashDriverError_t initialiseEeprom() {
+      static bool partitioned = false;
+      if (!partitioned) {
+         partitioned = true;
+         return FLASH_ERR_NEW_EEPROM;
+      }
+      return FLASH_ERR_OK;
+   }
+   static bool isFlexRamConfigured() {
+      return true;
+   }
+   static bool waitForFlashReady() {
+      return true;
+   }
+   static void getStallStatistics(uint32_t &count, uint32_t &totalTime, uint32_t &maxTime) {
+      count     = 0;
+      totalTime = 0;
+      maxTime   = 0;
+   }
+   static void resetStallStatistics() {
+   }
+
+   /**
+    * Invalidate Flash cache and prefetch buffer (no effect on the host)
+    */
+   static void invalidateCache() {
+      FMC->PFB0CR |= FMC_PFB0CR_CINV_WAY_MASK|FMC_PFB0CR_S_B_INV_MASK;
+   }
+
+   /**
+    * Update CRC-32 (IEEE 802.3) with data
+    *
+    * @param[in] crc  Current CRC (start with 0xFFFFFFFF)
+    * @param[in] data Data to add
+    * @param[in] size Size of data in bytes
+    *
+    * @return Updated CRC (complement for final value)
+    */
+   static uint32_t updateCrc32(uint32_t crc, const void *data, unsigned size) {
+      const uint8_t *ptr = (const uint8_t *)data;
+      while (size-->0) {
+         crc ^= *ptr++;
+         for (int bit=0; bit<8; bit++) {
+            crc = (crc&1)?(crc>>1)^0xEDB88320:(crc>>1);
+         }
+      }
+      return crc;
+   }
+
+   /**
+    * Program a range of bytes to Flash memory
+    *
+    * @param[in]  data       Location of data to program
+    * @param[out] address    Memory address to program - must be phrase boundary
+    * @param[in]  size       Size of range (in bytes) to program - must be multiple of phrase size
+    *
+    * @return Error code
+    */
+   static FlashDriverError_t programRange(const uint8_t *data, uint8_t *address, uint32_t size) {
+      if ((((uintptr_t)address|size)&(programFlashPhraseSize-1)) != 0) {
+         return FLASH_ERR_ILLEGAL_PARAMS;
+      }
+      for (uint32_t index=0; index<size; index++) {
+         address[index] &= data[index];
+         if (address[index] != data[index]) {
+            invalidateCache();
+            return FLASH_ERR_VERIFY_FAILED;
+         }
+      }
+      invalidateCache();
+      return FLASH_ERR_OK;
+   }
+
+   /**
+    * Erase a range of Flash memory
+    *
+    * @param[out] address    Memory address to start erasing - must be sector boundary
+    * @param[in]  size       Size of range (in bytes) to erase - must be multiple of sector size
+    *
+    * @return Error code
+    */
+   static FlashDriverError_t eraseRange(uint8_t *address, uint32_t size) {
+      if ((((uintptr_t)address|size)&(programFlashSectorSize-1)) != 0) {
+         return FLASH_ERR_ILLEGAL_PARAMS;
+      }
+      memset(address, 0xFF, size);
+      invalidateCache();
+      return FLASH_ERR_OK;
+   }
+};
+
+} // namespace USBDM
+
+// The non-volatile variables are the firmware's (using the simulated FlexRAM in hostHardware.cpp)
+#include "nonvolatile.h"
+
+#endif /* HOSTTESTS_STUBS_FTFL_H_ */
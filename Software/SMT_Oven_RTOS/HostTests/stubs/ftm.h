@@ -0,0 +1,49 @@
+/**
+ * @file    ftm.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM FlexTimer PWM channels
+ *
+ * The duty-cycle is recorded so it may be checked.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_FTM_H_
+#define HOSTTESTS_STUBS_FTM_H_
+
+#include "hardware.h"
+
+namespace USBDM {
+
+/**
+ * FTM0 channel used as PWM output
+ *
+ * @tparam channel Channel number
+ */
+template<int channel>
+class Ftm0Channel {
+
+public:
+   /** PWM period (s) */
+   static inline float period    = 0;
+
+   /** PWM duty-cycle (%) */
+   static inline float dutyCycle = 0;
+
+   static void enable() {
+   }
+   static ErrorCode setPeriod(float period) {
+      Ftm0Channel::period = period;
+      return E_NO_ERROR;
+   }
+   static void setDutyCycle(int dutyCycle) {
+      Ftm0Channel::dutyCycle = dutyCycle;
+   }
+   static void setDutyCycle(float dutyCycle) {
+      Ftm0Channel::dutyCycle = dutyCycle;
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_FTM_H_ */
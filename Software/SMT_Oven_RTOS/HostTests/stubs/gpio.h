@@ -0,0 +1,128 @@
+/**
+ * @file    gpio.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM GPIO templates
+ *
+ * Pins are bits in the simulated ports (see HostHardware::gpioPorts).
+ * Outputs drive the port data register. The level of input pins is set by the
+ * simulation and undriven inputs read high as if pulled-up.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_GPIO_H_
+#define HOSTTESTS_STUBS_GPIO_H_
+
+#include <stdint.h>
+#include "hostHardware.h"
+
+namespace USBDM {
+
+/**
+ * Pin of a simulated GPIO port
+ *
+ * @tparam portNum   Port number (0 => PORTA etc.)
+ * @tparam bitNum    Bit number within port
+ * @tparam polarity  Either USBDM::ActiveHigh or USBDM::ActiveLow
+ */
+template<unsigned portNum, int bitNum, Polarity polarity>
+class GpioBase_T {
+
+private:
+   GpioBase_T() = delete;
+   GpioBase_T(const GpioBase_T&) = delete;
+
+   static HostHardware::GpioPort &port() {
+      return HostHardware::gpioPorts[portNum];
+   }
+
+public:
+   /** Bit number of accessed bit in port */
+   static constexpr int BITNUM = bitNum;
+
+   /** Mask for bit within port */
+   static constexpr uint32_t MASK = (1U<<bitNum);
+
+   static void setPCR(PcrValue =0) {
+   }
+   static void setOut() {
+      port().pddr |= MASK;
+   }
+   static void setOutput(PcrValue =0) {
+      setOut();
+   }
+   static void setIn() {
+      port().pddr &= ~MASK;
+   }
+   static void setInput(PcrValue =0) {
+      setIn();
+   }
+   static void high() {
+      port().pdor |= MASK;
+   }
+   static void low() {
+      port().pdor &= ~MASK;
+   }
+   static void set() {
+      high();
+   }
+   static void clear() {
+      low();
+   }
+   static void toggle() {
+      port().pdor ^= MASK;
+   }
+   static void setActive() {
+      if (polarity) {
+         set();
+      }
+      else {
+         clear();
+      }
+   }
+   static void setInactive() {
+      if (polarity) {
+         clear();
+      }
+      else {
+         set();
+      }
+   }
+   static void on() {
+      setActive();
+   }
+   static void off() {
+      setInactive();
+   }
+   static void write(bool value) {
+      if (value) {
+         setActive();
+      }
+      else {
+         setInactive();
+      }
+   }
+   static bool isHigh() {
+      return (HostHardware::readPort(portNum) & MASK) != 0;
+   }
+   static bool isLow() {
+      return !isHigh();
+   }
+   static bool read() {
+      return polarity?isHigh():isLow();
+   }
+   static bool readState() {
+      bool t = (port().pdor & MASK) != 0;
+      return polarity?t:!t;
+   }
+};
+
+template<int bitNum, Polarity polarity=ActiveHigh> class GpioA : public GpioBase_T<0, bitNum, polarity> {};
+template<int bitNum, Polarity polarity=ActiveHigh> class GpioB : public GpioBase_T<1, bitNum, polarity> {};
+template<int bitNum, Polarity polarity=ActiveHigh> class GpioC : public GpioBase_T<2, bitNum, polarity> {};
+template<int bitNum, Polarity polarity=ActiveHigh> class GpioD : public GpioBase_T<3, bitNum, polarity> {};
+template<int bitNum, Polarity polarity=ActiveHigh> class GpioE : public GpioBase_T<4, bitNum, polarity> {};
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_GPIO_H_ */
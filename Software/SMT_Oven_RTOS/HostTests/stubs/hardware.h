@@ -0,0 +1,133 @@
+/**
+ * @file    hardware.h (HostTests/stubs)
+ * @brief   Host stand-in for hardware.h, pin_mapping.h and pcr.h
+ *
+ * GPIOs are provided by gpio.h.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_HARDWARE_H_
+#define HOSTTESTS_STUBS_HARDWARE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "derivative.h"
+
+namespace USBDM {
+
+static constexpr float ns      = 1E-9f; //!< Scale factor for nanoseconds
+static constexpr float us      = 1E-6f; //!< Scale factor for microseconds
+static constexpr float ms      = 1E-3f; //!< Scale factor for milliseconds
+static constexpr float seconds = 1.0f;  //!< Scale factor for seconds
+static constexpr float percent = 1.0f;  //!< Scale factor for percentage as float
+
+enum ErrorCode {
+   E_NO_ERROR = 0,      //!< No error
+   E_ERROR,             //!< General error
+   E_TOO_SMALL,         //!< Value too small
+   E_TOO_LARGE,         //!< Value too large
+   E_ILLEGAL_PARAM,     //!< Parameter has illegal value
+   E_NO_HANDLER,        //!< No handler installed
+   E_FLASH_INIT_FAILED, //!< Flash initialisation failed
+   E_TERMINATED,        //!< The program has terminated
+   E_CALIBRATE_FAIL,    //!< Failed ADC calibration
+   E_CMSIS_ERR_OFFSET = 1<<20, //!< Offset added to CMSIS error codes
+};
+
+/** Last error (defined by hostHardware.cpp) */
+extern volatile ErrorCode errorCode;
+
+inline ErrorCode getError() {
+   return errorCode;
+}
+
+inline const char *getErrorMessage(ErrorCode err = errorCode) {
+   return (err == E_NO_ERROR)?"No error":"Error";
+}
+
+/**
+ * Check for error - an error is fatal on the host
+ */
+inline static ErrorCode checkError() {
+   if (errorCode != E_NO_ERROR) {
+      fprintf(stderr, "USBDM error %d\n", errorCode);
+      abort();
+   }
+   return errorCode;
+}
+
+inline static ErrorCode setErrorCode(ErrorCode err) {
+   errorCode = err;
+   return errorCode;
+}
+
+inline static ErrorCode setAndCheckErrorCode(ErrorCode err) {
+   errorCode = err;
+   return checkError();
+}
+
+inline static ErrorCode setCmsisErrorCode(int err) {
+   if (err != 0) {
+      err |= E_CMSIS_ERR_OFFSET;
+   }
+   errorCode = (ErrorCode)err;
+   return errorCode;
+}
+
+inline static ErrorCode setAndCheckCmsisErrorCode(int err) {
+   setCmsisErrorCode(err);
+   return checkError();
+}
+
+inline void clearError() {
+   errorCode = E_NO_ERROR;
+}
+
+/** Signal polarity */
+enum Polarity {
+   ActiveLow=false,
+   ActiveHigh=true,
+};
+
+/** Pin configuration value (ignored on host) */
+using PcrValue = uint32_t;
+
+enum PinPull {
+   PinPullNone = 0,
+   PinPullUp   = 1,
+   PinPullDown = 2,
+};
+
+enum PinDriveStrength {
+   PinDriveStrengthLow  = 0,
+   PinDriveStrengthHigh = 1,
+};
+
+enum PinDriveMode {
+   PinDriveModePushPull  = 0,
+   PinDriveModeOpenDrain = 1,
+};
+
+enum PinIrq {
+   PinIrqNone = 0,
+};
+
+static constexpr PcrValue pcrValue(uint32_t pull=PinPullNone, uint32_t drive=PinDriveStrengthLow, uint32_t mode=PinDriveModePushPull, uint32_t irq=PinIrqNone) {
+   return pull|(drive<<2)|(mode<<3)|(irq<<16);
+}
+
+/**
+ * Map all pins (no effect on host)
+ */
+inline void mapAllPins() {
+}
+
+} // End namespace USBDM
+
+#include "gpio.h"
+#include "ftm.h"
+
+#endif /* HOSTTESTS_STUBS_HARDWARE_H_ */
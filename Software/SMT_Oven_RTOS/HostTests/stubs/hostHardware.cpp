@@ -0,0 +1,440 @@
+/**
+ * @file    hostHardware.cpp
+ * @brief   Simulated peripherals used by host builds
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include "hostHardware.h"
+#include "hostKernel.h"
+#include "hardware.h"
+#include "spi.h"
+#include "dma.h"
+
+namespace USBDM {
+
+volatile ErrorCode   errorCode = E_NO_ERROR;
+
+volatile uint32_t    hostDmaClockReg = 0;
+
+CMSIS::Mutex         Spi0::mutex;
+
+DmaSlot              DmaMux0::slots[Dma0Info::NumChannels];
+
+DmaTcd               Dma0::tcds[Dma0Info::NumChannels];
+bool                 Dma0::requestsEnabled[Dma0Info::NumChannels];
+bool                 Dma0::nvicEnabled[Dma0Info::NumChannels];
+DmaCallbackFunction  Dma0::callbacks[Dma0Info::NumChannels];
+
+} // End namespace USBDM
+
+FMC_Type             hostFmc;
+
+/*
+ * Program flash regions reserved by the linker script (Project_Settings/Linker_Files).
+ * The sizes are given to the linker as symbols (see Makefile).
+ */
+extern "C" {
+alignas(2048) uint8_t __runArchive_start__[0x8000];
+alignas(2048) uint8_t __profileLibrary_start__[0xC000];
+}
+
+/** Size of FlexRAM (see MemoryMap-mk22dx256m5.ld) */
+static constexpr unsigned FLEXRAM_SIZE = 0x1000;
+
+/*
+ * RAM shadow and write counters of the non-volatile variables (see Linker-rom.ld).
+ * The variables themselves are placed in the simulated FlexRAM by flexRam.ld.
+ */
+extern "C" {
+extern uint8_t __flexRAM_start__[];
+extern uint8_t __flexRAM_end__[];
+alignas(4) uint8_t __flexRAM_shadow__[FLEXRAM_SIZE];
+uint16_t           __flexRAM_counts__[FLEXRAM_SIZE/sizeof(uint32_t)];
+}
+
+/**
+ * Flash regions and FlexRAM are initially erased as for a new device\n
+ * This runs before the static constructors of the code under test.
+ */
+__attribute__((constructor(101)))
+static void eraseFlashRegions() {
+   memset(__runArchive_start__,     0xFF, sizeof(__runArchive_start__));
+   memset(__profileLibrary_start__, 0xFF, sizeof(__profileLibrary_start__));
+   if ((unsigned)(__flexRAM_end__-__flexRAM_start__) > FLEXRAM_SIZE) {
+      fprintf(stderr, "hostHardware: Non-volatile variables do not fit in FlexRAM\n");
+      abort();
+   }
+   memset(__flexRAM_start__, 0xFF, __flexRAM_end__-__flexRAM_start__);
+}
+
+/*
+ * DMA channel vectors (provided by the code under test if used)
+ */
+extern "C" void DMA0_IRQHandler() __attribute__((weak));
+extern "C" void DMA1_IRQHandler() __attribute__((weak));
+extern "C" void DMA2_IRQHandler() __attribute__((weak));
+extern "C" void DMA3_IRQHandler() __attribute__((weak));
+
+namespace HostHardware {
+
+using namespace USBDM;
+
+SPI_Type       spi0;
+SpiStatistics  spiStatistics;
+GpioPort       gpioPorts[5] = {
+      {0, 0, 0xFFFFFFFF}, {0, 0, 0xFFFFFFFF}, {0, 0, 0xFFFFFFFF}, {0, 0, 0xFFFFFFFF}, {0, 0, 0xFFFFFFFF},
+};
+
+/** Depth of SPI FIFOs */
+static constexpr unsigned FIFO_DEPTH = 4;
+
+/** SPI status flags that are cleared by writing 1 */
+static constexpr uint32_t SR_W1C_MASK = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_TFUF_MASK|SPI_SR_RFOF_MASK;
+
+/**
+ * Internal state of simulated SPI0
+ */
+struct SpiState {
+   std::deque<uint32_t>    txFifo;
+   std::deque<uint32_t>    rxFifo;
+   uint32_t                flags = 0;        // Sticky SR flags (SR_W1C_MASK)
+   uint32_t                activePcs = 0;    // PCS mask currently asserted
+   SpiDevice              *devices[6] = {};
+   std::vector<SpiFrame>  *recording = nullptr;
+};
+
+/**
+ * Get state of simulated SPI0\n
+ * This is created on first use as the SPI may be used by static constructors.
+ */
+static SpiState &getSpiState() {
+   static SpiState *state = new SpiState;
+   return *state;
+}
+
+/** DMA service event is pending */
+static bool dmaServicePending = false;
+
+void fail(const char *message) {
+   fprintf(stderr, "HostHardware: %s (t=%llu us)\n", message, (unsigned long long)HostKernel::getTime());
+   abort();
+}
+
+void attachSpiDevice(unsigned pcsNum, SpiDevice *device) {
+   SpiState &spiState = getSpiState();
+   if (pcsNum >= (sizeof(spiState.devices)/sizeof(spiState.devices[0]))) {
+      fail("Illegal PCS number");
+   }
+   spiState.devices[pcsNum] = device;
+}
+
+void recordSpiFrames(std::vector<SpiFrame> *frames) {
+   SpiState &spiState = getSpiState();
+   spiState.recording = frames;
+}
+
+/**
+ * Schedule next mains zero-crossing
+ *
+ * @param[in] crossing Function called at zero-crossing
+ * @param[in] rising   Polarity of crossing
+ */
+static void scheduleMainsCrossing(void (*crossing)(bool rising), bool rising) {
+   HostKernel::scheduleEvent(HostKernel::getTime()+1000000/(2*MAINS_FREQUENCY), [crossing, rising] {
+      scheduleMainsCrossing(crossing, !rising);
+      crossing(rising);
+   });
+}
+
+void startMains(void (*crossing)(bool rising)) {
+   static bool running = false;
+   if (!running) {
+      running = true;
+      scheduleMainsCrossing(crossing, true);
+   }
+}
+
+bool busyWait(uint64_t usToWait, bool testFn(void)) {
+   if (HostKernel::isInterrupt()) {
+      fail("Busy-wait in interrupt handler");
+   }
+   bool expired = false;
+   unsigned timeout = HostKernel::scheduleEvent(HostKernel::getTime()+usToWait, [&expired] {
+      expired = true;
+   });
+   bool satisfied = false;
+   HostKernel::block([&] {
+      satisfied = (testFn != nullptr) && testFn();
+      return satisfied || expired;
+   }, osWaitForever);
+   if (!expired) {
+      HostKernel::cancelEvent(timeout);
+   }
+   return satisfied;
+}
+
+/**
+ * Change the asserted PCS signals
+ *
+ * @param[in] pcs Mask for PCS to assert (0 => none)
+ */
+static void changePcs(uint32_t pcs) {
+   SpiState &spiState = getSpiState();
+   if (pcs == spiState.activePcs) {
+      return;
+   }
+   for (unsigned pcsNum=0; pcsNum<6; pcsNum++) {
+      if ((spiState.activePcs&(1<<pcsNum)) && (spiState.devices[pcsNum] != nullptr)) {
+         spiState.devices[pcsNum]->deselect();
+      }
+   }
+   spiState.activePcs = pcs;
+   if (pcs != 0) {
+      spiStatistics.selects++;
+   }
+   for (unsigned pcsNum=0; pcsNum<6; pcsNum++) {
+      if ((pcs&(1<<pcsNum)) && (spiState.devices[pcsNum] != nullptr)) {
+         spiState.devices[pcsNum]->select();
+      }
+   }
+}
+
+/**
+ * Transmit frames from the transmit FIFO until it is empty or the SPI is stopped
+ */
+static void transmit() {
+   SpiState &spiState = getSpiState();
+   while (!spiState.txFifo.empty() &&
+          ((spi0.MCR.value&SPI_MCR_HALT_MASK) == 0) &&
+          ((spiState.flags&SPI_SR_EOQF_MASK) == 0)) {
+      uint32_t pushr = spiState.txFifo.front();
+      spiState.txFifo.pop_front();
+
+      uint32_t pcs = (pushr&SPI_PUSHR_PCS_MASK)>>SPI_PUSHR_PCS_SHIFT;
+      if ((spiState.activePcs != 0) && (pcs != spiState.activePcs)) {
+         // Previous frame held PCS (CONT) but this frame selects something else
+         spiStatistics.pcsChanges++;
+      }
+      changePcs(pcs);
+
+      // Selected devices drive MISO (open-drain AND if several are selected)
+      uint8_t received = 0xFF;
+      for (unsigned pcsNum=0; pcsNum<6; pcsNum++) {
+         if ((pcs&(1<<pcsNum)) && (spiState.devices[pcsNum] != nullptr)) {
+            received &= spiState.devices[pcsNum]->transfer((uint8_t)pushr);
+         }
+      }
+      spiStatistics.frames++;
+      if (spiState.recording != nullptr) {
+         spiState.recording->push_back(SpiFrame{HostKernel::getTime(), pushr, received});
+      }
+      if (spiState.rxFifo.size() >= FIFO_DEPTH) {
+         spiState.flags |= SPI_SR_RFOF_MASK;
+         spiStatistics.rxOverflows++;
+      }
+      else {
+         spiState.rxFifo.push_back(received);
+      }
+      spiState.flags |= SPI_SR_TCF_MASK;
+      if ((pushr&SPI_PUSHR_CONT_MASK) == 0) {
+         changePcs(0);
+      }
+      if (pushr&SPI_PUSHR_EOQ_MASK) {
+         spiState.flags |= SPI_SR_EOQF_MASK;
+      }
+   }
+}
+
+/**
+ * Read from address used by DMA
+ */
+static uint32_t dmaRead(uint32_t address, unsigned size) {
+   if (address == (uint32_t)(uintptr_t)&spi0.POPR) {
+      return spi0.POPR;
+   }
+   switch(size) {
+   case 1:  return *(uint8_t *)(uintptr_t)address;
+   case 2:  return *(uint16_t *)(uintptr_t)address;
+   default: return *(uint32_t *)(uintptr_t)address;
+   }
+}
+
+/**
+ * Write to address used by DMA
+ */
+static void dmaWrite(uint32_t address, unsigned size, uint32_t value) {
+   if (address == (uint32_t)(uintptr_t)&spi0.PUSHR) {
+      spi0.PUSHR = value;
+      return;
+   }
+   switch(size) {
+   case 1:  *(uint8_t *)(uintptr_t)address  = value; break;
+   case 2:  *(uint16_t *)(uintptr_t)address = value; break;
+   default: *(uint32_t *)(uintptr_t)address = value; break;
+   }
+}
+
+/**
+ * Check if the peripheral connected to a DMA channel is requesting service
+ */
+static bool dmaRequest(unsigned channel) {
+   SpiState &spiState = getSpiState();
+   if (!Dma0::requestsEnabled[channel]) {
+      return false;
+   }
+   uint32_t rser = spi0.RSER;
+   switch(DmaMux0::slots[channel]) {
+   case DmaSlot_SPI0_Transmit:
+      return ((rser&(SPI_RSER_TFFF_RE_MASK|SPI_RSER_TFFF_DIRS_MASK)) == (SPI_RSER_TFFF_RE_MASK|SPI_RSER_TFFF_DIRS_MASK)) &&
+             (spiState.txFifo.size() < FIFO_DEPTH);
+   case DmaSlot_SPI0_Receive:
+      return ((rser&(SPI_RSER_RFDF_RE_MASK|SPI_RSER_RFDF_DIRS_MASK)) == (SPI_RSER_RFDF_RE_MASK|SPI_RSER_RFDF_DIRS_MASK)) &&
+             !spiState.rxFifo.empty();
+   default:
+      return false;
+   }
+}
+
+/**
+ * Execute DMA channel interrupt vector
+ */
+static void dmaInterrupt(unsigned channel) {
+   void (*const vectors[])() = {DMA0_IRQHandler, DMA1_IRQHandler, DMA2_IRQHandler, DMA3_IRQHandler};
+   if (!Dma0::nvicEnabled[channel]) {
+      return;
+   }
+   if (vectors[channel] == nullptr) {
+      fail("DMA interrupt without handler");
+   }
+   vectors[channel]();
+}
+
+/**
+ * Perform one minor loop on a DMA channel
+ */
+static void dmaMinorLoop(unsigned channel) {
+   DmaTcd &tcd = Dma0::tcds[channel];
+   if (tcd.CITER == 0) {
+      fail("DMA request with CITER == 0");
+   }
+   unsigned sourceSize      = 1U<<((tcd.ATTR&DMA_ATTR_SSIZE_MASK)>>DMA_ATTR_SSIZE_SHIFT);
+   unsigned destinationSize = 1U<<(tcd.ATTR&DMA_ATTR_DSIZE_MASK);
+   if (sourceSize != destinationSize) {
+      fail("DMA source and destination sizes differ");
+   }
+   for (unsigned count=0; count<tcd.NBYTES; count += sourceSize) {
+      dmaWrite(tcd.DADDR, destinationSize, dmaRead(tcd.SADDR, sourceSize));
+      tcd.SADDR += (int16_t)tcd.SOFF;
+      tcd.DADDR += (int16_t)tcd.DOFF;
+   }
+   if (--tcd.CITER == 0) {
+      tcd.SADDR += tcd.SLAST;
+      tcd.DADDR += tcd.DLAST;
+      tcd.CSR   |= DMA_CSR_DONE_MASK;
+      if (tcd.CSR&DMA_CSR_DREQ_MASK) {
+         Dma0::requestsEnabled[channel] = false;
+      }
+      if (tcd.CSR&DMA_CSR_INTMAJOR_MASK) {
+         dmaInterrupt(channel);
+      }
+   }
+}
+
+/**
+ * Service DMA channels until no requests remain
+ */
+static void dmaService() {
+   dmaServicePending = false;
+   bool progress;
+   do {
+      progress = false;
+      for (unsigned channel=0; channel<Dma0Info::NumChannels; channel++) {
+         if (dmaRequest(channel)) {
+            dmaMinorLoop(channel);
+            progress = true;
+         }
+      }
+   } while (progress);
+}
+
+void requestDmaService() {
+   if (!dmaServicePending) {
+      dmaServicePending = true;
+      HostKernel::scheduleEvent(HostKernel::getTime(), dmaService);
+   }
+}
+
+} // end namespace HostHardware
+
+using namespace HostHardware;
+
+HostSpiRegister::operator uint32_t() const volatile {
+   SpiState &spiState = getSpiState();
+   if (fSpi != &spi0) {
+      fail("Unknown SPI");
+   }
+   switch(fId) {
+   case SR: {
+      uint32_t sr = spiState.flags;
+      if (spiState.txFifo.size() < FIFO_DEPTH) {
+         sr |= SPI_SR_TFFF_MASK;
+      }
+      if (!spiState.rxFifo.empty()) {
+         sr |= SPI_SR_RFDF_MASK;
+      }
+      sr |= (spiState.txFifo.size()<<12)|(spiState.rxFifo.size()<<4);
+      return sr;
+   }
+   case POPR: {
+      if (spiState.rxFifo.empty()) {
+         return 0;
+      }
+      uint32_t data = spiState.rxFifo.front();
+      spiState.rxFifo.pop_front();
+      requestDmaService();
+      return data;
+   }
+   default:
+      return value;
+   }
+}
+
+void HostSpiRegister::operator=(uint32_t newValue) volatile {
+   SpiState &spiState = getSpiState();
+   if (fSpi != &spi0) {
+      fail("Unknown SPI");
+   }
+   switch(fId) {
+   case MCR:
+      if (newValue&SPI_MCR_CLR_TXF_MASK) {
+         spiState.txFifo.clear();
+      }
+      if (newValue&SPI_MCR_CLR_RXF_MASK) {
+         spiState.rxFifo.clear();
+      }
+      value = newValue&~(SPI_MCR_CLR_TXF_MASK|SPI_MCR_CLR_RXF_MASK);
+      break;
+   case SR:
+      spiState.flags &= ~(newValue&SR_W1C_MASK);
+      break;
+   case PUSHR:
+      value = newValue;
+      if (spiState.txFifo.size() >= FIFO_DEPTH) {
+         // Ignored by hardware
+         spiStatistics.txOverflows++;
+      }
+      else {
+         spiState.txFifo.push_back(newValue);
+      }
+      break;
+   case POPR:
+      return;
+   }
+   transmit();
+   requestDmaService();
+}
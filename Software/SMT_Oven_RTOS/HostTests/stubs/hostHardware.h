@@ -0,0 +1,161 @@
+/**
+ * @file    hostHardware.h
+ * @brief   Simulated peripherals used by host builds
+ *
+ * SPI0 (DSPI)
+ *  - Frames written to PUSHR are queued in a 4 entry FIFO and transmitted immediately
+ *    unless the module is halted (MCR.HALT) or stopped at the end of a queue (SR.EOQF)
+ *    as on the target. Writes to a full FIFO are lost and counted.
+ *  - PCS is asserted for consecutive frames with PUSHR.CONT set. A device attached
+ *    to the asserted PCS supplies the received data (0xFF if none).
+ *
+ * DMA
+ *  - Channels routed to the SPI0 transmit/receive slots move data between memory and
+ *    PUSHR/POPR while requests are enabled and the SPI has the matching DMA requests enabled.
+ *  - Completion of the major loop calls DMAn_IRQHandler() if INTMAJOR is set.
+ *
+ * GPIO
+ *  - Output pins drive the port data register. The simulation sets the level of input pins.
+ *
+ * Mains (CMP0)
+ *  - Zero-crossings of a 50Hz mains supply occur every 10ms once the comparator is enabled.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_HOSTHARDWARE_H_
+#define HOSTTESTS_STUBS_HOSTHARDWARE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "derivative.h"
+
+namespace HostHardware {
+
+/** Simulated SPI0 registers */
+extern SPI_Type spi0;
+
+/**
+ * Frame transmitted over SPI
+ */
+struct SpiFrame {
+   uint64_t time;       //!< Virtual time of transmission (us)
+   uint32_t pushr;      //!< PUSHR value (data and control)
+   uint8_t  received;   //!< Data received
+};
+
+/**
+ * SPI activity counts
+ */
+struct SpiStatistics {
+   unsigned transactions;  //!< Calls to Spi::startTransaction() that obtained the SPI
+   unsigned frames;        //!< Frames transmitted
+   unsigned selects;       //!< PCS assertions
+   unsigned txOverflows;   //!< Frames written to a full transmit FIFO (lost)
+   unsigned rxOverflows;   //!< Frames received with receive FIFO full (lost)
+   unsigned pcsChanges;    //!< PCS changed while asserted by CONT
+};
+
+/** SPI activity counts */
+extern SpiStatistics spiStatistics;
+
+/**
+ * Device connected to SPI
+ */
+class SpiDevice {
+public:
+   virtual ~SpiDevice() {}
+
+   /** PCS asserted */
+   virtual void select() {}
+
+   /**
+    * Exchange a frame
+    *
+    * @param[in] data Data from SPI
+    *
+    * @return Data to SPI
+    */
+   virtual uint8_t transfer(uint8_t data) = 0;
+
+   /** PCS negated */
+   virtual void deselect() {}
+};
+
+/**
+ * Connect device to SPI0
+ *
+ * @param[in] pcsNum Number of PCS signal selecting device
+ * @param[in] device Device (nullptr to disconnect)
+ */
+void attachSpiDevice(unsigned pcsNum, SpiDevice *device);
+
+/**
+ * Record frames transmitted on SPI0
+ *
+ * @param[in] frames Where to append frames (nullptr to stop recording)
+ */
+void recordSpiFrames(std::vector<SpiFrame> *frames);
+
+/**
+ * Service DMA requests at the current time
+ */
+void requestDmaService();
+
+/**
+ * Simulated GPIO port
+ */
+struct GpioPort {
+   uint32_t pdor;   //!< Output data
+   uint32_t pddr;   //!< Direction (1 => output)
+   uint32_t pdir;   //!< Level applied to input pins (undriven inputs read high)
+};
+
+/** Simulated GPIO ports A-E */
+extern GpioPort gpioPorts[5];
+
+/**
+ * Get level of port pins
+ *
+ * @param[in] portNum Port number (0 => PORTA etc.)
+ *
+ * @return Output level for output pins, applied level for input pins
+ */
+inline uint32_t readPort(unsigned portNum) {
+   const GpioPort &port = gpioPorts[portNum];
+   return (port.pddr&port.pdor)|(~port.pddr&port.pdir);
+}
+
+/** Mains frequency (Hz) */
+static constexpr unsigned MAINS_FREQUENCY = 50;
+
+/**
+ * Start mains zero-crossing events
+ *
+ * @param[in] crossing Function called in 'interrupt' context at each zero-crossing
+ *                     (rising => mains has become positive)
+ */
+void startMains(void (*crossing)(bool rising));
+
+/**
+ * Busy-wait on the target.\n
+ * The host thread blocks so time may advance.
+ *
+ * @param[in] usToWait Time to wait (us)
+ * @param[in] testFn   Function indicating if waited for condition has occurred (may be nullptr)
+ *
+ * @return true if testFn returned true before the time elapsed
+ */
+bool busyWait(uint64_t usToWait, bool testFn(void));
+
+/**
+ * Report a simulation failure and terminate
+ *
+ * @param[in] message Description of failure
+ */
+[[noreturn]] void fail(const char *message);
+
+}; // end namespace HostHardware
+
+#endif /* HOSTTESTS_STUBS_HOSTHARDWARE_H_ */
@@ -0,0 +1,367 @@
+/**
+ * @file    hostKernel.cpp
+ * @brief   Deterministic virtual-time kernel standing in for CMSIS-RTX in host builds
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "hostKernel.h"
+
+/**
+ * Kernel task (CMSIS thread)
+ */
+struct os_thread_cb {
+   enum State {
+      Ready,
+      Running,
+      Blocked,
+      Terminated,
+   };
+   HostKernel::ThreadFunction function;      //!< Thread function
+   const void                *argument;      //!< Argument to thread function
+   osPriority                 priority;      //!< Priority
+   State                      state;         //!< Current state
+   uint64_t                   order;         //!< Orders equal priority tasks (FIFO)
+   HostKernel::Condition      condition;     //!< Condition being waited for when Blocked
+   uint64_t                   timeout;       //!< Time that wait expires when Blocked
+   int32_t                    signals;       //!< Signal flags
+};
+
+namespace HostKernel {
+
+/** Timeout indicating no timeout */
+static constexpr uint64_t NEVER = UINT64_MAX;
+
+/**
+ * Kernel state\n
+ * Only accessed by the thread holding the baton (or an event run by it).
+ * This is allocated and never freed so threads still blocked at exit are harmless.
+ */
+struct Kernel {
+   /** Protects baton */
+   std::mutex              batonMutex;
+
+   /** Signals change of baton owner */
+   std::condition_variable batonChanged;
+
+   /** Task allowed to run */
+   os_thread_cb           *current = nullptr;
+
+   /** All tasks */
+   std::vector<os_thread_cb *> tasks;
+
+   /** Pending events by (time, sequence) */
+   std::map<std::pair<uint64_t, unsigned>, EventFunction> events;
+
+   /** Virtual time (us) */
+   uint64_t                now = 0;
+
+   /** Used to order tasks and events */
+   uint64_t                sequence = 0;
+
+   /** Number of events executed */
+   uint64_t                eventCount = 0;
+
+   /** Executing event */
+   bool                    inEvent = false;
+};
+
+static Kernel &kernel() {
+   static Kernel *k = new Kernel;
+   return *k;
+}
+
+/** Task associated with each host thread */
+static thread_local os_thread_cb *thisTask = nullptr;
+
+/**
+ * Get current task\n
+ * The first host thread to call the kernel becomes a normal priority thread
+ */
+static os_thread_cb *self() {
+   if (thisTask == nullptr) {
+      Kernel &k = kernel();
+      if (k.current != nullptr) {
+         fprintf(stderr, "HostKernel: Kernel used from a foreign host thread\n");
+         abort();
+      }
+      thisTask = new os_thread_cb{nullptr, nullptr, osPriorityNormal, os_thread_cb::Running, 0, nullptr, NEVER, 0};
+      k.tasks.push_back(thisTask);
+      k.current = thisTask;
+   }
+   return thisTask;
+}
+
+/**
+ * Check if task may run
+ */
+static bool isReady(os_thread_cb *task) {
+   switch(task->state) {
+   case os_thread_cb::Ready:
+   case os_thread_cb::Running:
+      return true;
+   case os_thread_cb::Blocked:
+      return (kernel().now >= task->timeout) || (task->condition && task->condition());
+   default:
+      return false;
+   }
+}
+
+/**
+ * Find highest priority task that may run
+ */
+static os_thread_cb *findReady() {
+   os_thread_cb *best = nullptr;
+   for (os_thread_cb *task:kernel().tasks) {
+      if (!isReady(task)) {
+         continue;
+      }
+      if ((best == nullptr) || (task->priority > best->priority) ||
+            ((task->priority == best->priority) && (task->order < best->order))) {
+         best = task;
+      }
+   }
+   return best;
+}
+
+/**
+ * Advance time to the next event or timeout and execute the events due
+ *
+ * @return false if nothing will ever happen
+ */
+static bool advanceTime() {
+   Kernel &k = kernel();
+   uint64_t next = NEVER;
+   if (!k.events.empty()) {
+      next = k.events.begin()->first.first;
+   }
+   for (os_thread_cb *task:k.tasks) {
+      if ((task->state == os_thread_cb::Blocked) && (task->timeout < next)) {
+         next = task->timeout;
+      }
+   }
+   if (next == NEVER) {
+      return false;
+   }
+   if (next > k.now) {
+      k.now = next;
+   }
+   while (!k.events.empty() && (k.events.begin()->first.first <= k.now)) {
+      EventFunction function = k.events.begin()->second;
+      k.events.erase(k.events.begin());
+      k.inEvent = true;
+      function();
+      k.inEvent = false;
+      k.eventCount++;
+   }
+   return true;
+}
+
+/**
+ * Pass the baton to another task
+ *
+ * @param[in] from Task giving up the baton
+ * @param[in] to   Task to run
+ */
+static void switchTo(os_thread_cb *from, os_thread_cb *to) {
+   Kernel &k = kernel();
+   to->state = os_thread_cb::Running;
+   if (from == to) {
+      return;
+   }
+   std::unique_lock<std::mutex> lock(k.batonMutex);
+   k.current = to;
+   k.batonChanged.notify_all();
+   if (from->state != os_thread_cb::Terminated) {
+      k.batonChanged.wait(lock, [from, &k]{ return k.current == from; });
+   }
+}
+
+/**
+ * Run the highest priority task, advancing time as necessary\n
+ * Returns when the calling task is chosen to run.
+ *
+ * @param[in] task Calling task (state already changed to Ready, Blocked or Terminated)
+ */
+static void schedule(os_thread_cb *task) {
+   for(;;) {
+      os_thread_cb *next = findReady();
+      if (next != nullptr) {
+         switchTo(task, next);
+         return;
+      }
+      if (!advanceTime()) {
+         fprintf(stderr, "HostKernel: Deadlock - all threads are blocked forever\n");
+         abort();
+      }
+   }
+}
+
+uint64_t getTime() {
+   return kernel().now;
+}
+
+bool isInterrupt() {
+   return kernel().inEvent;
+}
+
+/**
+ * Body of host thread running a task
+ */
+static void taskBody(os_thread_cb *task) {
+   Kernel &k = kernel();
+   {
+      std::unique_lock<std::mutex> lock(k.batonMutex);
+      k.batonChanged.wait(lock, [task, &k]{ return k.current == task; });
+   }
+   thisTask = task;
+   task->function(task->argument);
+   task->state = os_thread_cb::Terminated;
+   schedule(task);
+}
+
+osThreadId createThread(ThreadFunction function, const void *argument, osPriority priority) {
+   Kernel &k = kernel();
+   self();
+   os_thread_cb *task = new os_thread_cb{function, argument, priority, os_thread_cb::Ready, ++k.sequence, nullptr, NEVER, 0};
+   k.tasks.push_back(task);
+   std::thread(taskBody, task).detach();
+   reschedule();
+   return task;
+}
+
+bool block(Condition condition, uint32_t millisec) {
+   Kernel &k = kernel();
+   if (condition && condition()) {
+      return true;
+   }
+   if ((millisec == 0) || k.inEvent) {
+      return false;
+   }
+   os_thread_cb *task = self();
+   task->condition = condition;
+   task->timeout   = (millisec == osWaitForever)?NEVER:k.now+1000ULL*millisec;
+   task->state     = os_thread_cb::Blocked;
+   task->order     = ++k.sequence;
+   schedule(task);
+   bool satisfied = condition && condition();
+   task->condition = nullptr;
+   task->timeout   = NEVER;
+   return satisfied;
+}
+
+void reschedule() {
+   Kernel &k = kernel();
+   if (k.inEvent) {
+      return;
+   }
+   os_thread_cb *task = self();
+   os_thread_cb *next = findReady();
+   if ((next != nullptr) && (next->priority > task->priority)) {
+      task->state = os_thread_cb::Ready;
+      task->order = ++k.sequence;
+      schedule(task);
+   }
+}
+
+void waitForEvent() {
+   uint64_t count = kernel().eventCount;
+   block([count]{ return kernel().eventCount != count; }, osWaitForever);
+}
+
+unsigned scheduleEvent(uint64_t time, EventFunction function) {
+   Kernel &k = kernel();
+   unsigned handle = (unsigned)++k.sequence;
+   k.events[std::make_pair(time, handle)] = function;
+   return handle;
+}
+
+void cancelEvent(unsigned handle) {
+   Kernel &k = kernel();
+   for (auto it=k.events.begin(); it!=k.events.end(); ++it) {
+      if (it->first.second == handle) {
+         k.events.erase(it);
+         return;
+      }
+   }
+}
+
+}; // end namespace HostKernel
+
+using namespace HostKernel;
+
+uint32_t osKernelSysTick() {
+   return (uint32_t)kernel().now;
+}
+
+osStatus osDelay(uint32_t millisec) {
+   block(nullptr, millisec);
+   return osEventTimeout;
+}
+
+osThreadId osThreadGetId() {
+   return self();
+}
+
+osStatus osThreadYield() {
+   Kernel &k = kernel();
+   os_thread_cb *task = self();
+   task->state = os_thread_cb::Ready;
+   task->order = ++k.sequence;
+   schedule(task);
+   return osOK;
+}
+
+osStatus osThreadTerminate(osThreadId thread_id) {
+   if ((thread_id == nullptr) || (thread_id == thisTask)) {
+      return osErrorParameter;
+   }
+   thread_id->state = os_thread_cb::Terminated;
+   return osOK;
+}
+
+osPriority osThreadGetPriority(osThreadId thread_id) {
+   return thread_id->priority;
+}
+
+osStatus osThreadSetPriority(osThreadId thread_id, osPriority priority) {
+   thread_id->priority = priority;
+   reschedule();
+   return osOK;
+}
+
+int32_t osSignalSet(osThreadId thread_id, int32_t signals) {
+   int32_t previous = thread_id->signals;
+   thread_id->signals |= signals;
+   reschedule();
+   return previous;
+}
+
+int32_t osSignalClear(osThreadId thread_id, int32_t signals) {
+   int32_t previous = thread_id->signals;
+   thread_id->signals &= ~signals;
+   return previous;
+}
+
+osEvent osSignalWait(int32_t signals, uint32_t millisec) {
+   os_thread_cb *task = self();
+   osEvent event;
+   bool satisfied = block([task, signals]{
+      return (signals == 0)?(task->signals != 0):((task->signals&signals) == signals);
+   }, millisec);
+   if (!satisfied) {
+      event.status = (millisec == 0)?osOK:osEventTimeout;
+      return event;
+   }
+   event.status        = osEventSignal;
+   event.value.signals = task->signals;
+   task->signals &= (signals == 0)?0:~signals;
+   return event;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file    hostKernel.h
+ * @brief   Deterministic virtual-time kernel standing in for CMSIS-RTX in host builds
+ *
+ *  - Each CMSIS thread runs on a host thread but only one thread runs at a time.
+ *  - Code executes in zero virtual time. Time only advances when every thread is blocked
+ *    and then jumps directly to the next timeout or event. A simulated run is therefore
+ *    much faster than real-time and the result does not depend on the host.
+ *  - Events (simulated interrupts, timer call-backs) run when no thread is running.
+ *  - A thread made ready by a running thread pre-empts it if it has higher priority.
+ *
+ * The thread calling the kernel first (usually main()) becomes a normal priority thread.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_HOSTKERNEL_H_
+#define HOSTTESTS_STUBS_HOSTKERNEL_H_
+
+#include <stdint.h>
+#include <functional>
+#include "cmsis_os.h"
+
+namespace HostKernel {
+
+/** Function executed as a thread */
+using ThreadFunction = void (*)(const void *);
+
+/** Condition a thread is waiting on */
+using Condition = std::function<bool()>;
+
+/** Function executed at an event */
+using EventFunction = std::function<void()>;
+
+/**
+ * Get virtual time
+ *
+ * @return Time since start in microseconds
+ */
+uint64_t getTime();
+
+/**
+ * Create and start a thread
+ *
+ * @param[in] function Thread function
+ * @param[in] argument Argument passed to function
+ * @param[in] priority Priority of thread
+ *
+ * @return Thread ID
+ */
+osThreadId createThread(ThreadFunction function, const void *argument, osPriority priority);
+
+/**
+ * Block the current thread until a condition is true\n
+ * The condition is re-evaluated whenever the kernel looks for a thread to run.
+ *
+ * @param[in] condition Condition to wait for (nullptr to wait for the timeout only)
+ * @param[in] millisec  Timeout in milliseconds (osWaitForever for none)
+ *
+ * @return true if the condition is satisfied, false on timeout
+ */
+bool block(Condition condition, uint32_t millisec);
+
+/**
+ * Let a higher priority thread made ready by the current thread run\n
+ * Has no effect in an event.
+ */
+void reschedule();
+
+/**
+ * Block until the next event has been executed (__WFI)
+ */
+void waitForEvent();
+
+/**
+ * Schedule an event
+ *
+ * @param[in] time     Virtual time of event (us)
+ * @param[in] function Function to execute
+ *
+ * @return Handle used to cancel the event
+ */
+unsigned scheduleEvent(uint64_t time, EventFunction function);
+
+/**
+ * Cancel an event that has not yet occurred
+ *
+ * @param[in] handle Handle from scheduleEvent()
+ */
+void cancelEvent(unsigned handle);
+
+/**
+ * Indicates an event is executing
+ *
+ * @return true if in 'interrupt' context
+ */
+bool isInterrupt();
+
+}; // end namespace HostKernel
+
+#endif /* HOSTTESTS_STUBS_HOSTKERNEL_H_ */
@@ -0,0 +1,123 @@
+/**
+ * @file    pit.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM Programmable Interrupt Timer interface
+ *
+ * Each enabled channel with interrupts enabled calls its call-back in 'interrupt'
+ * context every interval of virtual time.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_PIT_H_
+#define HOSTTESTS_STUBS_PIT_H_
+
+#include <math.h>
+#include <stdint.h>
+#include "hardware.h"
+#include "hostKernel.h"
+
+namespace USBDM {
+
+/**
+ * Type definition for PIT interrupt call back
+ */
+typedef void (*PitCallbackFunction)(void);
+
+enum PitDebugMode {
+   PitDebugMode_Run  = 0,  //!< PIT continues to run in debug mode
+   PitDebugMode_Stop = 1,  //!< PIT stops in debug mode
+};
+
+enum PitChannelIrq {
+   PitChannelIrq_Disable  = 0,  //!< PIT channel interrupt disabled
+   PitChannelIrq_Enable   = 1,  //!< PIT channel interrupt enabled
+};
+
+enum PitChannelEnable {
+   PitChannelEnable_Disable  = 0,  //!< PIT channel disabled
+   PitChannelEnable_Enable   = 1,  //!< PIT channel enabled
+};
+
+/**
+ * Programmable Interrupt Timer
+ */
+class Pit {
+
+protected:
+   static constexpr unsigned NUM_CHANNELS = 4;
+
+   static inline PitCallbackFunction callbacks[NUM_CHANNELS] = {};
+   static inline uint64_t            intervals[NUM_CHANNELS] = {};
+   static inline bool                running[NUM_CHANNELS]   = {};
+   static inline unsigned            events[NUM_CHANNELS]    = {};
+
+   static void schedule(unsigned channel) {
+      events[channel] = HostKernel::scheduleEvent(HostKernel::getTime()+intervals[channel], [channel] {
+         schedule(channel);
+         if (callbacks[channel] == nullptr) {
+            setAndCheckErrorCode(E_NO_HANDLER);
+         }
+         callbacks[channel]();
+      });
+   }
+
+public:
+   static void configure(PitDebugMode =PitDebugMode_Stop) {
+   }
+   static void setCallback(unsigned channel, PitCallbackFunction callback) {
+      callbacks[channel] = callback;
+   }
+   static void configureChannel(unsigned channel, float interval, PitChannelIrq pitChannelIrq, PitChannelEnable pitChannelEnable) {
+      disableChannel(channel);
+      intervals[channel] = (uint64_t)llroundf(interval/us);
+      if (intervals[channel] == 0) {
+         intervals[channel] = 1;
+      }
+      if ((pitChannelIrq == PitChannelIrq_Enable) && (pitChannelEnable == PitChannelEnable_Enable)) {
+         running[channel] = true;
+         schedule(channel);
+      }
+   }
+   static void disableChannel(unsigned channel) {
+      if (running[channel]) {
+         HostKernel::cancelEvent(events[channel]);
+         running[channel] = false;
+      }
+   }
+};
+
+/**
+ * PIT channel
+ *
+ * @tparam channel Channel number
+ */
+template <int channel>
+class PitChannel_T : public Pit {
+
+public:
+   /** Timer channel number */
+   static constexpr int CHANNEL = channel;
+
+   static void configure(
+         float             interval,
+         PitChannelIrq     pitChannelIrq=PitChannelIrq_Disable,
+         PitChannelEnable  pitChannelEnable=PitChannelEnable_Enable) {
+      Pit::configureChannel(channel, interval, pitChannelIrq, pitChannelEnable);
+   }
+   static void disable() {
+      Pit::disableChannel(channel);
+   }
+   static void setCallback(PitCallbackFunction callback) {
+      Pit::setCallback(channel, callback);
+   }
+};
+
+using PitChannel0 = PitChannel_T<0>;
+using PitChannel1 = PitChannel_T<1>;
+using PitChannel2 = PitChannel_T<2>;
+using PitChannel3 = PitChannel_T<3>;
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_PIT_H_ */
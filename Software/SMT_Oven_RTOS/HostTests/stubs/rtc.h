@@ -0,0 +1,41 @@
+/**
+ * @file    rtc.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM Real Time Clock interface
+ *
+ * The clock counts seconds of virtual time.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_RTC_H_
+#define HOSTTESTS_STUBS_RTC_H_
+
+#include <stdint.h>
+#include "hostKernel.h"
+
+namespace USBDM {
+
+/**
+ * Real Time Clock
+ */
+class Rtc {
+
+private:
+   /** Time since epoch at virtual time 0 */
+   static inline uint32_t base = 0;
+
+public:
+   static void initialise() {
+   }
+   static void setTime(uint32_t timeSinceEpoch) {
+      base = timeSinceEpoch-(uint32_t)(HostKernel::getTime()/1000000);
+   }
+   static uint32_t getTime() {
+      return base+(uint32_t)(HostKernel::getTime()/1000000);
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_RTC_H_ */
@@ -0,0 +1,153 @@
+/**
+ * @file    spi.h (HostTests/stubs)
+ * @brief   Host stand-in for the USBDM SPI interface
+ *
+ * The registers are simulated by hostHardware.cpp. Polled transfers use the same
+ * register sequence as Sources/spi.cpp so they interleave correctly with DMA and
+ * interrupt driven use of the SPI.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_SPI_H_
+#define HOSTTESTS_STUBS_SPI_H_
+
+#include <stdint.h>
+#include "derivative.h"
+#include "hardware.h"
+#include "cmsis.h"
+#include "hostHardware.h"
+
+namespace USBDM {
+
+enum SpiModeValue {
+   SpiMode0 = SPI_CTAR_CPOL(0)|SPI_CTAR_CPHA(0),
+   SpiMode1 = SPI_CTAR_CPOL(0)|SPI_CTAR_CPHA(1),
+   SpiMode2 = SPI_CTAR_CPOL(1)|SPI_CTAR_CPHA(0),
+   SpiMode3 = SPI_CTAR_CPOL(1)|SPI_CTAR_CPHA(1),
+};
+
+/**
+ * Base class for representing an SPI interface
+ */
+class Spi {
+
+protected:
+   ~Spi() {}
+
+public:
+   volatile  SPI_Type * const spi; //!< SPI hardware
+
+protected:
+   uint32_t  pushrMask;            //!< Value to combine with data
+
+   Spi(volatile SPI_Type *baseAddress) :
+      spi(baseAddress), pushrMask(SPI_PUSHR_PCS_MASK) {
+   }
+
+public:
+   virtual osStatus startTransaction(uint32_t ctarValue=0, int milliseconds=osWaitForever) = 0;
+   virtual osStatus endTransaction() = 0;
+
+   /**
+    * Set communication speed\n
+    * The host encodes the speed in kHz in the low bits of CTAR.
+    */
+   void setSpeed(uint32_t frequency, int ctarNum=0) {
+      spi->CTAR[ctarNum] = (spi->CTAR[ctarNum]&~0xFFFFFU)|((frequency/1000)&0xFFFFFU);
+   }
+   void setDelays(float =1*USBDM::ms, float =1*USBDM::ms, float =1*USBDM::ms, int =0) {
+   }
+   void setMode(SpiModeValue mode, int ctarNum=0) {
+      spi->CTAR[ctarNum] = (spi->CTAR[ctarNum]&~(SPI_CTAR_CPHA(1)|SPI_CTAR_CPOL(1)|SPI_CTAR_LSBFE(1))) | mode;
+   }
+   void setFrameSize(int numBits=8, int ctarNum=0) {
+      spi->CTAR[ctarNum] = (spi->CTAR[ctarNum]&~(SPI_CTAR_FMSZ_MASK)) | SPI_CTAR_FMSZ(numBits-1);
+   }
+   void setPushrValue(uint32_t pushrMask) {
+      this->pushrMask = pushrMask;
+   }
+   /**
+    * Transmit and receive a value over SPI\n
+    * On the host a frame that is not transmitted immediately would never complete.
+    */
+   uint32_t txRx(uint32_t data) {
+      spi->MCR &= ~SPI_MCR_HALT_MASK;
+      spi->PUSHR = data;
+      if ((spi->SR & SPI_SR_TCF_MASK)==0) {
+         // Frames are transmitted immediately unless the SPI is stopped (e.g. EOQF left set)
+         HostHardware::fail("SPI stalled in txRx()");
+      }
+      spi->SR = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK;
+      return spi->POPR;
+   }
+   /**
+    * Transmit and receive a series of 4 to 8-bit values
+    */
+   void txRxBytes(uint32_t dataSize, const uint8_t *txData, uint8_t *rxData=0) {
+      while(dataSize-->0) {
+         uint32_t sendData = 0xFF;
+         if (txData != 0) {
+            sendData = *txData++;
+         }
+         if (dataSize == 0) {
+            sendData |= SPI_PUSHR_EOQ_MASK;
+         }
+         else {
+            sendData |= SPI_PUSHR_CONT_MASK;
+         }
+         uint32_t data = txRx(sendData|pushrMask);
+         if (rxData != 0) {
+            *rxData++ = data;
+         }
+      }
+      spi->MCR |= SPI_MCR_HALT_MASK;
+   }
+   void setCTAR0Value(uint32_t ctar) {
+      spi->CTAR[0] = ctar;
+   }
+   uint32_t getCTAR0Value() {
+      return spi->CTAR[0];
+   }
+   void setPcsPolarity(int, Polarity =ActiveHigh) {
+   }
+};
+
+/**
+ * SPI0 connected to the simulated devices (see HostHardware)
+ */
+class Spi0 : public Spi {
+
+protected:
+   static CMSIS::Mutex mutex;
+
+public:
+   Spi0() : Spi(&HostHardware::spi0) {
+      spi->MCR = SPI_MCR_HALT_MASK|SPI_MCR_CLR_RXF_MASK|SPI_MCR_CLR_TXF_MASK;
+      setFrameSize(8);
+   }
+   virtual ~Spi0() {}
+
+   /**
+    * Obtain SPI mutex and set SPI configuration\n
+    * Each transaction is counted by HostHardware.
+    */
+   virtual osStatus startTransaction(uint32_t config=0, int milliseconds=osWaitForever) override {
+      osStatus status = mutex.wait(milliseconds);
+      if (status == osOK) {
+         HostHardware::spiStatistics.transactions++;
+         if (config != 0) {
+            spi->CTAR[0] = config;
+         }
+      }
+      return status;
+   }
+   virtual osStatus endTransaction() override {
+      return mutex.release();
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* HOSTTESTS_STUBS_SPI_H_ */
@@ -0,0 +1,42 @@
+/**
+ * @file    system.h (HostTests/stubs)
+ * @brief   Host stand-in for the system initialisation routines
+ *
+ * Events never interrupt a running thread on the host so interrupts need not be masked.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef HOSTTESTS_STUBS_SYSTEM_H_
+#define HOSTTESTS_STUBS_SYSTEM_H_
+
+#include <stdint.h>
+
+/** System core clock frequency in Hz */
+static constexpr uint32_t SystemCoreClock = 48000000;
+
+/** System bus clock frequency in Hz */
+static constexpr uint32_t SystemBusClock  = 48000000;
+
+inline void disableInterrupts() {
+}
+
+inline int enableInterrupts() {
+   return true;
+}
+
+/**
+ * Class used to protect a block of C++ code from interrupts
+ */
+class IrqProtect {
+public:
+   IrqProtect() {
+      disableInterrupts();
+   }
+   ~IrqProtect() {
+      enableInterrupts();
+   }
+};
+
+#endif /* HOSTTESTS_STUBS_SYSTEM_H_ */
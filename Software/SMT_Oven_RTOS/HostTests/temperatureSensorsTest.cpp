@@ -0,0 +1,138 @@
+/**
+ * @file    temperatureSensorsTest.cpp
+ * @brief   Host test of TemperatureSensors sampling
+ *
+ * Four simulated MAX31855 are attached to the simulated SPI. Several consumer threads
+ * read the temperatures much faster than they are sampled. The SPI traffic must not
+ * depend on the consumers i.e. one DMA batch transaction per sample period.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include "hostTest.h"
+#include "hostKernel.h"
+#include "hostHardware.h"
+#include "spi.h"
+#include "flash.h"
+#include "simulatedMax31855.h"
+
+/*
+ * Objects normally provided by configure.cpp and settings.cpp
+ */
+USBDM::Spi0 spi;
+
+static constexpr int t1_cs_num  = 2;
+static constexpr int t2_cs_num  = 3;
+static constexpr int t3_cs_num  = 1;
+static constexpr int t4_cs_num  = 0;
+
+__attribute__ ((section(".flexRAM")))
+USBDM::Nonvolatile<int>   t1Offset, t2Offset, t3Offset, t4Offset;
+__attribute__ ((section(".flexRAM")))
+USBDM::Nonvolatile<bool>  t1Enable, t2Enable, t3Enable, t4Enable;
+__attribute__ ((section(".flexRAM")))
+USBDM::Nonvolatile<int>   thermocoupleFilter;
+__attribute__ ((section(".flexRAM")))
+USBDM::Nonvolatile<int>   thermocoupleFilterLength;
+__attribute__ ((section(".flexRAM")))
+USBDM::Nonvolatile<float> thermocoupleFilterAlpha;
+
+#include "temperatureSensors.h"
+
+using namespace HostHardware;
+
+static TemperatureSensors *temperatureSensors;
+
+/** Reads made by consumers */
+static unsigned consumerReads  = 0;
+
+/** Inconsistent snapshots seen by consumers */
+static unsigned inconsistent   = 0;
+
+/**
+ * Consumer polling the temperature sensors every millisecond
+ */
+static void consumer(const void *) {
+   for(;;) {
+      float temperature = temperatureSensors->getTemperature();
+      TemperatureSensors::Snapshot snapshot;
+      temperatureSensors->getSnapshot(snapshot);
+      for (unsigned t=0; t<TemperatureSensors::NUM_THERMOCOUPLES; t++) {
+         float value;
+         snapshot.measurements.getTemperature(t, value);
+         if (!isnan(snapshot.averageTemperature) && (value != snapshot.averageTemperature)) {
+            inconsistent++;
+         }
+      }
+      (void)temperatureSensors->getColdReferences(0);
+      (void)temperature;
+      consumerReads++;
+      osDelay(1);
+   }
+}
+
+int main() {
+   USBDM::NonvolatileShadow::load();
+
+   t1Offset = 0;
+   t2Offset = 0;
+   t3Offset = 0;
+   t4Offset = 0;
+   t1Enable = true;
+   t2Enable = true;
+   t3Enable = true;
+   t4Enable = true;
+   thermocoupleFilter       = Filter_None;
+   thermocoupleFilterLength = 1;
+   thermocoupleFilterAlpha  = 1.0f;
+
+   SimulatedMax31855 devices[] = {{25.0f}, {25.5f}, {26.0f}, {26.5f}};
+   for (unsigned pcsNum=0; pcsNum<4; pcsNum++) {
+      attachSpiDevice(pcsNum, &devices[pcsNum]);
+   }
+   temperatureSensors = new TemperatureSensors;
+   temperatureSensors->initialise();
+
+   CMSIS::Thread consumer1(consumer, osPriorityNormal);
+   CMSIS::Thread consumer2(consumer, osPriorityHigh);
+   CMSIS::Thread consumer3(consumer, osPriorityAboveNormal);
+   consumer1.run();
+   consumer2.run();
+   consumer3.run();
+
+   // Let sampler settle then measure over 10 seconds
+   osDelay(1000);
+   SpiStatistics start = spiStatistics;
+   unsigned startReads = consumerReads;
+   uint64_t startTime  = HostKernel::getTime();
+   osDelay(10000);
+   double elapsed = (HostKernel::getTime()-startTime)/1E6;
+
+   double transactionsPerSecond = (spiStatistics.transactions-start.transactions)/elapsed;
+   double framesPerSecond       = (spiStatistics.frames-start.frames)/elapsed;
+   double readsPerSecond        = (consumerReads-startReads)/elapsed;
+
+   printf("SPI transactions/s = %.1f, frames/s = %.1f, consumer reads/s = %.0f\n",
+         transactionsPerSecond, framesPerSecond, readsPerSecond);
+
+   // One batch transaction of 4x4 frames per 100 ms sample
+   CHECK(fabs(transactionsPerSecond-10) < 0.2);
+   CHECK(fabs(framesPerSecond-160) < 2);
+   CHECK(readsPerSecond > 2000);
+   CHECK(spiStatistics.txOverflows == 0);
+   CHECK(spiStatistics.rxOverflows == 0);
+   CHECK(spiStatistics.pcsChanges == 0);
+   for (SimulatedMax31855 &device:devices) {
+      CHECK(device.shortFrames == 0);
+   }
+   CHECK(inconsistent == 0);
+
+   // Latest values reflect the devices
+   float expected = devices[0].probeTemperature(HostKernel::getTime()-100000);
+   CHECK(fabs(temperatureSensors->getTemperature()-expected) <= 1.0f);
+   CHECK(temperatureSensors->getColdReferences(0) == devices[t1_cs_num].coldReference);
+   CHECK(temperatureSensors->getColdReferences(3) == devices[t4_cs_num].coldReference);
+
+   return HostTest::report("temperatureSensorsTest");
+}
@@ -0,0 +1,144 @@
+/**
+ * @file    thermocoupleFilterBench.cpp
+ * @brief   Noise and lag of the thermocouple filters
+ *
+ * A 10 Hz sampled reflow-like signal (1.5 C/s ramp then hold) with Gaussian noise,
+ * 0.25 C quantisation (MAX31855 resolution) and occasional spikes is passed through each
+ * filter setting. For each setting the following are reported:
+ *  - Lag on the ramp (s)
+ *  - RMS noise on the hold (C)
+ *  - Largest error on the hold i.e. spike rejection (C)
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <chrono>
+#include "hostTest.h"
+#include "thermocoupleFilter.h"
+
+/** Sample rate of thermocouples (Hz) */
+static constexpr float SAMPLE_RATE   = 10.0f;
+
+/** Ramp rate (C/s) */
+static constexpr float RAMP_RATE     = 1.5f;
+
+/** Samples on ramp and hold */
+static constexpr unsigned RAMP_SAMPLES = 1200;
+static constexpr unsigned HOLD_SAMPLES = 1200;
+
+/** Samples ignored after a change in the signal while the filter settles */
+static constexpr unsigned SETTLE_SAMPLES = 100;
+
+struct Result {
+   float lag;        // s
+   float noise;      // C RMS
+   float worst;      // C
+   float nsPerCall;  // Host time per call
+};
+
+/**
+ * Generate test signal
+ *
+ * @param[out] clean True temperature
+ * @param[out] noisy Measured temperature
+ */
+static void makeSignal(std::vector<float> &clean, std::vector<float> &noisy) {
+   std::mt19937 random(12345);
+   std::normal_distribution<float> noise(0.0f, 0.5f);
+   std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+   float temperature = 25.0f;
+   for (unsigned sample=0; sample<RAMP_SAMPLES+HOLD_SAMPLES; sample++) {
+      if (sample<RAMP_SAMPLES) {
+         temperature += RAMP_RATE/SAMPLE_RATE;
+      }
+      float measured = temperature+noise(random);
+      if (uniform(random) < 0.01f) {
+         measured += 20.0f;
+      }
+      clean.push_back(temperature);
+      noisy.push_back(roundf(measured*4)/4);
+   }
+}
+
+static Result measure(const std::vector<float> &clean, const std::vector<float> &noisy, FilterType type, unsigned length, float alpha) {
+   ThermocoupleFilter filter;
+   std::vector<float> output;
+
+   auto start = std::chrono::steady_clock::now();
+   for (float value:noisy) {
+      output.push_back(filter.filter(value, type, length, alpha));
+   }
+   auto elapsed = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now()-start).count();
+
+   // Lag from mean error on ramp (median is robust to spikes)
+   std::vector<float> errors;
+   for (unsigned sample=SETTLE_SAMPLES; sample<RAMP_SAMPLES; sample++) {
+      errors.push_back(clean[sample]-output[sample]);
+   }
+   std::nth_element(errors.begin(), errors.begin()+errors.size()/2, errors.end());
+   float lag = errors[errors.size()/2]/RAMP_RATE;
+
+   // Noise and worst error on hold
+   double sumSquares = 0;
+   float  worst      = 0;
+   unsigned count    = 0;
+   for (unsigned sample=RAMP_SAMPLES+SETTLE_SAMPLES; sample<clean.size(); sample++) {
+      float error = output[sample]-clean[sample];
+      sumSquares += error*error;
+      worst = fmaxf(worst, fabsf(error));
+      count++;
+   }
+   return Result{lag, (float)sqrt(sumSquares/count), worst, elapsed/noisy.size()};
+}
+
+int main() {
+   std::vector<float> clean, noisy;
+   makeSignal(clean, noisy);
+
+   printf("%-8s %6s %6s %8s %8s %8s %8s\n", "Filter", "Length", "Alpha", "Lag(s)", "RMS(C)", "Max(C)", "ns/call");
+   auto report = [&](FilterType type, unsigned length, float alpha) {
+      Result result = measure(clean, noisy, type, length, alpha);
+      printf("%-8s %6d %6.2f %8.2f %8.3f %8.2f %8.1f\n",
+            ThermocoupleFilter::getFilterName(type), (int)length, alpha, result.lag, result.noise, result.worst, result.nsPerCall);
+      return result;
+   };
+   Result none = report(Filter_None, 1, 1.0f);
+   CHECK(fabsf(none.lag) < 0.05f);
+   CHECK(none.worst > 15.0f);
+
+   for (unsigned length=3; length<=ThermocoupleFilter::MAX_LENGTH; length+=2) {
+      // Moving average delays by (N-1)/2 samples and reduces noise
+      Result average = report(Filter_MovingAverage, length, 1.0f);
+      CHECK(fabsf(average.lag-(length-1)/2.0f/SAMPLE_RATE) < 0.05f);
+      CHECK(average.noise < none.noise);
+   }
+   for (unsigned length=3; length<=ThermocoupleFilter::MAX_LENGTH; length+=2) {
+      // Median has similar lag but rejects isolated spikes (length 3 fails on adjacent spikes)
+      Result median = report(Filter_Median, length, 1.0f);
+      CHECK(fabsf(median.lag-(length-1)/2.0f/SAMPLE_RATE) < 0.1f);
+      CHECK((length<5) || (median.worst < 3.0f));
+   }
+   for (float alpha:{1.0f, 0.5f, 0.3f, 0.1f, ThermocoupleFilter::MIN_ALPHA}) {
+      // IIR delays by (1-a)/a samples
+      Result iir = report(Filter_Iir, 1, alpha);
+      CHECK(fabsf(iir.lag-(1-alpha)/alpha/SAMPLE_RATE) < 0.1f);
+   }
+   // Illegal alpha values (e.g. uninitialised FlexRAM) must not freeze the output
+   for (float alpha:{0.0f, -1.0f, NAN, 2.0f}) {
+      Result iir = report(Filter_Iir, 1, alpha);
+      CHECK(iir.lag < (1-ThermocoupleFilter::MIN_ALPHA)/ThermocoupleFilter::MIN_ALPHA/SAMPLE_RATE+0.1f);
+      CHECK(iir.noise < 5.0f);
+   }
+   // Illegal lengths are limited
+   Result result = report(Filter_MovingAverage, 0, 1.0f);
+   CHECK(fabsf(result.lag) < 0.05f);
+   result = report(Filter_MovingAverage, (unsigned)-1, 1.0f);
+   CHECK(fabsf(result.lag-(ThermocoupleFilter::MAX_LENGTH-1)/2.0f/SAMPLE_RATE) < 0.05f);
+
+   return HostTest::report("thermocoupleFilterBench");
+}
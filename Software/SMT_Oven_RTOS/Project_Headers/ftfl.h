@@ -51,6 +51,22 @@ protected:
    /** Minimum ratio for EEPROM to Flash backing storage */
    static constexpr unsigned MINIMUM_BACKING_RATIO = 16;
 
+   /** Number of waits where the Flash controller was busy */
+   static volatile uint32_t fStallCount;
+
+   /** Total time spent waiting for busy Flash controller (cycles) */
+   static volatile uint64_t fStallCycles;
+
+   /** Longest wait for busy Flash controller (cycles) */
+   static volatile uint32_t fMaxStallCycles;
+
+   /**
+    * Record time spent waiting for busy Flash controller
+    *
+    * @param[in] cycles Time waited (cycles)
+    */
+   static void recordStall(uint32_t cycles);
+
    /**
     * Constructor\n
     * Typically this method would be overridden in a derived class
@@ -61,6 +77,11 @@ protected:
       static int singletonFlag __attribute__((unused)) = false;
       assert (!singletonFlag);
       singletonFlag = true;
+
+      // Cycle counter used to time waits for Flash controller
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+      DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
       waitForFlashReady();
    }
 
@@ -181,19 +202,41 @@ public:
 
    /**
     * Wait until flash is ready.\n
-    * Any flash operations will have completed.
+    * Any flash operations will have completed.\n
+    * Time spent waiting for a busy controller is recorded (see getStallStatistics()).
     *
     * @return true => OK, false => timeout
     */
    static bool waitForFlashReady() {
+      if ((FTFL->FSTAT&FTFL_FSTAT_CCIF_MASK) != 0) {
+         return true;
+      }
+      uint32_t start = DWT->CYCCNT;
+      bool     ready = false;
       for(int timeout=0; timeout<100000; timeout++) {
          if ((FTFL->FSTAT&FTFL_FSTAT_CCIF_MASK) != 0) {
-            return true;
+            ready = true;
+            break;
          }
       }
-      return false;
+      recordStall(DWT->CYCCNT-start);
+      return ready;
    }
 
+   /**
+    * Get statistics for waits on busy Flash controller
+    *
+    * @param[out] count     Number of waits
+    * @param[out] totalTime Total time waited (us)
+    * @param[out] maxTime   Longest wait (us)
+    */
+   static void getStallStatistics(uint32_t &count, uint32_t &totalTime, uint32_t &maxTime);
+
+   /**
+    * Clear statistics for waits on busy Flash controller
+    */
+   static void resetStallStatistics();
+
 private:
    /**
     * Program a phrase to Flash memory
@@ -216,7 +259,16 @@ private:
 
 public:
    /**
-    * Program a range of bytes to Flash memory
+    * Invalidate Flash cache and prefetch buffer\n
+    * This is necessary after programming or erasing so the new contents are read
+    */
+   static void invalidateCache() {
+      FMC->PFB0CR |= FMC_PFB0CR_CINV_WAY_MASK|FMC_PFB0CR_S_B_INV_MASK;
+   }
+
+   /**
+    * Program a range of bytes to Flash memory\n
+    * The Flash cache is invalidated afterwards so the new contents are read
     *
     * @param[in]  data       Location of data to program
     * @param[out] address    Memory address to program - must be phrase boundary
@@ -227,7 +279,8 @@ public:
    static FlashDriverError_t programRange(const uint8_t *data, uint8_t *address, uint32_t size);
 
    /**
-    * Erase a range of Flash memory
+    * Erase a range of Flash memory\n
+    * The Flash cache is invalidated afterwards so the new contents are read
     *
     * @param[out] address    Memory address to start erasing - must be sector boundary
     * @param[in]  size       Size of range (in bytes) to erase - must be multiple of sector size
@@ -235,232 +288,32 @@ public:
     * @return Error code
     */
    static FlashDriverError_t eraseRange(uint8_t *address, uint32_t size);
-   /**
-    * Mass erase entire Flash memory
-    */
-   static void eraseAll();
-};
-
-/**
- * Class to wrap a scalar variable allocated within the FlexRam area\n
- * Size is limited to 1, 2 or 4 bytes.
- *
- * Writing to the variable triggers an EEPROM update.\n
- * Ensures updates are completed before return.
- *
- * @tparam T Scalar type for variable
- *
- * @note Instances should be placed in FlexRAM segment e.g.\n
- * @code
- * __attribute__ ((section(".flexRAM")))
- * USBDM::Nonvolatile<char> a_nonvolatile_char;
- * @endcode
- */
-template <typename T>
-class Nonvolatile {
-
-   static_assert((sizeof(T) == 1)||(sizeof(T) == 2)||(sizeof(T) == 4), "T must be 1,2 or 4 bytes in size");
-
-private:
-   /**
-    * Data value in FlexRAM
-    *
-    * FlexRAM required data to be aligned according to its size.\n
-    * Be careful how you order variables otherwise space will be wasted
-    */
-   __attribute__ ((aligned (sizeof(T))))
-   T data;
 
-public:
-   /**
-    * Assign to underlying type\n
-    * This adds a wait for the Flash to be updated
-    *
-    * @param[in]  data The data to assign
-    */
-   void operator=(const Nonvolatile &data ) {
-      this->data = data;
-      Flash::waitForFlashReady();
-   }
-   /**
-    * Assign to underlying type\n
-    * This adds a wait for the Flash to be updated
-    *
-    * @param[in]  data The data to assign
-    */
-   void operator=(const T &data ) {
-      this->data = data;
-      Flash::waitForFlashReady();
-   }
    /**
-    * Increment underlying type\n
-    * This adds a wait for the Flash to be updated
+    * Update CRC-32 (IEEE 802.3) with data\n
+    * Used to check records stored in Flash
     *
-    * @param[in]  change The amount to increment
-    */
-   void operator+=(const Nonvolatile &change ) {
-      this->data += change;
-      Flash::waitForFlashReady();
-   }
-   /**
-    * Increment underlying type\n
-    * This adds a wait for the Flash to be updated
+    * @param[in] crc  Current CRC (start with 0xFFFFFFFF)
+    * @param[in] data Data to add
+    * @param[in] size Size of data in bytes
     *
-    * @param[in]  change The amount to increment
+    * @return Updated CRC (complement for final value)
     */
-   void operator+=(const T &change ) {
-      this->data += change;
-      Flash::waitForFlashReady();
-   }
-   /**
-    * Decrement underlying type\n
-    * This adds a wait for the Flash to be updated
-    *
-    * @param[in]  change The amount to increment
-    */
-   void operator-=(const Nonvolatile &change ) {
-      this->data -= change;
-      Flash::waitForFlashReady();
-   }
-   /**
-    * Decrement underlying type\n
-    * This adds a wait for the Flash to be updated
-    *
-    * @param[in]  change The amount to increment
-    */
-   void operator-=(const T &change ) {
-      this->data -= change;
-      Flash::waitForFlashReady();
-   }
-   /**
-    * Return the underlying object - read-only!
-    */
-   operator T() const {
-      Flash::waitForFlashReady();
-      return data;
-   }
-};
-
-/**
- * Class to wrap an array of scalar variables allocated to the FlexRam area
- *
- * Element size is limited to 1, 2 or 4 bytes.
- *
- * Writing to an element triggers an EEPROM update.\n
- * Ensures updates are completed before return.
- *
- * @tparam T         Scalar type for element
- * @tparam dimension Dimension of array
- *
- * @note Instances should be placed in FlexRAM segment e.g.\n
- * @code
- * __attribute__ ((section(".flexRAM")))
- * USBDM::NonvolatileArray<20, int> a_nonvolatile_array_of_ints;
- * @endcode
- */
-template <typename T, int dimension>
-class NonvolatileArray {
-
-   static_assert((sizeof(T) == 1)||(sizeof(T) == 2)||(sizeof(T) == 4), "T must be 1, 2 or 4 bytes in size");
-
-private:
-   using TArray = T[dimension];
-   using TPtr   = const T(*);
-
-   /** Array of elements in FlexRAM
-    *
-    *  FlexRAM required data to be aligned according to its size.\n
-    *  Be careful how you order variables otherwise space will be wasted
-    */
-   __attribute__ ((aligned (sizeof(T))))
-   T data[dimension];
+   static uint32_t updateCrc32(uint32_t crc, const void *data, unsigned size);
 
-public:
    /**
-    * Assign to underlying array
-    *
-    * @param[in]  other TArray to assign from
-    *
-    * This adds a wait for the Flash to be updated after each element is assigned
-    */
-   void operator=(const TArray &other ) {
-      for (int index=0; index<dimension; index++) {
-         data[index] = other[index];
-         Flash::waitForFlashReady();
-      }
-   }
-
-   /**
-    * Assign to underlying array
-    *
-    * @param[in]  other NonvolatileArray to assign from
-    *
-    * This adds a wait for the Flash to be updated after each element is assigned
-    */
-   void operator=(const NonvolatileArray &other ) {
-      for (int index=0; index<dimension; index++) {
-         data[index] = other[index];
-         Flash::waitForFlashReady();
-      }
-   }
-
-   /**
-    * Assign to underlying array
-    *
-    * @param[in]  other NonvolatileArray to assign to
-    *
-    * This adds a wait for the Flash to be updated after each element is assigned
-    */
-   void copyTo(T *other) const {
-      for (int index=0; index<dimension; index++) {
-         other[index] = data[index];
-      }
-   }
-
-   /**
-    * Return a reference to the underlying array element - read-only!
-    *
-    * @param[in]  index Index of element to return
-    *
-    * @return Reference to underlying array
-    */
-   const T operator [](int index) {
-      return data[index];
-   }
-
-   /**
-    * Return a pointer to the underlying array - read-only!
-    */
-   operator TPtr() const {
-      return data;
-   }
-
-   /**
-    * Set an element of the array to the value provided
-    *
-    * @param[in]  index Array index of element to change
-    * @param[in]  value Value to initialise array elements to
-    */
-   void set(int index, T value) {
-      data[index] = value;
-      Flash::waitForFlashReady();
-   }
-   /**
-    * Set all elements of the array to the value provided
-    *
-    * @param[in]  value Value to initialise array elements to
+    * Mass erase entire Flash memory
     */
-   void set(T value) {
-      for (int index=0; index<dimension; index++) {
-         data[index] = value;
-         Flash::waitForFlashReady();
-      }
-   }
+   static void eraseAll();
 };
+
 /**
  * @}
  */
 
 } // namespace USBDM
 
+// Non-volatile variables stored in FlexRAM
+#include "nonvolatile.h"
+
 #endif /* SOURCES_FLASH_H_ */
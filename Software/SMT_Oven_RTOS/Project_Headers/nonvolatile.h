@@ -0,0 +1,496 @@
+/**
+ * @file    nonvolatile.h
+ * @brief   Non-volatile variables located in FlexRAM
+ *
+ * The variables are accessed through a RAM shadow (see NonvolatileShadow).\n
+ * This file is included by ftfl.h after the Flash class and should not be included directly.
+ * Only Flash::waitForFlashReady() and the Flash wait statistics are used.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef PROJECT_HEADERS_NONVOLATILE_H_
+#define PROJECT_HEADERS_NONVOLATILE_H_
+
+#include <stdint.h>
+#include <assert.h>
+
+namespace USBDM {
+/**
+ * @addtogroup FTFL_Group FTFL, Flash Memory Module
+ * @{
+ */
+
+/** Start of non-volatile variables in FlexRAM (from linker) */
+extern "C" uint8_t __flexRAM_start__[];
+
+/** End of non-volatile variables in FlexRAM (from linker) */
+extern "C" uint8_t __flexRAM_end__[];
+
+/** RAM shadow of non-volatile variables (from linker) */
+extern "C" uint8_t __flexRAM_shadow__[];
+
+/** Write counter for each word of non-volatile variables (from linker) */
+extern "C" uint16_t __flexRAM_counts__[];
+
+/**
+ * Counter of writes to a non-volatile variable (see NonvolatileShadow::setWriteCounters())
+ */
+struct NonvolatileWriteCounter {
+   const void *address;  //!< Location of variable in FlexRAM
+   unsigned    size;     //!< Size of variable in bytes
+   uint32_t    writes;   //!< Writes to FlexRAM that changed the variable
+};
+
+/**
+ * Statistics for writes to non-volatile variables
+ */
+struct NonvolatileStatistics {
+   uint32_t writes;        //!< Writes to FlexRAM (each programs an EEPROM record)
+   uint32_t bytesWritten;  //!< Bytes written to FlexRAM
+   uint32_t unchanged;     //!< Writes discarded as value was unchanged
+   uint32_t commits;       //!< Transactions committed
+   uint32_t stalls;        //!< Waits for busy Flash controller
+   uint32_t stallTime;     //!< Total time waiting for busy Flash controller (us)
+   uint32_t maxStall;      //!< Longest wait for busy Flash controller (us)
+};
+
+/**
+ * RAM shadow of the non-volatile variables in FlexRAM
+ *
+ * Reads of non-volatile variables are satisfied from the shadow so do not wait
+ * for the Flash controller.\n
+ * Writes update the shadow and then FlexRAM unless a transaction is open.
+ * Within a transaction only the shadow is changed. The changes are written to FlexRAM
+ * when the outermost transaction is committed. Only words that differ from the
+ * current FlexRAM contents are written.
+ *
+ * Changes are serialised by a mutex. A transaction holds the mutex from when it is
+ * opened until it is committed so writes from other threads wait for the commit rather
+ * than joining the transaction. Reads do not wait.
+ *
+ * @note Use NonvolatileTransaction to open and commit a transaction.
+ * @note load() must be called once the FlexRAM is available before any access.
+ */
+class NonvolatileShadow {
+
+private:
+   /** Indicates the shadow has been loaded from FlexRAM */
+   static volatile bool     fLoaded;
+
+   /** Nesting depth of the transaction opened by the thread holding the mutex */
+   static unsigned          fTransactionDepth;
+
+   /** Start of range modified by transaction (word offset) */
+   static unsigned          fDirtyStart;
+
+   /** End of range modified by transaction (word offset, exclusive) */
+   static unsigned          fDirtyEnd;
+
+   /** Number of writes to FlexRAM */
+   static volatile uint32_t fWrites;
+
+   /** Number of bytes written to FlexRAM */
+   static volatile uint32_t fBytesWritten;
+
+   /** Number of writes discarded as value was unchanged */
+   static volatile uint32_t fUnchanged;
+
+   /** Number of transactions committed */
+   static volatile uint32_t fCommits;
+
+   /** Counters for writes to individual variables */
+   static NonvolatileWriteCounter *fCounters;
+
+   /** Number of counters */
+   static unsigned          fNumCounters;
+
+   /**
+    * Record write to FlexRAM\n
+    * The write is counted for each variable with a byte that changed.
+    *
+    * @param[in] offset  Byte offset of write
+    * @param[in] size    Size of write in bytes (1, 2 or 4)
+    * @param[in] changed Mask of bytes changed by the write (bit 0 => byte at offset)
+    */
+   static void recordWrite(unsigned offset, unsigned size, unsigned changed);
+
+   /**
+    * Record range of shadow modified by transaction
+    *
+    * @param[in] offset Byte offset of change
+    * @param[in] size   Size of change in bytes
+    */
+   static void markDirty(unsigned offset, unsigned size);
+
+   /**
+    * Obtain mutex serialising changes (may be nested)
+    */
+   static void lock();
+
+   /**
+    * Release mutex serialising changes
+    */
+   static void unlock();
+
+public:
+   /**
+    * Load shadow from FlexRAM\n
+    * This must be called once the FlexRAM is available i.e. after Flash::initialiseEeprom()
+    * and before any non-volatile variable is accessed.
+    */
+   static void load();
+
+   /**
+    * Get shadow of a non-volatile location
+    *
+    * @param[in] nvAddress Address of location in FlexRAM
+    *
+    * @return Pointer to shadow of location in RAM
+    */
+   template<typename T>
+   static T *shadowOf(const T *nvAddress) {
+      assert(fLoaded);
+      return (T *)(__flexRAM_shadow__ + ((const uint8_t *)nvAddress - __flexRAM_start__));
+   }
+
+   /**
+    * Read non-volatile location
+    *
+    * @param[in] nvAddress Address of location in FlexRAM
+    *
+    * @return Value from shadow
+    */
+   template<typename T>
+   static T read(const T *nvAddress) {
+      return *shadowOf(nvAddress);
+   }
+
+   /**
+    * Write non-volatile location\n
+    * FlexRAM is not updated if the value is unchanged or a transaction is open.\n
+    * Waits while another thread has a transaction open.
+    *
+    * @param[in] nvAddress Address of location in FlexRAM
+    * @param[in] value     Value to write
+    */
+   template<typename T>
+   static void write(T *nvAddress, T value) {
+      lock();
+      T *shadow = shadowOf(nvAddress);
+      if (*shadow == value) {
+         fUnchanged = fUnchanged + 1;
+      }
+      else if (fTransactionDepth>0) {
+         *shadow = value;
+         markDirty((uint8_t *)nvAddress - __flexRAM_start__, sizeof(T));
+      }
+      else {
+         *shadow = value;
+         Flash::waitForFlashReady();
+         *nvAddress = value;
+         recordWrite((uint8_t *)nvAddress - __flexRAM_start__, sizeof(T), (1U<<sizeof(T))-1);
+         Flash::waitForFlashReady();
+      }
+      unlock();
+   }
+
+   /**
+    * Open transaction (may be nested)\n
+    * Waits while another thread has a transaction open.
+    */
+   static void beginTransaction();
+
+   /**
+    * Close transaction\n
+    * Changes are written to FlexRAM when the outermost transaction is closed.
+    *
+    * @return Number of words written to FlexRAM
+    */
+   static unsigned commitTransaction();
+
+   /**
+    * Get write statistics
+    *
+    * @param[out] statistics Statistics since last reset
+    */
+   static void getStatistics(NonvolatileStatistics &statistics);
+
+   /**
+    * Set counters for writes to individual variables\n
+    * A write to FlexRAM is counted for each variable it changes. Variables sharing a
+    * FlexRAM word are counted separately.
+    *
+    * @param[in] counters    Counters (address and size set, writes cleared)
+    * @param[in] numCounters Number of counters
+    */
+   static void setWriteCounters(NonvolatileWriteCounter counters[], unsigned numCounters);
+
+   /**
+    * Get number of writes to a non-volatile variable
+    *
+    * @param[in]  nvAddress     Address of variable in FlexRAM
+    * @param[in]  size          Size of variable in bytes
+    * @param[out] maxWordWrites Largest number of writes to a single FlexRAM word occupied by
+    *                           the variable. This is wear and includes writes to other variables
+    *                           sharing the word.
+    *
+    * @return Writes to FlexRAM that changed the variable (0 if it has no counter)
+    */
+   static uint32_t getWriteCount(const void *nvAddress, unsigned size, unsigned &maxWordWrites);
+
+   /**
+    * Clear write statistics including the Flash controller wait statistics
+    */
+   static void resetStatistics();
+};
+
+/**
+ * Groups changes to non-volatile variables so they are written to FlexRAM together
+ * when the object goes out of scope e.g.
+ * @code
+ * {
+ *    NonvolatileTransaction transaction;
+ *    profiles[index] = profile;
+ *    currentProfileIndex = index;
+ * } // Changes written here
+ * @endcode
+ * Other threads changing non-volatile variables wait until the changes are written.
+ */
+class NonvolatileTransaction {
+
+private:
+   NonvolatileTransaction(const NonvolatileTransaction &) = delete;
+   NonvolatileTransaction &operator=(const NonvolatileTransaction &) = delete;
+
+public:
+   NonvolatileTransaction() {
+      NonvolatileShadow::beginTransaction();
+   }
+   ~NonvolatileTransaction() {
+      NonvolatileShadow::commitTransaction();
+   }
+};
+
+/**
+ * Class to wrap a scalar variable allocated within the FlexRam area\n
+ * Size is limited to 1, 2 or 4 bytes.
+ *
+ * Reading the variable uses the RAM shadow (see NonvolatileShadow).\n
+ * Writing to the variable triggers an EEPROM update unless unchanged or
+ * a NonvolatileTransaction is open.\n
+ * Ensures updates are completed before return.
+ *
+ * @tparam T Scalar type for variable
+ *
+ * @note Instances should be placed in FlexRAM segment e.g.\n
+ * @code
+ * __attribute__ ((section(".flexRAM")))
+ * USBDM::Nonvolatile<char> a_nonvolatile_char;
+ * @endcode
+ */
+template <typename T>
+class Nonvolatile {
+
+   static_assert((sizeof(T) == 1)||(sizeof(T) == 2)||(sizeof(T) == 4), "T must be 1,2 or 4 bytes in size");
+
+private:
+   /**
+    * Data value in FlexRAM
+    *
+    * FlexRAM required data to be aligned according to its size.\n
+    * Be careful how you order variables otherwise space will be wasted
+    */
+   __attribute__ ((aligned (sizeof(T))))
+   T data;
+
+public:
+   /**
+    * Assign to underlying type\n
+    * This adds a wait for the Flash to be updated
+    *
+    * @param[in]  data The data to assign
+    */
+   void operator=(const Nonvolatile &data ) {
+      NonvolatileShadow::write(&this->data, (T)data);
+   }
+   /**
+    * Assign to underlying type\n
+    * This adds a wait for the Flash to be updated
+    *
+    * @param[in]  data The data to assign
+    */
+   void operator=(const T &data ) {
+      NonvolatileShadow::write(&this->data, data);
+   }
+   /**
+    * Increment underlying type\n
+    * This adds a wait for the Flash to be updated
+    *
+    * @param[in]  change The amount to increment
+    */
+   void operator+=(const Nonvolatile &change ) {
+      NonvolatileShadow::write(&this->data, (T)(NonvolatileShadow::read(&data) + (T)change));
+   }
+   /**
+    * Increment underlying type\n
+    * This adds a wait for the Flash to be updated
+    *
+    * @param[in]  change The amount to increment
+    */
+   void operator+=(const T &change ) {
+      NonvolatileShadow::write(&this->data, (T)(NonvolatileShadow::read(&data) + change));
+   }
+   /**
+    * Decrement underlying type\n
+    * This adds a wait for the Flash to be updated
+    *
+    * @param[in]  change The amount to increment
+    */
+   void operator-=(const Nonvolatile &change ) {
+      NonvolatileShadow::write(&this->data, (T)(NonvolatileShadow::read(&data) - (T)change));
+   }
+   /**
+    * Decrement underlying type\n
+    * This adds a wait for the Flash to be updated
+    *
+    * @param[in]  change The amount to increment
+    */
+   void operator-=(const T &change ) {
+      NonvolatileShadow::write(&this->data, (T)(NonvolatileShadow::read(&data) - change));
+   }
+   /**
+    * Return the underlying object - read-only!\n
+    * This is read from the RAM shadow
+    */
+   operator T() const {
+      return NonvolatileShadow::read(&data);
+   }
+};
+
+/**
+ * Class to wrap an array of scalar variables allocated to the FlexRam area
+ *
+ * Element size is limited to 1, 2 or 4 bytes.
+ *
+ * Reading an element uses the RAM shadow (see NonvolatileShadow).\n
+ * Writing to an element triggers an EEPROM update.\n
+ * Ensures updates are completed before return.
+ *
+ * @tparam T         Scalar type for element
+ * @tparam dimension Dimension of array
+ *
+ * @note Instances should be placed in FlexRAM segment e.g.\n
+ * @code
+ * __attribute__ ((section(".flexRAM")))
+ * USBDM::NonvolatileArray<20, int> a_nonvolatile_array_of_ints;
+ * @endcode
+ */
+template <typename T, int dimension>
+class NonvolatileArray {
+
+   static_assert((sizeof(T) == 1)||(sizeof(T) == 2)||(sizeof(T) == 4), "T must be 1, 2 or 4 bytes in size");
+
+private:
+   using TArray = T[dimension];
+   using TPtr   = const T(*);
+
+   /** Array of elements in FlexRAM
+    *
+    *  FlexRAM required data to be aligned according to its size.\n
+    *  Be careful how you order variables otherwise space will be wasted
+    */
+   __attribute__ ((aligned (sizeof(T))))
+   T data[dimension];
+
+public:
+   /**
+    * Assign to underlying array
+    *
+    * @param[in]  other TArray to assign from
+    *
+    * The array is written to Flash as a single transaction
+    */
+   void operator=(const TArray &other ) {
+      NonvolatileTransaction transaction;
+      for (int index=0; index<dimension; index++) {
+         NonvolatileShadow::write(&data[index], other[index]);
+      }
+   }
+
+   /**
+    * Assign to underlying array
+    *
+    * @param[in]  other NonvolatileArray to assign from
+    *
+    * The array is written to Flash as a single transaction
+    */
+   void operator=(const NonvolatileArray &other ) {
+      NonvolatileTransaction transaction;
+      for (int index=0; index<dimension; index++) {
+         NonvolatileShadow::write(&data[index], other[index]);
+      }
+   }
+
+   /**
+    * Assign to underlying array
+    *
+    * @param[in]  other NonvolatileArray to assign to
+    */
+   void copyTo(T *other) const {
+      const T *shadow = NonvolatileShadow::shadowOf(data);
+      for (int index=0; index<dimension; index++) {
+         other[index] = shadow[index];
+      }
+   }
+
+   /**
+    * Return a reference to the underlying array element - read-only!
+    *
+    * @param[in]  index Index of element to return
+    *
+    * @return Reference to underlying array
+    */
+   const T operator [](int index) const {
+      return NonvolatileShadow::read(&data[index]);
+   }
+
+   /**
+    * Return a pointer to the underlying array - read-only!\n
+    * This is the RAM shadow of the array
+    */
+   operator TPtr() const {
+      return NonvolatileShadow::shadowOf(data);
+   }
+
+   /**
+    * Set an element of the array to the value provided
+    *
+    * @param[in]  index Array index of element to change
+    * @param[in]  value Value to initialise array elements to
+    */
+   void set(int index, T value) {
+      NonvolatileShadow::write(&data[index], value);
+   }
+   /**
+    * Set all elements of the array to the value provided
+    *
+    * @param[in]  value Value to initialise array elements to
+    *
+    * The array is written to Flash as a single transaction
+    */
+   void set(T value) {
+      NonvolatileTransaction transaction;
+      for (int index=0; index<dimension; index++) {
+         NonvolatileShadow::write(&data[index], value);
+      }
+   }
+};
+/**
+ * @}
+ */
+
+} // namespace USBDM
+
+#endif /* PROJECT_HEADERS_NONVOLATILE_H_ */
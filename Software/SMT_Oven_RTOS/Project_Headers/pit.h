@@ -326,11 +326,11 @@ public:
     *  @note Function doesn't return until interval has expired
     */
    static void delay(uint8_t channel, uint32_t interval) {
-      configureChannel(channel, interval, PIT_TCTRL_TEN_MASK);
+      configureChannelInTicks(channel, interval, PitChannelIrq_Disable, PitChannelEnable_Enable);
       while (pit->CHANNEL[channel].TFLG == 0) {
          __NOP();
       }
-      configureChannel(channel, (uint32_t)0, 0);
+      disableChannel(channel);
    }
 
 };
@@ -0,0 +1,138 @@
+/**
+ * @file ringBuffer.h
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef PROJECT_HEADERS_RINGBUFFER_H_
+#define PROJECT_HEADERS_RINGBUFFER_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <cmsis_gcc.h>
+
+/**
+ * Lock-free single-producer/single-consumer byte ring
+ *
+ * The producer (e.g. an ISR) only changes fHead and the consumer (e.g. a thread)
+ * only changes fTail so no locking is needed provided there is only one of each.
+ * Data is copied in bulk using at most two memcpy() operations.
+ *
+ * @tparam SIZE Size of buffer (power of 2). One byte is always left unused to distinguish full from empty.
+ */
+template<unsigned SIZE>
+class RingBuffer {
+
+   static_assert((SIZE&(SIZE-1)) == 0, "SIZE must be a power of 2");
+
+   /** Mask used to wrap indices */
+   static constexpr unsigned MASK = SIZE-1;
+
+   uint8_t           fBuff[SIZE];
+
+   /** Index of next free location - only changed by producer */
+   volatile unsigned fHead = 0;
+
+   /** Index of oldest data - only changed by consumer */
+   volatile unsigned fTail = 0;
+
+public:
+   /**
+    * Check if empty
+    *
+    * @return true => empty
+    */
+   bool isEmpty() const {
+      return fHead == fTail;
+   }
+
+   /**
+    * Get number of bytes waiting
+    *
+    * @return Number of bytes that may be read
+    */
+   unsigned available() const {
+      return (fHead-fTail)&MASK;
+   }
+
+   /**
+    * Get free space
+    *
+    * @return Number of bytes that may be written
+    */
+   unsigned space() const {
+      return (fTail-fHead-1)&MASK;
+   }
+
+   /**
+    * Add data (producer only)
+    *
+    * @param[in] data Data to add
+    * @param[in] size Number of bytes to add
+    *
+    * @return Number of bytes added (less than size if insufficient space)
+    */
+   unsigned write(const uint8_t *data, unsigned size) {
+      unsigned head = fHead;
+      unsigned free = (fTail-head-1)&MASK;
+      if (size>free) {
+         size = free;
+      }
+      // Copy up to end of buffer then wrap
+      unsigned first = SIZE-head;
+      if (first>size) {
+         first = size;
+      }
+      memcpy(fBuff+head, data, first);
+      memcpy(fBuff, data+first, size-first);
+
+      // Make data visible before index
+      __DMB();
+      fHead = (head+size)&MASK;
+      return size;
+   }
+
+   /**
+    * Remove data (consumer only)
+    *
+    * @param[out] data Buffer for data
+    * @param[in]  size Maximum number of bytes to remove
+    *
+    * @return Number of bytes removed (0 if empty)
+    */
+   unsigned read(uint8_t *data, unsigned size) {
+      unsigned tail  = fTail;
+      unsigned count = (fHead-tail)&MASK;
+      if (size>count) {
+         size = count;
+      }
+      // Read data before index is read
+      __DMB();
+      unsigned first = SIZE-tail;
+      if (first>size) {
+         first = size;
+      }
+      memcpy(data, fBuff+tail, first);
+      memcpy(data+first, fBuff, size-first);
+
+      // Finish with data before releasing space
+      __DMB();
+      fTail = (tail+size)&MASK;
+      return size;
+   }
+
+   /**
+    * Remove single byte (consumer only)
+    *
+    * @param[out] data Byte removed
+    *
+    * @return true  Byte removed
+    * @return false Empty
+    */
+   bool get(uint8_t &data) {
+      return read(&data, 1) == 1;
+   }
+};
+
+#endif /* PROJECT_HEADERS_RINGBUFFER_H_ */
@@ -4,7 +4,7 @@
  *
  *  This file contains the handler for the remote USB CDC command handler.\n
  *  It runs as a separate thread communicating with the USB interrupt handler
- *  through MailQueue queues.
+ *  through byte ring buffers.
  *
  *  Created on: 26Feb.,2017
  *      Author: podonoghue
@@ -12,35 +12,93 @@
 #include <RemoteInterface.h>
 #include "cmsis.h"
 #include "configure.h"
-
-/** Current command */
-RemoteInterface::Command   *RemoteInterface::command;
-
-/** Current response */
-RemoteInterface::Response  *RemoteInterface::response;
+#include "telemetry.h"
+#include "formatter.h"
+#include "tokenizer.h"
+#include "keywordHash.h"
+#include "profileTrajectory.h"
+#include "controlLoop.h"
+#include "profileLibrary.h"
+#include "runArchive.h"
+#include "rtc.h"
 
 /** The remote handler thread */
 CMSIS::Thread RemoteInterface::handlerThread(RemoteInterface::commandThread);
 
-/** Mail queue USB -> handler thread */
-CMSIS::MailQueue<RemoteInterface::Command,  4> RemoteInterface::commandQueue;
+/** Receive buffer USB -> handler thread */
+RingBuffer<RemoteInterface::RX_BUFFER_SIZE> RemoteInterface::rxBuffer;
+
+/** Transmit buffer USB <- handler thread */
+RingBuffer<RemoteInterface::TX_BUFFER_SIZE> RemoteInterface::txBuffer;
 
-/** Mail queue USB <- handler thread */
-CMSIS::MailQueue<RemoteInterface::Response, 4> RemoteInterface::responseQueue;
+/** Serialises writers of txBuffer */
+CMSIS::Mutex RemoteInterface::txMutex;
+
+/** Writer blocked on full txBuffer */
+volatile osThreadId RemoteInterface::txWaiter = nullptr;
 
 /** ID string for Oven */
-const char *RemoteInterface::IDN = "SMT-Oven 1.0.0.0\n\r";
+static const char *IDN = "SMT-Oven 1.0.0.0\n\r";
+
+/**
+ * Send response data over CDC\n
+ * This blocks while the transmit buffer is full
+ *
+ * @param data Data to send
+ * @param size Number of bytes to send
+ */
+void RemoteInterface::send(const uint8_t *data, unsigned size) {
+   for(;;) {
+      unsigned count = txBuffer.write(data, size);
+      data += count;
+      size -= count;
+      if (count>0) {
+         notifyUsbIn();
+      }
+      if (size == 0) {
+         break;
+      }
+      // Full - wait for USB to make space.
+      // The timeout covers space freed before txWaiter was set.
+      txWaiter = osThreadGetId();
+      if (txBuffer.space() == 0) {
+         CMSIS::Thread::signalWait(TX_SIGNAL, 2);
+      }
+      txWaiter = nullptr;
+   }
+}
 
 /**
- * Set response over CDC
+ * Wait until all response data has been passed to the USB IN end-point\n
+ * This blocks on the same signal as send() so the thread sleeps until USB removes data
+ */
+void RemoteInterface::waitForTxEmpty() {
+   while (!txBuffer.isEmpty()) {
+      // Wait for USB to remove data.
+      // The timeout covers data removed before txWaiter was set.
+      txWaiter = osThreadGetId();
+      if (!txBuffer.isEmpty()) {
+         CMSIS::Thread::signalWait(TX_SIGNAL, 2);
+      }
+      txWaiter = nullptr;
+   }
+}
+
+/**
+ * Send response data over CDC if there is room\n
+ * The data is either sent in its entirety or not at all.  This does not block.
  *
- * @param response Response text to send
+ * @param data Data to send
+ * @param size Number of bytes to send
  *
- * @return true Success
+ * @return true  Data queued
+ * @return false Insufficient space
  */
-bool RemoteInterface::send(Response *response) {
-   responseQueue.put(response);
-//   PUTS("send()");
+bool RemoteInterface::trySend(const uint8_t *data, unsigned size) {
+   if (txBuffer.space()<size) {
+      return false;
+   }
+   txBuffer.write(data, size);
    notifyUsbIn();
    return true;
 }
@@ -48,221 +106,890 @@ bool RemoteInterface::send(Response *response) {
 /**
  * Writes thermocouple status to remote
  *
- * @param time  Time of log entry to send
+ * @param time      Time of log entry to send
+ * @param point     Data point for the above time
  * @param lastEntry Indicates this is the last entry so append "\n\r"
- *
- * @return Number of characters written to buffer
  */
-void RemoteInterface::logThermocoupleStatus(int time, bool lastEntry) {
-
-   // Allocate buffer for response
-   Response *response = allocResponseBuffer();
-   if (response == nullptr) {
-      // Failed allocation - discard
-      return;
-   }
-   // Data point to log
-   const DataPoint &point = Draw::getDataPoint(time);
+static void logThermocoupleStatus(int time, const DataPoint &point, bool lastEntry=false) {
 
    // Format response
-   snprintf(reinterpret_cast<char*>(response->data), sizeof(response->data), "%s,%d,%0.1f,%0.1f,%d,%d,",
-         Reporter::getStateName(point.getState()),
-         time,
-         point.getTargetTemperature(),
-         point.getAverageTemperature(),
-         point.getHeater(),
-         point.getFan());
+   FormattedString<80> buff;
+   buff.writeString(Reporter::getStateName(point.getState())).writeChar(',')
+       .writeInt(time).writeChar(',')
+       .writeFixed(point.getTargetTemperature(), 1).writeChar(',')
+       .writeFixed(point.getAverageTemperature(), 1).writeChar(',')
+       .writeInt(point.getHeater()).writeChar(',')
+       .writeInt(point.getFan()).writeChar(',');
    for (unsigned t=0; t<DataPoint::NUM_THERMOCOUPLES; t++) {
-      char buff2[10];
       float temperature;
       point.getTemperature(t, temperature);
-      snprintf(buff2, sizeof(buff2), "%0.1f", temperature);
+      buff.writeFixed(temperature, 1);
       if (t != 3) {
-         strcat(buff2,",");
+         buff.writeChar(',');
       }
-      strcat(reinterpret_cast<char*>(response->data), buff2);
    }
-   strcat(reinterpret_cast<char*>(response->data), ";");
+   buff.writeChar(';');
    if (lastEntry) {
       // Terminate the whole transfer sequence
-      strcat(reinterpret_cast<char*>(response->data),"\n\r");
+      buff.writeString("\n\r");
    }
-   response->size = strlen(reinterpret_cast<char*>(response->data));
-   RemoteInterface::send(response);
+   RemoteInterface::send(buff);
 }
 
 /**
- *  Parse profile information into selected profile
+ * Send standard response for a command that succeeded or failed
  *
- *  @param cmd Profile described by a string e.g.\n
- *  4,My Profile,FF,1.0,140,183,90,1.4,210,15,-3.0;
+ * @param success Indicates success
+ */
+static void sendResult(bool success) {
+   RemoteInterface::send(success?"OK\n\r":"Failed - Data error\n\r");
+}
+
+/**
+ * IDN? - Identify
+ */
+static void cmdIdn(Tokenizer &) {
+   RemoteInterface::send(IDN);
+}
+
+/**
+ *  THERM - Set thermocouple enable and offset
  *
- *  @return true  Successfully parsed
- *  @return false Failed parse
+ *  @param arguments Describes the enable and offset value for each thermocouple e.g.\n
+ *  1,-5,0,0,1,0,1,0;
  */
-bool parseProfile(char *cmd) {
-   unsigned profileNum;
-   SolderProfile profile;
+static void cmdTherm(Tokenizer &arguments) {
+   int enable[TemperatureSensors::NUM_THERMOCOUPLES];
+   int offset[TemperatureSensors::NUM_THERMOCOUPLES];
 
-   char *tok = strtok(cmd, ",");
+   for (unsigned t=0; t<TemperatureSensors::NUM_THERMOCOUPLES; t++) {
+      if (!arguments.getInt(enable[t]) || !arguments.getInt(offset[t]) ||
+          (offset[t]<-10) || (offset[t]>10)) {
+         sendResult(false);
+         return;
+      }
+   }
+   for (unsigned t=0; t<TemperatureSensors::NUM_THERMOCOUPLES; t++) {
+      temperatureSensors.getThermocouple(t).enable(enable[t] != 0);
+      temperatureSensors.getThermocouple(t).setOffset(offset[t]);
+   }
+   sendResult(true);
+}
 
-   profileNum = strtol(tok, &cmd, 10);
+/**
+ * THERM? - Report thermocouple enable and offset
+ */
+static void cmdThermQuery(Tokenizer &) {
+   FormattedString<80> buff;
+   for (int t=0; t<4; t++) {
+      buff.writeInt(temperatureSensors.getThermocouple(t).isEnabled()).writeChar(',')
+          .writeInt(temperatureSensors.getThermocouple(t).getOffset());
+      if (t != 3) {
+         buff.writeChar(',');
+      }
+      else {
+         buff.writeString(";\n\r");
+      }
+   }
+   RemoteInterface::send(buff);
+}
 
-   if (profileNum>=MAX_PROFILES) {
-      return false;
+/**
+ *  PID - Set PID parameters
+ *
+ *  @param arguments Describes the PID parameters e.g.\n
+ *  .1,.024,23.4;
+ */
+static void cmdPid(Tokenizer &arguments) {
+   float kp, ki, kd;
+
+   if (!arguments.getFloat(kp) || !arguments.getFloat(ki) || !arguments.getFloat(kd)) {
+      sendResult(false);
+      return;
    }
+   pidKp = kp;
+   pidKi = ki;
+   pidKd = kd;
+   sendResult(true);
+}
 
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
+/**
+ * PID? - Report PID parameters
+ */
+static void cmdPidQuery(Tokenizer &) {
+   FormattedString<80> buff;
+   buff.writeFixed(pidKp, 6).writeChar(',').writeFixed(pidKi, 6).writeChar(',').writeFixed(pidKd, 6).writeString("\n\r");
+   RemoteInterface::send(buff);
+}
+
+/**
+ *  PROF - Select profile and optionally update it
+ *
+ *  @param arguments Profile described by a string e.g.\n
+ *  4,My Profile,FF,1.0,140,183,90,1.4,210,15,-3.0;
+ */
+static void cmdProf(Tokenizer &arguments) {
+   int profileNum;
+   if (!arguments.getInt(profileNum) || (profileNum<0) || (profileNum>=(int)MAX_PROFILES)) {
+      sendResult(false);
+      return;
+   }
+
+   SolderProfile profile;
+   if (!arguments.getString(profile.description, sizeof(profile.description))) {
       // Assume setting current profile without changes
       currentProfileIndex = profileNum;
-      return true;
+      sendResult(true);
+      return;
    }
 
    if ((profiles[profileNum].flags & P_UNLOCKED) == 0) {
       // Profile is locked
-      return false;
+      sendResult(false);
+      return;
    }
 
-   strncpy(profile.description, tok, sizeof(profile.description));
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   int flags, liquidus, preheatTime, soakTemp1, soakTemp2, soakTime, peakTemp, peakDwell;
+   bool success =
+         arguments.getInt(flags, 16)         &&
+         arguments.getInt(liquidus)          &&
+         arguments.getInt(preheatTime)       &&
+         arguments.getInt(soakTemp1)         &&
+         arguments.getInt(soakTemp2)         &&
+         arguments.getInt(soakTime)          &&
+         arguments.getFloat(profile.rampUpSlope) &&
+         arguments.getInt(peakTemp)          &&
+         arguments.getInt(peakDwell)         &&
+         arguments.getFloat(profile.rampDownSlope);
+   if (!success) {
+      sendResult(false);
+      return;
    }
-   profile.flags = strtol(tok, nullptr, 16);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   profile.flags       = flags;
+   profile.liquidus    = liquidus;
+   profile.preheatTime = preheatTime;
+   profile.soakTemp1   = soakTemp1;
+   profile.soakTemp2   = soakTemp2;
+   profile.soakTime    = soakTime;
+   profile.peakTemp    = peakTemp;
+   profile.peakDwell   = peakDwell;
+
+   {
+      // Written to Flash together
+      USBDM::NonvolatileTransaction transaction;
+      currentProfileIndex  = profileNum;
+      profiles[profileNum] = profile;
    }
-   profile.liquidus = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+
+   sendResult(true);
+}
+
+/**
+ * PROF? - Report current profile
+ */
+static void cmdProfQuery(Tokenizer &) {
+   const NvSolderProfile &profile = profiles[currentProfileIndex];
+   FormattedString<80> buff;
+   buff
+      /* index         */ .writeInt(currentProfileIndex).writeChar(',')
+      /* name          */ .writeString(profile.description).writeChar(',')
+      /* flags         */ .writeHex((uint8_t)profile.flags, 2).writeChar(',')
+      /* liquidus      */ .writeInt(profile.liquidus).writeChar(',')
+      /* preheatTime   */ .writeInt(profile.preheatTime).writeChar(',')
+      /* soakTemp1     */ .writeInt(profile.soakTemp1).writeChar(',')
+      /* soakTemp2     */ .writeInt(profile.soakTemp2).writeChar(',')
+      /* soakTime      */ .writeInt(profile.soakTime).writeChar(',')
+      /* ramp2Slope    */ .writeFixed(profile.rampUpSlope, 1).writeChar(',')
+      /* peakTemp      */ .writeInt(profile.peakTemp).writeChar(',')
+      /* peakDwell     */ .writeInt(profile.peakDwell).writeChar(',')
+      /* rampDownSlope */ .writeFixed(profile.rampDownSlope, 1).writeString(";\n\r");
+   RemoteInterface::send(buff);
+}
+
+/**
+ * LIB? - Report profile library
+ *
+ * @param arguments Optional library index or profile name
+ *
+ * Response (no argument):
+ *   <count>,<capacity>,<freeRecords>,<generation>;<index>,<name>;...;\n\r
+ * Response (index or name):
+ *   Profile in PROF? format with library index
+ */
+static void cmdLibQuery(Tokenizer &arguments) {
+   char key[sizeof(SolderProfile::description)];
+   if (!arguments.getString(key, sizeof(key)) || (key[0] == '\0')) {
+      FormattedString<80> buff;
+      buff.writeInt(profileLibrary.getCount()).writeChar(',').writeInt(profileLibrary.getCapacity()).writeChar(',')
+          .writeInt(profileLibrary.getFreeRecords()).writeChar(',').writeInt(profileLibrary.getGeneration()).writeChar(';');
+      RemoteInterface::send(buff);
+      SolderProfile profile;
+      for (int index=profileLibrary.getNext(-1); index>=0; index=profileLibrary.getNext(index)) {
+         if (profileLibrary.load(index, profile)) {
+            buff.reset().writeInt(index).writeChar(',').writeString(profile.description).writeChar(';');
+            RemoteInterface::send(buff);
+         }
+      }
+      RemoteInterface::send("\n\r");
+      return;
    }
-   profile.preheatTime = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   char *end;
+   int index = strtol(key, &end, 10);
+   if ((end == key) || (*end != '\0')) {
+      index = profileLibrary.find(key);
    }
-   profile.soakTemp1 = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   SolderProfile profile;
+   if ((index<0) || !profileLibrary.load(index, profile)) {
+      sendResult(false);
+      return;
    }
-   profile.soakTemp2 = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   FormattedString<80> buff;
+   buff
+      /* index         */ .writeInt(index).writeChar(',')
+      /* name          */ .writeString(profile.description).writeChar(',')
+      /* flags         */ .writeHex(profile.flags, 2).writeChar(',')
+      /* liquidus      */ .writeInt(profile.liquidus).writeChar(',')
+      /* preheatTime   */ .writeInt(profile.preheatTime).writeChar(',')
+      /* soakTemp1     */ .writeInt(profile.soakTemp1).writeChar(',')
+      /* soakTemp2     */ .writeInt(profile.soakTemp2).writeChar(',')
+      /* soakTime      */ .writeInt(profile.soakTime).writeChar(',')
+      /* ramp2Slope    */ .writeFixed(profile.rampUpSlope, 1).writeChar(',')
+      /* peakTemp      */ .writeInt(profile.peakTemp).writeChar(',')
+      /* peakDwell     */ .writeInt(profile.peakDwell).writeChar(',')
+      /* rampDownSlope */ .writeFixed(profile.rampDownSlope, 1).writeString(";\n\r");
+   RemoteInterface::send(buff);
+}
+
+/**
+ * LIB - Modify profile library
+ *
+ * @param arguments Sub-command e.g.\n
+ *  SAVE p   - Save profile p to library (replaces library profile with the same name)\n
+ *  LOAD n,p - Load library profile n into profile p and make it the current profile\n
+ *  DEL n    - Delete library profile n
+ */
+static void cmdLib(Tokenizer &arguments) {
+   if (!RunProfile::isIdle()) {
+      // Flash programming would stall the control loop
+      RemoteInterface::send("Failed - Busy\n\r");
+      return;
    }
-   profile.soakTime = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   const char *word;
+   unsigned    length;
+   arguments.getWord(word, length);
+   int index, profileNum;
+   if ((length == 4) && (strncasecmp(word, "SAVE", length) == 0) &&
+         arguments.getInt(profileNum) && arguments.atEnd()) {
+      if ((profileNum<0) || (profileNum>=(int)MAX_PROFILES)) {
+         sendResult(false);
+         return;
+      }
+      SolderProfile profile;
+      profile = profiles[profileNum];
+      sendResult(profileLibrary.store(profile)>=0);
+      return;
    }
-   profile.rampUpSlope = strtof(tok, nullptr);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   if ((length == 4) && (strncasecmp(word, "LOAD", length) == 0) &&
+         arguments.getInt(index) && arguments.getInt(profileNum) && arguments.atEnd()) {
+      SolderProfile profile;
+      if ((index<0) || (profileNum<0) || (profileNum>=(int)MAX_PROFILES) ||
+            ((profiles[profileNum].flags & P_UNLOCKED) == 0) || !profileLibrary.load(index, profile)) {
+         sendResult(false);
+         return;
+      }
+      profile.flags |= P_UNLOCKED;
+      {
+         // Written to Flash together
+         USBDM::NonvolatileTransaction transaction;
+         currentProfileIndex  = profileNum;
+         profiles[profileNum] = profile;
+      }
+      sendResult(true);
+      return;
    }
-   profile.peakTemp = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+   if ((length == 3) && (strncasecmp(word, "DEL", length) == 0) &&
+         arguments.getInt(index) && arguments.atEnd()) {
+      sendResult((index>=0) && profileLibrary.isUsed(index) && profileLibrary.remove(index));
+      return;
    }
-   profile.peakDwell = strtol(tok, nullptr, 10);
-   tok = strtok(nullptr, ";\n\r");
-   if (tok == nullptr) {
-      return false;
+   sendResult(false);
+}
+
+/**
+ * Format summary of archived run
+ *
+ * @param[out] buff    Buffer to write to
+ * @param[in]  summary Summary of run
+ */
+static void writeRunSummary(Formatter &buff, const RunSummary &summary) {
+   buff
+      /* run               */ .writeInt(summary.run).writeChar(',')
+      /* timestamp         */ .writeInt(summary.timestamp).writeChar(',')
+      /* profile index     */ .writeInt(summary.profileIndex).writeChar(',')
+      /* profile name      */ .writeString(summary.description).writeChar(',')
+      /* final state       */ .writeString(Reporter::getStateName((State)summary.finalState)).writeChar(',')
+      /* points            */ .writeInt(summary.points).writeChar(',')
+      /* peak temperature  */ .writeFixed(summary.peakTemperature/100.0f, 1).writeChar(',')
+      /* liquidus          */ .writeInt(summary.liquidus).writeChar(',')
+      /* time above liquid */ .writeInt(summary.timeAboveLiquidus).writeChar(',')
+      /* max ramp slope    */ .writeFixed(summary.maxRampSlope/100.0f, 2);
+}
+
+/**
+ * RUNS? - Report run archive
+ *
+ * @param arguments Optional run number
+ *
+ * Response (no argument):
+ *   <count>,<freeBytes>;<run>,<timestamp>,<profile>,<name>,<state>,<points>,<peak>,<liquidus>,<timeAboveLiquidus>,<slope>,<valid>;...;\n\r
+ * Response (run number) - summary followed by points of run in PLOT? format:
+ *   <run>,<timestamp>,<profile>,<name>,<state>,<points>,<peak>,<liquidus>,<timeAboveLiquidus>,<slope>;<count>;<point>;...;\n\r
+ */
+static void cmdRunsQuery(Tokenizer &arguments) {
+   FormattedString<100> buff;
+   RunSummary summary;
+   bool       valid;
+   if (arguments.atEnd()) {
+      unsigned count = runArchive.getCount();
+      buff.writeInt(count).writeChar(',').writeInt(runArchive.getFreeSpace()).writeChar(';');
+      RemoteInterface::send(buff);
+      for (unsigned index=0; index<count; index++) {
+         if (runArchive.getSummary(index, summary, valid)) {
+            writeRunSummary(buff.reset(), summary);
+            buff.writeChar(',').writeInt(valid).writeChar(';');
+            RemoteInterface::send(buff);
+         }
+      }
+      RemoteInterface::send("\n\r");
+      return;
+   }
+   int run;
+   if (!arguments.getInt(run) || !arguments.atEnd() ||
+       !runArchive.findSummary(run, summary, valid) || !valid) {
+      sendResult(false);
+      return;
    }
-   profile.rampDownSlope = strtof(tok, nullptr);
+   writeRunSummary(buff, summary);
+   buff.writeChar(';').writeInt(summary.points).writeChar(';');
+   RemoteInterface::send(buff);
+   if (!runArchive.getPoints(run, logThermocoupleStatus)) {
+      // Run discarded since summary was sent
+      RemoteInterface::send("\n\r");
+   }
+}
 
-   currentProfileIndex = profileNum;
-   profiles[profileNum] = profile;
+/**
+ * METRICS? - Report reflow metrics of current (or last) run
+ *
+ * Response:
+ *   <samples>,<liquidus>,<peak>,<peakTime>,<timeAboveLiquidus>,<maxRise>,<maxFall>,<soakTime>,
+ *   <maxSpread>,<peakSpread>,<peak> (for each thermocouple);\n\r
+ *
+ * Values that are not available e.g. inactive thermocouple are reported as nan.
+ */
+static void cmdMetricsQuery(Tokenizer &) {
+   ReflowMetrics::Values values;
+   Reporter::getMetrics(values);
 
-   return true;
+   FormattedString<100> buff;
+   buff.writeInt(values.samples).writeChar(',')
+       .writeFixed(values.liquidus, 1).writeChar(',')
+       .writeFixed(values.peakTemperature, 1).writeChar(',')
+       .writeInt(values.peakTime).writeChar(',')
+       .writeInt(values.timeAboveLiquidus).writeChar(',')
+       .writeFixed(values.maxRiseSlope, 2).writeChar(',')
+       .writeFixed(values.maxFallSlope, 2).writeChar(',')
+       .writeInt(values.soakTime).writeChar(',')
+       .writeFixed(values.maxSpread, 1).writeChar(',')
+       .writeFixed(values.getPeakSpread(), 1);
+   for (float peak:values.thermocouplePeaks) {
+      buff.writeChar(',').writeFixed(peak, 1);
+   }
+   buff.writeString(";\n\r");
+   RemoteInterface::send(buff);
 }
 
 /**
- *  Parse thermocouple information into selected profile
+ * TIME? - Report real-time clock
  *
- *  @param cmd Describes the enable and offset value for each thermocouple e.g.\n
- *  1,-5,0,0,1,0,1,0;
+ * Response:
+ *   <seconds since epoch>\n\r
+ */
+static void cmdTimeQuery(Tokenizer &) {
+   FormattedString<20> buff;
+   buff.writeInt(USBDM::Rtc::getTime()).writeString("\n\r");
+   RemoteInterface::send(buff);
+}
+
+/**
+ * TIME - Set real-time clock (used to time-stamp archived runs)
  *
- *  @return true  Successfully parsed
- *  @return false Failed parse
+ * @param arguments Seconds since epoch e.g. 1508112000
  */
-bool parseThermocouples(char *cmd) {
-   char *tok;
-   bool enable;
-   int  offset;
+static void cmdTime(Tokenizer &arguments) {
+   int time;
+   if (!arguments.getInt(time) || !arguments.atEnd() || (time<0)) {
+      sendResult(false);
+      return;
+   }
+   USBDM::Rtc::setTime(time);
+   sendResult(true);
+}
 
-   tok = strtok(cmd, ",");
+/**
+ * Send a range of plot points as text
+ *
+ * @param from  Index of first point to send
+ * @param count Number of points to send (already limited to valid points)
+ * @param extended Include last valid index, plot generation and log full flag in header
+ *
+ * Response:
+ *   <count>;<point>;...;\n\r                                  (extended=false)
+ *   <count>,<lastValid>,<generation>,<full>;<point>;...;\n\r  (extended=true)
+ *
+ *   <full> is 1 if points have been discarded because the plot is full
+ */
+static void sendPlotRange(int from, int count, bool extended) {
+   const TemperaturePlot &plot = Draw::getData();
+   FormattedString<40> buff;
+   buff.writeInt(count);
+   if (extended) {
+      buff.writeChar(',').writeInt(plot.getLastValid()).writeChar(',').writeInt(plot.getGeneration())
+          .writeChar(',').writeInt(plot.isLogFull()?1:0);
+   }
+   buff.writeChar(';');
+   if (count <= 0) {
+      // Terminate the response early
+      buff.writeString("\n\r");
+   }
+   RemoteInterface::send(buff);
 
-   for (int t=0; t<4; t++) {
-      if (tok == nullptr) {
-         return false;
+   // Single cursor so each point is only decoded once
+   TemperaturePlot::Cursor cursor;
+   int last = from+count-1;
+   for (int index=from; index<=last; index++) {
+      logThermocoupleStatus(index, plot.getDataPoint(index, cursor), index == last);
+   }
+}
+
+/**
+ * PLOT? - Report plot as text
+ *
+ * @param arguments Optional range e.g.\n
+ *  (none)              - Entire plot\n
+ *  from,count          - Up to count points starting at index from\n
+ *  SINCE generation,n  - Points after index n. If the plot has been cleared since
+ *                        generation was reported then all points are sent.\n
+ * The forms with arguments report the last valid index and generation so the host
+ * may resume polling with SINCE, and whether the plot is full.
+ */
+static void cmdPlotQuery(Tokenizer &arguments) {
+   int lastValid = Draw::getData().getLastValid();
+   if (arguments.atEnd()) {
+      sendPlotRange(0, lastValid+1, false);
+      return;
+   }
+   Tokenizer   sinceArguments = arguments;
+   const char *word;
+   unsigned    length;
+   sinceArguments.getWord(word, length);
+   int from, count;
+   if ((length == 5) && (strncasecmp(word, "SINCE", length) == 0)) {
+      int generation, last;
+      if (!sinceArguments.getInt(generation) || !sinceArguments.getInt(last) || !sinceArguments.atEnd()) {
+         sendResult(false);
+         return;
       }
-      enable = (strtol(tok, nullptr, 10)!=0);
-      tok    = strtok(nullptr, ",;\n\r");
-      if (tok == nullptr) {
-         return false;
+      from = ((unsigned)generation == Draw::getData().getGeneration())?last+1:0;
+      if (from<0) {
+         from = 0;
       }
-      offset = strtol(tok, nullptr, 10);
-      tok    = strtok(nullptr, ",");
-      if ((offset<-10) || (offset>10)) {
-         return false;
+      count = lastValid+1-from;
+   }
+   else {
+      if (!arguments.getInt(from) || !arguments.getInt(count) || !arguments.atEnd() || (from<0) || (count<0)) {
+         sendResult(false);
+         return;
+      }
+      if (count>(lastValid+1-from)) {
+         count = lastValid+1-from;
       }
-      temperatureSensors.getThermocouple(t).enable(enable);
-      temperatureSensors.getThermocouple(t).setOffset(offset);
    }
-   return true;
+   sendPlotRange(from, (count>0)?count:0, true);
 }
 
 /**
- *  Parse PID information into PID parameters
+ * STATUS? - Report snapshot of oven status in a single response
  *
- *  @param cmd Describes the PID parameters e.g.\n
- *  .1,.024,23.4;
+ * Response:
+ *   <state>,<time>,<setpoint>,<error>,<output>,<heater>,<fan>,
+ *   <temperature>,<status>,<cold junction> (for each thermocouple),
+ *   <lastValid>,<generation>,<full>;\n\r
  *
- *  @return true  Successfully parsed
- *  @return false Failed parse
+ *   <full> is 1 if plot points have been discarded because the plot is full
+ *
+ * All values are captured before any formatting so they describe the same instant
+ * as closely as possible without blocking the controller.
  */
-bool parsePidParameters(char *cmd) {
-   char *tok;
+static void cmdStatusQuery(Tokenizer &) {
+   // Capture
+   State    state       = RunProfile::remoteCheckRunProfile();
+   int      time        = RunProfile::getRunTime();
+   float    setpoint    = pid.getSetpoint();
+   float    error       = pid.getError();
+   float    output      = pid.getOutput();
+   int      heater      = ovenControl.getHeaterDutycycle();
+   int      fan         = ovenControl.getFanDutycycle();
+   int      lastValid   = Draw::getData().getLastValid();
+   unsigned generation  = Draw::getData().getGeneration();
+   bool     logFull     = Draw::getData().isLogFull();
+   TemperatureSensors::Snapshot snapshot;
+   temperatureSensors.getSnapshot(snapshot);
 
-   tok = strtok(cmd, ",");
-   if (tok == nullptr) {
-      return false;
+   // Report
+   FormattedString<80> buff;
+   buff.writeString(Reporter::getStateName(state)).writeChar(',')
+       .writeInt(time).writeChar(',')
+       .writeFixed(setpoint, 1).writeChar(',')
+       .writeFixed(error, 2).writeChar(',')
+       .writeFixed(output, 2).writeChar(',')
+       .writeInt(heater).writeChar(',')
+       .writeInt(fan).writeChar(',');
+   RemoteInterface::send(buff);
+   for (unsigned t=0; t<TemperatureSensors::NUM_THERMOCOUPLES; t++) {
+      float temperature;
+      Max31855::ThermocoupleStatus status = snapshot.measurements.getTemperature(t, temperature);
+      buff.reset().writeFixed(temperature, 1).writeChar(',')
+          .writeString(Max31855::getStatusName(status)).writeChar(',')
+          .writeFixed(snapshot.coldReferences[t], 1).writeChar(',');
+      RemoteInterface::send(buff);
    }
-   float kp = strtof(tok, nullptr);
+   buff.reset().writeInt(lastValid).writeChar(',').writeInt(generation).writeChar(',')
+       .writeInt(logFull?1:0).writeString(";\n\r");
+   RemoteInterface::send(buff);
+}
 
-   tok = strtok(nullptr, ",");
-   if (tok == nullptr) {
-      return false;
+/**
+ * TRAJ? - Report set-point trajectory of current profile (nominal ambient)
+ *
+ * @param arguments Optional time e.g.\n
+ *  (none) - Segment table\n
+ *           <count>;<state>,<start>,<duration>,<startTemp>,<endTemp>;...\n\r\n
+ *  t      - Set-point at time t\n
+ *           <state>,<setpoint>;\n\r
+ */
+static void cmdTrajQuery(Tokenizer &arguments) {
+   ProfileTrajectory trajectory;
+   getProfileTrajectory(profiles[currentProfileIndex], trajectory);
+
+   FormattedString<80> buff;
+   if (!arguments.atEnd()) {
+      int time;
+      if (!arguments.getInt(time) || !arguments.atEnd() || (time<0)) {
+         sendResult(false);
+         return;
+      }
+      const ProfileTrajectory::Segment &segment = trajectory.findSegment(time);
+      buff.writeString(Reporter::getStateName(segment.state)).writeChar(',')
+          .writeFixed(segment.getSetpoint(time-segment.startTime), 1).writeString(";\n\r");
+      RemoteInterface::send(buff);
+      return;
    }
-   float ki = strtof(tok, nullptr);
+   buff.writeInt(ProfileTrajectory::NUM_SEGMENTS).writeChar(';');
+   RemoteInterface::send(buff);
+   for (unsigned index=0; index<ProfileTrajectory::NUM_SEGMENTS; index++) {
+      const ProfileTrajectory::Segment &segment = trajectory.getSegment(index);
+      buff.reset().writeString(Reporter::getStateName(segment.state)).writeChar(',')
+          .writeInt(segment.startTime).writeChar(',')
+          .writeInt(segment.duration).writeChar(',')
+          .writeFixed(segment.startTemp, 1).writeChar(',')
+          .writeFixed(segment.endTemp, 1).writeChar(';');
+      if (index == (ProfileTrajectory::NUM_SEGMENTS-1)) {
+         buff.writeString("\n\r");
+      }
+      RemoteInterface::send(buff);
+   }
+}
 
-   tok = strtok(nullptr, ";\n\r");
-   if (tok == nullptr) {
-      return false;
+/**
+ * CTRL? - Report control loop timing statistics
+ *
+ * @param arguments Optional "RESET" to clear statistics after reporting
+ *
+ * Response:
+ *   <ticks>,<overruns>,<name>,<last>,<average>,<maximum>,... (times in us);\n\r
+ */
+static void cmdCtrlQuery(Tokenizer &arguments) {
+   const char *word;
+   unsigned    length;
+   bool reset = arguments.getWord(word, length);
+   if (reset && ((length != 5) || (strncasecmp(word, "RESET", length) != 0) || !arguments.atEnd())) {
+      sendResult(false);
+      return;
+   }
+   FormattedString<80> buff;
+   buff.writeInt(ControlLoop::getTickCount()).writeChar(',').writeInt(ControlLoop::getOverruns());
+   RemoteInterface::send(buff);
+   for (int stage=0; stage<ControlLoop::NUM_STAGES; stage++) {
+      ControlLoop::StageStatistics statistics;
+      ControlLoop::getStatistics((ControlLoop::Stage)stage, statistics);
+      buff.reset().writeChar(',').writeString(ControlLoop::getStageName((ControlLoop::Stage)stage)).writeChar(',')
+          .writeInt(statistics.last).writeChar(',')
+          .writeInt(statistics.average).writeChar(',')
+          .writeInt(statistics.maximum);
+      RemoteInterface::send(buff);
+   }
+   RemoteInterface::send(";\n\r");
+   if (reset) {
+      ControlLoop::resetStatistics();
    }
-   float kd = strtof(tok, nullptr);
+}
 
-   pidKp = kp;
-   pidKi = ki;
-   pidKd = kd;
-   return true;
+/**
+ * FLASH? - Report non-volatile storage write and wear statistics
+ *
+ * @param arguments Optional "RESET" to clear statistics after reporting
+ *
+ * Response:
+ *   <writes>,<bytes>,<unchanged>,<commits>,<stalls>,<stallTime>,<maxStall>,<name>,<writes>,<maxWordWrites>,... (times in us);\n\r
+ *   For each variable <writes> counts the FlexRAM writes that changed it and <maxWordWrites> is the
+ *   most writes to one FlexRAM word it occupies (wear, including variables sharing the word).
+ *   Profile entries are named profile0, profile1 etc.
+ */
+static void cmdFlashQuery(Tokenizer &arguments) {
+   const char *word;
+   unsigned    length;
+   bool reset = arguments.getWord(word, length);
+   if (reset && ((length != 5) || (strncasecmp(word, "RESET", length) != 0) || !arguments.atEnd())) {
+      sendResult(false);
+      return;
+   }
+   USBDM::NonvolatileStatistics statistics;
+   USBDM::NonvolatileShadow::getStatistics(statistics);
+   FormattedString<80> buff;
+   buff.writeInt(statistics.writes).writeChar(',').writeInt(statistics.bytesWritten).writeChar(',')
+       .writeInt(statistics.unchanged).writeChar(',').writeInt(statistics.commits).writeChar(',')
+       .writeInt(statistics.stalls).writeChar(',').writeInt(statistics.stallTime).writeChar(',')
+       .writeInt(statistics.maxStall);
+   RemoteInterface::send(buff);
+   NonvolatileVariable variable;
+   for (unsigned index=0; Settings::getNonvolatileVariable(index, variable); index++) {
+      unsigned maxWordWrites;
+      uint32_t writes = USBDM::NonvolatileShadow::getWriteCount(variable.address, variable.size, maxWordWrites);
+      buff.reset().writeChar(',').writeString(variable.name);
+      if (variable.index>=0) {
+         buff.writeInt(variable.index);
+      }
+      buff.writeChar(',').writeInt(writes).writeChar(',').writeInt(maxWordWrites);
+      RemoteInterface::send(buff);
+   }
+   RemoteInterface::send(";\n\r");
+   if (reset) {
+      USBDM::NonvolatileShadow::resetStatistics();
+   }
 }
 
 /**
- * Try to lock the Interactive MUTEX so that the remote session has ownership
+ * TELEM? - Report binary telemetry format
+ */
+static void cmdTelemQuery(Tokenizer &) {
+   FormattedString<80> buff;
+   buff.writeInt(Telemetry::VERSION).writeChar(',').writeInt(Telemetry::RECORD_SIZE).writeChar(',')
+       .writeInt(Telemetry::RECORDS_PER_FRAME).writeString(";\n\r");
+   RemoteInterface::send(buff);
+}
+
+/**
+ * TELEM - Binary telemetry
+ *
+ * @param arguments Sub-command e.g.\n
+ *  PLOT?  - Send entire plot as binary frames\n
+ *  LIVE n - Enable(1)/disable(0) live frames
+ */
+static void cmdTelem(Tokenizer &arguments) {
+   const char *word;
+   unsigned    length;
+   arguments.getWord(word, length);
+   if ((length == 5) && (strncasecmp(word, "PLOT?", length) == 0) && arguments.atEnd()) {
+      Telemetry::sendPlot();
+      return;
+   }
+   int enable;
+   if ((length == 4) && (strncasecmp(word, "LIVE", length) == 0) && arguments.getInt(enable)) {
+      Telemetry::setLive(enable != 0);
+      sendResult(true);
+      return;
+   }
+   sendResult(false);
+}
+
+/**
+ * RUN - Run current profile\n
+ * The interactive mutex remains locked until the run is completed
+ */
+static void cmdRun(Tokenizer &) {
+   RunProfile::remoteStartRunProfile();
+   RemoteInterface::send("OK\n\r");
+}
+
+/**
+ * ABORT - Abort running profile
+ */
+static void cmdAbort(Tokenizer &) {
+   // Archives the run as failed
+   RunProfile::abortRunProfile();
+   // Unlock from RUN
+   interactiveMutex.release();
+   RemoteInterface::send("OK\n\r");
+}
+
+/**
+ * RUN? - Check status of running profile
+ */
+static void cmdRunQuery(Tokenizer &) {
+   State state = RunProfile::remoteCheckRunProfile();
+   if (state == s_complete) {
+      // Unlock from RUN
+      interactiveMutex.release();
+      RemoteInterface::send("OK\n\r");
+   }
+   else if (state == s_fail) {
+      // Unlock from RUN
+      interactiveMutex.release();
+      RemoteInterface::send("Failed\n\r");
+   }
+   else {
+      RemoteInterface::send("Running\n\r");
+   }
+}
+
+/** Maximum number of bytes for BENCH command */
+static constexpr int MAX_BENCH_SIZE = 1000000;
+
+/**
+ * BENCH n - Stream n bytes of test data to measure throughput
+ *
+ * Response:
+ *   <n bytes of 'A'-'Z','0'-'9' pattern>;<elapsed time in ms>\n\r
+ */
+static void cmdBench(Tokenizer &arguments) {
+   int count;
+   if (!arguments.getInt(count) || (count<0) || (count>MAX_BENCH_SIZE)) {
+      RemoteInterface::send("Failed - Data error\n\r");
+      return;
+   }
+   static const char pattern[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+   static constexpr unsigned PATTERN_LENGTH = sizeof(pattern)-1;
+
+   uint32_t startTime = osKernelSysTick();
+   while (count>0) {
+      unsigned size = (count>(int)PATTERN_LENGTH)?PATTERN_LENGTH:count;
+      RemoteInterface::send((const uint8_t *)pattern, size);
+      count -= size;
+   }
+   // Wait for data to be accepted by USB
+   RemoteInterface::waitForTxEmpty();
+   uint32_t elapsed = (osKernelSysTick()-startTime)/osKernelSysTickMicroSec(1000);
+
+   FormattedString<20> buff;
+   buff.writeChar(';').writeInt(elapsed).writeString("\n\r");
+   RemoteInterface::send(buff);
+}
+
+/** Arguments expected by command */
+enum ArgumentSchema : uint8_t {
+   Args_None,     //!< Keyword only e.g. "PID?"
+   Args_Required, //!< Keyword followed by arguments e.g. "PID 1.0,0.1,20"
+   Args_Optional, //!< Keyword optionally followed by arguments e.g. "PLOT? 0,10"
+};
+
+/** Use of interactive mutex by command */
+enum MutexPolicy : uint8_t {
+   Mutex_None,    //!< Mutex not needed
+   Mutex_Lock,    //!< Mutex is held while command executes
+   Mutex_Acquire, //!< Mutex is obtained and remains held after command completes
+};
+
+/** Describes a remote command */
+struct CommandEntry {
+   const char     *keyword;            //!< Command keyword (matched without regard to case)
+   ArgumentSchema  schema;             //!< Arguments expected
+   MutexPolicy     mutexPolicy;        //!< Use of interactive mutex
+   void          (*handler)(Tokenizer &arguments); //!< Handler - arguments are positioned after keyword
+};
+
+/** Remote commands */
+static constexpr CommandEntry commands[] = {
+      {"IDN?",   Args_None,     Mutex_None,    cmdIdn        },
+      {"THERM",  Args_Required, Mutex_Lock,    cmdTherm      },
+      {"THERM?", Args_None,     Mutex_None,    cmdThermQuery },
+      {"PID",    Args_Required, Mutex_Lock,    cmdPid        },
+      {"PID?",   Args_None,     Mutex_None,    cmdPidQuery   },
+      {"PROF",   Args_Required, Mutex_Lock,    cmdProf       },
+      {"PROF?",  Args_None,     Mutex_None,    cmdProfQuery  },
+      {"PLOT?",  Args_Optional, Mutex_None,    cmdPlotQuery  },
+      {"TELEM?", Args_None,     Mutex_None,    cmdTelemQuery },
+      {"TELEM",  Args_Required, Mutex_None,    cmdTelem      },
+      {"RUN",    Args_None,     Mutex_Acquire, cmdRun        },
+      {"ABORT",  Args_None,     Mutex_Lock,    cmdAbort      },
+      {"RUN?",   Args_None,     Mutex_Lock,    cmdRunQuery   },
+      {"BENCH",  Args_Required, Mutex_None,    cmdBench      },
+      {"STATUS?",Args_None,     Mutex_None,    cmdStatusQuery},
+      {"TRAJ?",  Args_Optional, Mutex_None,    cmdTrajQuery  },
+      {"CTRL?",  Args_Optional, Mutex_None,    cmdCtrlQuery  },
+      {"FLASH?", Args_Optional, Mutex_None,    cmdFlashQuery },
+      {"LIB?",   Args_Optional, Mutex_None,    cmdLibQuery   },
+      {"LIB",    Args_Required, Mutex_Lock,    cmdLib        },
+      {"RUNS?",  Args_Optional, Mutex_None,    cmdRunsQuery  },
+      {"METRICS?",Args_None,    Mutex_None,    cmdMetricsQuery},
+      {"TIME?",  Args_None,     Mutex_None,    cmdTimeQuery  },
+      {"TIME",   Args_Required, Mutex_Lock,    cmdTime       },
+};
+
+/** Number of remote commands */
+static constexpr unsigned NUM_COMMANDS = sizeof(commands)/sizeof(commands[0]);
+
+/** Command keywords for hashing */
+struct CommandKeywords {
+   static constexpr unsigned count = NUM_COMMANDS;
+   static constexpr const char *keyword(unsigned index) {
+      return commands[index].keyword;
+   }
+};
+
+/** Hash table locating commands - built by initialise() */
+static KeywordHash<CommandKeywords, 6> commandHash;
+
+/**
+ * Locate command
  *
- * @param response Buffer to use for response if getting MUTEX fails.
+ * @param[in] keyword Keyword to look up
+ * @param[in] length  Length of keyword
+ *
+ * @return Index of command or -1 if not found
+ */
+int RemoteInterface::findCommand(const char *keyword, unsigned length) {
+   return commandHash.find(keyword, length);
+}
+
+/**
+ * Get keyword of command
+ *
+ * @param[in] index Index of command
+ *
+ * @return Keyword or nullptr if index is past the last command
+ */
+const char *RemoteInterface::getCommandKeyword(unsigned index) {
+   return (index<NUM_COMMANDS)?commands[index].keyword:nullptr;
+}
+
+/**
+ * Try to lock the Interactive MUTEX so that the remote session has ownership
  *
  * @return true  => success
- * @return false => failed (A fail response has been sent to the remote and response has been consumed)
+ * @return false => failed (A fail response has been sent to the remote)
  */
-bool RemoteInterface::getInteractiveMutex(RemoteInterface::Response *response) {
+bool RemoteInterface::getInteractiveMutex() {
    // Lock interface
    osStatus status = interactiveMutex.wait(0);
 
@@ -270,9 +997,7 @@ bool RemoteInterface::getInteractiveMutex(RemoteInterface::Response *response) {
    if (status == osOK) {
       return true;
    }
-   strcpy(reinterpret_cast<char*>(response->data), "Failed - Busy\n\r");
-   response->size = strlen(reinterpret_cast<char*>(response->data));
-   RemoteInterface::send(response);
+   send("Failed - Busy\n\r");
    return false;
 }
 
@@ -284,203 +1009,86 @@ bool RemoteInterface::getInteractiveMutex(RemoteInterface::Response *response) {
  * @return true  => success
  * @return false => failed (A fail response has been sent to the remote)
  */
-bool RemoteInterface::doCommand(Command *cmd) {
+bool RemoteInterface::doCommand(const char *cmd) {
 
-   // Allocate response buffer
-   Response *response = allocResponseBuffer();
-   if (response == nullptr) {
-      // Discard command if we can't respond
-      // This should be impossible
-      return false;
-   }
+   Tokenizer   arguments(cmd);
+   const char *keyword;
+   unsigned    length;
 
-   if (strcasecmp((const char *)(cmd->data), "IDN?\n") == 0) {
-      strcpy(reinterpret_cast<char*>(response->data), IDN);
-      response->size = strlen(IDN);
-      send(response);
-   }
-   else if (strncasecmp((const char *)(cmd->data), "THERM ", 6) == 0) {
-      // Lock interface
-      if (!getInteractiveMutex(response)) {
-         return false;
-      }
-      if (parseThermocouples(reinterpret_cast<char*>(&cmd->data[6]))) {
-         strcpy(reinterpret_cast<char*>(response->data), "OK\n\r");
-      }
-      else {
-         strcpy(reinterpret_cast<char*>(response->data), "Failed - Data error\n\r");
-      }
-      interactiveMutex.release();
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else if (strcasecmp((const char *)(cmd->data), "THERM?\n") == 0) {
-      response->data[0] = (uint8_t)'\0';
-      for (int t=0; t<4; t++) {
-         char buff[10];
-         snprintf(buff, sizeof(buff),"%d,%d",
-               temperatureSensors.getThermocouple(t).isEnabled(),
-               temperatureSensors.getThermocouple(t).getOffset());
-         if (t != 3) {
-            strcat(buff, ",");
-         }
-         else {
-            strcat(buff, ";\n\r");
-         }
-         strcat(reinterpret_cast<char*>(response->data), buff);
-      }
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else if (strncasecmp((const char *)(cmd->data), "PID ", 4) == 0) {
-      // Lock interface
-      if (!getInteractiveMutex(response)) {
-         return false;
-      }
-      if (parsePidParameters(reinterpret_cast<char*>(&cmd->data[4]))) {
-         strcpy(reinterpret_cast<char*>(response->data), "OK\n\r");
-      }
-      else {
-         strcpy(reinterpret_cast<char*>(response->data), "Failed - Data error\n\r");
-      }
-      interactiveMutex.release();
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else if (strcasecmp((const char *)(cmd->data), "PID?\n") == 0) {
-      response->data[0] = (uint8_t)'\0';
-      snprintf(reinterpret_cast<char*>(response->data), sizeof(response->data), "%f,%f,%f\n\r",
-            (float)pidKp, (float)pidKi, (float)pidKd);
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else if (strncasecmp((const char *)(cmd->data), "PROF ", 5) == 0) {
-      // Lock interface
-      if (!getInteractiveMutex(response)) {
-         return false;
-      }
-      if (parseProfile(reinterpret_cast<char*>(&cmd->data[5]))) {
-         strcpy(reinterpret_cast<char*>(response->data), "OK\n\r");
-      }
-      else {
-         strcpy(reinterpret_cast<char*>(response->data), "Failed - data error\n\r");
-      }
-      interactiveMutex.release();
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else if (strcasecmp((const char *)(cmd->data), "PROF?\n") == 0) {
-      const NvSolderProfile &profile = profiles[currentProfileIndex];
-      snprintf(reinterpret_cast<char*>(response->data), sizeof(response->data),
-            /* index         */ "%d,"
-            /* name          */ "%s,"
-            /* flags         */ "%2.2X,"
-            /* liquidus      */ "%d,"
-            /* preheatTime   */ "%d,"
-            /* soakTemp1     */ "%d,"
-            /* soakTemp2     */ "%d,"
-            /* soakTime      */ "%d,"
-            /* ramp2Slope    */ "%.1f,"
-            /* peakTemp      */ "%d,"
-            /* peakDwell     */ "%d,"
-            /* rampDownSlope */ "%.1f;\n\r",
-            (int)currentProfileIndex,
-            (const char *)profile.description,
-            (int)  profile.flags,
-            (int)  profile.liquidus,
-            (int)  profile.preheatTime,
-            (int)  profile.soakTemp1,
-            (int)  profile.soakTemp2,
-            (int)  profile.soakTime,
-            (float)profile.rampUpSlope,
-            (int)  profile.peakTemp,
-            (int)  profile.peakDwell,
-            (float)profile.rampDownSlope);
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else if (strcasecmp((const char *)(cmd->data), "PLOT?\n") == 0) {
-      int lastValid = Draw::getData().getLastValid();
-      snprintf(reinterpret_cast<char*>(response->data), sizeof(response->data), "%d;", lastValid+1);
-      if (lastValid < 0) {
-         // Terminate the response early
-         strcat(reinterpret_cast<char*>(response->data), "\n\r");
-      }
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-      for (int index=0; index<=lastValid; index++) {
-         logThermocoupleStatus(index, index == lastValid);
-      }
+   arguments.getWord(keyword, length);
+
+   int index = findCommand(keyword, length);
+   if (index<0) {
+      send("Failed - unrecognized command\n\r");
+      return false;
    }
-   else if (strncasecmp((const char *)(cmd->data), "RUN\n\r", 4) == 0) {
-      // Lock interface
-      if (!getInteractiveMutex(response)) {
-         return false;
-      }
-      RunProfile::remoteStartRunProfile();
-      strcpy(reinterpret_cast<char*>(response->data), "OK\n\r");
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
+   const CommandEntry *entry = &commands[index];
+   if ((entry->schema != Args_Optional) && ((entry->schema == Args_None) != arguments.atEnd())) {
+      sendResult(false);
+      return false;
    }
-   else if (strncasecmp((const char *)(cmd->data), "ABORT\n\r", 4) == 0) {
+   if (entry->mutexPolicy != Mutex_None) {
       // Lock interface
-      if (!getInteractiveMutex(response)) {
+      if (!getInteractiveMutex()) {
          return false;
       }
-      RunProfile::abortRunProfile();
-      // Unlock previous lock
-      interactiveMutex.release();
-      strcpy(reinterpret_cast<char*>(response->data), "OK\n\r");
-      // Unlock interface
-      interactiveMutex.release();
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
    }
-   else if (strncasecmp((const char *)(cmd->data), "RUN?\n\r", 4) == 0) {
-      // Lock interface
-      if (!getInteractiveMutex(response)) {
-         return false;
-      }
-      State state = RunProfile::remoteCheckRunProfile();
-      if (state == s_complete) {
-         // Unlock previous lock
-         interactiveMutex.release();
-         strcpy(reinterpret_cast<char*>(response->data), "OK\n\r");
-      }
-      else if (state == s_fail) {
-         // Unlock interface
-         interactiveMutex.release();
-         strcpy(reinterpret_cast<char*>(response->data), "Failed\n\r");
-      }
-      else {
-         strcpy(reinterpret_cast<char*>(response->data), "Running\n\r");
-      }
+   entry->handler(arguments);
+
+   if (entry->mutexPolicy == Mutex_Lock) {
       // Unlock interface
       interactiveMutex.release();
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
-   }
-   else {
-      strcpy(reinterpret_cast<char*>(response->data), "Failed - unrecognized command\n\r");
-      response->size = strlen(reinterpret_cast<char*>(response->data));
-      send(response);
    }
    return true;
 }
 
 /**
- * Thread handling CDC traffic
+ * Thread handling CDC traffic\n
+ * Splits data received from host into commands terminated by '\\r' or '\\n'
  */
 void RemoteInterface::commandThread(const void *) {
+   // Command being assembled
+   static char command[MAX_COMMAND_SIZE];
+   unsigned    size     = 0;
+   bool        overflow = false;
+
    for(;;) {
-      osEvent event = commandQueue.get();
-      if (event.status == osEventMail) {
-         // Get command
-         Command *cmd = (Command *)event.value.p;
-         // Process command
-         doCommand(cmd);
-         // Release command storage
-         commandQueue.free(cmd);
+      uint8_t ch;
+      if (!rxBuffer.get(ch)) {
+         // Space is available - let USB accept more data
+         notifyUsbOut();
+         CMSIS::Thread::signalWait(RX_SIGNAL);
+         continue;
+      }
+      // Check for command termination
+      if ((ch == '\r') || (ch == '\n')) {
+         // Discard empty commands (discards '\r', '\n')
+         if (size>0) {
+            // Let USB accept more data while command executes
+            notifyUsbOut();
+            // Process command - response is not interleaved with other writers
+            lockResponse();
+            if (overflow) {
+               send("Failed - command too long\n\r");
+            }
+            else {
+               // Terminate command
+               command[size++] = '\n';
+               command[size++] = '\0';
+               doCommand(command);
+            }
+            unlockResponse();
+         }
+         size     = 0;
+         overflow = false;
+         continue;
+      }
+      // Save data to buffer leaving room for terminator
+      if (size<(MAX_COMMAND_SIZE-2)) {
+         command[size++] = ch;
+      }
+      else {
+         overflow = true;
       }
    }
 }
@@ -491,57 +1099,23 @@ void RemoteInterface::commandThread(const void *) {
  * Starts the thread that handles the CDC communications.
  */
 void RemoteInterface::initialise() {
-   command  = nullptr;
-   response = nullptr;
-
-   commandQueue.create();
-   responseQueue.create();
+   // Build command hash table
+   commandHash.initialise();
 
    handlerThread.run();
 }
 
 /**
  * Process data received from host\n
- * The data is collected into a command and then added to command queue\n
- * This function is actually called from the USB interrupt thread and passes
- * the assembled command to the handler using a MailQueue queue.
+ * The data is copied to the receive buffer and the handler thread is signalled.\n
+ * This function is actually called from the USB interrupt handler.
  *
- * @param size Amount of data
+ * @param size Amount of data (must not exceed getRxSpace())
  * @param buff Buffer for data
  *
  * @note the Data is volatile and is processed or saved immediately.
  */
 void RemoteInterface::putData(int size, const uint8_t *buff) {
-   for (int i=0; i<size; i++) {
-      if (command == nullptr) {
-         // Allocate new command buffer
-         command = commandQueue.allocISR();
-         if (command == nullptr) {
-            // Can't allocate buffer - discard data & return
-            return;
-         }
-         command->size = 0;
-      }
-      // Check for command too large
-      assert(command->size<((sizeof(command->data)/sizeof(command->data[0]))-2));
-
-      // Check for command termination
-      if ((buff[i] == '\r') || (buff[i] == '\n')) {
-         // Discard empty commands (discards '\r', '\n')
-         if (command->size>0) {
-            // Terminate command
-            command->data[command->size++] = '\n';
-            command->data[command->size++] = '\0';
-
-            // Add this command to queue
-            commandQueue.put(command);
-
-            // We no longer have an active buffer
-            command = nullptr;
-         }
-         continue;
-      }
-      // Save data to buffer
-      command->data[command->size++] = buff[i];
-   }
+   rxBuffer.write(buff, size);
+   handlerThread.signalSet(RX_SIGNAL);
 }
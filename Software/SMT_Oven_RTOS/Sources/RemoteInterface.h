@@ -13,118 +13,205 @@
 #include "cmsis.h"
 #include "plotting.h"
 #include "reporter.h"
+#include "formatter.h"
+#include "ringBuffer.h"
 
 /**
- *    USB CDC receive ISR ----> Command Queue -----> Remote thread
+ *    USB CDC receive ISR ----> Receive Buffer ----> Remote thread
  *                                                     ...
  *                                                     ...
- *    USB CDC send ISR <------- Response Queue <---- Remote thread
+ *    USB CDC send ISR <------- Transmit Buffer <--- Remote thread
+ *
+ * Received packets are copied to a byte ring buffer which the remote thread
+ * splits into lines.  The USB OUT end-point is not re-armed (host is NAKed) while
+ * the buffer lacks space for a packet so data is not lost.
+ *
+ * Responses are written to a byte ring buffer which is drained by the USB IN
+ * end-point a packet at a time.  A writer only blocks while the buffer is full so
+ * responses of any length may be streamed.
  */
 class RemoteInterface: public USBDM::CDC_Interface {
 
 public:
-   /** Structure holding a command */
-   using Command  = struct {uint8_t data[100];  unsigned size; };
+   /** Maximum size of a command including terminator */
+   static constexpr unsigned MAX_COMMAND_SIZE = 100;
+
+   /** Size of receive buffer (must be a power of 2) */
+   static constexpr unsigned RX_BUFFER_SIZE = 256;
 
-   /** Structure holding (part of) a response */
-   using Response = struct {uint8_t data[1000]; unsigned size; };
+   /** Size of transmit buffer (must be a power of 2) */
+   static constexpr unsigned TX_BUFFER_SIZE = 512;
 
 protected:
    RemoteInterface() {}
    virtual ~RemoteInterface() {};
 
-   /** Queue of received commands */
-   static CMSIS::MailQueue<Command, 4>  commandQueue;
+   /** Signal to handler thread that received data is available */
+   static constexpr int32_t RX_SIGNAL = 1<<0;
 
-   /** Queue of sent responses */
-   static CMSIS::MailQueue<Response, 4> responseQueue;
+   /** Signal to a blocked writer that data has been removed from the transmit buffer */
+   static constexpr int32_t TX_SIGNAL = 1<<1;
 
-   /** Current command being assembled by USB receive ISR */
-   static Command  *command;
+   /** Receive buffer - filled by USB ISR */
+   static RingBuffer<RX_BUFFER_SIZE> rxBuffer;
 
-   /** Current response being assembled by Remote thread */
-   static Response *response;
+   /** Transmit buffer - drained by USB ISR */
+   static RingBuffer<TX_BUFFER_SIZE> txBuffer;
+
+   /** Prevents responses from different threads being interleaved */
+   static CMSIS::Mutex txMutex;
+
+   /** Writer waiting for space in transmit buffer or for it to empty (nullptr if none) */
+   static volatile osThreadId txWaiter;
 
    /** Thread to handle CDC commands */
    static CMSIS::Thread handlerThread;
 
-   /** Identification string */
-   static const char *IDN;
+   /**
+    * Try to lock the Interactive mutex so that the remote session has ownership
+    *
+    * @return true  => success
+    * @return false => failed (A fail response has been sent to the remote)
+    */
+   static bool getInteractiveMutex();
 
    /**
-    * Writes thermocouple status to log
+    * Locate command
+    *
+    * @param[in] keyword Keyword to look up (need not be terminated)
+    * @param[in] length  Length of keyword
     *
-    * @param[in] time  Time of log entry to send
-    * @param[in] lastEntry Indicates this is the last entry so append "\n\r"
+    * @return Index of command or -1 if not found
     */
-   static void logThermocoupleStatus(int time, bool lastEntry=false);
+   static int findCommand(const char *keyword, unsigned length);
 
    /**
-    * Try to lock the Interactive mutex so that the remote session has ownership
+    * Get keyword of command
     *
-    * @param[out] response Buffer to use for response if needed.
+    * @param[in] index Index of command
     *
-    * @return true  => success
-    * @return false => failed (A fail response has been sent to the remote and response has been consumed)
+    * @return Keyword or nullptr if index is past the last command
     */
-   static bool getInteractiveMutex(RemoteInterface::Response *response);
+   static const char *getCommandKeyword(unsigned index);
 
    /**
     * Handle command
     *
-    * @param[in] cmd Command to process
+    * @param[in] cmd Command to process (terminated by "\n")
     */
-   static bool doCommand(Command *cmd);
+   static bool doCommand(const char *cmd);
 
    /**
-    * Thread handling CDC traffic
+    * Thread handling CDC traffic\n
+    * Frames received data into commands
     */
    static void commandThread(const void *);
 
 public:
    /**
-    * Get response
+    * Get data waiting to be sent to host\n
+    * Used by USB IN end-point
+    *
+    * @param[out] buffer  Buffer for data e.g. end-point buffer
+    * @param[in]  maxSize Maximum number of bytes to get
     *
-    * @return osEvent
+    * @return Number of bytes copied to buffer (0 => none waiting)
     */
-   static RemoteInterface::Response *getResponse() {
-      osEvent status = RemoteInterface::responseQueue.getISR();
-      if (status.status != osEventMail) {
-         // No messages waiting
-         return nullptr;
+   static unsigned getTxData(uint8_t *buffer, unsigned maxSize) {
+      unsigned size = txBuffer.read(buffer, maxSize);
+      osThreadId waiter = txWaiter;
+      if ((size>0) && (waiter != nullptr)) {
+         // Wake writer blocked on full buffer or waiting for it to empty
+         osSignalSet(waiter, TX_SIGNAL);
       }
-      // Set up new message
-      return (RemoteInterface::Response*)status.value.p;
+      return size;
+   }
+
+   /**
+    * Check if all data has been passed to the USB IN end-point
+    *
+    * @return true if transmit buffer is empty
+    */
+   static bool isTxEmpty() {
+      return txBuffer.isEmpty();
    }
 
    /**
-    * Used to free response buffer
+    * Wait until all data has been passed to the USB IN end-point\n
+    * The caller sleeps on the signal raised by getTxData() rather than polling
+    */
+   static void waitForTxEmpty();
+
+   /**
+    * Get space available for data from host\n
+    * Used by USB OUT end-point to decide if another packet may be accepted
+    *
+    * @return Number of bytes that may be received
+    */
+   static unsigned getRxSpace() {
+      return rxBuffer.space();
+   }
+
+   /**
+    * Obtain exclusive use of the response stream\n
+    * This is done for each command so responses are not interleaved with other writers
+    *
+    * @param[in] millisec How long to wait in milliseconds. Use osWaitForever for indefinite wait.
+    *
+    * @return true  Obtained lock
+    * @return false Timeout
+    */
+   static bool lockResponse(uint32_t millisec=osWaitForever) {
+      return txMutex.wait(millisec) == osOK;
+   }
+
+   /**
+    * Release lock obtained with lockResponse()
+    */
+   static void unlockResponse() {
+      txMutex.release();
+   }
+
+   /**
+    * Send response data over CDC\n
+    * This blocks while the transmit buffer is full
+    *
+    * @param[in] data Data to send
+    * @param[in] size Number of bytes to send
+    */
+   static void send(const uint8_t *data, unsigned size);
+
+   /**
+    * Send response text over CDC\n
+    * This blocks while the transmit buffer is full
     *
-    * @param[in,out] response Buffer to free
+    * @param[in] text Response text to send
     */
-   static void freeResponseBuffer(RemoteInterface::Response *&response) {
-      RemoteInterface::responseQueue.free(response);
-      response = nullptr;
+   static void send(const char *text) {
+      send(reinterpret_cast<const uint8_t*>(text), strlen(text));
    }
 
    /**
-    * Allocate send buffer
+    * Send formatted response text over CDC\n
+    * This blocks while the transmit buffer is full
     *
-    * @return Pointer to allocated buffer
-    * @return NULL Failed allocation
+    * @param[in] text Response text to send
     */
-   static Response *allocResponseBuffer() {
-      return responseQueue.alloc();
+   static void send(const Formatter &text) {
+      send(reinterpret_cast<const uint8_t*>(text.toString()), text.length());
    }
 
    /**
-    * Set response over CDC
+    * Send response data over CDC if there is room\n
+    * The data is either sent in its entirety or not at all.  This does not block.
     *
-    * @param[in] response Response text to send
+    * @param[in] data Data to send
+    * @param[in] size Number of bytes to send
     *
-    * @return true Success
+    * @return true  Data queued
+    * @return false Insufficient space
     */
-   static bool send(Response *response);
+   static bool trySend(const uint8_t *data, unsigned size);
 
    /**
     * Initialise
@@ -133,9 +220,9 @@ public:
 
    /**
     * Process data received from host\n
-    * The data is collected into a command and then added to command queue
+    * The data is copied to the receive buffer for the handler thread
     *
-    * @param[in] size Amount of data
+    * @param[in] size Amount of data (must not exceed getRxSpace())
     * @param[in] buff Buffer containing data
     *
     * @note the Data is volatile and is processed or saved immediately.
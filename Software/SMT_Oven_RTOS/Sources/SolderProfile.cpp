@@ -53,11 +53,13 @@ void SolderProfile::operator=(const SolderProfile &other ) {
 /**
  * Assignment from SolderProfile
  *
- * This adds a wait for the Flash to be updated after each element is assigned
+ * The profile is written to Flash as a single transaction
  *
  * @param other Profile to copy from
  */
 void NvSolderProfile::operator=(const SolderProfile &other ) {
+   USBDM::NonvolatileTransaction transaction;
+
    flags         = other.flags;
    description   = other.description;
    liquidus      = other.liquidus;
@@ -74,11 +76,13 @@ void NvSolderProfile::operator=(const SolderProfile &other ) {
 /**
  * Assignment from NvSolderProfile
  *
- * This adds a wait for the Flash to be updated after each element is assigned
+ * The profile is written to Flash as a single transaction
  *
  * @param other Profile to copy from
  */
 void NvSolderProfile::operator=(const NvSolderProfile &other ) {
+   USBDM::NonvolatileTransaction transaction;
+
    flags         = other.flags;
    description   = other.description;
    liquidus      = other.liquidus;
@@ -8,8 +8,116 @@
 #ifndef HEADERS_ZEROCROSSINGPWM_H_
 #define HEADERS_ZEROCROSSINGPWM_H_
 
+#include <string.h>
 #include "flash.h"
 
+/**
+ * Pre-computed on/off pattern for a zero-crossing switched output
+ *
+ * Each bit of the pattern controls one mains half-cycle.  The 'on' bits are spread
+ * evenly through the pattern (Bresenham) so that the energy delivered over any window
+ * is within one half-cycle of the pattern average.  The average is within half a
+ * half-cycle per pattern (0.05%) of the requested per-mille duty-cycle.\n
+ * The pattern is double-buffered.  A new pattern is built in the inactive buffer and then
+ * made active in a single write so the ISR never sees a partly built pattern.
+ */
+class DutyPattern {
+
+public:
+   /** Number of half-cycles in pattern (power of 2) */
+   static constexpr unsigned PATTERN_BITS = 1024;
+
+   /** Duty-cycle resolution (per-mille) */
+   static constexpr unsigned RESOLUTION   = 1000;
+
+private:
+   static_assert((PATTERN_BITS&(PATTERN_BITS-1)) == 0, "PATTERN_BITS must be a power of 2");
+
+   /** Number of words in pattern */
+   static constexpr unsigned PATTERN_WORDS = PATTERN_BITS/32;
+
+   /** Pattern buffers */
+   uint32_t          fPatterns[2][PATTERN_WORDS];
+
+   /** Index of pattern in use by ISR */
+   volatile unsigned fActive = 0;
+
+   /** Duty-cycle (per-mille) */
+   volatile unsigned fDuty   = 0;
+
+public:
+   DutyPattern() {
+      memset(fPatterns, 0, sizeof(fPatterns));
+   }
+
+   /**
+    * Build pattern with 'on' bits evenly spread
+    *
+    * @param[out] pattern Pattern to build
+    * @param[in]  ones    Number of 'on' bits [0..PATTERN_BITS]
+    */
+   static void build(uint32_t pattern[PATTERN_WORDS], unsigned ones) {
+      unsigned accumulator = 0;
+      for (unsigned word=0; word<PATTERN_WORDS; word++) {
+         uint32_t bits = 0;
+         for (unsigned bit=0; bit<32; bit++) {
+            accumulator += ones;
+            if (accumulator>=PATTERN_BITS) {
+               accumulator -= PATTERN_BITS;
+               bits |= (1U<<bit);
+            }
+         }
+         pattern[word] = bits;
+      }
+   }
+
+   /**
+    * Set duty-cycle
+    *
+    * @param[in] duty Duty-cycle in per-mille [0..RESOLUTION]
+    */
+   void set(unsigned duty) {
+      if (duty>RESOLUTION) {
+         duty = RESOLUTION;
+      }
+      if (duty == fDuty) {
+         return;
+      }
+      // Build outside critical section
+      uint32_t pattern[PATTERN_WORDS];
+      build(pattern, (duty*PATTERN_BITS+RESOLUTION/2)/RESOLUTION);
+
+      // Serialise writers - copy to inactive buffer and swap
+      uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      unsigned inactive = fActive^1;
+      memcpy(fPatterns[inactive], pattern, sizeof(pattern));
+      fActive = inactive;
+      fDuty   = duty;
+      __set_PRIMASK(primask);
+   }
+
+   /**
+    * Get duty-cycle
+    *
+    * @return Duty-cycle in per-mille
+    */
+   unsigned get() const {
+      return fDuty;
+   }
+
+   /**
+    * Get state of output for a half-cycle
+    *
+    * @param[in] position Position in pattern [0..PATTERN_BITS-1]
+    *
+    * @return true if output is on
+    */
+   bool isOn(unsigned position) const {
+      return (fPatterns[fActive][position/32]>>(position%32))&1;
+   }
+};
+
 /**
  * Simple zero-crossing PWM for oven fan and heater controlled by zero-crossing SSDs
  *
@@ -25,15 +133,36 @@ template<typename Heater, typename HeaterLed, typename Fan, typename FanLed, typ
 class ZeroCrossingPwm {
 
 private:
-   /** Duty cycle for Heater */
-   static int  heaterDutycycle;
+   /** Pattern for Heater */
+   static DutyPattern heaterPattern;
+
+   /** Pattern for Fan */
+   static DutyPattern fanPattern;
 
-   /** Duty cycle for Fan */
-   static int  fanDutycycle;
+   /** Position in patterns */
+   static unsigned    position;
 
    /** Count down for fan kick */
    static int  fanKick;
 
+   /**
+    * Convert percentage duty-cycle to per-mille
+    *
+    * @param[in] dutycycle Percentage duty-cycle
+    *
+    * @return Per-mille duty-cycle [0..DutyPattern::RESOLUTION]
+    */
+   static unsigned toPerMille(float dutycycle) {
+      if (!(dutycycle>0)) {
+         // Also catches NAN
+         return 0;
+      }
+      if (dutycycle>=100) {
+         return DutyPattern::RESOLUTION;
+      }
+      return (unsigned)(dutycycle*(DutyPattern::RESOLUTION/100)+0.5f);
+   }
+
    /**
     * Number of mains half-cycles to run the fan before switching to PWM mode
     * This is to overcome the static friction of the fan on low duty-cycle
@@ -42,37 +171,17 @@ private:
 
    /*
     * Function is called on zero-crossings of the mains.
-    * Implements a simple PWM with variable period (~20ms - ~1s @50Hz mains).
+    * Outputs the next bit of the pre-computed duty-cycle patterns.
     */
    static void callbackFunction(int status) {
       (void)status;
 
-      // Keeps track of heater drive
-      static int heaterDutycount = 0;
+      unsigned pos = position;
+      position = (pos+1)&(DutyPattern::PATTERN_BITS-1);
 
-      // Keeps track of fan drive
-      static int fanDutycount = 0;
-
-#if 0
-      // Simple PWM with fixed period
-      static int cycleCount = 0;
-      cycleCount++;
-      if (cycleCount>=20) {
-         cycleCount = 0;
-      }
-      //      Heater::toggle();
-      //      Fan::toggle();
-      Heater::write(cycleCount<heaterDutycycle);
-      Fan::write(cycleCount<fanDutycycle);
-#else
-      // Variable period PWM
-      int wholePart;
-      heaterDutycount += heaterDutycycle;
-      wholePart        = heaterDutycount/100;
-      heaterDutycount -= 100*wholePart;
-
-      Heater::write(wholePart>0);
-      HeaterLed::write(wholePart>0);
+      bool heaterOn = heaterPattern.isOn(pos);
+      Heater::write(heaterOn);
+      HeaterLed::write(heaterOn);
 
       if (fanKick>0) {
          // Still kicking
@@ -81,14 +190,10 @@ private:
          FanLed::on();
       }
       else {
-         // PWM
-         fanDutycount += fanDutycycle;
-         wholePart = fanDutycount/100;
-         fanDutycount -= 100*wholePart;
-         Fan::write(wholePart>0);
-         FanLed::write(wholePart>0);
+         bool fanOn = fanPattern.isOn(pos);
+         Fan::write(fanOn);
+         FanLed::write(fanOn);
       }
-#endif
    }
 
 public:
@@ -103,8 +208,8 @@ public:
 
 private:
    static void initialise() {
-      heaterDutycycle = 0;
-      fanDutycycle    = 0;
+      heaterPattern.set(0);
+      fanPattern.set(0);
       HeaterLed::init();
       Heater::setOutput();
       Heater::low();
@@ -127,53 +232,56 @@ public:
    /**
     * Set duty cycle of fan
     *
-    * @param dutycycle Percentage duty-cycle to set
+    * @param dutycycle Percentage duty-cycle to set (resolution 0.1%)
     *
     * @note The fan is run at full speed for a short time when first started from 0% duty-cycle
     */
-   void setFanDutycycle(int dutycycle) {
-      if (dutycycle == 0) {
+   void setFanDutycycle(float dutycycle) {
+      unsigned duty = toPerMille(dutycycle);
+      if (duty == 0) {
          // Ensure no kick in progress
          fanKick = 0;
       }
-      else if (fanDutycycle == 0) {
+      else if (fanPattern.get() == 0) {
          // Turn on - apply kick
          fanKick = fanKickTime;
       }
-      fanDutycycle = dutycycle;
+      fanPattern.set(duty);
    }
 
    /**
     * Set duty cycle of heater
     *
-    * @param dutycycle Percentage duty-cycle to set
+    * @param dutycycle Percentage duty-cycle to set (resolution 0.1%)
     */
-   static void setHeaterDutycycle(int dutycycle) {
-      heaterDutycycle = dutycycle;
+   static void setHeaterDutycycle(float dutycycle) {
+      heaterPattern.set(toPerMille(dutycycle));
    }
    /**
     * Get duty cycle of fan
     *
-    * @return dutycycle Percentage duty-cycle to set
+    * @return dutycycle Percentage duty-cycle (rounded)
     */
    static int getFanDutycycle() {
-      return fanDutycycle;
+      return (fanPattern.get()+5)/10;
    }
 
    /**
     * Get duty cycle of heater
     *
-    * @return Duty cycle Percentage duty-cycle to set
+    * @return Duty cycle Percentage duty-cycle (rounded)
     */
    static int getHeaterDutycycle() {
-      return heaterDutycycle;
+      return (heaterPattern.get()+5)/10;
    }
 };
 
 template<typename Heater, typename HeaterLed, typename Fan, typename FanLed, typename Vmains>
-int  ZeroCrossingPwm<Heater, HeaterLed, Fan, FanLed, Vmains>::heaterDutycycle = 0;
+DutyPattern ZeroCrossingPwm<Heater, HeaterLed, Fan, FanLed, Vmains>::heaterPattern;
+template<typename Heater, typename HeaterLed, typename Fan, typename FanLed, typename Vmains>
+DutyPattern ZeroCrossingPwm<Heater, HeaterLed, Fan, FanLed, Vmains>::fanPattern;
 template<typename Heater, typename HeaterLed, typename Fan, typename FanLed, typename Vmains>
-int  ZeroCrossingPwm<Heater, HeaterLed, Fan, FanLed, Vmains>::fanDutycycle = 0;
+unsigned    ZeroCrossingPwm<Heater, HeaterLed, Fan, FanLed, Vmains>::position = 0;
 template<typename Heater, typename HeaterLed, typename Fan, typename FanLed, typename Vmains>
 int  ZeroCrossingPwm<Heater, HeaterLed, Fan, FanLed, Vmains>::fanKick = 0;
 
@@ -0,0 +1,499 @@
+/**
+ * @file    compressedLog.h
+ * @brief   Compressed time-series of fixed-size records
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_COMPRESSEDLOG_H_
+#define SOURCES_COMPRESSEDLOG_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "cmsis_gcc.h"
+
+/**
+ * Time-series of records each consisting of NUM_FIELDS 16-bit fields.
+ *
+ * Records are appended in time order and encoded into a byte pool as chunks of
+ * CHUNK_POINTS records.  A small index holds the pool offset of each chunk so a
+ * record may be located by decoding at most one chunk.
+ *
+ * @verbatim
+ *  Chunk  = Keyframe Record*
+ *  Keyframe = varint[NUM_FIELDS]               Raw field values
+ *  Record = 0b1nnnnnnn                         Run of n (1-127) records that match prediction
+ *         | 0b0mmmmmmm varint[popcount(m)]     Mask of fields that differ from prediction
+ *                                              followed by zig-zag encoded differences
+ * @endverbatim
+ *
+ * Fields selected by LINEAR_FIELDS are predicted by linear extrapolation from the previous
+ * two values (delta-of-delta encoding) which suits slowly changing temperatures.
+ * Other fields are predicted to be unchanged from the previous value which suits
+ * state and duty-cycle values.
+ *
+ * A single writer may append (or replace the last record) while other threads read.
+ * Readers see a record once it is counted by size(). Replacing the last record changes
+ * the generation so cursors positioned on it are re-loaded from the chunk keyframe.
+ *
+ * @tparam NUM_FIELDS     Number of 16-bit fields in each record [1..7]
+ * @tparam LINEAR_FIELDS  Bit-mask of fields using linear prediction
+ * @tparam MAX_POINTS     Maximum number of records
+ * @tparam POOL_SIZE      Size of encoded data pool in bytes
+ */
+template<unsigned NUM_FIELDS, unsigned LINEAR_FIELDS, unsigned MAX_POINTS, unsigned POOL_SIZE>
+class CompressedLog {
+
+   static_assert((NUM_FIELDS>0)&&(NUM_FIELDS<=7), "Illegal number of fields");
+   static_assert(POOL_SIZE<=65535, "Pool too large for index");
+
+public:
+   /** Number of records in each chunk */
+   static constexpr unsigned CHUNK_POINTS = 32;
+
+   /** Fields in a record */
+   using Record = uint16_t[NUM_FIELDS];
+
+   /**
+    * Decoder position within the log.\n
+    * Sequential reads using the same cursor decode each record only once.
+    * Each reader should use its own cursor for a single pass over the log.
+    */
+   class Cursor {
+      friend CompressedLog;
+
+      /** Index of last record decoded (-1 => none) */
+      int      index  = -1;
+
+      /** Pool offset of next encoded record */
+      unsigned offset = 0;
+
+      /** Pool offset of header of current run (-1 => none) */
+      int      runHeader = -1;
+
+      /** Index of first record in current run */
+      unsigned runStart  = 0;
+
+      /** Log generation when cursor was last positioned */
+      unsigned generation = 0;
+
+      /** Field values of last decoded record */
+      int32_t  values[NUM_FIELDS];
+
+      /** Field deltas of last decoded record */
+      int32_t  deltas[NUM_FIELDS];
+
+   public:
+      /**
+       * Invalidate cursor e.g. after log is reset
+       */
+      void reset() {
+         index = -1;
+      }
+   };
+
+private:
+   /** Size of largest encoded record */
+   static constexpr unsigned MAX_RECORD_SIZE = 1+3*NUM_FIELDS;
+
+   /** Number of chunks */
+   static constexpr unsigned MAX_CHUNKS = (MAX_POINTS+CHUNK_POINTS-1)/CHUNK_POINTS;
+
+   /** Run header flag */
+   static constexpr uint8_t RUN_FLAG = 0x80;
+
+   /** Largest run in a single header */
+   static constexpr unsigned MAX_RUN = 0x7F;
+
+   /** Encoded records */
+   uint8_t  fPool[POOL_SIZE];
+
+   /** Offset of each chunk in fPool */
+   uint16_t fIndex[MAX_CHUNKS];
+
+   /** Number of records in log */
+   volatile unsigned fCount = 0;
+
+   /** Incremented before and after the last record is replaced (odd while replacing) */
+   volatile unsigned fGeneration = 0;
+
+   /** Indicates a record has been discarded as the log is full */
+   bool     fFull = false;
+
+   /** Encoder state (position and last record) */
+   Cursor   fEncoder;
+
+   /** Pool offset of open run header (-1 => none) */
+   int      fRunHeader = -1;
+
+   /** Encoder state before the last record was added - allows last record to be replaced */
+   Cursor   fUndoEncoder;
+
+   /** Run header state before the last record was added */
+   int      fUndoRunHeader = -1;
+
+   /** Indicates the last record extended an existing run */
+   bool     fUndoRunExtended = false;
+
+   /**
+    * Map signed value to unsigned so small magnitudes have short encodings
+    */
+   static uint32_t zigzag(int32_t value) {
+      return ((uint32_t)value<<1)^(uint32_t)(value>>31);
+   }
+
+   /**
+    * Inverse of zigzag()
+    */
+   static int32_t unzigzag(uint32_t value) {
+      return (int32_t)(value>>1)^-(int32_t)(value&1);
+   }
+
+   /**
+    * Write varint to pool
+    *
+    * @param[inout] offset Offset in pool (updated)
+    * @param[in]    value  Value to write (< 2^21)
+    */
+   void putVarint(unsigned &offset, uint32_t value) {
+      while (value>=0x80) {
+         fPool[offset++] = (uint8_t)(value|0x80);
+         value >>= 7;
+      }
+      fPool[offset++] = (uint8_t)value;
+   }
+
+   /**
+    * Read varint from encoded data
+    *
+    * @param[in]    pool   Encoded data
+    * @param[inout] offset Offset in encoded data (updated)
+    *
+    * @return Value read
+    */
+   static uint32_t getVarint(const uint8_t *pool, unsigned &offset) {
+      uint32_t value = 0;
+      unsigned shift = 0;
+      uint8_t  byte;
+      do {
+         byte   = pool[offset++];
+         value |= (uint32_t)(byte&0x7F)<<shift;
+         shift += 7;
+      } while (byte&0x80);
+      return value;
+   }
+
+   /**
+    * Get predicted difference for a field
+    *
+    * @param[in] cursor Cursor holding previous record
+    * @param[in] field  Field number
+    */
+   static int32_t predictedDelta(const Cursor &cursor, unsigned field) {
+      return (LINEAR_FIELDS&(1<<field))?cursor.deltas[field]:0;
+   }
+
+   /**
+    * Advance cursor by one record applying differences from prediction
+    *
+    * @param[inout] cursor      Cursor to update
+    * @param[in]    differences Differences from prediction for each field
+    */
+   static void apply(Cursor &cursor, const int32_t differences[NUM_FIELDS]) {
+      for (unsigned field=0; field<NUM_FIELDS; field++) {
+         int32_t delta = predictedDelta(cursor, field)+differences[field];
+         cursor.deltas[field]  = delta;
+         cursor.values[field] += delta;
+      }
+      cursor.index++;
+   }
+
+   /**
+    * Decode keyframe at the cursor offset
+    *
+    * @param[in]    pool   Encoded data
+    * @param[inout] cursor Cursor to position (offset must be start of chunk)
+    * @param[in]    index  Index of first record in chunk
+    */
+   static void decodeKeyframe(const uint8_t *pool, Cursor &cursor, unsigned index) {
+      for (unsigned field=0; field<NUM_FIELDS; field++) {
+         cursor.values[field] = (int32_t)getVarint(pool, cursor.offset);
+         cursor.deltas[field] = 0;
+      }
+      cursor.runHeader = -1;
+      cursor.index     = index;
+   }
+
+   /**
+    * Position cursor at start of chunk by decoding the keyframe
+    *
+    * @param[out] cursor Cursor to position
+    * @param[in]  chunk  Chunk number
+    */
+   void loadKeyframe(Cursor &cursor, unsigned chunk) const {
+      cursor.offset = fIndex[chunk];
+      decodeKeyframe(fPool, cursor, chunk*CHUNK_POINTS);
+   }
+
+   /**
+    * Decode next record in current chunk
+    *
+    * @param[in]    pool   Encoded data
+    * @param[inout] cursor Cursor to advance
+    */
+   static void decodeNext(const uint8_t *pool, Cursor &cursor) {
+      int32_t  differences[NUM_FIELDS] = {0};
+      unsigned next = cursor.index+1;
+
+      // The run length is re-read as the writer may have extended the run since it was decoded
+      if ((cursor.runHeader<0) || (next>=(cursor.runStart+(pool[cursor.runHeader]&MAX_RUN)))) {
+         cursor.runHeader = -1;
+         uint8_t header = pool[cursor.offset++];
+         if (header&RUN_FLAG) {
+            cursor.runHeader = cursor.offset-1;
+            cursor.runStart  = next;
+         }
+         else {
+            for (unsigned field=0; field<NUM_FIELDS; field++) {
+               if (header&(1<<field)) {
+                  differences[field] = unzigzag(getVarint(pool, cursor.offset));
+               }
+            }
+         }
+      }
+      apply(cursor, differences);
+   }
+
+   /**
+    * Copy cursor values to record
+    */
+   static void getRecord(const Cursor &cursor, Record &record) {
+      for (unsigned field=0; field<NUM_FIELDS; field++) {
+         record[field] = (uint16_t)cursor.values[field];
+      }
+   }
+
+public:
+   /**
+    * Discard all records
+    */
+   void reset() {
+      fCount         = 0;
+      fRunHeader     = -1;
+      fFull          = false;
+      fEncoder       = Cursor();
+      fEncoder.index = -1;
+   }
+
+   /**
+    * Indicates a record has been discarded since the log was reset because it was full
+    *
+    * @return true if full
+    */
+   bool isFull() const {
+      return fFull;
+   }
+
+   /**
+    * Get number of records in log
+    *
+    * @return Number of records
+    */
+   unsigned size() const {
+      return fCount;
+   }
+
+   /**
+    * Get number of bytes of pool used
+    *
+    * @return Bytes used
+    */
+   unsigned bytesUsed() const {
+      return (fCount==0)?0:fEncoder.offset;
+   }
+
+   /**
+    * Get encoded records e.g. to archive a copy
+    *
+    * @return Pointer to encoded data (bytesUsed() bytes)
+    */
+   const uint8_t *getEncodedData() const {
+      return fPool;
+   }
+
+   /**
+    * Get next record from a copy of the encoded data\n
+    * Chunks are contiguous so the copy is decoded in order without the chunk index.
+    * Use a new cursor for each pass and do not read past the number of records copied.
+    *
+    * @param[in]    data   Copy of encoded data from getEncodedData()
+    * @param[out]   record Record retrieved
+    * @param[inout] cursor Cursor used for decoding
+    */
+   static void getNext(const uint8_t *data, Record &record, Cursor &cursor) {
+      unsigned index = cursor.index+1;
+      if ((index%CHUNK_POINTS) == 0) {
+         if (index == 0) {
+            cursor.offset = 0;
+         }
+         decodeKeyframe(data, cursor, index);
+      }
+      else {
+         decodeNext(data, cursor);
+      }
+      getRecord(cursor, record);
+   }
+
+   /**
+    * Append a record
+    *
+    * @param[in] record Record to add
+    *
+    * @return true  Record added
+    * @return false Log full
+    */
+   bool append(const Record &record) {
+      unsigned count = fCount;
+      if ((count>=MAX_POINTS)||((fEncoder.offset+MAX_RECORD_SIZE)>POOL_SIZE)) {
+         fFull = true;
+         return false;
+      }
+      fUndoEncoder     = fEncoder;
+      fUndoRunHeader   = fRunHeader;
+      fUndoRunExtended = false;
+
+      if ((count%CHUNK_POINTS) == 0) {
+         // Start new chunk with keyframe
+         unsigned offset = fEncoder.offset;
+         fIndex[count/CHUNK_POINTS] = offset;
+         for (unsigned field=0; field<NUM_FIELDS; field++) {
+            putVarint(offset, record[field]);
+            fEncoder.values[field] = record[field];
+            fEncoder.deltas[field] = 0;
+         }
+         fEncoder.offset = offset;
+         fEncoder.index  = count;
+         fRunHeader      = -1;
+      }
+      else {
+         int32_t  differences[NUM_FIELDS];
+         uint8_t  mask = 0;
+         for (unsigned field=0; field<NUM_FIELDS; field++) {
+            differences[field] = (int32_t)record[field]-(fEncoder.values[field]+predictedDelta(fEncoder, field));
+            if (differences[field] != 0) {
+               mask |= (1<<field);
+            }
+         }
+         if (mask == 0) {
+            if ((fRunHeader>=0) && ((fPool[fRunHeader]&MAX_RUN)<MAX_RUN)) {
+               // Extend current run
+               fPool[fRunHeader]++;
+               fUndoRunExtended = true;
+            }
+            else {
+               // Start new run
+               fRunHeader = fEncoder.offset;
+               fPool[fEncoder.offset++] = RUN_FLAG|1;
+            }
+         }
+         else {
+            fPool[fEncoder.offset++] = mask;
+            for (unsigned field=0; field<NUM_FIELDS; field++) {
+               if (mask&(1<<field)) {
+                  putVarint(fEncoder.offset, zigzag(differences[field]));
+               }
+            }
+            fRunHeader = -1;
+         }
+         apply(fEncoder, differences);
+      }
+      // Make record visible to readers
+      __DMB();
+      fCount = count+1;
+      return true;
+   }
+
+   /**
+    * Replace the last record
+    *
+    * @param[in] record Record to add
+    *
+    * @return true  Record replaced
+    * @return false Log empty or full
+    */
+   bool replaceLast(const Record &record) {
+      if (fCount==0) {
+         return false;
+      }
+      // Readers decoding while the generation changes start again from the keyframe
+      fGeneration++;
+      __DMB();
+      fCount--;
+      __DMB();
+      if (fUndoRunExtended) {
+         fPool[fUndoRunHeader]--;
+      }
+      fEncoder   = fUndoEncoder;
+      fRunHeader = fUndoRunHeader;
+      bool success = append(record);
+      __DMB();
+      fGeneration++;
+      return success;
+   }
+
+   /**
+    * Get record
+    *
+    * @param[in]    index  Index of record
+    * @param[out]   record Record retrieved
+    * @param[inout] cursor Cursor used for decoding (speeds sequential access)
+    *
+    * @return true  Record retrieved
+    * @return false Index out of range
+    */
+   bool get(unsigned index, Record &record, Cursor &cursor) const {
+      unsigned chunk = index/CHUNK_POINTS;
+      for(;;) {
+         unsigned generation = fGeneration;
+         __DMB();
+         if (index>=fCount) {
+            return false;
+         }
+         if ((cursor.generation != generation) || (cursor.index<0) ||
+               ((unsigned)cursor.index>index) || ((unsigned)cursor.index/CHUNK_POINTS != chunk)) {
+            loadKeyframe(cursor, chunk);
+            cursor.generation = generation;
+         }
+         while ((unsigned)cursor.index<index) {
+            decodeNext(fPool, cursor);
+         }
+         __DMB();
+         if (fGeneration == generation) {
+            // Records below size() are unchanged by a replacement in progress (odd generation).
+            // The cursor is re-loaded on the next call as the generation will have changed.
+            getRecord(cursor, record);
+            return true;
+         }
+         // Last record replaced while decoding
+         cursor.index = -1;
+      }
+   }
+
+   /**
+    * Get record\n
+    * This decodes from the start of the chunk - use a cursor for sequential access.
+    *
+    * @param[in]  index  Index of record
+    * @param[out] record Record retrieved
+    *
+    * @return true  Record retrieved
+    * @return false Index out of range
+    */
+   bool get(unsigned index, Record &record) const {
+      Cursor cursor;
+      return get(index, record, cursor);
+   }
+};
+
+#endif /* SOURCES_COMPRESSEDLOG_H_ */
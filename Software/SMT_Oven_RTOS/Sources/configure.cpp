@@ -28,9 +28,9 @@ SwitchDebouncer<F1Button, F2Button, F3Button, F4Button, SButton> buttons{};
  *
  * @param[in] dutyCycle Controls the Heater/Fan
  */
-inline void outPutControl(float dutyCycle) {
-   int heaterDutycycle;
-   int fanDutycycle;
+void outPutControl(float dutyCycle) {
+   float heaterDutycycle;
+   float fanDutycycle;
 
    if (dutyCycle>=0) {
       heaterDutycycle = dutyCycle;
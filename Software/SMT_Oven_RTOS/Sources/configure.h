@@ -109,7 +109,10 @@ extern ZeroCrossingPwm <Heater, HeaterLed, OvenFan, OvenFanLed, Vmains> ovenCont
 /** Switch debouncer for front panel buttons */
 extern SwitchDebouncer<F1Button, F2Button, F3Button, F4Button, SButton> buttons;
 
-/** PID controller sample interval - seconds */
+/**
+ * Control loop and PID controller sample interval - seconds\n
+ * Must divide 1 second evenly as the profile state-machine is stepped each second.
+ */
 constexpr float pidInterval = 0.25f;
 
 /**
@@ -0,0 +1,233 @@
+/**
+ * @file    controlLoop.cpp
+ * @brief   Periodic oven control task
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include "cmsis.h"
+#include "configure.h"
+#include "controlLoop.h"
+
+namespace ControlLoop {
+
+/** Number of ticks in each second */
+static constexpr unsigned TICKS_PER_SECOND = (unsigned)(1.0f/pidInterval+0.5f);
+
+static_assert((TICKS_PER_SECOND>0) && (TICKS_PER_SECOND*pidInterval == 1.0f),
+      "pidInterval must divide 1 second evenly");
+
+/** Stack size for control thread (bytes) */
+static constexpr uint32_t CONTROL_STACK_SIZE = 1024;
+
+/** Function executed in set-point stage */
+static volatile SetpointFunction setpointFunction = nullptr;
+
+/** Indicates the set-point function has changed and the tick count should restart */
+static volatile bool restartTick = false;
+
+/** Temperature latched by sample stage */
+static volatile float temperature = NAN;
+
+/** Accumulated timing for a stage (cycles) */
+struct StageTiming {
+   uint32_t last;
+   uint64_t total;
+   uint32_t maximum;
+};
+
+/** Timing for each stage */
+static StageTiming timing[NUM_STAGES];
+
+/** Ticks executed since statistics were reset */
+static volatile uint32_t tickCount = 0;
+
+/** Ticks not completed within interval */
+static volatile uint32_t overruns = 0;
+
+/** Request to reset statistics from control thread */
+static volatile bool resetRequest = false;
+
+/**
+ * Record execution time of stage
+ *
+ * @param[in]    stage Stage executed
+ * @param[inout] start Start time of stage - updated to current time
+ */
+static void recordStage(Stage stage, uint32_t &start) {
+   uint32_t now     = osKernelSysTick();
+   uint32_t elapsed = now-start;
+   StageTiming &t = timing[stage];
+   t.last   = elapsed;
+   t.total += elapsed;
+   if (elapsed>t.maximum) {
+      t.maximum = elapsed;
+   }
+   start = now;
+}
+
+/**
+ * Execute one tick of the control pipeline
+ *
+ * @param[in] tick Tick within the current second
+ */
+static void runStages(unsigned tick) {
+   uint32_t start = osKernelSysTick();
+
+   // Sample
+   temperature = temperatureSensors.getTemperature();
+   recordStage(Stage_Sample, start);
+
+   // Set-point
+   SetpointFunction function = setpointFunction;
+   if (function != nullptr) {
+      function(tick);
+   }
+   recordStage(Stage_Setpoint, start);
+
+   // PID
+   pid.update(temperature);
+   recordStage(Stage_Pid, start);
+
+   // Actuate
+   pid.actuate();
+   recordStage(Stage_Actuate, start);
+}
+
+/**
+ * Thread running the control pipeline at pidInterval
+ */
+static void controlThread(const void *) {
+   unsigned tick = 0;
+   uint32_t last = osKernelSysTick();
+   for(;;) {
+      if (resetRequest) {
+         for (StageTiming &t:timing) {
+            t = {0, 0, 0};
+         }
+         tickCount    = 0;
+         overruns     = 0;
+         resetRequest = false;
+      }
+      if (restartTick) {
+         restartTick = false;
+         tick        = 0;
+      }
+      runStages(tick);
+      tickCount = tickCount + 1;
+      if (++tick >= TICKS_PER_SECOND) {
+         tick = 0;
+      }
+
+      // Wait for next tick
+      last += osKernelSysTickMicroSec((uint32_t)(pidInterval*1000000));
+      int32_t remaining = (int32_t)(last - osKernelSysTick());
+      if (remaining <= 0) {
+         // Overran - re-synchronise
+         overruns = overruns + 1;
+         last = osKernelSysTick();
+         continue;
+      }
+      osDelay((remaining+osKernelSysTickMicroSec(1000)-1)/osKernelSysTickMicroSec(1000));
+   }
+}
+
+/** Thread running the control pipeline */
+static CMSIS::Thread thread{controlThread, osPriorityHigh, CONTROL_STACK_SIZE};
+
+/**
+ * Start the control loop thread
+ */
+void initialise() {
+   thread.run();
+}
+
+/**
+ * Set function executed in the set-point stage\n
+ * The function is first called on the next tick with tick = 0.
+ *
+ * @param[in] function Function to execute (nullptr for none)
+ */
+void setSetpointFunction(SetpointFunction function) {
+   restartTick      = true;
+   setpointFunction = function;
+}
+
+/**
+ * Get number of ticks in each second
+ *
+ * @return Ticks per second
+ */
+unsigned getTicksPerSecond() {
+   return TICKS_PER_SECOND;
+}
+
+/**
+ * Get oven temperature latched by the sample stage of the current tick
+ *
+ * @return Averaged oven temperature (NAN if no active thermocouples)
+ */
+float getTemperature() {
+   return temperature;
+}
+
+/**
+ * Get timing statistics for a stage
+ *
+ * @param[in]  stage      Stage of interest
+ * @param[out] statistics Statistics for stage
+ */
+void getStatistics(Stage stage, StageStatistics &statistics) {
+   const StageTiming &t = timing[stage];
+   uint32_t count  = tickCount;
+   uint32_t cycles = osKernelSysTickMicroSec(1000);
+
+   statistics.last    = (uint32_t)((uint64_t)t.last*1000/cycles);
+   statistics.maximum = (uint32_t)((uint64_t)t.maximum*1000/cycles);
+   statistics.average = (count == 0)?0:(uint32_t)((uint64_t)t.total*1000/cycles/count);
+}
+
+/**
+ * Get name of stage
+ *
+ * @param[in] stage Stage of interest
+ *
+ * @return Pointer to static string
+ */
+const char *getStageName(Stage stage) {
+   switch(stage) {
+   case Stage_Sample   : return "sample";
+   case Stage_Setpoint : return "setpoint";
+   case Stage_Pid      : return "pid";
+   case Stage_Actuate  : return "actuate";
+   default             : return "????";
+   }
+}
+
+/**
+ * Get number of ticks executed since statistics were reset
+ *
+ * @return Number of ticks
+ */
+uint32_t getTickCount() {
+   return tickCount;
+}
+
+/**
+ * Get number of ticks that did not complete within the interval
+ *
+ * @return Number of overruns
+ */
+uint32_t getOverruns() {
+   return overruns;
+}
+
+/**
+ * Clear timing statistics
+ */
+void resetStatistics() {
+   resetRequest = true;
+}
+
+}; // end namespace ControlLoop
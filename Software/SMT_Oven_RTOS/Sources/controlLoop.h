@@ -0,0 +1,111 @@
+/**
+ * @file    controlLoop.h
+ * @brief   Periodic oven control task
+ *
+ * A single thread runs the control pipeline at \ref pidInterval.
+ * Each tick executes the following stages in order:
+ *  - Sample    - Latch the oven temperature from the latest thermocouple snapshot
+ *  - Set-point - Run the set-point function (e.g. profile state-machine and interpolation)
+ *  - PID       - Calculate the PID controller output
+ *  - Actuate   - Apply the PID output to the heater and fan
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_CONTROLLOOP_H_
+#define SOURCES_CONTROLLOOP_H_
+
+#include <stdint.h>
+
+namespace ControlLoop {
+
+/** Stages executed each tick */
+enum Stage {
+   Stage_Sample,
+   Stage_Setpoint,
+   Stage_Pid,
+   Stage_Actuate,
+   NUM_STAGES,
+};
+
+/** Execution time of a stage in microseconds */
+struct StageStatistics {
+   uint32_t last;      //!< Last execution time
+   uint32_t average;   //!< Average execution time
+   uint32_t maximum;   //!< Maximum execution time
+};
+
+/**
+ * Function executed in the set-point stage
+ *
+ * @param[in] tick Tick within the current second [0..getTicksPerSecond()-1]
+ */
+using SetpointFunction = void (*)(unsigned tick);
+
+/**
+ * Start the control loop thread
+ */
+void initialise();
+
+/**
+ * Set function executed in the set-point stage\n
+ * The function is first called on the next tick with tick = 0.
+ *
+ * @param[in] function Function to execute (nullptr for none)
+ */
+void setSetpointFunction(SetpointFunction function);
+
+/**
+ * Get number of ticks in each second
+ *
+ * @return Ticks per second
+ */
+unsigned getTicksPerSecond();
+
+/**
+ * Get oven temperature latched by the sample stage of the current tick
+ *
+ * @return Averaged oven temperature (NAN if no active thermocouples)
+ */
+float getTemperature();
+
+/**
+ * Get timing statistics for a stage
+ *
+ * @param[in]  stage      Stage of interest
+ * @param[out] statistics Statistics for stage
+ */
+void getStatistics(Stage stage, StageStatistics &statistics);
+
+/**
+ * Get name of stage
+ *
+ * @param[in] stage Stage of interest
+ *
+ * @return Pointer to static string
+ */
+const char *getStageName(Stage stage);
+
+/**
+ * Get number of ticks executed since statistics were reset
+ *
+ * @return Number of ticks
+ */
+uint32_t getTickCount();
+
+/**
+ * Get number of ticks that did not complete within the interval
+ *
+ * @return Number of overruns
+ */
+uint32_t getOverruns();
+
+/**
+ * Clear timing statistics
+ */
+void resetStatistics();
+
+}; // end namespace ControlLoop
+
+#endif /* SOURCES_CONTROLLOOP_H_ */
@@ -7,8 +7,10 @@
 
 #include <copyProfile.h>
 #include "lcd_st7920.h"
+#include "formatter.h"
 #include "messageBox.h"
 #include "configure.h"
+#include "profileLibrary.h"
 
 namespace CopyProfile {
 
@@ -27,15 +29,18 @@ void draw() {
    lcd.gotoXY(0,1*lcd.FONT_HEIGHT+5);
    lcd.setInversion(false);lcd.putString("Copy:");     lcd.setInversion(false);
    lcd.gotoXY(0,2*lcd.FONT_HEIGHT+5);
-   lcd.printf("%d:%s", sourceProfileIndex, (const volatile char *)profiles[sourceProfileIndex].description);
+   FormattedString<22> buff;
+   lcd.putString(buff.writeInt(sourceProfileIndex).writeChar(':').writeString(profiles[sourceProfileIndex].description).toString());
    lcd.gotoXY(0,4*lcd.FONT_HEIGHT);
    lcd.setInversion(false);lcd.putString("To:");         lcd.setInversion(false);
    lcd.gotoXY(0,5*lcd.FONT_HEIGHT);
-   lcd.printf("%d:%s", destinationProfileIndex, (const volatile char *)profiles[destinationProfileIndex].description);
+   buff.reset();
+   lcd.putString(buff.writeInt(destinationProfileIndex).writeChar(':').writeString(profiles[destinationProfileIndex].description).toString());
 
    lcd.gotoXY(8,lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
    lcd.setInversion(true); lcd.putSpace(4); lcd.putUpArrow();        lcd.putSpace(4); lcd.setInversion(false); lcd.putSpace(6);
-   lcd.setInversion(true); lcd.putSpace(4); lcd.putDownArrow();      lcd.putSpace(4); lcd.setInversion(false); lcd.putSpace(6);
+   lcd.setInversion(true); lcd.putSpace(4); lcd.putDownArrow();      lcd.putSpace(4); lcd.setInversion(false); lcd.putSpace(4);
+   lcd.setInversion(true); lcd.putSpace(2); lcd.putString("L");      lcd.putSpace(2); lcd.setInversion(false); lcd.putSpace(6);
    lcd.gotoXY(lcd.LCD_WIDTH-6*lcd.FONT_WIDTH-22,lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
    if ((destinationProfileIndex != sourceProfileIndex) && (profiles[destinationProfileIndex].flags&P_UNLOCKED)) {
       lcd.setInversion(true); lcd.putSpace(4); lcd.putString("OK");     lcd.putSpace(3); lcd.setInversion(false); lcd.putSpace(3);
@@ -58,16 +63,17 @@ void draw() {
  */
 bool copyProfile(unsigned sourceIndex, unsigned destinationIndex) {
    MessageBoxResult rc;
-   char buff[100];
+   FormattedString<100> buff;
    if ((destinationProfileIndex == sourceProfileIndex) || !(profiles[destinationProfileIndex].flags&P_UNLOCKED)) {
       // Illegal copy - quietly ignore
       return false;
    }
 
-   snprintf(buff, sizeof(buff), "Overwrite:\n%d:%s", destinationIndex, (const volatile char *)profiles[destinationIndex].description );
-   rc = messageBox("Overwrite Profile", buff, MSG_YES_NO);
+   buff.writeString("Overwrite:\n").writeInt(destinationIndex).writeChar(':').writeString(profiles[destinationIndex].description);
+   rc = messageBox("Overwrite Profile", buff.toString(), MSG_YES_NO);
    if (rc == MSG_IS_YES) {
       // Update profile in NV ram
+      USBDM::NonvolatileTransaction transaction;
       profiles[destinationIndex] = profiles[sourceIndex];
       profiles[destinationIndex].flags = profiles[destinationIndex].flags | P_UNLOCKED;
       return true;
@@ -75,6 +81,42 @@ bool copyProfile(unsigned sourceIndex, unsigned destinationIndex) {
    return false;
 }
 
+/**
+ * Save a profile to the profile library with confirmation dialogue\n
+ * A library profile with the same name is replaced
+ *
+ * @param[in] sourceIndex Index of profile to save
+ *
+ * @return true  => Profile saved
+ * @return false => Profile not saved (library full/cancelled)
+ */
+bool saveToLibrary(unsigned sourceIndex) {
+   if (!RunProfile::isIdle()) {
+      // Flash programming would stall the control loop
+      messageBox("Save Profile", "Not available while\na profile is running", MSG_OK);
+      return false;
+   }
+   SolderProfile profile;
+   profile = profiles[sourceIndex];
+
+   FormattedString<100> buff;
+   buff.writeString("Save to library:\n").writeInt(sourceIndex).writeChar(':').writeString(profile.description);
+   if (profileLibrary.find(profile.description)>=0) {
+      buff.writeString("\n(Replaces existing)");
+   }
+   if (messageBox("Save Profile", buff.toString(), MSG_YES_NO) != MSG_IS_YES) {
+      return false;
+   }
+   int libraryIndex = profileLibrary.store(profile);
+   if (libraryIndex<0) {
+      messageBox("Save Profile", "Library is full or\nFlash failed", MSG_OK);
+      return false;
+   }
+   buff.reset().writeString("Saved as library\nprofile ").writeInt(libraryIndex);
+   messageBox("Save Profile", buff.toString(), MSG_OK);
+   return true;
+}
+
 /**
  * Run Copy Profile Dialogue
  *
@@ -104,6 +146,12 @@ void run(int index) {
             needsUpdate = true;
          }
          break;
+      case SwitchValue::SW_F3:
+         if (saveToLibrary(sourceProfileIndex)) {
+            return;
+         }
+         needsUpdate = true;
+         break;
       case SwitchValue::SW_F4:
          if (copyProfile(sourceProfileIndex, destinationProfileIndex)) {
             return;
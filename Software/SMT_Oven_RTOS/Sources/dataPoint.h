@@ -42,6 +42,15 @@ public:
    using TemperatureArray = float[NUM_THERMOCOUPLES];
    using StatusArray      = ThermocoupleStatus[NUM_THERMOCOUPLES];
 
+   /** Number of 16-bit fields in packed representation */
+   static constexpr unsigned NUM_FIELDS = 3+NUM_THERMOCOUPLES;
+
+   /** Fields that follow straight line segments (target temperature)\n
+    *  Measured temperatures are too noisy to benefit from linear prediction */
+   static constexpr unsigned SMOOTH_FIELDS = (1<<2);
+
+   using FieldArray       = uint16_t[NUM_FIELDS];
+
 private:
    /** Value used to scale float to scaled integer values => 2 decimal places */
    static constexpr float FIXED_POINT_SCALE    = 100.0;
@@ -67,6 +76,33 @@ public:
     */
    DataPoint() : fState_status{0}, fHeater{0}, fFan{0}, fTargetTemp{0}, fThermocouples{0,0,0,0} {
    }
+   /**
+    * Get packed representation of data point
+    *
+    * @param[out] fields Fields {state/status, heater/fan, target, thermocouples...}
+    */
+   void getFields(FieldArray &fields) const {
+      fields[0] = fState_status;
+      fields[1] = fHeater|(fFan<<8);
+      fields[2] = fTargetTemp;
+      for (unsigned index=0; index<NUM_THERMOCOUPLES; index++) {
+         fields[3+index] = fThermocouples[index];
+      }
+   }
+   /**
+    * Set data point from packed representation
+    *
+    * @param[in] fields Fields {state/status, heater/fan, target, thermocouples...}
+    */
+   void setFields(const FieldArray &fields) {
+      fState_status = fields[0];
+      fHeater       = (uint8_t)fields[1];
+      fFan          = (uint8_t)(fields[1]>>8);
+      fTargetTemp   = fields[2];
+      for (unsigned index=0; index<NUM_THERMOCOUPLES; index++) {
+         fThermocouples[index] = fields[3+index];
+      }
+   }
    /**
     * Get recorded status of a thermocouple
     *
@@ -139,7 +139,7 @@ void EditProfile::drawScreen() {
       }
       lcd.setInversion(item == selection);
       lcd.gotoXY(0, (item+1-offset)*lcd.FONT_HEIGHT);
-      lcd.printf(items[item]->getDescription());
+      lcd.putString(items[item]->getDescription());
    }
    lcd.gotoXY(0, lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
    lcd.setInversion(false); lcd.putSpace(4);
@@ -226,15 +226,15 @@ void EditProfile::run(NvSolderProfile &nvProfile) {
    do {
       if (editProfile.doit() || changed) {
          changed = true;
-         char buff[100];
+         FormattedString<100> buff;
          if (!tempProfile.isValid()) {
-            snprintf(buff, sizeof(buff), "%s\n\nProfile is invalid\nPlease check", tempProfile.description);
-            messageBox("Profile changed", buff, MSG_OK);
+            buff.writeString(tempProfile.description).writeString("\n\nProfile is invalid\nPlease check");
+            messageBox("Profile changed", buff.toString(), MSG_OK);
             rc = MSG_IS_CANCEL;
          }
          else {
-            snprintf(buff, sizeof(buff), "%s\n\nSave Profile changes?", tempProfile.description);
-            rc = messageBox("Profile changed", buff, MSG_YES_NO_CANCEL);
+            buff.writeString(tempProfile.description).writeString("\n\nSave Profile changes?");
+            rc = messageBox("Profile changed", buff.toString(), MSG_YES_NO_CANCEL);
             if (rc == MSG_IS_YES) {
                // Update profile in NV ram
                nvProfile = tempProfile;
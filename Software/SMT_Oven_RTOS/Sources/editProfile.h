@@ -10,6 +10,7 @@
 #define SOURCES_EDITPROFILE_H_
 
 #include <SolderProfile.h>
+#include "formatter.h"
 
 class ProfileSetting {
 public:
@@ -51,8 +52,12 @@ class ProfileSetting_T : public ProfileSetting {
 private:
    /** Variable value */
    T     &value;
-   /** Description format string  as for printf() */
+   /** Description displayed before value */
    const char * const description;
+   /** Format used to display value */
+   const NumberFormat format;
+   /** Units displayed after value */
+   const char * const units;
    /** Increment/decrement size */
    const T delta;
    /** Default value for reset */
@@ -73,11 +78,13 @@ public:
    ProfileSetting_T(
          T &value,
          const char *description,
+         NumberFormat format,
+         const char *units,
          T delta,
          T defaultValue,
          T min,
          T max) :
-            value(value), description(description), delta(delta), defaultValue(defaultValue), min(min), max(max) {
+            value(value), description(description), format(format), units(units), delta(delta), defaultValue(defaultValue), min(min), max(max) {
       set((T)value);
    }
    /**
@@ -86,7 +93,8 @@ public:
     * @return Pointer to static buffer containing description
     */
    virtual const char *getDescription() const {
-      snprintf(buff, sizeof(buff), description, (T)value);
+      Formatter formatter(buff, sizeof(buff));
+      formatter.writeString(description).writeNumber((T)value, format).writeString(units);
       return buff;
    }
    /**
@@ -238,17 +246,17 @@ private:
 
    /** Describes the editable items */
    ProfileSetting *items[NUM_ITEMS] = {
-         //                             value,                 description                  delta default minimum maximum
+         //                             value,                 description      format units      delta default minimum maximum
          new ProfileNameSetting        (profile.description),
-         new ProfileSetting_T<uint16_t>(profile.liquidus,      "Liquidus T.  %3d\177C",        1,    183,   120,    250),
-         new ProfileSetting_T<uint16_t>(profile.preheatTime,   "Preheat Time %3ds",            1,     90,    60,    200),
-         new ProfileSetting_T<uint16_t>(profile.soakTemp1,     "Soak temp. 1 %3d\177C",        1,    140,    80,    160),
-         new ProfileSetting_T<uint16_t>(profile.soakTemp2,     "Soak temp. 2 %3d\177C",        1,    183,   150,    250),
-         new ProfileSetting_T<uint16_t>(profile.soakTime,      "Soak time    %3ds",            1,    120,    60,    300),
-         new ProfileSetting_T<float>   (profile.rampUpSlope,   "Ramp up      %3.1f\177C/s",  0.1f,  3.0f,  0.1f,   6.0f),
-         new ProfileSetting_T<uint16_t>(profile.peakTemp,      "Peak temp.   %3d\177C",        1,    210,   180,    300),
-         new ProfileSetting_T<uint16_t>(profile.peakDwell,     "Peak dwell   %3ds",            1,     20,     1,     30),
-         new ProfileSetting_T<float>   (profile.rampDownSlope, "Ramp down    %3.1f\177C/s", 0.1f,  -3.0f, -6.0f,  -0.1f),
+         new ProfileSetting_T<uint16_t>(profile.liquidus,      "Liquidus T.  ", {3},   "\177C",        1,    183,   120,    250),
+         new ProfileSetting_T<uint16_t>(profile.preheatTime,   "Preheat Time ", {3},   "s",            1,     90,    60,    200),
+         new ProfileSetting_T<uint16_t>(profile.soakTemp1,     "Soak temp. 1 ", {3},   "\177C",        1,    140,    80,    160),
+         new ProfileSetting_T<uint16_t>(profile.soakTemp2,     "Soak temp. 2 ", {3},   "\177C",        1,    183,   150,    250),
+         new ProfileSetting_T<uint16_t>(profile.soakTime,      "Soak time    ", {3},   "s",            1,    120,    60,    300),
+         new ProfileSetting_T<float>   (profile.rampUpSlope,   "Ramp up      ", {3,1}, "\177C/s",   0.1f,  3.0f,  0.1f,   6.0f),
+         new ProfileSetting_T<uint16_t>(profile.peakTemp,      "Peak temp.   ", {3},   "\177C",        1,    210,   180,    300),
+         new ProfileSetting_T<uint16_t>(profile.peakDwell,     "Peak dwell   ", {3},   "s",            1,     20,     1,     30),
+         new ProfileSetting_T<float>   (profile.rampDownSlope, "Ramp down    ", {3,1}, "\177C/s",   0.1f,  -3.0f, -6.0f,  -0.1f),
    };
 
    /**
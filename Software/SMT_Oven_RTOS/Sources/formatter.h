@@ -0,0 +1,280 @@
+/**
+ * @file    formatter.h
+ * @brief   Allocation-free typed formatting
+ *
+ * Replacement for snprintf() for the small set of formats used by the LCD and
+ * remote interface.  Each value is written by a typed method so argument types
+ * are checked at compile time and no variadic or floating-point printf support
+ * is needed.
+ *
+ * @code
+ *    FormattedString<22> buff;
+ *    buff.writeString("T=").writeFixed(temperature, 1, 5).writeChar('\x7F');
+ *    lcd.putString(buff.toString());
+ * @endcode
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_FORMATTER_H_
+#define SOURCES_FORMATTER_H_
+
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * Describes how a number is formatted
+ */
+struct NumberFormat {
+   /** Minimum field width (right justified) */
+   uint8_t width;
+   /** Number of decimal places (0 => integer) */
+   uint8_t decimals;
+};
+
+/**
+ * Formats values into a caller supplied buffer.\n
+ * Output is truncated (and remains terminated) if the buffer is too small.
+ */
+class Formatter {
+
+public:
+   /** Padding used for numbers */
+   enum Padding {
+      Pad_Space,  //!< Pad with leading spaces e.g. "  12"
+      Pad_Zero,   //!< Pad with leading zeroes e.g. "0012"
+   };
+
+private:
+   /** Buffer being written */
+   char * const fBuffer;
+
+   /** Size of buffer including terminator */
+   const unsigned fSize;
+
+   /** Number of characters written */
+   unsigned fLength = 0;
+
+   /**
+    * Write unsigned value
+    *
+    * @param[in] value    Value to write
+    * @param[in] negative Precede value with '-'
+    * @param[in] width    Minimum width of field
+    * @param[in] padding  Padding to use
+    * @param[in] radix    Radix to use (10 or 16)
+    */
+   Formatter &writeUnsigned(uint32_t value, bool negative, unsigned width, Padding padding, unsigned radix) {
+      char     digits[12];
+      unsigned count = 0;
+      do {
+         unsigned digit = value%radix;
+         digits[count++] = (digit<10)?('0'+digit):('A'+digit-10);
+         value /= radix;
+      } while (value != 0);
+
+      unsigned length = count+(negative?1:0);
+      if ((padding == Pad_Zero) && negative) {
+         writeChar('-');
+      }
+      while (width>length) {
+         writeChar((padding == Pad_Zero)?'0':' ');
+         width--;
+      }
+      if ((padding == Pad_Space) && negative) {
+         writeChar('-');
+      }
+      while (count>0) {
+         writeChar(digits[--count]);
+      }
+      return *this;
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param[in] buffer Buffer to write to
+    * @param[in] size   Size of buffer including terminator
+    */
+   Formatter(char *buffer, unsigned size) : fBuffer(buffer), fSize(size) {
+      reset();
+   }
+
+   /**
+    * Discard contents
+    */
+   Formatter &reset() {
+      fLength    = 0;
+      fBuffer[0] = '\0';
+      return *this;
+   }
+
+   /**
+    * Get formatted string
+    *
+    * @return Pointer to terminated string
+    */
+   const char *toString() const {
+      return fBuffer;
+   }
+
+   /**
+    * Get length of formatted string
+    *
+    * @return Number of characters (excluding terminator)
+    */
+   unsigned length() const {
+      return fLength;
+   }
+
+   /**
+    * Write character
+    *
+    * @param[in] ch Character to write
+    */
+   Formatter &writeChar(char ch) {
+      if ((fLength+1)<fSize) {
+         fBuffer[fLength++] = ch;
+         fBuffer[fLength]   = '\0';
+      }
+      return *this;
+   }
+
+   /**
+    * Write string (as for %s or %-Ns)
+    *
+    * @param[in] str   String to write
+    * @param[in] width Minimum width of field (string is left justified)
+    */
+   Formatter &writeString(const char *str, unsigned width=0) {
+      while (*str != '\0') {
+         writeChar(*str++);
+         if (width>0) {
+            width--;
+         }
+      }
+      while (width-->0) {
+         writeChar(' ');
+      }
+      return *this;
+   }
+
+   /**
+    * Write string from non-volatile storage
+    *
+    * @param[in] str   String to write
+    * @param[in] width Minimum width of field (string is left justified)
+    */
+   Formatter &writeString(const volatile char *str, unsigned width=0) {
+      return writeString(const_cast<const char *>(str), width);
+   }
+
+   /**
+    * Write integer (as for %Nd or %0Nd)
+    *
+    * @param[in] value   Value to write
+    * @param[in] width   Minimum width of field
+    * @param[in] padding Padding to use
+    */
+   Formatter &writeInt(int value, unsigned width=0, Padding padding=Pad_Space) {
+      bool negative = value<0;
+      return writeUnsigned(negative?-(uint32_t)value:(uint32_t)value, negative, width, padding, 10);
+   }
+
+   /**
+    * Write value in upper-case hexadecimal (as for %0NX)
+    *
+    * @param[in] value Value to write
+    * @param[in] width Minimum width of field (zero padded)
+    */
+   Formatter &writeHex(uint32_t value, unsigned width=0) {
+      return writeUnsigned(value, false, width, Pad_Zero, 16);
+   }
+
+   /**
+    * Write number in fixed-point (as for %N.Df)
+    *
+    * @param[in] value    Value to write
+    * @param[in] decimals Number of decimal places [0..6]
+    * @param[in] width    Minimum width of field
+    */
+   Formatter &writeFixed(float value, unsigned decimals, unsigned width=0) {
+      static const uint32_t scales[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+      if (isnan(value)) {
+         return writeString("", (width>3)?width-3:0).writeString("nan");
+      }
+      if (decimals>6) {
+         decimals = 6;
+      }
+      bool negative = value<0;
+      if (negative) {
+         value = -value;
+      }
+      uint32_t scale    = scales[decimals];
+      uint32_t integer  = (uint32_t)value;
+      uint32_t fraction = (uint32_t)lroundf((value-integer)*scale);
+      if (fraction>=scale) {
+         // Rounding carried into integer part
+         fraction -= scale;
+         integer++;
+      }
+      if (negative && (integer==0) && (fraction==0)) {
+         // Don't show "-0.0"
+         negative = false;
+      }
+      unsigned fieldWidth = (decimals>0)?decimals+1:0;
+      writeUnsigned(integer, negative, (width>fieldWidth)?width-fieldWidth:0, Pad_Space, 10);
+      if (decimals>0) {
+         writeChar('.');
+         writeUnsigned(fraction, false, decimals, Pad_Zero, 10);
+      }
+      return *this;
+   }
+
+   /**
+    * Write number using format description
+    *
+    * @param[in] value  Value to write
+    * @param[in] format Format to use
+    */
+   Formatter &writeNumber(float value, NumberFormat format) {
+      return writeFixed(value, format.decimals, format.width);
+   }
+
+   /**
+    * Write number using format description
+    *
+    * @param[in] value  Value to write
+    * @param[in] format Format to use (decimals are ignored)
+    */
+   Formatter &writeNumber(int value, NumberFormat format) {
+      return writeInt(value, format.width);
+   }
+};
+
+/**
+ * Formatter with internal buffer e.g. for use on the stack
+ *
+ * @tparam SIZE Size of buffer including terminator
+ */
+template<unsigned SIZE>
+class FormattedString : public Formatter {
+
+private:
+   /** Buffer for formatted string */
+   char fData[SIZE];
+
+public:
+   /**
+    * Constructor
+    */
+   FormattedString() : Formatter(fData, SIZE) {
+   }
+
+   FormattedString(const FormattedString &) = delete;
+   FormattedString &operator=(const FormattedString &) = delete;
+};
+
+#endif /* SOURCES_FORMATTER_H_ */
@@ -184,7 +184,8 @@ FlashDriverError_t Flash::programPhrase(const uint8_t *data, uint8_t *address) {
 }
 
 /**
- * Program a range of bytes to Flash memory
+ * Program a range of bytes to Flash memory\n
+ * The Flash cache is invalidated afterwards so the new contents are read
  *
  * @param[in]  data       Location of data to program
  * @param[out] address    Memory address to program - must be phrase boundary
@@ -206,16 +207,15 @@ FlashDriverError_t Flash::programRange(const uint8_t *data, uint8_t *address, ui
    assert((((uint32_t)address)&(phraseSize-1)) == 0);
    assert((size&(phraseSize-1)) == 0);
 
-   while (size>0) {
-      FlashDriverError_t rc = programPhrase(data, address);
-      if (rc != FLASH_ERR_OK) {
-         return rc;
-      }
+   FlashDriverError_t rc = FLASH_ERR_OK;
+   while ((size>0) && (rc == FLASH_ERR_OK)) {
+      rc = programPhrase(data, address);
       data    += phraseSize;
       address += phraseSize;
       size    -= phraseSize;
    }
-   return FLASH_ERR_OK;
+   invalidateCache();
+   return rc;
 }
 
 /**
@@ -235,7 +235,8 @@ FlashDriverError_t Flash::eraseSector(uint8_t *address) {
 }
 
 /**
- * Program a range of bytes to Flash memory
+ * Erase a range of Flash memory\n
+ * The Flash cache is invalidated afterwards so the new contents are read
  *
  * @param[in]  address    Memory address to start erasing - must be sector boundary
  * @param[in]  size       Size of range (in bytes) to erase - must be multiple of sector size
@@ -256,15 +257,34 @@ FlashDriverError_t Flash::eraseRange(uint8_t *address, uint32_t size) {
    assert((((uint32_t)address)&(sectorSize-1)) == 0);
    assert((size&(sectorSize-1)) == 0);
 
-   while (size>0) {
-      FlashDriverError_t rc = eraseSector(address);
-      if (rc != FLASH_ERR_OK) {
-         return rc;
-      }
+   FlashDriverError_t rc = FLASH_ERR_OK;
+   while ((size>0) && (rc == FLASH_ERR_OK)) {
+      rc = eraseSector(address);
       address += sectorSize;
       size    -= sectorSize;
    }
-   return FLASH_ERR_OK;
+   invalidateCache();
+   return rc;
+}
+
+/**
+ * Update CRC-32 (IEEE 802.3) with data
+ *
+ * @param[in] crc  Current CRC (start with 0xFFFFFFFF)
+ * @param[in] data Data to add
+ * @param[in] size Size of data in bytes
+ *
+ * @return Updated CRC (complement for final value)
+ */
+uint32_t Flash::updateCrc32(uint32_t crc, const void *data, unsigned size) {
+   const uint8_t *ptr = (const uint8_t *)data;
+   while (size-->0) {
+      crc ^= *ptr++;
+      for (int bit=0; bit<8; bit++) {
+         crc = (crc&1)?(crc>>1)^0xEDB88320:(crc>>1);
+      }
+   }
+   return crc;
 }
 
 /**
@@ -280,4 +300,61 @@ void Flash::eraseAll() {
    }
 }
 
+/** Number of waits where the Flash controller was busy */
+volatile uint32_t Flash::fStallCount     = 0;
+
+/** Total time spent waiting for busy Flash controller (cycles) */
+volatile uint64_t Flash::fStallCycles    = 0;
+
+/** Longest wait for busy Flash controller (cycles) */
+volatile uint32_t Flash::fMaxStallCycles = 0;
+
+/**
+ * Record time spent waiting for busy Flash controller
+ *
+ * @param[in] cycles Time waited (cycles)
+ */
+void Flash::recordStall(uint32_t cycles) {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   fStallCount  = fStallCount + 1;
+   fStallCycles = fStallCycles + cycles;
+   if (cycles>fMaxStallCycles) {
+      fMaxStallCycles = cycles;
+   }
+   __set_PRIMASK(primask);
+}
+
+/**
+ * Get statistics for waits on busy Flash controller
+ *
+ * @param[out] count     Number of waits
+ * @param[out] totalTime Total time waited (us)
+ * @param[out] maxTime   Longest wait (us)
+ */
+void Flash::getStallStatistics(uint32_t &count, uint32_t &totalTime, uint32_t &maxTime) {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   uint64_t total   = fStallCycles;
+   uint32_t maximum = fMaxStallCycles;
+   count = fStallCount;
+   __set_PRIMASK(primask);
+
+   uint32_t cyclesPerMicrosecond = SystemCoreClock/1000000;
+   totalTime = (uint32_t)(total/cyclesPerMicrosecond);
+   maxTime   = maximum/cyclesPerMicrosecond;
+}
+
+/**
+ * Clear statistics for waits on busy Flash controller
+ */
+void Flash::resetStallStatistics() {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   fStallCount     = 0;
+   fStallCycles    = 0;
+   fMaxStallCycles = 0;
+   __set_PRIMASK(primask);
+}
+
 }
@@ -0,0 +1,186 @@
+/**
+ * @file    keywordHash.h
+ * @brief   Perfect hash of a fixed set of keywords
+ *
+ * The seed giving a collision-free (perfect) hash of the keywords is found at compile time.
+ * Lookup is then a single hash of the word and a single comparison.\n
+ * The keyword set is described by a class providing:
+ * @code
+ *   static constexpr unsigned count;                        // Number of keywords
+ *   static constexpr const char *keyword(unsigned index);   // Keyword at index
+ * @endcode
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_KEYWORDHASH_H_
+#define SOURCES_KEYWORDHASH_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Case-insensitive keyword hashing (FNV-1a)
+ */
+namespace KeywordHashing {
+
+/**
+ * Convert character to upper-case
+ */
+constexpr char toUpper(char ch) {
+   return ((ch>='a')&&(ch<='z'))?(ch-'a'+'A'):ch;
+}
+
+/**
+ * Get length of keyword
+ */
+constexpr unsigned keywordLength(const char *keyword) {
+   return (*keyword == '\0')?0:1+keywordLength(keyword+1);
+}
+
+/**
+ * Hash keyword without regard to case (FNV-1a)
+ *
+ * @param[in] keyword Keyword to hash
+ * @param[in] length  Length of keyword
+ * @param[in] hash    Initial value (seed)
+ *
+ * @return Hash value
+ */
+constexpr uint32_t hashKeyword(const char *keyword, unsigned length, uint32_t hash) {
+   return (length == 0)?hash:hashKeyword(keyword+1, length-1, (hash^(uint8_t)toUpper(*keyword))*16777619U);
+}
+
+/**
+ * Get hash table slot for keyword\n
+ * High bits of hash are used as they depend on all bits of the seed
+ *
+ * @tparam    Keywords Keyword set
+ * @tparam    bits     Number of bits in hash table index
+ *
+ * @param[in] index Index of keyword in set
+ * @param[in] seed  Hash seed
+ */
+template<typename Keywords, unsigned bits>
+constexpr unsigned keywordSlot(unsigned index, uint32_t seed) {
+   return hashKeyword(Keywords::keyword(index), keywordLength(Keywords::keyword(index)), seed)>>(32-bits);
+}
+
+/**
+ * Check that keyword does not share a slot with any following keyword
+ */
+template<typename Keywords, unsigned bits>
+constexpr bool isUniqueSlot(unsigned index, unsigned other, uint32_t seed) {
+   return (other>=Keywords::count) ||
+         ((keywordSlot<Keywords, bits>(index, seed) != keywordSlot<Keywords, bits>(other, seed)) &&
+               isUniqueSlot<Keywords, bits>(index, other+1, seed));
+}
+
+/**
+ * Check that no keywords share a slot
+ */
+template<typename Keywords, unsigned bits>
+constexpr bool isPerfectHash(uint32_t seed, unsigned index=0) {
+   return (index>=Keywords::count) ||
+         (isUniqueSlot<Keywords, bits>(index, index+1, seed) && isPerfectHash<Keywords, bits>(seed, index+1));
+}
+
+/** Returned by findSeed() if no seed in the range gives a perfect hash */
+static constexpr uint32_t NO_SEED = 0;
+
+template<typename Keywords, unsigned bits>
+constexpr uint32_t findSeed(uint32_t seed, uint32_t count);
+
+/**
+ * Continue search in upper half of range if not found in lower half
+ */
+template<typename Keywords, unsigned bits>
+constexpr uint32_t findSeedInUpper(uint32_t found, uint32_t seed, uint32_t count) {
+   return (found != NO_SEED)?found:findSeed<Keywords, bits>(seed+count/2, count-count/2);
+}
+
+/**
+ * Search for first seed giving a perfect hash\n
+ * The range is split in halves so the recursion depth is log2(count)
+ *
+ * @param[in] seed  First seed to try
+ * @param[in] count Number of seeds to try
+ *
+ * @return Seed or NO_SEED if none found
+ */
+template<typename Keywords, unsigned bits>
+constexpr uint32_t findSeed(uint32_t seed, uint32_t count) {
+   return (count == 1)?(isPerfectHash<Keywords, bits>(seed)?seed:NO_SEED):
+         findSeedInUpper<Keywords, bits>(findSeed<Keywords, bits>(seed, count/2), seed, count);
+}
+
+}; // end namespace KeywordHashing
+
+/**
+ * Hash table locating keywords
+ *
+ * @tparam Keywords Keyword set
+ * @tparam bits     Number of bits in hash table index
+ */
+template<typename Keywords, unsigned bits>
+class KeywordHash {
+
+public:
+   /** Size of hash table */
+   static constexpr unsigned SIZE = 1<<bits;
+
+   /** Returned by find() for an unknown keyword */
+   static constexpr int NOT_FOUND = -1;
+
+   /** Seed giving collision-free hash of keywords - found at compile time */
+   static constexpr uint32_t SEED = KeywordHashing::findSeed<Keywords, bits>(2166136261U, 4096);
+
+   static_assert(SEED != KeywordHashing::NO_SEED, "No perfect hash found - increase bits");
+   static_assert(Keywords::count<SIZE, "Hash table too small");
+   static_assert(SIZE<=256, "Hash table entries are 8-bit");
+
+private:
+   /** Marks unused hash table entry */
+   static constexpr uint8_t NO_ENTRY = 0xFF;
+
+   /** Hash table mapping slot to index in keyword set */
+   uint8_t fTable[SIZE];
+
+public:
+   /**
+    * Build hash table
+    */
+   void initialise() {
+      memset(fTable, NO_ENTRY, sizeof(fTable));
+      for (unsigned index=0; index<Keywords::count; index++) {
+         fTable[KeywordHashing::keywordSlot<Keywords, bits>(index, SEED)] = index;
+      }
+   }
+
+   /**
+    * Locate keyword
+    *
+    * @param[in] keyword Keyword to look up (need not be terminated)
+    * @param[in] length  Length of keyword
+    *
+    * @return Index of keyword in set or NOT_FOUND
+    */
+   int find(const char *keyword, unsigned length) const {
+      uint8_t index = fTable[KeywordHashing::hashKeyword(keyword, length, SEED)>>(32-bits)];
+      if (index == NO_ENTRY) {
+         return NOT_FOUND;
+      }
+      // Keyword may contain characters that terminate the entry so strncasecmp() is not used
+      const char *entry = Keywords::keyword(index);
+      for (unsigned position=0; position<length; position++) {
+         if ((entry[position] == '\0') ||
+               (KeywordHashing::toUpper(entry[position]) != KeywordHashing::toUpper(keyword[position]))) {
+            return NOT_FOUND;
+         }
+      }
+      return (entry[length] == '\0')?index:NOT_FOUND;
+   }
+};
+
+#endif /* SOURCES_KEYWORDHASH_H_ */
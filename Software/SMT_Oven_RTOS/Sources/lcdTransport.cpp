@@ -0,0 +1,188 @@
+/**
+ * @file    lcdTransport.cpp
+ * @brief   Asynchronous transmit queue for ST7920 LCD
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#include <assert.h>
+#include "lcdTransport.h"
+
+using namespace USBDM;
+
+uint16_t      LcdTransport::queue[QUEUE_SIZE];
+volatile unsigned LcdTransport::head       = 0;
+volatile unsigned LcdTransport::tail       = 0;
+unsigned      LcdTransport::pauseCount     = 0;
+unsigned      LcdTransport::sliceRemaining = 0;
+bool          LcdTransport::csHeld         = false;
+volatile bool LcdTransport::active         = false;
+Spi          *LcdTransport::spi            = nullptr;
+uint32_t      LcdTransport::spiConfig      = 0;
+uint32_t      LcdTransport::pushrValue     = 0;
+CMSIS::Thread LcdTransport::transportThread(LcdTransport::transportThreadFunction, osPriorityAboveNormal, STACK_SIZE);
+
+/**
+ * PIT callback - sends one entry to the LCD
+ */
+void LcdTransport::timerCallback() {
+   if (pauseCount>0) {
+      pauseCount--;
+      return;
+   }
+   unsigned index = tail;
+   if (index == head) {
+      // Queue drained - previous transfer has completed as a full interval has elapsed
+      Timer::disable();
+      active = false;
+      transportThread.signalSet(DRAINED_SIGNAL);
+      return;
+   }
+   if ((sliceRemaining == 0) && !csHeld) {
+      // Slice complete - release SPI to other users (queue is still being drained)
+      Timer::disable();
+      transportThread.signalSet(DRAINED_SIGNAL);
+      return;
+   }
+   uint16_t entry = queue[index];
+   tail = (index+1)&(QUEUE_SIZE-1);
+
+   uint8_t value = (uint8_t)entry;
+   if (entry&Entry_Pause) {
+      pauseCount = value;
+      return;
+   }
+   if (sliceRemaining>0) {
+      sliceRemaining--;
+   }
+   csHeld = (entry&Entry_HoldCs) != 0;
+
+   // Previous frame ended the queue (EOQ) which stops the SPI until EOQF is cleared
+   spi->spi->SR = SPI_SR_EOQF_MASK|SPI_SR_TCF_MASK;
+
+   // Frame {sync, high nibble, low nibble} or {high nibble, low nibble} within a burst fits in SPI Tx FIFO
+   uint32_t last = csHeld?SPI_PUSHR_CONT_MASK:SPI_PUSHR_EOQ_MASK;
+   if (!(entry&Entry_NoSync)) {
+      spi->spi->PUSHR = pushrValue|SPI_PUSHR_CONT_MASK|((entry&Entry_Data)?0xFA:0xF8);
+   }
+   spi->spi->PUSHR = pushrValue|SPI_PUSHR_CONT_MASK|(value&0xF0);
+   spi->spi->PUSHR = pushrValue|last|((value<<4)&0xF0);
+}
+
+/**
+ * Thread owning the SPI while each slice of the queue is sent
+ */
+void LcdTransport::transportThreadFunction(const void *) {
+   for(;;) {
+      CMSIS::Thread::signalWait(DATA_SIGNAL);
+
+      active = true;
+      do {
+         spi->startTransaction(spiConfig);
+
+         // Prepare SPI for FIFO use
+         spi->spi->MCR |= SPI_MCR_CLR_TXF_MASK|SPI_MCR_CLR_RXF_MASK;
+         spi->spi->SR   = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_TFUF_MASK|SPI_SR_RFOF_MASK|SPI_SR_RFDF_MASK;
+         spi->spi->MCR &= ~SPI_MCR_HALT_MASK;
+
+         // Send slice
+         sliceRemaining = SLICE_SIZE;
+         Timer::configure(INTERVAL, PitChannelIrq_Enable, PitChannelEnable_Enable);
+         CMSIS::Thread::signalWait(DRAINED_SIGNAL);
+
+         // Restore SPI for polled use
+         spi->spi->MCR |= SPI_MCR_HALT_MASK|SPI_MCR_CLR_TXF_MASK|SPI_MCR_CLR_RXF_MASK;
+         spi->spi->SR   = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_TFUF_MASK|SPI_SR_RFOF_MASK|SPI_SR_RFDF_MASK;
+
+         // Other users waiting on the SPI obtain it here
+         spi->endTransaction();
+      } while (active);
+   }
+}
+
+/**
+ * Start the transport\n
+ * Until this is called the LCD must be written synchronously
+ *
+ * @param[in] spi        SPI used by LCD
+ * @param[in] spiConfig  SPI CTAR value used by LCD
+ * @param[in] pinNum     Number of PCS used by LCD
+ */
+void LcdTransport::initialise(Spi &spi, uint32_t spiConfig, int pinNum) {
+   LcdTransport::spiConfig  = spiConfig;
+   LcdTransport::pushrValue = SPI_PUSHR_CTAS(0)|SPI_PUSHR_PCS(1<<pinNum);
+
+   Pit::configure(PitDebugMode_Stop);
+   Timer::setCallback(timerCallback);
+
+   transportThread.run();
+
+   // Enables write()
+   LcdTransport::spi = &spi;
+}
+
+/**
+ * Queue entry for transmission to the LCD.\n
+ * This only blocks if the queue is full.
+ *
+ * @param[in] entry Entry type combined with value e.g. (Entry_Data|0x23)
+ */
+void LcdTransport::write(uint16_t entry) {
+   waitForSpace(1);
+   unsigned index = head;
+   queue[index] = entry;
+   __DMB();
+   head = (index+1)&(QUEUE_SIZE-1);
+   if (!active) {
+      transportThread.signalSet(DATA_SIGNAL);
+   }
+}
+
+/**
+ * Queue a burst of data bytes for transmission to the LCD.\n
+ * The bytes are sent as a single sync byte followed by nibble pairs with CS held asserted.\n
+ * This only blocks if the queue is full.
+ *
+ * @param[in] data  Data bytes to write
+ * @param[in] count Number of bytes [1..MAX_BURST]
+ */
+void LcdTransport::writeBurst(const uint8_t data[], unsigned count) {
+   assert((count>0)&&(count<=MAX_BURST));
+
+   // Burst is published as a whole so the ISR never finds the queue empty while CS is held
+   waitForSpace(count);
+   unsigned index = head;
+   for (unsigned sub=0; sub<count; sub++) {
+      uint16_t entry = Entry_Data|data[sub];
+      if (sub>0) {
+         entry |= Entry_NoSync;
+      }
+      if (sub<(count-1)) {
+         entry |= Entry_HoldCs;
+      }
+      queue[index] = entry;
+      index = (index+1)&(QUEUE_SIZE-1);
+   }
+   __DMB();
+   head = index;
+   if (!active) {
+      transportThread.signalSet(DATA_SIGNAL);
+   }
+}
+
+/**
+ * Wait until the queue has space for the given number of entries
+ *
+ * @param[in] count Number of entries required
+ */
+void LcdTransport::waitForSpace(unsigned count) {
+   // One entry is always left unused to distinguish full from empty
+   while (((tail-head-1)&(QUEUE_SIZE-1)) < count) {
+      // Full - wait for ISR to make space
+      if (!active) {
+         transportThread.signalSet(DATA_SIGNAL);
+      }
+      osDelay(1);
+   }
+}
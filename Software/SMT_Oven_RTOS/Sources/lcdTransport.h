@@ -0,0 +1,158 @@
+/**
+ * @file    lcdTransport.h
+ * @brief   Asynchronous transmit queue for ST7920 LCD
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_LCDTRANSPORT_H_
+#define SOURCES_LCDTRANSPORT_H_
+
+#include <stdint.h>
+#include "spi.h"
+#include "pit.h"
+#include "cmsis.h"
+
+/**
+ * Asynchronous transport for the ST7920 serial interface.
+ *
+ * @verbatim
+ *    Drawing thread ----> Entry queue ----> PIT ISR ----> SPI FIFO
+ *                                             ^
+ *                      Transport thread ------+ (owns SPI while a slice of the queue is sent)
+ * @endverbatim
+ *
+ * The ST7920 requires ~72us between instructions.  Rather than busy-waiting after each
+ * write, commands and data are queued and a PIT interrupt sends one entry each interval.
+ * The transport thread holds the SPI (mutex) while the queue is drained so the bus may be
+ * shared with the thermocouples. The SPI is released after each slice of at most SLICE_SIZE
+ * entries (a complete row) so other users wait at most a few milliseconds for the bus.
+ */
+class LcdTransport {
+
+public:
+   /** Type of queue entry (combined with 8-bit value) */
+   enum EntryType : uint16_t {
+      Entry_Command = 0x000,  //!< Instruction byte
+      Entry_Data    = 0x100,  //!< Data byte
+      Entry_Pause   = 0x200,  //!< Idle for value intervals e.g. after clear
+      Entry_NoSync  = 0x400,  //!< Modifier - continues burst so sync byte is omitted
+      Entry_HoldCs  = 0x800,  //!< Modifier - more bytes follow in burst so CS is held asserted
+   };
+
+   /** Maximum number of bytes in a burst */
+   static constexpr unsigned MAX_BURST = 32;
+
+   /** Interval between entries sent to the LCD (ST7920 instruction time is 72us) */
+   static constexpr float INTERVAL = 80*USBDM::us;
+
+private:
+   /** Maximum number of entries sent before the SPI is released (slice ends between bursts) */
+   static constexpr unsigned SLICE_SIZE = MAX_BURST;
+
+   /** Size of queue - must be a power of 2 */
+   static constexpr unsigned QUEUE_SIZE = 256;
+
+   /** Signal used to wake the transport thread when entries are available */
+   static constexpr int32_t DATA_SIGNAL    = (1<<0);
+
+   /** Signal used by the ISR to indicate the queue has been drained or the slice is complete */
+   static constexpr int32_t DRAINED_SIGNAL = (1<<1);
+
+   /** Stack size for transport thread (bytes) */
+   static constexpr uint32_t STACK_SIZE = 256;
+
+   /** PIT channel pacing the transfers */
+   using Timer = USBDM::PitChannel0;
+
+   /** Queue of entries to send */
+   static uint16_t queue[QUEUE_SIZE];
+
+   /** Index of next free entry (written by producer only) */
+   static volatile unsigned head;
+
+   /** Index of next entry to send (written by ISR only) */
+   static volatile unsigned tail;
+
+   /** Number of intervals remaining for current Entry_Pause */
+   static unsigned pauseCount;
+
+   /** Number of entries remaining in current slice */
+   static unsigned sliceRemaining;
+
+   /** Indicates CS is held asserted by the last frame sent i.e. within a burst */
+   static bool csHeld;
+
+   /** Indicates the queue is being drained (remains set between slices) */
+   static volatile bool active;
+
+   /** SPI used by LCD */
+   static USBDM::Spi *spi;
+
+   /** SPI CTAR value used by LCD */
+   static uint32_t spiConfig;
+
+   /** PUSHR control bits (PCS, CTAS) */
+   static uint32_t pushrValue;
+
+   /** Thread owning the SPI while queue is drained */
+   static CMSIS::Thread transportThread;
+
+   /**
+    * Thread owning the SPI while each slice of the queue is sent
+    */
+   static void transportThreadFunction(const void *);
+
+   /**
+    * PIT callback - sends one entry to the LCD
+    */
+   static void timerCallback();
+
+   /**
+    * Wait until the queue has space for the given number of entries
+    *
+    * @param[in] count Number of entries required
+    */
+   static void waitForSpace(unsigned count);
+
+public:
+   /**
+    * Start the transport\n
+    * Until this is called the LCD must be written synchronously
+    *
+    * @param[in] spi        SPI used by LCD
+    * @param[in] spiConfig  SPI CTAR value used by LCD
+    * @param[in] pinNum     Number of PCS used by LCD
+    */
+   static void initialise(USBDM::Spi &spi, uint32_t spiConfig, int pinNum);
+
+   /**
+    * Indicates if the transport has been started
+    *
+    * @return true => write() may be used
+    */
+   static bool isRunning() {
+      return spi != nullptr;
+   }
+
+   /**
+    * Queue entry for transmission to the LCD.\n
+    * This only blocks if the queue is full.
+    *
+    * @param[in] entry Entry type combined with value e.g. (Entry_Data|0x23)
+    */
+   static void write(uint16_t entry);
+
+   /**
+    * Queue a burst of data bytes for transmission to the LCD.\n
+    * The bytes are sent as a single sync byte followed by nibble pairs with CS held asserted.\n
+    * This only blocks if the queue is full.
+    *
+    * @param[in] data  Data bytes to write
+    * @param[in] count Number of bytes [1..MAX_BURST]
+    */
+   static void writeBurst(const uint8_t data[], unsigned count);
+};
+
+#endif /* SOURCES_LCDTRANSPORT_H_ */
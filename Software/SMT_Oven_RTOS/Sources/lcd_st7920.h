@@ -10,12 +10,11 @@
 
 #include <stdint.h>
 #include <string.h>
-#include <stdarg.h>
-#include <stdio.h>
 #include "fonts.h"
 #include "hardware.h"
 #include "spi.h"
 #include "delay.h"
+#include "lcdTransport.h"
 
 /**
  * Class representing an LCD connected over SPI
@@ -60,6 +59,38 @@ protected:
    /** Frame buffer for graphics mode */
    uint8_t frameBuffer[(LCD_WIDTH*LCD_HEIGHT)/8];
 
+   /** Copy of what has been written to the LCD GDRAM */
+   uint8_t lcdImage[(LCD_WIDTH*LCD_HEIGHT)/8];
+
+   /** Indicates lcdImage reflects LCD GDRAM contents */
+   bool lcdImageValid = false;
+
+   /** Bit-mask of frame buffer rows that may have changed since the last refresh */
+   uint64_t dirtyRows = ~0ULL;
+
+   /** Number of bytes in a frame buffer row */
+   static constexpr int BYTES_PER_ROW = LCD_WIDTH/8;
+
+   /**
+    * Mark a range of frame buffer rows as possibly changed
+    *
+    * @param[in] y1 First row
+    * @param[in] y2 Last row (inclusive)
+    */
+   void markDirty(int y1, int y2) {
+      if (y1<0) {
+         y1 = 0;
+      }
+      if (y2>=LCD_HEIGHT) {
+         y2 = LCD_HEIGHT-1;
+      }
+      if (y1>y2) {
+         return;
+      }
+      uint64_t mask = (y2-y1>=63)?~0ULL:((1ULL<<(y2-y1+1))-1);
+      dirtyRows |= mask<<y1;
+   }
+
    template<typename T> T max(T a, T b) {
       return (a>b)?a:b;
    }
@@ -70,6 +101,10 @@ protected:
     * @param[in] value Command value to write
     */
    void writeCommand(uint8_t value) {
+      if (LcdTransport::isRunning()) {
+         LcdTransport::write(LcdTransport::Entry_Command|value);
+         return;
+      }
       uint8_t data[] = {
             0xF8,
             (uint8_t)(value&0xF0),
@@ -88,6 +123,10 @@ protected:
     * @param[in] value Data value to write
     */
    void writeData(uint8_t value) {
+      if (LcdTransport::isRunning()) {
+         LcdTransport::write(LcdTransport::Entry_Data|value);
+         return;
+      }
       uint8_t data[] = {
             0xFA,
             (uint8_t)(value&0xF0),
@@ -100,8 +139,46 @@ protected:
       USBDM::waitUS(100);
    }
 
+   /**
+    * Write a sequence of data values to LCD.\n
+    * When the transport is running the values are sent as a single burst.
+    *
+    * @param[in] data  Data values to write
+    * @param[in] count Number of values (<= LcdTransport::MAX_BURST)
+    */
+   void writeDataBurst(const uint8_t data[], unsigned count) {
+      if (LcdTransport::isRunning()) {
+         LcdTransport::writeBurst(data, count);
+         return;
+      }
+      // Each byte must be paced when writing synchronously
+      for (unsigned index=0; index<count; index++) {
+         writeData(data[index]);
+      }
+   }
+
+   /**
+    * Idle the LCD interface e.g. while a slow command executes
+    *
+    * @param[in] ms Time to idle in milliseconds
+    */
+   void pause(unsigned ms) {
+      if (LcdTransport::isRunning()) {
+         LcdTransport::write(LcdTransport::Entry_Pause|(uint8_t)((ms*1E-3f)/LcdTransport::INTERVAL+1));
+         return;
+      }
+      USBDM::waitMS(ms);
+   }
 
 public:
+   /**
+    * Start asynchronous transfers to the LCD.\n
+    * Must be called after the RTOS is running.
+    */
+   void startTransport() {
+      LcdTransport::initialise(spi, spiConfig, pinNum);
+   }
+
    /**
     * Initialise the LCD
     */
@@ -123,6 +200,10 @@ public:
       writeCommand(0b00001100); // On/Off(D=1 C=0, B=0)
       writeCommand(0b00000110); // EntryMode(I/D=1,S=0)
 
+      // GDRAM contents unknown so next refresh must write everything
+      lcdImageValid = false;
+      dirtyRows     = ~0ULL;
+
       clear();
    }
 
@@ -144,7 +225,7 @@ public:
       writeCommand(0b00110000); // Basic instruction mode
       writeCommand(0b00000010); // Home
       writeCommand(0b00000001); // Clear
-      USBDM::waitMS(2);
+      pause(2);
    }
 
    /**
@@ -203,38 +284,79 @@ public:
     *
     */
    void clearFrameBuffer() {
-      memset(frameBuffer, invertMask, sizeof(frameBuffer));
+      uint8_t *rowPtr = frameBuffer;
+      for (int row=0; row<LCD_HEIGHT; row++) {
+         // Only rows that actually change need refreshing
+         for (int col=0; col<BYTES_PER_ROW; col++) {
+            if (rowPtr[col] != invertMask) {
+               memset(rowPtr, invertMask, BYTES_PER_ROW);
+               dirtyRows |= 1ULL<<row;
+               break;
+            }
+         }
+         rowPtr += BYTES_PER_ROW;
+      }
       x          = 0;
       y          = 0;
       fontHeight = 0;
    }
+
    /**
-    * Refreshes LCD from frame buffer
+    * Refreshes LCD from frame buffer\n
+    * Only the 16-bit words that differ from the current LCD contents are written.
     */
    void refreshImage() {
-      // Set Extended instructions
-      writeCommand(0b110110);
+      if (!lcdImageValid) {
+         dirtyRows = ~0ULL;
+      }
+      if (dirtyRows == 0) {
+         return;
+      }
+      // Extended instructions are only selected once a changed row is found
+      bool extendedMode = false;
 
-      // Copy image from buffer to LCD
-      const uint8_t *bufPtr = frameBuffer;
-      for (int row=0; row<32; row++) {
-         // Start of internal row
-         writeCommand(0b10000000+row); // Vertical AC5..AC0 = N
-         writeCommand(0b10000000);     // Horizontal AC3..AC0 = 0 => start of row
-         for (int col=0; col<16; col++) {
-            writeData(*bufPtr++);
+      for (int row=0; row<LCD_HEIGHT; row++) {
+         if ((dirtyRows & (1ULL<<row)) == 0) {
+            continue;
          }
-      }
-      for (int row=0; row<32; row++) {
-         // Start of internal row
-         writeCommand(0b10000000+row); // Vertical AC5..AC0 = N
-         writeCommand(0b10000000+8);   // Horizontal AC3..AC0 = 0 => start of row
-         for (int col=0; col<16; col++) {
-            writeData(*bufPtr++);
+         const uint8_t *bufPtr = frameBuffer+(row*BYTES_PER_ROW);
+         uint8_t       *lcdPtr = lcdImage+(row*BYTES_PER_ROW);
+
+         // Find span of changed words (LCD is addressed horizontally in 16-bit words)
+         int firstWord = 0;
+         int lastWord  = (BYTES_PER_ROW/2)-1;
+         if (lcdImageValid) {
+            while ((firstWord<=lastWord) && (memcmp(bufPtr+2*firstWord, lcdPtr+2*firstWord, 2) == 0)) {
+               firstWord++;
+            }
+            if (firstWord>lastWord) {
+               // Row unchanged
+               continue;
+            }
+            while (memcmp(bufPtr+2*lastWord, lcdPtr+2*lastWord, 2) == 0) {
+               lastWord--;
+            }
          }
+         if (!extendedMode) {
+            // Set Extended instructions
+            writeCommand(0b110110);
+            extendedMode = true;
+         }
+         // Upper and lower halves of screen are side-by-side in GDRAM
+         writeCommand(0b10000000+(row&0x1F));                       // Vertical AC5..AC0 = N
+         writeCommand(0b10000000+((row>=32)?8:0)+firstWord);        // Horizontal AC3..AC0 = word
+         int firstCol = 2*firstWord;
+         int count    = 2*(lastWord-firstWord+1);
+         writeDataBurst(bufPtr+firstCol, count);
+         memcpy(lcdPtr+firstCol, bufPtr+firstCol, count);
+      }
+      dirtyRows     = 0;
+      lcdImageValid = true;
+
+      if (extendedMode) {
+         // Set Basic instructions
+         writeCommand(0b110000);
       }
-      // Set Basic instructions
-      writeCommand(0b110000);
    }
 
    /**
@@ -263,6 +385,8 @@ public:
          // Clip at bottom
          height = LCD_HEIGHT-y;
       }
+      markDirty(y, y+height-1);
+
       int offset          = x&0x07;
       int offsetPlusWidth = ((x+width-1)&0x07)+1;
       int startMask = (uint8_t)(0xFF>>offset);
@@ -484,6 +608,8 @@ public:
          // Off screen
          return;
       }
+      markDirty(y1, y2);
+
       uint8_t mask = 0x80>>(x&7);
       int    offset = x>>3;
       for (int yy=y1*(LCD_WIDTH/8); yy<=y2*(LCD_WIDTH/8); yy+=(LCD_WIDTH/8)) {
@@ -506,6 +632,8 @@ public:
          // Off screen
          return;
       }
+      markDirty(y, y);
+
       uint8_t mask = invertMask?0x00:0xFF;
       for (int xx=0; xx<(LCD_WIDTH/8); xx++) {
          frameBuffer[(y*(LCD_WIDTH/8))+xx] = mask;
@@ -527,6 +655,8 @@ public:
          // Off screen
          return;
       }
+      markDirty(y, y);
+
       uint8_t mask    = 0x80>>(x&7);
       int     hOffset = x>>3;
       if (invertMask) {
@@ -536,26 +666,6 @@ public:
          frameBuffer[(y*(LCD_WIDTH/8))+hOffset] |= mask;
       }
    }
-
-   /**
-    * Printf style formatted print\n
-    * The string is printed to the screen at the current x,y location
-    *
-    * @param[in] format Format control string (as for printf())
-    * @param[in] ...    Arguments to print
-    *
-    * @return numbers of chars printed?
-    *
-    * @note Limited to 21 characters ~ 1 line
-    */
-   int printf(const char *format, ...) __attribute__ ((format (printf, 2, 3))) {
-      static char buff[22];
-      va_list args;
-      va_start(args, format);
-      int rc = vsnprintf(buff, sizeof(buff), format, args);
-      putString(buff);
-      return rc;
-   }
 };
 
 #endif /* SOURCES_LCD_ST7920_H_ */
@@ -26,6 +26,8 @@
 #include "usb.h"
 #include "utilities.h"
 #include "EditProfile.h"
+#include "controlLoop.h"
+#include "rtc.h"
 
 class profilesMenu {
 
@@ -70,11 +72,17 @@ public:
 };
 
 void initialise() {
+   // RTC is used to time-stamp archived runs
+   USBDM::Rtc::initialise();
    Buzzer::init();
    OvenFanLed::init();
    HeaterLed::init();
    Spare::enable();
    Spare::setDutyCycle(0);
+   temperatureSensors.initialise();
+   ControlLoop::initialise();
+   RunProfile::initialise();
+   lcd.startTransport();
 }
 
 int main() {
@@ -83,10 +91,10 @@ int main() {
    USBDM::mapAllPins();
 
    if (USBDM::getError() != USBDM::E_NO_ERROR) {
-      char buff[100];
       lcd.clear();
-      lcd.printf("Error in initialisation \n  %s\n", USBDM::getErrorMessage());
-      lcd.putString(buff);
+      lcd.putString("Error in initialisation \n  ");
+      lcd.putString(USBDM::getErrorMessage());
+      lcd.putString("\n");
    }
 
    USBDM::Usb0::initialise();
@@ -88,8 +88,8 @@ void displayBusy() {
    lcd.setInversion(false);  lcd.clearFrameBuffer();
 
    lcd.gotoXY(0, 20);
-   lcd.printf("  Locked for \n");
-   lcd.printf("  Remote use");
+   lcd.putString("  Locked for \n");
+   lcd.putString("  Remote use");
    lcd.refreshImage();
    lcd.setGraphicMode();
 }
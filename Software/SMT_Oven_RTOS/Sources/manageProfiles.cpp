@@ -11,6 +11,9 @@
 #include "lcd_st7920.h"
 #include "configure.h"
 #include "EditProfile.h"
+#include "formatter.h"
+#include "messageBox.h"
+#include "profileLibrary.h"
 
 namespace ManageProfiles {
 
@@ -31,9 +34,142 @@ static void putProfileMenu(const NvSolderProfile &profile) {
    lcd.putSpace(1); lcd.putString("F4"); lcd.putSpace(2); lcd.putString("C"); lcd.putSpace(1);
    lcd.gotoXY(xMenuOffset, yMenuOffset+lcd.FONT_HEIGHT*4);
    lcd.putSpace(1); lcd.putString("S "); lcd.putEnter(); lcd.putSpace(2);
+   lcd.gotoXY(xMenuOffset, yMenuOffset+lcd.FONT_HEIGHT*5);
+   lcd.putSpace(1); lcd.putString("34"); lcd.putSpace(2); lcd.putString("L"); lcd.putSpace(1);
    lcd.setInversion(false);
 }
 
+/**
+ * Draw profile library screen
+ *
+ * @param[in] libraryIndex Library entry to display (-1 if library is empty)
+ * @param[in] profileIndex Index of profile to load into
+ */
+static void drawLibrary(int libraryIndex, unsigned profileIndex) {
+   lcd.setInversion(false);
+   lcd.clearFrameBuffer();
+
+   lcd.gotoXY(8,0);
+   lcd.setInversion(true); lcd.putString(" Profile Library "); lcd.setInversion(false);
+
+   FormattedString<22> buff;
+   lcd.gotoXY(0, 1*lcd.FONT_HEIGHT+2);
+   lcd.putString(buff.writeInt(profileLibrary.getCount()).writeChar('/').writeInt(profileLibrary.getCapacity())
+                     .writeString(" used").toString());
+
+   SolderProfile profile;
+   bool valid = (libraryIndex>=0) && profileLibrary.load(libraryIndex, profile);
+   if (valid) {
+      lcd.gotoXY(0, 2*lcd.FONT_HEIGHT+4);
+      lcd.putString(buff.reset().writeInt(libraryIndex).writeChar(':').writeString(profile.description).toString());
+      lcd.gotoXY(0, 3*lcd.FONT_HEIGHT+4);
+      lcd.putString(buff.reset().writeString("Soak ").writeInt(profile.soakTemp1).writeChar('-')
+                        .writeInt(profile.soakTemp2).writeString("\x7F ").writeInt(profile.soakTime).writeChar('s').toString());
+      lcd.gotoXY(0, 4*lcd.FONT_HEIGHT+4);
+      lcd.putString(buff.reset().writeString("Peak ").writeInt(profile.peakTemp).writeString("\x7F ")
+                        .writeInt(profile.peakDwell).writeChar('s').toString());
+   }
+   else {
+      lcd.gotoXY(0, 3*lcd.FONT_HEIGHT);
+      lcd.putString("Library is empty");
+   }
+   lcd.gotoXY(0, 5*lcd.FONT_HEIGHT+4);
+   lcd.putString(buff.reset().writeString("Load to ").writeInt(profileIndex).toString());
+
+   lcd.gotoXY(8,lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
+   lcd.setInversion(true); lcd.putSpace(4); lcd.putUpArrow();   lcd.putSpace(4); lcd.setInversion(false); lcd.putSpace(6);
+   lcd.setInversion(true); lcd.putSpace(4); lcd.putDownArrow(); lcd.putSpace(4); lcd.setInversion(false); lcd.putSpace(4);
+   if (valid) {
+      lcd.setInversion(true); lcd.putSpace(2); lcd.putString("Ld");  lcd.putSpace(2); lcd.setInversion(false); lcd.putSpace(3);
+      lcd.setInversion(true); lcd.putSpace(2); lcd.putString("Del"); lcd.putSpace(2); lcd.setInversion(false);
+   }
+   lcd.gotoXY(lcd.LCD_WIDTH-4*lcd.FONT_WIDTH-11,lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
+   lcd.setInversion(true); lcd.putSpace(4); lcd.putString("EXIT"); lcd.putSpace(3); lcd.setInversion(false);
+
+   lcd.refreshImage();
+   lcd.setGraphicMode();
+}
+
+/**
+ * Browse profile library and optionally load a profile
+ *
+ * @param[in] profileIndex Index of profile to load into
+ */
+static void libraryMenu(unsigned profileIndex) {
+   if (!RunProfile::isIdle()) {
+      // Flash programming would stall the control loop
+      messageBox("Profile Library", "Not available while\na profile is running", MSG_OK);
+      return;
+   }
+   int libraryIndex = profileLibrary.getNext(-1);
+   bool needUpdate = true;
+
+   for(;;) {
+      if (needUpdate) {
+         drawLibrary(libraryIndex, profileIndex);
+         needUpdate = false;
+      }
+      switch(buttons.getButton()) {
+      case SwitchValue::SW_F1: {
+         int previous = profileLibrary.getPrevious(libraryIndex);
+         if (previous>=0) {
+            libraryIndex = previous;
+            needUpdate   = true;
+         }
+      }
+         break;
+      case SwitchValue::SW_F2: {
+         int next = profileLibrary.getNext(libraryIndex);
+         if (next>=0) {
+            libraryIndex = next;
+            needUpdate   = true;
+         }
+      }
+         break;
+      case SwitchValue::SW_F3: {
+         SolderProfile profile;
+         if ((libraryIndex<0) || !profileLibrary.load(libraryIndex, profile)) {
+            break;
+         }
+         if ((profiles[profileIndex].flags&P_UNLOCKED) == 0) {
+            messageBox("Profile is locked", " Profile cannot be\n changed", MSG_OK);
+            needUpdate = true;
+            break;
+         }
+         FormattedString<100> buff;
+         buff.writeString("Overwrite:\n").writeInt(profileIndex).writeChar(':').writeString(profiles[profileIndex].description);
+         if (messageBox("Load Profile", buff.toString(), MSG_YES_NO) == MSG_IS_YES) {
+            profile.flags |= P_UNLOCKED;
+            profiles[profileIndex] = profile;
+            return;
+         }
+         needUpdate = true;
+      }
+         break;
+      case SwitchValue::SW_F4: {
+         SolderProfile profile;
+         if ((libraryIndex<0) || !profileLibrary.load(libraryIndex, profile)) {
+            break;
+         }
+         FormattedString<100> buff;
+         buff.writeString("Delete:\n").writeInt(libraryIndex).writeChar(':').writeString(profile.description);
+         if (messageBox("Delete Profile", buff.toString(), MSG_YES_NO) == MSG_IS_YES) {
+            profileLibrary.remove(libraryIndex);
+            int next = profileLibrary.getNext(libraryIndex);
+            libraryIndex = (next>=0)?next:profileLibrary.getPrevious(libraryIndex);
+         }
+         needUpdate = true;
+      }
+         break;
+      case SwitchValue::SW_S:
+         return;
+      default:
+         break;
+      }
+      __WFI();
+   }
+}
+
 /**
  * Display profiles for selection or editing
  *
@@ -74,6 +210,10 @@ void profileMenu() {
          CopyProfile::run(profileIndex);
          needUpdate = true;
          break;
+      case SwitchValue::SW_F3F4:
+         libraryMenu(profileIndex);
+         needUpdate = true;
+         break;
       case SwitchValue::SW_S:
          ::currentProfileIndex.operator =(profileIndex);
          return;
@@ -115,24 +115,33 @@ public:
       return enabled;
    }
    /**
-    * Read thermocouple
+    * Get number of PCS signal used by this device
+    *
+    * @return PCS number
+    */
+   int getPinNum() const {
+      return pinNum;
+   }
+
+   /**
+    * Get SPI configuration used to communicate with this device
+    *
+    * @return CTAR value
+    */
+   uint32_t getSpiConfig() const {
+      return spiConfig;
+   }
+
+   /**
+    * Decode raw data frame from thermocouple
     *
+    * @param[in]  data          4 bytes of data read from the MAX31855
     * @param[out] temperature   Temperature reading of external probe (.25 degree resolution)
     * @param[out] coldReference Temperature reading of internal cold-junction reference (.0625 degree resolution)
     *
     * @return status flag
-    *
-    * @note Temperature and cold-junction may be valid even if the thermocouple is disabled (TH_DISABLED).
     */
-   ThermocoupleStatus getReading(float &temperature, float &coldReference) {
-      uint8_t data[] = {
-            0xFF, 0xFF, 0xFF, 0xFF,
-      };
-      spi.startTransaction(spiConfig);
-      spi.setPushrValue(SPI_PUSHR_CTAS(0)|SPI_PUSHR_PCS(1<<pinNum));
-      spi.txRxBytes(sizeof(data), nullptr, data);
-      spi.endTransaction();
-
+   ThermocoupleStatus decode(const uint8_t data[4], float &temperature, float &coldReference) {
       // Temperature = sign-extended 14-bit value
       temperature = (((int16_t)((data[0]<<8)|data[1]))>>2)/4.0;
 
@@ -180,6 +189,28 @@ public:
       return status;
    }
 
+   /**
+    * Read thermocouple
+    *
+    * @param[out] temperature   Temperature reading of external probe (.25 degree resolution)
+    * @param[out] coldReference Temperature reading of internal cold-junction reference (.0625 degree resolution)
+    *
+    * @return status flag
+    *
+    * @note Temperature and cold-junction may be valid even if the thermocouple is disabled (TH_DISABLED).
+    */
+   ThermocoupleStatus getReading(float &temperature, float &coldReference) {
+      uint8_t data[] = {
+            0xFF, 0xFF, 0xFF, 0xFF,
+      };
+      spi.startTransaction(spiConfig);
+      spi.setPushrValue(SPI_PUSHR_CTAS(0)|SPI_PUSHR_PCS(1<<pinNum));
+      spi.txRxBytes(sizeof(data), nullptr, data);
+      spi.endTransaction();
+
+      return decode(data, temperature, coldReference);
+   }
+
    /**
     * Read enabled thermocouple
     *
@@ -0,0 +1,164 @@
+/**
+ * @file    max31855Batch.cpp
+ * @brief   DMA driven batch reading of several MAX31855 sharing a SPI
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#include "max31855Batch.h"
+
+using namespace USBDM;
+
+uint32_t   Max31855Batch::txBuffer[MAX_DEVICES*FRAME_SIZE];
+uint32_t   Max31855Batch::rxBuffer[MAX_DEVICES*FRAME_SIZE];
+osThreadId Max31855Batch::waitingThread = nullptr;
+
+/**
+ * DMA channel 1 interrupt handler (receive channel)
+ */
+extern "C"
+void DMA1_IRQHandler() {
+   Dma0::irq1Handler();
+}
+
+/**
+ * Called from DMA receive channel interrupt on transfer completion
+ */
+void Max31855Batch::dmaCallback() {
+   if (waitingThread != nullptr) {
+      osSignalSet(waitingThread, COMPLETE_SIGNAL);
+   }
+}
+
+/**
+ * Configure DMA controller and build the transmit frames.\n
+ * This should be called before the first read().
+ */
+void Max31855Batch::initialise() {
+   if (numDevices>MAX_DEVICES) {
+      setAndCheckErrorCode(E_ILLEGAL_PARAM);
+      return;
+   }
+   // Each device is read as 4 bytes with PCS held asserted (CONT) between bytes
+   // and released after the last byte.  The last byte of the batch ends the queue (EOQ).
+   uint32_t *pushr = txBuffer;
+   for (unsigned device=0; device<numDevices; device++) {
+      for (unsigned byte=0; byte<FRAME_SIZE; byte++) {
+         uint32_t value = SPI_PUSHR_CTAS(0)|SPI_PUSHR_PCS(1<<devices[device].getPinNum())|0xFF;
+         if (byte<(FRAME_SIZE-1)) {
+            value |= SPI_PUSHR_CONT_MASK;
+         }
+         else if (device == (numDevices-1)) {
+            value |= SPI_PUSHR_EOQ_MASK;
+         }
+         *pushr++ = value;
+      }
+   }
+   // Dma_T::enable() doesn't enable the correct clock
+   *Dma0Info::clockReg |= Dma0Info::clockMask;
+   Dma0::enable();
+
+   DmaMux0::configure(TX_CHANNEL, DmaSlot_SPI0_Transmit);
+   DmaMux0::configure(RX_CHANNEL, DmaSlot_SPI0_Receive);
+
+   Dma0::setCallback(RX_CHANNEL, dmaCallback);
+   Dma0::enableNvicInterrupts(RX_CHANNEL);
+}
+
+/**
+ * Read all devices.\n
+ * The calling thread is blocked but the CPU is free while the transfer takes place.
+ *
+ * @param[out] status         Status of each device
+ * @param[out] temperatures   Temperature of each device
+ * @param[out] coldReferences Cold-junction reference of each device
+ *
+ * @return true  => Success
+ * @return false => Transfer failed to complete - results are not valid
+ */
+bool Max31855Batch::read(
+      Max31855::ThermocoupleStatus status[],
+      float                        temperatures[],
+      float                        coldReferences[]) {
+
+   const unsigned transferCount = numDevices*FRAME_SIZE;
+
+   // Transmit: PUSHR values from buffer -> SPI.PUSHR on each TFFF request
+   static const DmaTcd txTcd = {
+      /* SADDR  */ (uint32_t)(uintptr_t)txBuffer,
+      /* SOFF   */ sizeof(txBuffer[0]),
+      /* ATTR   */ DMA_ATTR_SSIZE(DmaSize_32bit)|DMA_ATTR_DSIZE(DmaSize_32bit),
+      /* NBYTES */ sizeof(txBuffer[0]),
+      /* SLAST  */ 0,
+      /* DADDR  */ 0,
+      /* DOFF   */ 0,
+      /* CITER  */ 0,
+      /* DLAST  */ 0,
+      /* CSR    */ DMA_CSR_DREQ_MASK,
+   };
+   // Receive: SPI.POPR -> buffer on each RFDF request, interrupt when done
+   static const DmaTcd rxTcd = {
+      /* SADDR  */ 0,
+      /* SOFF   */ 0,
+      /* ATTR   */ DMA_ATTR_SSIZE(DmaSize_32bit)|DMA_ATTR_DSIZE(DmaSize_32bit),
+      /* NBYTES */ sizeof(rxBuffer[0]),
+      /* SLAST  */ 0,
+      /* DADDR  */ (uint32_t)(uintptr_t)rxBuffer,
+      /* DOFF   */ sizeof(rxBuffer[0]),
+      /* CITER  */ 0,
+      /* DLAST  */ 0,
+      /* CSR    */ DMA_CSR_DREQ_MASK|DMA_CSR_INTMAJOR_MASK,
+   };
+
+   spi.startTransaction(devices[0].getSpiConfig());
+
+   waitingThread = osThreadGetId();
+   osSignalClear(waitingThread, COMPLETE_SIGNAL);
+
+   DmaTcd tcd = txTcd;
+   tcd.DADDR = (uint32_t)(uintptr_t)&spi.spi->PUSHR;
+   tcd.CITER = transferCount;
+   Dma0::configureTransfer(TX_CHANNEL, tcd);
+
+   tcd = rxTcd;
+   tcd.SADDR = (uint32_t)(uintptr_t)&spi.spi->POPR;
+   tcd.CITER = transferCount;
+   Dma0::configureTransfer(RX_CHANNEL, tcd);
+
+   // Flush FIFOs, clear stale flags and route FIFO requests to DMA
+   spi.spi->MCR |= SPI_MCR_HALT_MASK|SPI_MCR_CLR_TXF_MASK|SPI_MCR_CLR_RXF_MASK;
+   spi.spi->SR   = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK|SPI_SR_TFUF_MASK|SPI_SR_TFFF_MASK|SPI_SR_RFOF_MASK|SPI_SR_RFDF_MASK;
+   spi.spi->RSER = SPI_RSER_TFFF_RE_MASK|SPI_RSER_TFFF_DIRS_MASK|SPI_RSER_RFDF_RE_MASK|SPI_RSER_RFDF_DIRS_MASK;
+
+   Dma0::enableRequests(RX_CHANNEL);
+   Dma0::enableRequests(TX_CHANNEL);
+
+   // Start SPI
+   spi.spi->MCR &= ~SPI_MCR_HALT_MASK;
+
+   osEvent event = osSignalWait(COMPLETE_SIGNAL, TIMEOUT_MS);
+
+   // Restore SPI for polled use
+   spi.spi->MCR |= SPI_MCR_HALT_MASK;
+   spi.spi->RSER = 0;
+   spi.spi->SR   = SPI_SR_TCF_MASK|SPI_SR_EOQF_MASK;
+   Dma0::enableRequests(TX_CHANNEL, false);
+   Dma0::enableRequests(RX_CHANNEL, false);
+   waitingThread = nullptr;
+
+   spi.endTransaction();
+
+   if (event.status != osEventSignal) {
+      // Transfer didn't complete
+      return false;
+   }
+   for (unsigned device=0; device<numDevices; device++) {
+      uint8_t data[FRAME_SIZE];
+      for (unsigned byte=0; byte<FRAME_SIZE; byte++) {
+         data[byte] = rxBuffer[device*FRAME_SIZE+byte];
+      }
+      status[device] = devices[device].decode(data, temperatures[device], coldReferences[device]);
+   }
+   return true;
+}
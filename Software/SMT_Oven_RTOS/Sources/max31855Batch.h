@@ -0,0 +1,106 @@
+/**
+ * @file    max31855Batch.h
+ * @brief   DMA driven batch reading of several MAX31855 sharing a SPI
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_MAX31855BATCH_H_
+#define SOURCES_MAX31855BATCH_H_
+
+#include "dma.h"
+#include "cmsis.h"
+#include "Max31855.h"
+
+/**
+ * Reads a group of MAX31855 in a single SPI transaction using DMA.
+ *
+ * The frames for all devices are prepared in advance as SPI PUSHR values (data + PCS + CONT/EOQ)
+ * and are transferred to the SPI by one DMA channel while a second DMA channel
+ * collects the received data.  The calling thread sleeps until the receive channel
+ * signals completion from its major-loop interrupt.
+ *
+ * @note The devices must share the same SPI and SPI configuration.
+ */
+class Max31855Batch {
+
+public:
+   /** Maximum number of devices in a batch */
+   static constexpr unsigned MAX_DEVICES = 4;
+
+   /** Size of data frame for each device */
+   static constexpr unsigned FRAME_SIZE  = 4;
+
+private:
+   /** DMA channel used to write PUSHR */
+   static constexpr USBDM::DmaChannelNum TX_CHANNEL = USBDM::DmaChannelNum_0;
+
+   /** DMA channel used to read POPR */
+   static constexpr USBDM::DmaChannelNum RX_CHANNEL = USBDM::DmaChannelNum_1;
+
+   /** Signal used to indicate completion to waiting thread */
+   static constexpr int32_t COMPLETE_SIGNAL = (1<<0);
+
+   /** How long to wait for transfer to complete before giving up (ms) */
+   static constexpr uint32_t TIMEOUT_MS = 5;
+
+   /** PUSHR values to send (one per byte) */
+   static uint32_t txBuffer[MAX_DEVICES*FRAME_SIZE];
+
+   /** POPR values received (one per byte) */
+   static uint32_t rxBuffer[MAX_DEVICES*FRAME_SIZE];
+
+   /** Thread waiting on transfer complete */
+   static osThreadId waitingThread;
+
+   /**
+    * Called from DMA receive channel interrupt on transfer completion
+    */
+   static void dmaCallback();
+
+   /** SPI shared by devices */
+   USBDM::Spi &spi;
+
+   /** Devices to read */
+   Max31855 * const devices;
+
+   /** Number of devices to read */
+   const unsigned numDevices;
+
+public:
+   /**
+    * Constructor
+    *
+    * @param[in] spi        SPI shared by the devices
+    * @param[in] devices    Array of devices to read as a batch
+    * @param[in] numDevices Number of devices in array (<= MAX_DEVICES)
+    */
+   Max31855Batch(USBDM::Spi &spi, Max31855 devices[], unsigned numDevices) :
+      spi(spi), devices(devices), numDevices(numDevices) {
+   }
+
+   /**
+    * Configure DMA controller and build the transmit frames.\n
+    * This should be called before the first read().
+    */
+   void initialise();
+
+   /**
+    * Read all devices.\n
+    * The calling thread is blocked but the CPU is free while the transfer takes place.
+    *
+    * @param[out] status         Status of each device
+    * @param[out] temperatures   Temperature of each device
+    * @param[out] coldReferences Cold-junction reference of each device
+    *
+    * @return true  => Success
+    * @return false => Transfer failed to complete - results are not valid
+    */
+   bool read(
+         Max31855::ThermocoupleStatus status[],
+         float                        temperatures[],
+         float                        coldReferences[]);
+};
+
+#endif /* SOURCES_MAX31855BATCH_H_ */
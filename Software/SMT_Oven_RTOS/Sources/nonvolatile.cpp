@@ -0,0 +1,261 @@
+/**
+ * @file    nonvolatile.cpp
+ * @brief   RAM shadow of the non-volatile variables in FlexRAM
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <string.h>
+
+#include "cmsis.h"
+#include "ftfl.h"
+
+namespace USBDM {
+
+/** Indicates the shadow has been loaded from FlexRAM */
+volatile bool     NonvolatileShadow::fLoaded           = false;
+
+/** Nesting depth of the transaction opened by the thread holding the mutex */
+unsigned          NonvolatileShadow::fTransactionDepth = 0;
+
+/** Start of range modified by transaction (word offset) */
+unsigned          NonvolatileShadow::fDirtyStart       = ~0U;
+
+/** End of range modified by transaction (word offset, exclusive) */
+unsigned          NonvolatileShadow::fDirtyEnd         = 0;
+
+/** Number of writes to FlexRAM */
+volatile uint32_t NonvolatileShadow::fWrites           = 0;
+
+/** Number of bytes written to FlexRAM */
+volatile uint32_t NonvolatileShadow::fBytesWritten     = 0;
+
+/** Number of writes discarded as value was unchanged */
+volatile uint32_t NonvolatileShadow::fUnchanged        = 0;
+
+/** Number of transactions committed */
+volatile uint32_t NonvolatileShadow::fCommits          = 0;
+
+/** Counters for writes to individual variables */
+NonvolatileWriteCounter *NonvolatileShadow::fCounters  = nullptr;
+
+/** Number of counters */
+unsigned          NonvolatileShadow::fNumCounters      = 0;
+
+/**
+ * Mutex serialising changes to the non-volatile variables\n
+ * Created on first use as the variables are initialised by static constructors (Settings).
+ */
+static CMSIS::Mutex &getMutex() {
+   static CMSIS::Mutex mutex;
+   return mutex;
+}
+
+/**
+ * Obtain mutex serialising changes (may be nested)
+ */
+void NonvolatileShadow::lock() {
+   getMutex().wait();
+}
+
+/**
+ * Release mutex serialising changes
+ */
+void NonvolatileShadow::unlock() {
+   getMutex().release();
+}
+
+/**
+ * Load shadow from FlexRAM\n
+ * This must be called once the FlexRAM is available i.e. after Flash::initialiseEeprom()
+ * and before any non-volatile variable is accessed.
+ */
+void NonvolatileShadow::load() {
+   lock();
+   Flash::waitForFlashReady();
+   memcpy(__flexRAM_shadow__, __flexRAM_start__, __flexRAM_end__-__flexRAM_start__);
+   if (!fLoaded) {
+      memset(__flexRAM_counts__, 0, (__flexRAM_end__-__flexRAM_start__)/sizeof(uint32_t)*sizeof(uint16_t));
+   }
+   fLoaded = true;
+   unlock();
+}
+
+/**
+ * Record write to FlexRAM\n
+ * The write is counted for each variable with a byte that changed.
+ *
+ * @param[in] offset  Byte offset of write
+ * @param[in] size    Size of write in bytes (1, 2 or 4)
+ * @param[in] changed Mask of bytes changed by the write (bit 0 => byte at offset)
+ */
+void NonvolatileShadow::recordWrite(unsigned offset, unsigned size, unsigned changed) {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   fWrites       = fWrites + 1;
+   fBytesWritten = fBytesWritten + size;
+   uint16_t &count = __flexRAM_counts__[offset/sizeof(uint32_t)];
+   if (count<UINT16_MAX) {
+      count++;
+   }
+   for (unsigned index=0; index<fNumCounters; index++) {
+      NonvolatileWriteCounter &counter = fCounters[index];
+      unsigned start = (const uint8_t *)counter.address - __flexRAM_start__;
+      for (unsigned byte=0; byte<size; byte++) {
+         if (((changed&(1<<byte)) != 0) && (offset+byte>=start) && (offset+byte<start+counter.size)) {
+            counter.writes++;
+            break;
+         }
+      }
+   }
+   __set_PRIMASK(primask);
+}
+
+/**
+ * Set counters for writes to individual variables\n
+ * A write to FlexRAM is counted for each variable it changes. Variables sharing a
+ * FlexRAM word are counted separately.
+ *
+ * @param[in] counters    Counters (address and size set, writes cleared)
+ * @param[in] numCounters Number of counters
+ */
+void NonvolatileShadow::setWriteCounters(NonvolatileWriteCounter counters[], unsigned numCounters) {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   fCounters    = counters;
+   fNumCounters = numCounters;
+   __set_PRIMASK(primask);
+}
+
+/**
+ * Get write statistics
+ *
+ * @param[out] statistics Statistics since last reset
+ */
+void NonvolatileShadow::getStatistics(NonvolatileStatistics &statistics) {
+   statistics.writes       = fWrites;
+   statistics.bytesWritten = fBytesWritten;
+   statistics.unchanged    = fUnchanged;
+   statistics.commits      = fCommits;
+   Flash::getStallStatistics(statistics.stalls, statistics.stallTime, statistics.maxStall);
+}
+
+/**
+ * Get number of writes to a non-volatile variable
+ *
+ * @param[in]  nvAddress     Address of variable in FlexRAM
+ * @param[in]  size          Size of variable in bytes
+ * @param[out] maxWordWrites Largest number of writes to a single FlexRAM word occupied by
+ *                           the variable. This is wear and includes writes to other variables
+ *                           sharing the word.
+ *
+ * @return Writes to FlexRAM that changed the variable (0 if it has no counter)
+ */
+uint32_t NonvolatileShadow::getWriteCount(const void *nvAddress, unsigned size, unsigned &maxWordWrites) {
+   unsigned offset = (const uint8_t *)nvAddress - __flexRAM_start__;
+   unsigned start  = offset/sizeof(uint32_t);
+   unsigned end    = (offset+size+sizeof(uint32_t)-1)/sizeof(uint32_t);
+   maxWordWrites = 0;
+   for (unsigned index=start; index<end; index++) {
+      unsigned count = __flexRAM_counts__[index];
+      if (count>maxWordWrites) {
+         maxWordWrites = count;
+      }
+   }
+   for (unsigned index=0; index<fNumCounters; index++) {
+      if ((fCounters[index].address == nvAddress) && (fCounters[index].size == size)) {
+         return fCounters[index].writes;
+      }
+   }
+   return 0;
+}
+
+/**
+ * Clear write statistics including the Flash controller wait statistics
+ */
+void NonvolatileShadow::resetStatistics() {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   fWrites       = 0;
+   fBytesWritten = 0;
+   fUnchanged    = 0;
+   fCommits      = 0;
+   memset(__flexRAM_counts__, 0, (__flexRAM_end__-__flexRAM_start__)/sizeof(uint32_t)*sizeof(uint16_t));
+   for (unsigned index=0; index<fNumCounters; index++) {
+      fCounters[index].writes = 0;
+   }
+   __set_PRIMASK(primask);
+   Flash::resetStallStatistics();
+}
+
+/**
+ * Record range of shadow modified by transaction\n
+ * Called with the mutex held.
+ *
+ * @param[in] offset Byte offset of change
+ * @param[in] size   Size of change in bytes
+ */
+void NonvolatileShadow::markDirty(unsigned offset, unsigned size) {
+   unsigned start = offset/sizeof(uint32_t);
+   unsigned end   = (offset+size+sizeof(uint32_t)-1)/sizeof(uint32_t);
+
+   if (start<fDirtyStart) {
+      fDirtyStart = start;
+   }
+   if (end>fDirtyEnd) {
+      fDirtyEnd = end;
+   }
+}
+
+/**
+ * Open transaction (may be nested)\n
+ * Waits while another thread has a transaction open.
+ * The mutex is held until the outermost transaction is committed.
+ */
+void NonvolatileShadow::beginTransaction() {
+   lock();
+   fTransactionDepth++;
+}
+
+/**
+ * Close transaction\n
+ * Changes are written to FlexRAM when the outermost transaction is closed.
+ * Only words that differ from the FlexRAM contents are written.
+ *
+ * @return Number of words written to FlexRAM
+ */
+unsigned NonvolatileShadow::commitTransaction() {
+   assert(fTransactionDepth>0);
+   if (--fTransactionDepth>0) {
+      unlock();
+      return 0;
+   }
+   // Region is word aligned and a multiple of words in size (see linker script)
+   volatile uint32_t *nvWords     = (volatile uint32_t *)__flexRAM_start__;
+   const uint32_t    *shadowWords = (const uint32_t *)__flexRAM_shadow__;
+   unsigned written = 0;
+   for (unsigned index=fDirtyStart; index<fDirtyEnd; index++) {
+      Flash::waitForFlashReady();
+      uint32_t before = nvWords[index];
+      if (before != shadowWords[index]) {
+         nvWords[index] = shadowWords[index];
+         // Bytes changed (FlexRAM is little-endian)
+         unsigned changed = 0;
+         for (unsigned byte=0; byte<sizeof(uint32_t); byte++) {
+            if (((before^shadowWords[index])>>(8*byte))&0xFF) {
+               changed |= 1<<byte;
+            }
+         }
+         recordWrite(index*sizeof(uint32_t), sizeof(uint32_t), changed);
+         written++;
+      }
+   }
+   Flash::waitForFlashReady();
+   fDirtyStart = ~0U;
+   fDirtyEnd   = 0;
+   fCommits    = fCommits + 1;
+   unlock();
+   return written;
+}
+
+} // namespace USBDM
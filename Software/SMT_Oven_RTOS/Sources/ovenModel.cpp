@@ -0,0 +1,98 @@
+/**
+ * @file    ovenModel.cpp
+ * @brief   Thermal model of oven used for simulation
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#if defined(OVEN_SIMULATION)
+
+#include <math.h>
+#include "ovenModel.h"
+#include "configure.h"
+
+float    OvenModel::elementTemperature = OvenModel::AMBIENT;
+float    OvenModel::ovenTemperature    = OvenModel::AMBIENT;
+uint32_t OvenModel::lastUpdate         = 0;
+uint32_t OvenModel::noiseSeed          = 1;
+
+/**
+ * Reset model to ambient conditions
+ */
+void OvenModel::reset() {
+   elementTemperature = AMBIENT;
+   ovenTemperature    = AMBIENT;
+   lastUpdate         = osKernelSysTick();
+   noiseSeed          = 1;
+}
+
+/**
+ * Advance model
+ *
+ * @param[in] interval Time step (s)
+ * @param[in] heater   Heater duty-cycle (%)
+ * @param[in] fan      Fan duty-cycle (%)
+ */
+void OvenModel::step(float interval, float heater, float fan) {
+   float elementFlow = K_ELEMENT*(elementTemperature-ovenTemperature);
+   float lossFlow    = (K_LOSS + K_FAN*fan/100)*(ovenTemperature-AMBIENT);
+
+   elementTemperature += interval*(HEATER_POWER*heater/100 - elementFlow)/C_ELEMENT;
+   ovenTemperature    += interval*(elementFlow - lossFlow)/C_OVEN;
+}
+
+/**
+ * Get deterministic pseudo-random noise
+ *
+ * @return Noise in range [-0.5, 0.5)
+ */
+float OvenModel::noise() {
+   // Numerical Recipes LCG
+   noiseSeed = 1664525*noiseSeed + 1013904223;
+   return (noiseSeed>>8)/(float)(1<<24) - 0.5f;
+}
+
+/**
+ * Update the model to the current time and obtain simulated MAX31855 frames.\n
+ * Thermocouples 1 & 2 are present, 3 & 4 appear as open-circuit.
+ *
+ * @param[out] frames Raw 32-bit MAX31855 frames for each thermocouple
+ */
+void OvenModel::getFrames(uint8_t frames[NUM_THERMOCOUPLES][FRAME_SIZE]) {
+   uint32_t now = osKernelSysTick();
+   if (lastUpdate == 0) {
+      lastUpdate = now;
+   }
+   float elapsed = (uint32_t)(now-lastUpdate)/(float)osKernelSysTickMicroSec(1000000U);
+   lastUpdate = now;
+
+   float heater = ovenControl.getHeaterDutycycle();
+   float fan    = ovenControl.getFanDutycycle();
+   while (elapsed>0) {
+      float interval = (elapsed>MAX_STEP)?MAX_STEP:elapsed;
+      step(interval, heater, fan);
+      elapsed -= interval;
+   }
+   float coldReference = AMBIENT + CASE_COUPLING*(ovenTemperature-AMBIENT);
+
+   for (unsigned t=0; t<NUM_THERMOCOUPLES; t++) {
+      // Probes see slightly different temperatures
+      float temperature = ovenTemperature + t + noise();
+
+      // Temperature: 14-bit 0.25 degree, Cold junction: 12-bit 0.0625 degree
+      int16_t rawTemperature   = (int16_t)lroundf(temperature*4)<<2;
+      int16_t rawColdReference = (int16_t)lroundf(coldReference*16)<<4;
+      if (t>=2) {
+         // Open circuit
+         rawTemperature   |= 0x01;
+         rawColdReference |= 0x01;
+      }
+      frames[t][0] = rawTemperature>>8;
+      frames[t][1] = rawTemperature;
+      frames[t][2] = rawColdReference>>8;
+      frames[t][3] = rawColdReference;
+   }
+}
+
+#endif // defined(OVEN_SIMULATION)
@@ -0,0 +1,118 @@
+/**
+ * @file    ovenModel.h
+ * @brief   Thermal model of oven used for simulation
+ *
+ * When the firmware is built with OVEN_SIMULATION defined the thermocouple
+ * readings are generated by this model rather than read from the MAX31855s.
+ * The model is driven by the heater and fan duty-cycles set by the controller
+ * so the complete control path (PID, profile sequencing, logging, plotting and
+ * remote interface) may be exercised on a bare board without an oven.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_OVENMODEL_H_
+#define SOURCES_OVENMODEL_H_
+
+#include <stdint.h>
+
+/**
+ * Lumped-parameter thermal model of the oven
+ *
+ * @verbatim
+ *   Heater ---> [Element Ce] --kElement--> [Oven Co] --(kLoss + kFan*fan)--> Ambient
+ * @endverbatim
+ *
+ * The model state is advanced using the time elapsed since the previous update.
+ */
+class OvenModel {
+
+public:
+   /** Number of thermocouples simulated */
+   static constexpr unsigned NUM_THERMOCOUPLES = 4;
+
+   /** Size of MAX31855 frame */
+   static constexpr unsigned FRAME_SIZE        = 4;
+
+private:
+   /** Ambient temperature (C) */
+   static constexpr float AMBIENT        = 25.0;
+
+   /** Heater power at 100% (W) */
+   static constexpr float HEATER_POWER   = 800.0;
+
+   /** Thermal capacity of heater elements (J/K) */
+   static constexpr float C_ELEMENT      = 100.0;
+
+   /** Thermal capacity of oven chamber and load (J/K) */
+   static constexpr float C_OVEN         = 200.0;
+
+   /** Conductance element to chamber (W/K) */
+   static constexpr float K_ELEMENT      = 15.0;
+
+   /** Conductance chamber to ambient with fan off (W/K) */
+   static constexpr float K_LOSS         = 1.0;
+
+   /** Additional conductance chamber to ambient with fan at 100% (W/K) */
+   static constexpr float K_FAN          = 4.0;
+
+   /** Rise of cold-junction (case) temperature above ambient per degree of oven rise */
+   static constexpr float CASE_COUPLING  = 0.05;
+
+   /** Maximum integration step (s) */
+   static constexpr float MAX_STEP       = 0.1;
+
+   /** Element temperature (C) */
+   static float elementTemperature;
+
+   /** Chamber temperature (C) */
+   static float ovenTemperature;
+
+   /** Time of last update (kernel ticks) */
+   static uint32_t lastUpdate;
+
+   /** State of pseudo-random noise generator */
+   static uint32_t noiseSeed;
+
+   /**
+    * Advance model
+    *
+    * @param[in] interval Time step (s)
+    * @param[in] heater   Heater duty-cycle (%)
+    * @param[in] fan      Fan duty-cycle (%)
+    */
+   static void step(float interval, float heater, float fan);
+
+   /**
+    * Get deterministic pseudo-random noise
+    *
+    * @return Noise in range [-0.5, 0.5)
+    */
+   static float noise();
+
+public:
+   /**
+    * Reset model to ambient conditions
+    */
+   static void reset();
+
+   /**
+    * Get oven chamber temperature
+    *
+    * @return Temperature (C)
+    */
+   static float getOvenTemperature() {
+      return ovenTemperature;
+   }
+
+   /**
+    * Update the model to the current time and obtain simulated MAX31855 frames.\n
+    * Thermocouples 1 & 2 are present, 3 & 4 appear as open-circuit.
+    *
+    * @param[out] frames Raw 32-bit MAX31855 frames for each thermocouple
+    */
+   static void getFrames(uint8_t frames[NUM_THERMOCOUPLES][FRAME_SIZE]);
+};
+
+#endif /* SOURCES_OVENMODEL_H_ */
@@ -1,6 +1,6 @@
 /**
  * @file    pid.h
- * @brief   PID Controller using CMSIS TimerClass
+ * @brief   PID Controller
  *
  *  Created on: 10 Jul 2016
  *      Author: podonoghue
@@ -10,6 +10,8 @@
 #define PROJECT_HEADERS_PID_H_
 
 #include <time.h>
+#include <math.h>
+#include <stdint.h>
 #include "cmsis.h"
 #include "pid.h"
 
@@ -19,35 +21,140 @@ public:
    typedef void   OutFunction(float);
 };
 
+/**
+ * PID numeric policy - double precision floating point\n
+ * This is done in software on the Cortex-M4
+ */
+struct PidDouble {
+   using Value = double;
+
+   static Value fromFloat(float value) {
+      return value;
+   }
+   static float toFloat(Value value) {
+      return value;
+   }
+   static Value multiply(Value left, Value right) {
+      return left*right;
+   }
+   static Value add(Value left, Value right) {
+      return left+right;
+   }
+   static Value subtract(Value left, Value right) {
+      return left-right;
+   }
+};
+
+/**
+ * PID numeric policy - single precision floating point\n
+ * This uses the Cortex-M4 FPU
+ */
+struct PidFloat {
+   using Value = float;
+
+   static Value fromFloat(float value) {
+      return value;
+   }
+   static float toFloat(Value value) {
+      return value;
+   }
+   static Value multiply(Value left, Value right) {
+      return left*right;
+   }
+   static Value add(Value left, Value right) {
+      return left+right;
+   }
+   static Value subtract(Value left, Value right) {
+      return left-right;
+   }
+};
+
+/**
+ * PID numeric policy - Q16.16 signed fixed point\n
+ * Values are saturated to the representable range [-32768, 32768).\n
+ * NAN is converted to zero.
+ */
+struct PidFixed {
+   using Value = int32_t;
+
+   /** Number of fractional bits */
+   static constexpr int   FRACTION_BITS = 16;
+
+   /** Scale factor between float and fixed point */
+   static constexpr float SCALE         = (1<<FRACTION_BITS);
+
+   static Value saturate(int64_t value) {
+      if (value>INT32_MAX) {
+         return INT32_MAX;
+      }
+      if (value<INT32_MIN) {
+         return INT32_MIN;
+      }
+      return (Value)value;
+   }
+   static Value fromFloat(float value) {
+      if (isnan(value)) {
+         return 0;
+      }
+      value *= SCALE;
+      if (value>=(float)INT32_MAX) {
+         return INT32_MAX;
+      }
+      if (value<=(float)INT32_MIN) {
+         return INT32_MIN;
+      }
+      return (Value)lroundf(value);
+   }
+   static float toFloat(Value value) {
+      return value/SCALE;
+   }
+   static Value multiply(Value left, Value right) {
+      return saturate(((int64_t)left*right)>>FRACTION_BITS);
+   }
+   static Value add(Value left, Value right) {
+      return saturate((int64_t)left+right);
+   }
+   static Value subtract(Value left, Value right) {
+      return saturate((int64_t)left-right);
+   }
+};
+
 /**
  * PID Controller
- * Makes use of CMSIS TimerClass
+ * The controller does not have its own timer.  update() and actuate() must be called
+ * at the sample interval e.g. by the control loop.
  *
  * These template parameters connect the PID controller to the input and output functions
  * @tparam inputFn      Input function  - used to obtain value of system state
  * @tparam outputFn     Output function - used to control the output variable
+ * @tparam Numeric      Numeric policy used for internal calculations e.g. PidFloat, PidFixed, PidDouble
+ *
+ * @note All arithmetic on controller values goes through the policy so PidFixed saturates
+ *       rather than wrapping.
  */
-template<Pid::InFunction inputFn, Pid::OutFunction outputFn>
-class Pid_T : private Pid, private CMSIS::TimerClass {
+template<Pid::InFunction inputFn, Pid::OutFunction outputFn, typename Numeric=PidFloat>
+class Pid_T : private Pid {
 
 private:
-   const double interval;     //! Interval for sampling
-   const double outMin;       //! Minimum limit for output
-   const double outMax;       //! Maximum limit for output
+   using Value = typename Numeric::Value;
+
+   const float interval;      //! Interval for sampling
+   const Value outMin;        //! Minimum limit for output
+   const Value outMax;        //! Maximum limit for output
 
-   double kp;                 //! Proportional Tuning Parameter
-   double ki;                 //! Integral Tuning Parameter
-   double kd;                 //! Derivative Tuning Parameter
+   Value  kp;                 //! Proportional Tuning Parameter
+   Value  ki;                 //! Integral Tuning Parameter
+   Value  kd;                 //! Derivative Tuning Parameter
 
    bool   enabled;            //! Enable for controller
 
-   double integral;           //! Integral accumulation term
+   Value  integral;           //! Integral accumulation term
 
-   double lastInput;          //! Last input sample
-   double currentInput;       //! Current input sample
-   double currentOutput;      //! Current output
-   double setpoint;           //! Set-point for controller
-   double currentError;       //! Current error calculation
+   Value  lastInput;          //! Last input sample
+   Value  currentInput;       //! Current input sample
+   Value  currentOutput;      //! Current output
+   Value  setpoint;           //! Set-point for controller
+   Value  currentError;       //! Current error calculation
 
    unsigned tickCount = 0;    //! Time in ticks since last enabled
 
@@ -62,8 +169,10 @@ public:
     * @param[in] outMin      Minimum value of output variable
     * @param[in] outMax      Maximum value of output variable
     */
-   Pid_T(double Kp, double Ki, double Kd, double interval, double outMin, double outMax) :
-      interval(interval), outMin(outMin), outMax(outMax), enabled(false) {
+   Pid_T(float Kp, float Ki, float Kd, float interval, float outMin, float outMax) :
+      interval(interval), outMin(Numeric::fromFloat(outMin)), outMax(Numeric::fromFloat(outMax)), enabled(false),
+      integral(Numeric::fromFloat(0)), currentOutput(Numeric::fromFloat(0)),
+      setpoint(Numeric::fromFloat(0)), currentError(Numeric::fromFloat(0)) {
       setTunings(Kp, Ki, Kd);
    }
 
@@ -83,15 +192,11 @@ public:
       if (enable) {
          if (!enabled) {
             // Just enabled
-            currentInput = inputFn();
+            currentInput = Numeric::fromFloat(inputFn());
             integral     = 0; //currentOutput;
             tickCount    = 0;
-            start(interval);
          }
       }
-      else {
-         stop();
-      }
       enabled = enable;
    }
 
@@ -118,7 +223,7 @@ public:
     *
     * @return Elapsed time
     */
-   double getElapsedTime() {
+   float getElapsedTime() {
       return (tickCount*interval);
    }
 
@@ -129,13 +234,13 @@ public:
     * @param[in] Ki Integral constant
     * @param[in] Kd Differential constant
     */
-   void setTunings(double Kp, double Ki, double Kd) {
+   void setTunings(float Kp, float Ki, float Kd) {
       if ((Kp<0) || (Ki<0) || (Kd<0)) {
          USBDM::setAndCheckErrorCode(USBDM::E_ILLEGAL_PARAM);
       }
-      kp = Kp;
-      ki = Ki * interval;
-      kd = Kd / interval;
+      kp = Numeric::fromFloat(Kp);
+      ki = Numeric::fromFloat(Ki * interval);
+      kd = Numeric::fromFloat(Kd / interval);
    }
 
    /**
@@ -143,8 +248,8 @@ public:
     *
     * @param[in] value Value to set
     */
-   void setSetpoint(double value) {
-      setpoint = value;
+   void setSetpoint(float value) {
+      setpoint = Numeric::fromFloat(value);
    }
 
    /**
@@ -152,8 +257,8 @@ public:
     *
     * @return Current setpoint
     */
-   double getSetpoint() {
-      return setpoint;
+   float getSetpoint() {
+      return Numeric::toFloat(setpoint);
    }
 
    /**
@@ -161,8 +266,8 @@ public:
     *
     * @return Last input sample
     */
-   double getInput() {
-      return currentInput;
+   float getInput() {
+      return Numeric::toFloat(currentInput);
    }
 
    /**
@@ -170,8 +275,8 @@ public:
     *
     * @return Last output sample
     */
-   double getOutput() {
-      return currentOutput;
+   float getOutput() {
+      return Numeric::toFloat(currentOutput);
    }
 
    /**
@@ -179,42 +284,42 @@ public:
     *
     * @return Last error calculation
     */
-   double getError() {
-      return currentError;
+   float getError() {
+      return Numeric::toFloat(currentError);
    }
 
    /**
     * Get proportional control factor
     *
-    * @return factor as double
+    * @return factor as float
     */
-   double getKp() {
-      return  kp;
+   float getKp() {
+      return  Numeric::toFloat(kp);
    }
    /**
     * Get integral control factor
     *
-    * @return factor as double
+    * @return factor as float
     */
-   double getKi() {
-      return  ki/interval;
+   float getKi() {
+      return  Numeric::toFloat(ki)/interval;
    }
    /**
     * Get differential control factor
     *
-    * @return factor as double
+    * @return factor as float
     */
-   double getKd() {
-      return  kd*interval;
+   float getKd() {
+      return  Numeric::toFloat(kd)*interval;
    }
 
-private:
    /**
-    * Main PID calculation
+    * Main PID calculation\n
+    * Must be executed at \ref interval.  The output is not applied until actuate() is called.
     *
-    * Executed at \ref interval by Timer callback
+    * @param[in] input Current value of system state
     */
-   void callback() override {
+   void update(float input) {
       if(!enabled) {
          return;
       }
@@ -223,27 +328,45 @@ private:
 
       // Update input samples & error
       lastInput    = currentInput;
-      currentInput = inputFn();
-      currentError = setpoint - currentInput;
+      currentInput = Numeric::fromFloat(input);
+      currentError = Numeric::subtract(setpoint, currentInput);
 
-      integral += (ki * currentError);
+      integral = Numeric::add(integral, Numeric::multiply(ki, currentError));
       if(integral > outMax) {
          integral = outMax;
       }
       else if(integral < outMin) {
          integral = outMin;
       }
-      double deltaInput = (currentInput - lastInput);
+      Value deltaInput = Numeric::subtract(currentInput, lastInput);
 
-      currentOutput = kp * currentError + integral - kd * deltaInput;
+      currentOutput = Numeric::subtract(
+            Numeric::add(Numeric::multiply(kp, currentError), integral),
+            Numeric::multiply(kd, deltaInput));
       if(currentOutput > outMax) {
          currentOutput = outMax;
       }
       else if(currentOutput < outMin) {
          currentOutput = outMin;
       }
-      // Update output
-      outputFn(currentOutput);
+   }
+
+   /**
+    * Main PID calculation using input function\n
+    * Must be executed at \ref interval.  The output is not applied until actuate() is called.
+    */
+   void update() {
+      update(inputFn());
+   }
+
+   /**
+    * Apply output calculated by update() using the output function
+    */
+   void actuate() {
+      if(!enabled) {
+         return;
+      }
+      outputFn(Numeric::toFloat(currentOutput));
    }
 
 };
@@ -10,8 +10,10 @@
 #include <algorithm>    // std::max
 #include <plotting.h>
 #include <TemperaturePlot.h>
+#include <profileTrajectory.h>
 #include "lcd_st7920.h"
 #include "configure.h"
+#include "formatter.h"
 
 /**
  * Functions associated with drawing profiles and related
@@ -28,7 +30,7 @@ static constexpr int NAME_OFFSET_Y  = 0;     // Pixels from top
 
 static constexpr int MIN_TEMP       = 50;    // Minimum temperature to plot (C)
 static constexpr int MAX_TEMP       = 305;   // Maximum temperature to plot (C)
-static constexpr int GRID_TIME      = 60;    // Time grid spacing (s) must be 60*N
+static constexpr int MIN_GRID_WIDTH = 10;    // Minimum time grid spacing (pixels)
 static constexpr int GRID_TEMP      = 50;    // Temperature grid spacing (C)
 
 // These stop the plot resizing when too small
@@ -50,6 +52,10 @@ static float timeScale        = 4;
  *  Temperature -> pixel scaling (C/pixel)
  */
 static float temperatureScale = 4;
+/**
+ *  Calculated time grid spacing (s) - always 60*N
+ */
+static int   gridTime         = 60;
 
 /**
  * Determines the plot scaling for temperaturePlot
@@ -57,18 +63,36 @@ static float temperatureScale = 4;
 static void calculateScales() {
    // Maximum temperature found - Don't scale below MIN_SCALE_TEMP
    int maxTemperature = MIN_SCALE_TEMP;
+   TemperaturePlot::Cursor cursor;
    for (int time=0; time<=temperaturePlot.getLastIndex(); time++) {
-      float pointTemp = temperaturePlot.getDataPoint(time).maximum();
+      float pointTemp = temperaturePlot.getDataPoint(time, cursor).maximum();
       if (pointTemp>maxTemperature) {
          maxTemperature = pointTemp;
       }
-      pointTemp = temperaturePlot.getProfilePoint(time);
+      pointTemp = temperaturePlot.getProfilePoint(time, cursor);
       if (pointTemp>maxTemperature) {
          maxTemperature = pointTemp;
       }
    }
    temperatureScale = (maxTemperature-MIN_TEMP)/(float)(lcd.LCD_HEIGHT-lcd.FONT_HEIGHT-10);
    timeScale        = std::max(temperaturePlot.getLastIndex(),MIN_SCALE_TIME)/(float)(lcd.LCD_WIDTH-12-24);
+
+   // Choose minute grid so labels don't overlap
+   static const int gridMinutes[] = {1, 2, 5, 10, 15, 30, 60};
+   for (int minutes:gridMinutes) {
+      gridTime = 60*minutes;
+      if ((gridTime/timeScale)>=MIN_GRID_WIDTH) {
+         break;
+      }
+   }
+}
+/**
+ * Get the last time that fits on the plot
+ *
+ * @return Time in seconds
+ */
+static int getMaxPlotTime() {
+   return std::min((int)(timeScale*(lcd.LCD_WIDTH-X_ORIGIN-1)), TemperaturePlot::MAX_PROFILE_TIME);
 }
 /**
  * Plot a temperature point into LCD buffer.
@@ -93,11 +117,12 @@ static void plotTemperatureOnLCD(int time, int temperature) {
  * This includes the profile and average measure temperatures if present.
  */
 static void plotProfilePointsOnLCD() {
+   TemperaturePlot::Cursor cursor;
    for (int time=0; time<=temperaturePlot.getLastIndex(); time++) {
-      plotTemperatureOnLCD(time, temperaturePlot.getProfilePoint(time));
+      plotTemperatureOnLCD(time, temperaturePlot.getProfilePoint(time, cursor));
       if(temperaturePlot.isLiveDataPresent()) {
          // TODO add x5 temperature factor for debug
-         plotTemperatureOnLCD(time, temperaturePlot.getDataPoint(time).getAverageTemperature());
+         plotTemperatureOnLCD(time, temperaturePlot.getDataPoint(time, cursor).getAverageTemperature());
       }
    }
 }
@@ -112,9 +137,16 @@ static void drawAxis(int profileIndex) {
 
    // Horizontal axis minute axis ticks
    lcd.drawHorizontalLine(lcd.LCD_HEIGHT-Y_ORIGIN);
-   for (int time=60; time<=TemperaturePlot::MAX_PROFILE_TIME; time+=GRID_TIME) {
-      lcd.gotoXY((X_ORIGIN+round(time/timeScale)-3), lcd.LCD_HEIGHT-5);
-      lcd.putSmallDigit(time/60);
+   for (int time=gridTime; time<=getMaxPlotTime(); time+=gridTime) {
+      int minutes = time/60;
+      if (minutes<10) {
+         lcd.gotoXY((X_ORIGIN+round(time/timeScale)-3), lcd.LCD_HEIGHT-5);
+      }
+      else {
+         lcd.gotoXY((X_ORIGIN+round(time/timeScale)-5), lcd.LCD_HEIGHT-5);
+         lcd.putSmallDigit(minutes/10);
+      }
+      lcd.putSmallDigit(minutes%10);
    }
    static uint8_t min[] = {
          209,88,
@@ -140,7 +172,7 @@ static void drawAxis(int profileIndex) {
    }
    lcd.drawVerticalLine(X_ORIGIN);
    // Grid
-   for (int time=0; time<=TemperaturePlot::MAX_PROFILE_TIME; time += GRID_TIME) {
+   for (int time=0; time<=getMaxPlotTime(); time += gridTime) {
       for (int temperature=MIN_TEMP; temperature<=MAX_TEMP; temperature+=GRID_TEMP) {
          plotTemperatureOnLCD(time, temperature);
       }
@@ -148,122 +180,26 @@ static void drawAxis(int profileIndex) {
    // Name
    lcd.gotoXY(NAME_OFFSET_X, NAME_OFFSET_Y);
    lcd.setInversion(true);
-   lcd.printf("%d:%s", profileIndex, (const volatile char *)(profiles[profileIndex].description));
+   FormattedString<22> buff;
+   lcd.putString(buff.writeInt(profileIndex).writeChar(':').writeString(profiles[profileIndex].description).toString());
    lcd.putChar('\n');
    lcd.setInversion(false);
 }
 
-/**
- * Class used to plot a Profile
- */
-class ProfilePlotter {
-
-protected:
-   /** Current state of profile */
-   State state;
-
-   /** Current time in profile */
-   int   time;
-
-   /** Current set-point  */
-   float setpoint;
-
-   /*
-    * Calculates one step of the profile
-    *
-    * @param profile Profile to use
-    */
-   void calculate(const NvSolderProfile &profile) {
-      static int  startOfSoakTime;
-      static int  startOfDwellTime;
-      static constexpr float ambient = 25.0f;
-
-      // Advance time
-      time++;
-
-      // Handle state
-      switch (state) {
-      case s_off:
-      case s_manual:
-      case s_fail:
-      case s_complete:
-         return;
-      case s_init:
-         state = s_preheat;
-         // no break
-      case s_preheat:
-         // Heat from ambient to start of soak temperature
-         // A -> soakTemp1 over preheatTime
-         if (setpoint<profile.soakTemp1) {
-            setpoint = ambient + (time/(float)profile.preheatTime)*(profile.soakTemp1-ambient);
-         }
-         else {
-            state = s_soak;
-            startOfSoakTime = time;
-         }
-         break;
-      case s_soak:
-         // Heat from soak start temperature to soak end temperature over soak time
-         // soakTemp1 -> soakTemp2 over soakTime time
-         if (setpoint<profile.soakTemp2) {
-            setpoint = profile.soakTemp1 + (time-startOfSoakTime)*(profile.soakTemp2-profile.soakTemp1)/(float)profile.soakTime;
-         }
-         if (time >= (startOfSoakTime+profile.soakTime)) {
-            state = s_ramp_up;
-         }
-         break;
-      case s_ramp_up:
-         // Heat from soak end temperature to peak at rampUp rate
-         // soakTemp2 -> peakTemp @ ramp2Slope
-         if (setpoint < profile.peakTemp) {
-            setpoint += profile.rampUpSlope;
-         }
-         else {
-            state = s_dwell;
-            startOfDwellTime = time;
-         }
-         break;
-      case s_dwell:
-         // Remain at peak temperature for dwell time
-         // peakTemp for peakDwell
-         if (time>(startOfDwellTime+profile.peakDwell)) {
-            state = s_ramp_down;
-         }
-         break;
-      case s_ramp_down:
-         // Ramp down at rampDown rate
-         // peakDwell 50 @ rampDown
-         if (setpoint > 50) {
-            setpoint += profile.rampDownSlope;
-         }
-         else {
-            state = s_off;
-         }
-         break;
-      }
-   };
-
-public:
-   /**
-    * Plot the entire profile to the current plot
-    *
-    * @param[in] profile Profile to use
-    */
-   ProfilePlotter(const NvSolderProfile &profile) : state(s_preheat), time(0), setpoint(25.0) {
-      while (state != s_off) {
-         calculate(profile);
-         temperaturePlot.addProfilePoint(time, setpoint);
-      }
-   }
-};
-
 /**
  * Plot the entire profile to the current plot
  *
  * @param[in] profileIndex Index of profile to use
  */
 static void plotProfile(int profileIndex) {
-   ProfilePlotter plotter(profiles[profileIndex]);
+   // Trajectory is only re-compiled if the profile has changed
+   ProfileTrajectory trajectory;
+   getProfileTrajectory(profiles[profileIndex], trajectory);
+
+   const int duration = trajectory.getDuration();
+   for (int time=0; time<=duration; time++) {
+      temperaturePlot.addProfilePoint(time, trajectory.getSetpoint(time));
+   }
 }
 
 /**
@@ -313,7 +249,7 @@ void addDataPoint(int time, DataPoint dataPoint) {
  *
  * @return dataPoint for time index
  */
-const DataPoint &getDataPoint(int time) {
+DataPoint getDataPoint(int time) {
    return  temperaturePlot.getDataPoint(time);
 }
 
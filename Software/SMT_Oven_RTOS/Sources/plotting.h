@@ -50,7 +50,7 @@ void addDataPoint(int time, DataPoint dataPoint);
  *
  * @return dataPoint for time index
  */
-const DataPoint &getDataPoint(int time);
+DataPoint getDataPoint(int time);
 
 /**
  * Get reference to entire plot data
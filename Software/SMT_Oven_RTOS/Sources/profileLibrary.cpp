@@ -0,0 +1,471 @@
+/**
+ * @file    profileLibrary.cpp
+ * @brief   Library of solder profiles stored in program flash
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <string.h>
+#include "profileLibrary.h"
+
+using namespace USBDM;
+
+/** Start of program flash reserved for library (from linker) */
+extern "C" uint8_t __profileLibrary_start__[];
+
+/** Size of program flash reserved for library (from linker - address is size) */
+extern "C" uint8_t __profileLibrary_size__[];
+
+/**
+ * Get size of each bank
+ *
+ * @return Size in bytes
+ */
+unsigned ProfileLibrary::getBankSize() {
+   return (uint32_t)(uintptr_t)__profileLibrary_size__/2;
+}
+
+/**
+ * Get the bank not in use
+ *
+ * @return Pointer to start of bank
+ */
+uint8_t *ProfileLibrary::getOtherBank() const {
+   return (fBank == __profileLibrary_start__)?__profileLibrary_start__+getBankSize():__profileLibrary_start__;
+}
+
+/**
+ * Calculate CRC of record
+ *
+ * @param[in] record Record to check
+ *
+ * @return CRC-32 of index and profile
+ */
+uint32_t ProfileLibrary::calculateCrc(const Record &record) {
+   uint32_t crc = Flash::updateCrc32(0xFFFFFFFF, &record.index, sizeof(record.index));
+   crc = Flash::updateCrc32(crc, &record.profile, sizeof(record.profile));
+   return ~crc;
+}
+
+/**
+ * Hash profile name (FNV-1a)
+ *
+ * @param[in] name Name to hash
+ *
+ * @return Slot in fNameTable[]
+ */
+unsigned ProfileLibrary::hashName(const char *name) {
+   uint32_t hash = 2166136261U;
+   for (unsigned index=0; (index<sizeof(SolderProfile::description)) && (name[index] != '\0'); index++) {
+      hash = (hash^(uint8_t)name[index])*16777619U;
+   }
+   return hash>>(32-NAME_HASH_BITS);
+}
+
+/**
+ * Get record for entry
+ *
+ * @param[in] index Library entry
+ *
+ * @return Record in flash or nullptr if entry is unused
+ */
+const ProfileLibrary::Record *ProfileLibrary::getRecord(unsigned index) const {
+   if ((index>=CAPACITY) || (fOffsets[index] == NO_RECORD)) {
+      return nullptr;
+   }
+   return (const Record *)(fBank+fOffsets[index]);
+}
+
+/**
+ * Scan flash and build index\n
+ * Selects the active bank and recovers from an interrupted garbage collection
+ */
+void ProfileLibrary::scan() {
+   uint8_t *bank0 = __profileLibrary_start__;
+   uint8_t *bank1 = __profileLibrary_start__+getBankSize();
+   const BankHeader *header0 = (const BankHeader *)bank0;
+   const BankHeader *header1 = (const BankHeader *)bank1;
+
+   bool valid0 = header0->magic == BANK_MAGIC;
+   bool valid1 = header1->magic == BANK_MAGIC;
+
+   if (valid0 && valid1) {
+      // Garbage collection interrupted before old bank was erased - discard older bank
+      if ((int32_t)(header1->generation-header0->generation)>0) {
+         fBank = bank1;
+         Flash::eraseRange(bank0, getBankSize());
+      }
+      else {
+         fBank = bank0;
+         Flash::eraseRange(bank1, getBankSize());
+      }
+   }
+   else if (valid0) {
+      fBank = bank0;
+   }
+   else if (valid1) {
+      fBank = bank1;
+   }
+   else {
+      // New library
+      fBank = bank0;
+      Flash::eraseRange(bank0, getBankSize());
+      BankHeader header = {BANK_MAGIC, 1};
+      Flash::programRange((const uint8_t *)&header, bank0, sizeof(header));
+   }
+   fGeneration = ((const BankHeader *)fBank)->generation;
+
+   // Replay log
+   for (uint16_t &offset:fOffsets) {
+      offset = NO_RECORD;
+   }
+   unsigned offset = sizeof(BankHeader);
+   while ((offset+sizeof(Record))<=getBankSize()) {
+      const Record *record = (const Record *)(fBank+offset);
+      if ((record->magic == 0xFFFF) && (record->index == 0xFFFF)) {
+         // Erased - end of log
+         break;
+      }
+      if ((record->magic == RECORD_MAGIC) && (record->index<CAPACITY) && (record->crc == calculateCrc(*record))) {
+         fOffsets[record->index] = (record->profile.description[0] == '\0')?NO_RECORD:offset;
+      }
+      offset += sizeof(Record);
+   }
+   fFreeOffset = offset;
+
+   buildNameTable();
+   fInitialised = true;
+}
+
+/**
+ * Build name hash table from index
+ */
+void ProfileLibrary::buildNameTable() {
+   memset(fNameTable, NO_ENTRY, sizeof(fNameTable));
+   fCount = 0;
+   for (unsigned index=0; index<CAPACITY; index++) {
+      const Record *record = getRecord(index);
+      if (record == nullptr) {
+         continue;
+      }
+      fCount++;
+      unsigned slot = hashName(record->profile.description);
+      while (fNameTable[slot] != NO_ENTRY) {
+         slot = (slot+1)&(NAME_HASH_SIZE-1);
+      }
+      fNameTable[slot] = index;
+   }
+}
+
+/**
+ * Copy current records to other bank and make it the active bank
+ *
+ * @return true on success
+ */
+bool ProfileLibrary::collect() {
+   uint8_t *newBank = getOtherBank();
+   if (Flash::eraseRange(newBank, getBankSize()) != FLASH_ERR_OK) {
+      return false;
+   }
+   unsigned offset = sizeof(BankHeader);
+   for (unsigned index=0; index<CAPACITY; index++) {
+      const Record *record = getRecord(index);
+      if (record == nullptr) {
+         continue;
+      }
+      // Record is copied unchanged - CRC remains valid
+      if (Flash::programRange((const uint8_t *)record, newBank+offset, sizeof(Record)) != FLASH_ERR_OK) {
+         return false;
+      }
+      fOffsets[index] = offset;
+      offset += sizeof(Record);
+   }
+   // Header is written last so an incomplete copy is not used
+   BankHeader header = {BANK_MAGIC, fGeneration+1};
+   if (Flash::programRange((const uint8_t *)&header, newBank, sizeof(header)) != FLASH_ERR_OK) {
+      return false;
+   }
+   uint8_t *oldBank = fBank;
+   fBank       = newBank;
+   fGeneration = header.generation;
+   fFreeOffset = offset;
+   Flash::eraseRange(oldBank, getBankSize());
+   return true;
+}
+
+/**
+ * Append record to active bank
+ *
+ * @param[in] index   Library entry
+ * @param[in] profile Profile to write
+ *
+ * @return true on success
+ */
+bool ProfileLibrary::append(unsigned index, const SolderProfile &profile) {
+   Record record;
+   memset(&record, 0, sizeof(record));
+   record.magic = RECORD_MAGIC;
+   record.index = index;
+   memcpy(&record.profile, &profile, sizeof(record.profile));
+   record.crc   = calculateCrc(record);
+
+   for(;;) {
+      if ((fFreeOffset+sizeof(Record))>getBankSize()) {
+         if (!collect()) {
+            // Rebuild index from whatever is valid in flash
+            scan();
+            return false;
+         }
+         if ((fFreeOffset+sizeof(Record))>getBankSize()) {
+            // Full even after garbage collection
+            return false;
+         }
+      }
+      // Skip over any partially programmed record
+      const uint32_t *location = (const uint32_t *)(fBank+fFreeOffset);
+      bool blank = true;
+      for (unsigned word=0; word<sizeof(Record)/sizeof(uint32_t); word++) {
+         if (location[word] != 0xFFFFFFFF) {
+            blank = false;
+            break;
+         }
+      }
+      if (blank &&
+          (Flash::programRange((const uint8_t *)&record, fBank+fFreeOffset, sizeof(record)) == FLASH_ERR_OK) &&
+          (memcmp(location, &record, sizeof(record)) == 0)) {
+         break;
+      }
+      fFreeOffset += sizeof(Record);
+   }
+   fOffsets[index] = (profile.description[0] == '\0')?NO_RECORD:fFreeOffset;
+   fFreeOffset += sizeof(Record);
+   buildNameTable();
+   return true;
+}
+
+/**
+ * Find entry by name (mutex must be held)
+ *
+ * @param[in] name Name of profile
+ *
+ * @return Library entry or -1 if not found
+ */
+int ProfileLibrary::findEntry(const char *name) const {
+   unsigned slot = hashName(name);
+   while (fNameTable[slot] != NO_ENTRY) {
+      const Record *record = getRecord(fNameTable[slot]);
+      if (strncmp(record->profile.description, name, sizeof(record->profile.description)) == 0) {
+         return fNameTable[slot];
+      }
+      slot = (slot+1)&(NAME_HASH_SIZE-1);
+   }
+   return -1;
+}
+
+/**
+ * Get number of profiles in library
+ *
+ * @return Number of entries in use
+ */
+unsigned ProfileLibrary::getCount() {
+   fMutex.wait();
+   checkInitialised();
+   unsigned count = fCount;
+   fMutex.release();
+   return count;
+}
+
+/**
+ * Get number of records that may be written before garbage collection is needed
+ *
+ * @return Number of records
+ */
+unsigned ProfileLibrary::getFreeRecords() {
+   fMutex.wait();
+   checkInitialised();
+   unsigned freeRecords = (getBankSize()-fFreeOffset)/sizeof(Record);
+   fMutex.release();
+   return freeRecords;
+}
+
+/**
+ * Get number of times the library has been copied between banks
+ *
+ * @return Generation
+ */
+uint32_t ProfileLibrary::getGeneration() {
+   fMutex.wait();
+   checkInitialised();
+   uint32_t generation = fGeneration;
+   fMutex.release();
+   return generation;
+}
+
+/**
+ * Check if entry is in use
+ *
+ * @param[in] index Library entry
+ *
+ * @return true if entry contains a profile
+ */
+bool ProfileLibrary::isUsed(unsigned index) {
+   fMutex.wait();
+   checkInitialised();
+   bool used = getRecord(index) != nullptr;
+   fMutex.release();
+   return used;
+}
+
+/**
+ * Find next entry in use
+ *
+ * @param[in] index Library entry to start after (-1 to find first)
+ *
+ * @return Library entry or -1 if none
+ */
+int ProfileLibrary::getNext(int index) {
+   fMutex.wait();
+   checkInitialised();
+   int next = -1;
+   for (unsigned entry=index+1; entry<CAPACITY; entry++) {
+      if (fOffsets[entry] != NO_RECORD) {
+         next = entry;
+         break;
+      }
+   }
+   fMutex.release();
+   return next;
+}
+
+/**
+ * Find previous entry in use
+ *
+ * @param[in] index Library entry to start before
+ *
+ * @return Library entry or -1 if none
+ */
+int ProfileLibrary::getPrevious(int index) {
+   fMutex.wait();
+   checkInitialised();
+   int previous = -1;
+   if (index>(int)CAPACITY) {
+      index = CAPACITY;
+   }
+   for (int entry=index-1; entry>=0; entry--) {
+      if (fOffsets[entry] != NO_RECORD) {
+         previous = entry;
+         break;
+      }
+   }
+   fMutex.release();
+   return previous;
+}
+
+/**
+ * Load profile from library
+ *
+ * @param[in]  index   Library entry
+ * @param[out] profile Profile loaded
+ *
+ * @return true on success, false if entry is unused
+ */
+bool ProfileLibrary::load(unsigned index, SolderProfile &profile) {
+   fMutex.wait();
+   checkInitialised();
+   const Record *record = getRecord(index);
+   if (record != nullptr) {
+      memcpy(&profile, &record->profile, sizeof(profile));
+   }
+   fMutex.release();
+   return record != nullptr;
+}
+
+/**
+ * Find profile by name
+ *
+ * @param[in] name Name of profile
+ *
+ * @return Library entry or -1 if not found
+ */
+int ProfileLibrary::find(const char *name) {
+   fMutex.wait();
+   checkInitialised();
+   int index = findEntry(name);
+   fMutex.release();
+   return index;
+}
+
+/**
+ * Store profile in library\n
+ * A profile with the same name is replaced, otherwise the first unused entry is used
+ *
+ * @param[in] profile Profile to store
+ *
+ * @return Library entry used or -1 on failure (library full or Flash error)
+ */
+int ProfileLibrary::store(const SolderProfile &profile) {
+   if (profile.description[0] == '\0') {
+      return -1;
+   }
+   fMutex.wait();
+   checkInitialised();
+   int index = findEntry(profile.description);
+   if (index<0) {
+      for (unsigned entry=0; entry<CAPACITY; entry++) {
+         if (fOffsets[entry] == NO_RECORD) {
+            index = entry;
+            break;
+         }
+      }
+   }
+   if ((index>=0) && !append(index, profile)) {
+      index = -1;
+   }
+   fMutex.release();
+   return index;
+}
+
+/**
+ * Store profile in library entry
+ *
+ * @param[in] index   Library entry
+ * @param[in] profile Profile to store
+ *
+ * @return true on success
+ */
+bool ProfileLibrary::store(unsigned index, const SolderProfile &profile) {
+   if ((index>=CAPACITY) || (profile.description[0] == '\0')) {
+      return false;
+   }
+   fMutex.wait();
+   checkInitialised();
+   bool success = append(index, profile);
+   fMutex.release();
+   return success;
+}
+
+/**
+ * Delete profile from library
+ *
+ * @param[in] index Library entry
+ *
+ * @return true on success
+ */
+bool ProfileLibrary::remove(unsigned index) {
+   if (index>=CAPACITY) {
+      return false;
+   }
+   fMutex.wait();
+   checkInitialised();
+   bool success = true;
+   if (fOffsets[index] != NO_RECORD) {
+      SolderProfile empty;
+      memset(&empty, 0, sizeof(empty));
+      success = append(index, empty);
+   }
+   fMutex.release();
+   return success;
+}
+
+/** Library of solder profiles in program flash */
+ProfileLibrary profileLibrary;
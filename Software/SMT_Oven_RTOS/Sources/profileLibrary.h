@@ -0,0 +1,312 @@
+/**
+ * @file    profileLibrary.h
+ * @brief   Library of solder profiles stored in program flash
+ *
+ * The library holds many more profiles than the FlexRAM profile slots.
+ * Profiles are loaded from the library into a FlexRAM slot to be used.
+ *
+ * Storage is log-structured in two banks of program flash:
+ * @verbatim
+ *   Bank   = | BankHeader | Record | Record | ... | erased |
+ *   Record = | magic | index | crc | SolderProfile |
+ * @endverbatim
+ *  - Records are only ever appended to the active bank.
+ *    The last valid record for an index is the current value of that entry.
+ *  - A record with an empty description deletes the entry.
+ *  - When the active bank is full the current records are copied to the other bank
+ *    (garbage collection). The new bank header is written last so an interrupted
+ *    copy is discarded on the next start-up.
+ *  - Each record has a CRC. Records that fail the check e.g. due to power failure
+ *    during programming are ignored.
+ *
+ * A RAM index maps entry number to record location and a hash table maps names to entries.
+ * This gives O(1) lookup by index or name.
+ *
+ * @note Programming or erasing program flash disables interrupts for the duration
+ *       of each Flash command. The library should not be modified while a profile is running.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_PROFILELIBRARY_H_
+#define SOURCES_PROFILELIBRARY_H_
+
+#include <stdint.h>
+#include "cmsis.h"
+#include "SolderProfile.h"
+
+/**
+ * Library of solder profiles stored in program flash
+ */
+class ProfileLibrary {
+
+public:
+   /** Maximum number of profiles in library */
+   static constexpr unsigned CAPACITY = 200;
+
+private:
+   /** Identifies a valid bank header */
+   static constexpr uint32_t BANK_MAGIC   = 0x3042494C; // "LIB0"
+
+   /** Identifies a record */
+   static constexpr uint16_t RECORD_MAGIC = 0x5250;     // "PR"
+
+   /** Marks unused entry in fOffsets[] */
+   static constexpr uint16_t NO_RECORD    = 0;
+
+   /** Number of bits in name hash table index */
+   static constexpr unsigned NAME_HASH_BITS = 8;
+
+   /** Size of name hash table */
+   static constexpr unsigned NAME_HASH_SIZE = 1<<NAME_HASH_BITS;
+
+   /** Marks unused entry in fNameTable[] */
+   static constexpr uint8_t  NO_ENTRY     = 0xFF;
+
+   static_assert(CAPACITY<NO_ENTRY, "Library too large for name table");
+   static_assert(CAPACITY<NAME_HASH_SIZE, "Name hash table too small");
+
+   /**
+    * Header at start of each bank
+    */
+   struct BankHeader {
+      uint32_t magic;         //!< BANK_MAGIC if bank is valid
+      uint32_t generation;    //!< Incremented each time the library is copied to the other bank
+   };
+
+   /**
+    * Profile record
+    */
+   struct Record {
+      uint16_t      magic;    //!< RECORD_MAGIC
+      uint16_t      index;    //!< Library entry [0..CAPACITY-1]
+      uint32_t      crc;      //!< CRC-32 of index and profile
+      SolderProfile profile;  //!< Profile (empty description => entry deleted)
+   };
+
+   static_assert((sizeof(BankHeader)%USBDM::FtflInfo::programFlashPhraseSize) == 0, "BankHeader must be a multiple of phrase size");
+   static_assert((sizeof(Record)%USBDM::FtflInfo::programFlashPhraseSize) == 0, "Record must be a multiple of phrase size");
+
+   /** Protects library */
+   CMSIS::Mutex fMutex;
+
+   /** Indicates library has been scanned */
+   bool     fInitialised = false;
+
+   /** Active bank */
+   uint8_t *fBank = nullptr;
+
+   /** Generation of active bank */
+   uint32_t fGeneration = 0;
+
+   /** Offset of next free record in active bank */
+   unsigned fFreeOffset = 0;
+
+   /** Number of entries in use */
+   unsigned fCount = 0;
+
+   /** Offset of current record for each entry (NO_RECORD if unused) */
+   uint16_t fOffsets[CAPACITY];
+
+   /** Entry for each name hash (linear probing) */
+   uint8_t  fNameTable[NAME_HASH_SIZE];
+
+   /**
+    * Get size of each bank
+    *
+    * @return Size in bytes
+    */
+   static unsigned getBankSize();
+
+   /**
+    * Get the bank not in use
+    *
+    * @return Pointer to start of bank
+    */
+   uint8_t *getOtherBank() const;
+
+   /**
+    * Calculate CRC of record
+    *
+    * @param[in] record Record to check
+    *
+    * @return CRC-32 of index and profile
+    */
+   static uint32_t calculateCrc(const Record &record);
+
+   /**
+    * Hash profile name
+    *
+    * @param[in] name Name to hash
+    *
+    * @return Slot in fNameTable[]
+    */
+   static unsigned hashName(const char *name);
+
+   /**
+    * Get record for entry
+    *
+    * @param[in] index Library entry
+    *
+    * @return Record in flash or nullptr if entry is unused
+    */
+   const Record *getRecord(unsigned index) const;
+
+   /**
+    * Scan flash and build index\n
+    * Selects the active bank and recovers from an interrupted garbage collection
+    */
+   void scan();
+
+   /**
+    * Build name hash table from index
+    */
+   void buildNameTable();
+
+   /**
+    * Copy current records to other bank and make it the active bank
+    *
+    * @return true on success
+    */
+   bool collect();
+
+   /**
+    * Append record to active bank
+    *
+    * @param[in] index   Library entry
+    * @param[in] profile Profile to write
+    *
+    * @return true on success
+    */
+   bool append(unsigned index, const SolderProfile &profile);
+
+   /**
+    * Find entry by name (mutex must be held)
+    *
+    * @param[in] name Name of profile
+    *
+    * @return Library entry or -1 if not found
+    */
+   int findEntry(const char *name) const;
+
+   /**
+    * Scan flash on first use (mutex must be held)
+    */
+   void checkInitialised() {
+      if (!fInitialised) {
+         scan();
+      }
+   }
+
+public:
+   /**
+    * Get maximum number of profiles in library
+    *
+    * @return Number of entries
+    */
+   static constexpr unsigned getCapacity() {
+      return CAPACITY;
+   }
+
+   /**
+    * Get number of profiles in library
+    *
+    * @return Number of entries in use
+    */
+   unsigned getCount();
+
+   /**
+    * Get number of records that may be written before garbage collection is needed
+    *
+    * @return Number of records
+    */
+   unsigned getFreeRecords();
+
+   /**
+    * Get number of times the library has been copied between banks
+    *
+    * @return Generation
+    */
+   uint32_t getGeneration();
+
+   /**
+    * Check if entry is in use
+    *
+    * @param[in] index Library entry
+    *
+    * @return true if entry contains a profile
+    */
+   bool isUsed(unsigned index);
+
+   /**
+    * Find next entry in use
+    *
+    * @param[in] index Library entry to start after (-1 to find first)
+    *
+    * @return Library entry or -1 if none
+    */
+   int getNext(int index);
+
+   /**
+    * Find previous entry in use
+    *
+    * @param[in] index Library entry to start before
+    *
+    * @return Library entry or -1 if none
+    */
+   int getPrevious(int index);
+
+   /**
+    * Load profile from library
+    *
+    * @param[in]  index   Library entry
+    * @param[out] profile Profile loaded
+    *
+    * @return true on success, false if entry is unused
+    */
+   bool load(unsigned index, SolderProfile &profile);
+
+   /**
+    * Find profile by name
+    *
+    * @param[in] name Name of profile
+    *
+    * @return Library entry or -1 if not found
+    */
+   int find(const char *name);
+
+   /**
+    * Store profile in library\n
+    * A profile with the same name is replaced, otherwise the first unused entry is used
+    *
+    * @param[in] profile Profile to store
+    *
+    * @return Library entry used or -1 on failure (library full or Flash error)
+    */
+   int store(const SolderProfile &profile);
+
+   /**
+    * Store profile in library entry
+    *
+    * @param[in] index   Library entry
+    * @param[in] profile Profile to store
+    *
+    * @return true on success
+    */
+   bool store(unsigned index, const SolderProfile &profile);
+
+   /**
+    * Delete profile from library
+    *
+    * @param[in] index Library entry
+    *
+    * @return true on success
+    */
+   bool remove(unsigned index);
+};
+
+/** Library of solder profiles in program flash */
+extern ProfileLibrary profileLibrary;
+
+#endif /* SOURCES_PROFILELIBRARY_H_ */
@@ -0,0 +1,182 @@
+/**
+ * @file    profileTrajectory.cpp
+ * @brief   Piecewise-linear set-point trajectory of a solder profile
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <string.h>
+#include "cmsis.h"
+#include "profileTrajectory.h"
+
+/**
+ * Get profile values affecting the trajectory
+ *
+ * @param[in]  profile    Profile to use
+ * @param[in]  ambient    Starting and finishing temperature
+ * @param[out] parameters Values obtained
+ */
+void ProfileTrajectory::getParameters(const NvSolderProfile &profile, float ambient, Parameters &parameters) {
+   // Clear padding so parameters may be compared with memcmp()
+   memset(&parameters, 0, sizeof(parameters));
+   parameters.ambient       = ambient;
+   parameters.rampUpSlope   = profile.rampUpSlope;
+   parameters.rampDownSlope = profile.rampDownSlope;
+   parameters.preheatTime   = profile.preheatTime;
+   parameters.soakTemp1     = profile.soakTemp1;
+   parameters.soakTemp2     = profile.soakTemp2;
+   parameters.soakTime      = profile.soakTime;
+   parameters.peakTemp      = profile.peakTemp;
+   parameters.peakDwell     = profile.peakDwell;
+}
+
+/**
+ * Set up segment
+ *
+ * @param[in] segment   Segment to set
+ * @param[in] state     State in profile sequence
+ * @param[in] startTime Start time of segment
+ * @param[in] startTemp Set-point at start of segment
+ * @param[in] endTemp   Set-point at end of segment
+ * @param[in] slope     Rate of change of set-point (magnitude only)
+ */
+void ProfileTrajectory::setSegment(Segment &segment, State state, unsigned startTime, float startTemp, float endTemp, float slope) {
+   float change = endTemp-startTemp;
+   slope = fabsf(slope);
+
+   segment.state     = state;
+   segment.startTime = startTime;
+   segment.startTemp = startTemp;
+   segment.endTemp   = endTemp;
+   if ((slope == 0) || (change == 0)) {
+      // Step change
+      segment.duration = 0;
+      segment.slope    = 0;
+      return;
+   }
+   segment.duration = (uint16_t)ceilf(fabsf(change)/slope);
+   segment.slope    = (change>0)?slope:-slope;
+}
+
+/**
+ * Compile profile into trajectory
+ *
+ * @param[in] profile Profile to use
+ * @param[in] ambient Starting and finishing temperature
+ */
+void ProfileTrajectory::build(const NvSolderProfile &profile, float ambient) {
+   getParameters(profile, ambient, fParameters);
+   const Parameters &p = fParameters;
+
+   // Preheat and soak are specified by time
+   float preheatSlope = (p.preheatTime>0)?(p.soakTemp1-ambient)/p.preheatTime:0;
+   float soakSlope    = (p.soakTime>0)?(p.soakTemp2-p.soakTemp1)/(float)p.soakTime:0;
+
+   unsigned time = 0;
+   setSegment(fSegments[0], s_preheat,   time, ambient,     p.soakTemp1, preheatSlope);
+   fSegments[0].duration = p.preheatTime;
+   time += fSegments[0].duration;
+
+   setSegment(fSegments[1], s_soak,      time, p.soakTemp1, p.soakTemp2, soakSlope);
+   fSegments[1].duration = p.soakTime;
+   time += fSegments[1].duration;
+
+   setSegment(fSegments[2], s_ramp_up,   time, p.soakTemp2, p.peakTemp,  p.rampUpSlope);
+   time += fSegments[2].duration;
+
+   setSegment(fSegments[3], s_dwell,     time, p.peakTemp,  p.peakTemp,  0);
+   fSegments[3].duration = p.peakDwell;
+   time += fSegments[3].duration;
+
+   setSegment(fSegments[4], s_ramp_down, time, p.peakTemp,  ambient,     p.rampDownSlope);
+
+   fValid = true;
+}
+
+/**
+ * Check if trajectory is up to date for a profile
+ *
+ * @param[in] profile Profile to check
+ * @param[in] ambient Starting and finishing temperature
+ *
+ * @return true if the trajectory was compiled from the same values
+ */
+bool ProfileTrajectory::isBuiltFrom(const NvSolderProfile &profile, float ambient) const {
+   if (!fValid) {
+      return false;
+   }
+   Parameters parameters;
+   getParameters(profile, ambient, parameters);
+   return memcmp(&parameters, &fParameters, sizeof(parameters)) == 0;
+}
+
+/**
+ * Get segment for state
+ *
+ * @param[in] state State in profile sequence e.g. s_soak
+ *
+ * @return Segment for state (first segment if state does not have a segment)
+ */
+const ProfileTrajectory::Segment &ProfileTrajectory::getSegment(State state) const {
+   for (const Segment &segment:fSegments) {
+      if (segment.state == state) {
+         return segment;
+      }
+   }
+   return fSegments[0];
+}
+
+/**
+ * Find segment containing time\n
+ * This is a binary search of the segment table.
+ *
+ * @param[in] time Time in profile (s)
+ *
+ * @return Segment containing time (last segment if after end of profile)
+ */
+const ProfileTrajectory::Segment &ProfileTrajectory::findSegment(int time) const {
+   // Find last segment starting at or before time
+   unsigned low  = 0;
+   unsigned high = NUM_SEGMENTS;
+   while ((high-low)>1) {
+      unsigned mid = (low+high)/2;
+      if (fSegments[mid].startTime<=time) {
+         low = mid;
+      }
+      else {
+         high = mid;
+      }
+   }
+   return fSegments[low];
+}
+
+/** Trajectory of each profile slot (profiles[]) */
+static ProfileTrajectory cachedTrajectories[MAX_PROFILES];
+
+/** Protects cachedTrajectories */
+static CMSIS::Mutex cacheMutex;
+
+/**
+ * Get trajectory for a profile using the nominal ambient temperature\n
+ * A trajectory is cached for each profile slot and only re-compiled when that profile
+ * is changed e.g. by editing. Other profiles are compiled on each call.
+ *
+ * @param[in]  profile    Profile to use
+ * @param[out] trajectory Copy of trajectory
+ */
+void getProfileTrajectory(const NvSolderProfile &profile, ProfileTrajectory &trajectory) {
+   if ((&profile < profiles) || (&profile >= profiles+MAX_PROFILES)) {
+      // Not a profile slot
+      trajectory.build(profile);
+      return;
+   }
+   cacheMutex.wait();
+   ProfileTrajectory &cachedTrajectory = cachedTrajectories[&profile-profiles];
+   // Compiled values are compared so an edit of this profile is always seen
+   if (!cachedTrajectory.isBuiltFrom(profile)) {
+      cachedTrajectory.build(profile);
+   }
+   trajectory = cachedTrajectory;
+   cacheMutex.release();
+}
@@ -0,0 +1,197 @@
+/**
+ * @file    profileTrajectory.h
+ * @brief   Piecewise-linear set-point trajectory of a solder profile
+ *
+ * The trajectory is compiled once from a profile into a small table of segments.
+ * It is then used by the profile runner, the plot preview and the remote interface
+ * so they all agree on the set-point at any time.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_PROFILETRAJECTORY_H_
+#define SOURCES_PROFILETRAJECTORY_H_
+
+#include <stdint.h>
+#include "dataPoint.h"
+#include "SolderProfile.h"
+
+/**
+ * Set-point trajectory of a solder profile
+ *
+ * @verbatim
+ *   s_preheat    ambient   -> soakTemp1 over preheatTime
+ *   s_soak       soakTemp1 -> soakTemp2 over soakTime
+ *   s_ramp_up    soakTemp2 -> peakTemp  @ rampUpSlope
+ *   s_dwell      peakTemp for peakDwell
+ *   s_ramp_down  peakTemp  -> ambient   @ rampDownSlope
+ * @endverbatim
+ */
+class ProfileTrajectory {
+
+public:
+   /** Nominal ambient used when the oven temperature is not known e.g. for a preview */
+   static constexpr float NOMINAL_AMBIENT = 25.0f;
+
+   /** Number of segments in trajectory */
+   static constexpr unsigned NUM_SEGMENTS = 5;
+
+   /**
+    * Linear segment of trajectory
+    */
+   struct Segment {
+      State    state;      //!< State in profile sequence
+      uint16_t startTime;  //!< Start time of segment (s)
+      uint16_t duration;   //!< Duration of segment (s)
+      float    startTemp;  //!< Set-point at start of segment
+      float    endTemp;    //!< Set-point at end of segment
+      float    slope;      //!< Rate of change of set-point (C/s)
+
+      /**
+       * Get set-point within segment
+       *
+       * @param[in] offset Time since start of segment (s) - limited to segment
+       *
+       * @return Set-point
+       */
+      float getSetpoint(float offset) const {
+         if (offset<=0) {
+            return startTemp;
+         }
+         if (offset>=duration) {
+            return endTemp;
+         }
+         return startTemp+offset*slope;
+      }
+   };
+
+private:
+   /**
+    * Profile values the trajectory was compiled from
+    */
+   struct Parameters {
+      float    ambient;
+      float    rampUpSlope;
+      float    rampDownSlope;
+      uint16_t preheatTime;
+      uint16_t soakTemp1;
+      uint16_t soakTemp2;
+      uint16_t soakTime;
+      uint16_t peakTemp;
+      uint16_t peakDwell;
+   };
+
+   /** Values used to compile trajectory */
+   Parameters fParameters;
+
+   /** Trajectory segments in time order */
+   Segment    fSegments[NUM_SEGMENTS];
+
+   /** Indicates the trajectory has been compiled */
+   bool       fValid = false;
+
+   /**
+    * Get profile values affecting the trajectory
+    *
+    * @param[in]  profile    Profile to use
+    * @param[in]  ambient    Starting and finishing temperature
+    * @param[out] parameters Values obtained
+    */
+   static void getParameters(const NvSolderProfile &profile, float ambient, Parameters &parameters);
+
+   /**
+    * Set up segment
+    *
+    * @param[in] segment   Segment to set
+    * @param[in] state     State in profile sequence
+    * @param[in] startTime Start time of segment
+    * @param[in] startTemp Set-point at start of segment
+    * @param[in] endTemp   Set-point at end of segment
+    * @param[in] slope     Rate of change of set-point (magnitude only)
+    */
+   static void setSegment(Segment &segment, State state, unsigned startTime, float startTemp, float endTemp, float slope);
+
+public:
+   /**
+    * Compile profile into trajectory
+    *
+    * @param[in] profile Profile to use
+    * @param[in] ambient Starting and finishing temperature
+    */
+   void build(const NvSolderProfile &profile, float ambient=NOMINAL_AMBIENT);
+
+   /**
+    * Check if trajectory is up to date for a profile
+    *
+    * @param[in] profile Profile to check
+    * @param[in] ambient Starting and finishing temperature
+    *
+    * @return true if the trajectory was compiled from the same values
+    */
+   bool isBuiltFrom(const NvSolderProfile &profile, float ambient=NOMINAL_AMBIENT) const;
+
+   /**
+    * Get segment for state
+    *
+    * @param[in] state State in profile sequence e.g. s_soak
+    *
+    * @return Segment for state (first segment if state does not have a segment)
+    */
+   const Segment &getSegment(State state) const;
+
+   /**
+    * Get segment
+    *
+    * @param[in] index Index of segment [0..NUM_SEGMENTS-1]
+    *
+    * @return Segment
+    */
+   const Segment &getSegment(unsigned index) const {
+      return fSegments[index];
+   }
+
+   /**
+    * Find segment containing time\n
+    * This is a binary search of the segment table.
+    *
+    * @param[in] time Time in profile (s)
+    *
+    * @return Segment containing time (last segment if after end of profile)
+    */
+   const Segment &findSegment(int time) const;
+
+   /**
+    * Get set-point at time
+    *
+    * @param[in] time Time in profile (s)
+    *
+    * @return Set-point
+    */
+   float getSetpoint(int time) const {
+      const Segment &segment = findSegment(time);
+      return segment.getSetpoint(time-segment.startTime);
+   }
+
+   /**
+    * Get total duration of profile
+    *
+    * @return Time at end of last segment (s)
+    */
+   int getDuration() const {
+      const Segment &last = fSegments[NUM_SEGMENTS-1];
+      return last.startTime+last.duration;
+   }
+};
+
+/**
+ * Get trajectory for a profile using the nominal ambient temperature\n
+ * A trajectory is cached for each profile slot and only re-compiled when that profile
+ * is changed e.g. by editing. Other profiles are compiled on each call.
+ *
+ * @param[in]  profile    Profile to use
+ * @param[out] trajectory Copy of trajectory
+ */
+void getProfileTrajectory(const NvSolderProfile &profile, ProfileTrajectory &trajectory);
+
+#endif /* SOURCES_PROFILETRAJECTORY_H_ */
@@ -0,0 +1,97 @@
+/**
+ * @file    reflowMetrics.cpp
+ * @brief   Reflow quality metrics accumulated during a run
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include "reflowMetrics.h"
+
+/**
+ * Discard accumulated values (liquidus is unchanged)
+ */
+void ReflowMetrics::reset() {
+   fValues.samples           = 0;
+   fValues.peakTemperature   = NAN;
+   fValues.peakTime          = 0;
+   fValues.timeAboveLiquidus = 0;
+   fValues.maxRiseSlope      = 0;
+   fValues.maxFallSlope      = 0;
+   fValues.soakTime          = 0;
+   fValues.maxSpread         = 0;
+   for (float &peak:fValues.thermocouplePeaks) {
+      peak = NAN;
+   }
+   fLastTime      = -1;
+   fLastValidTime = -1;
+   fHistoryIndex  = 0;
+}
+
+/**
+ * Add sample
+ *
+ * @param[in] time  Time of sample (s) - A sample that is not later than the previous sample is ignored
+ * @param[in] point Sample
+ */
+void ReflowMetrics::addPoint(int time, const DataPoint &point) {
+   if (time<=fLastTime) {
+      return;
+   }
+   fLastTime = time;
+
+   float minimum  = INFINITY;
+   float maximum  = -INFINITY;
+   float average  = 0;
+   int   numTemps = 0;
+   for (unsigned index=0; index<DataPoint::NUM_THERMOCOUPLES; index++) {
+      float temperature;
+      if (point.getTemperature(index, temperature) != Max31855::TH_ENABLED) {
+         continue;
+      }
+      if (isnan(fValues.thermocouplePeaks[index]) || (temperature>fValues.thermocouplePeaks[index])) {
+         fValues.thermocouplePeaks[index] = temperature;
+      }
+      minimum  = fminf(minimum, temperature);
+      maximum  = fmaxf(maximum, temperature);
+      average += temperature;
+      numTemps++;
+   }
+   if (numTemps == 0) {
+      return;
+   }
+   average /= numTemps;
+
+   if ((maximum-minimum)>fValues.maxSpread) {
+      fValues.maxSpread = maximum-minimum;
+   }
+   if (isnan(fValues.peakTemperature) || (average>fValues.peakTemperature)) {
+      fValues.peakTemperature = average;
+      fValues.peakTime        = time;
+   }
+   // Each sample accounts for the time since the previous sample
+   if (fValues.samples>0) {
+      unsigned interval = time-fLastValidTime;
+      if (average>=fValues.liquidus) {
+         fValues.timeAboveLiquidus += interval;
+      }
+      if (point.getState() == s_soak) {
+         fValues.soakTime += interval;
+      }
+   }
+   fLastValidTime = time;
+
+   // Slope from sample SLOPE_INTERVAL samples earlier
+   if (fValues.samples>=SLOPE_INTERVAL) {
+      float slope = (average-fHistory[fHistoryIndex])/(time-fHistoryTimes[fHistoryIndex]);
+      if (slope>fValues.maxRiseSlope) {
+         fValues.maxRiseSlope = slope;
+      }
+      if (slope<fValues.maxFallSlope) {
+         fValues.maxFallSlope = slope;
+      }
+   }
+   fHistory[fHistoryIndex]      = average;
+   fHistoryTimes[fHistoryIndex] = time;
+   fHistoryIndex = (fHistoryIndex+1)%SLOPE_INTERVAL;
+   fValues.samples++;
+}
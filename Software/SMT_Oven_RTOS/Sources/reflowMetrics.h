@@ -0,0 +1,130 @@
+/**
+ * @file    reflowMetrics.h
+ * @brief   Reflow quality metrics accumulated during a run
+ *
+ * The metrics are updated as each sample is recorded so they are available
+ * while the run is in progress. Each update takes constant time and space.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_REFLOWMETRICS_H_
+#define SOURCES_REFLOWMETRICS_H_
+
+#include <math.h>
+#include "dataPoint.h"
+
+/**
+ * Reflow quality metrics accumulated from samples taken once a second
+ *
+ * The oven temperature is the average of the active thermocouples.
+ * Samples without an active thermocouple are ignored.
+ * Times are accumulated from the time since the previous sample, so a missing sample is
+ * counted once the next sample is added.
+ */
+class ReflowMetrics {
+
+public:
+   /** Interval used to calculate slopes (samples) - measured temperatures are too noisy for adjacent samples */
+   static constexpr unsigned SLOPE_INTERVAL = 5;
+
+   /**
+    * Metric values
+    */
+   struct Values {
+      unsigned samples;             //!< Number of samples with an oven temperature
+      float    liquidus;            //!< Liquidus temperature used (Celsius)
+      float    peakTemperature;     //!< Peak oven temperature (Celsius, NAN if no samples)
+      int      peakTime;            //!< Time of peak oven temperature (s)
+      unsigned timeAboveLiquidus;   //!< Time at or above liquidus (s)
+      float    maxRiseSlope;        //!< Maximum rate of rise over SLOPE_INTERVAL (Celsius/s)
+      float    maxFallSlope;        //!< Maximum rate of fall over SLOPE_INTERVAL (Celsius/s, negative)
+      unsigned soakTime;            //!< Time in soak state (s)
+      float    maxSpread;           //!< Maximum difference between active thermocouples (Celsius)
+      float    thermocouplePeaks[DataPoint::NUM_THERMOCOUPLES]; //!< Peak of each thermocouple (NAN if never active)
+
+      /**
+       * Get difference between thermocouple peaks e.g. uniformity of board
+       *
+       * @return Difference in Celsius (NAN if less than 2 thermocouples were active)
+       */
+      float getPeakSpread() const {
+         float    minimum = INFINITY;
+         float    maximum = -INFINITY;
+         unsigned count   = 0;
+         for (float peak:thermocouplePeaks) {
+            if (!isnan(peak)) {
+               minimum = fminf(minimum, peak);
+               maximum = fmaxf(maximum, peak);
+               count++;
+            }
+         }
+         return (count<2)?NAN:maximum-minimum;
+      }
+   };
+
+private:
+   /** Metric values */
+   Values   fValues;
+
+   /** Time of last sample (-1 => none) */
+   int      fLastTime;
+
+   /** Time of last sample with an oven temperature */
+   int      fLastValidTime;
+
+   /** Oven temperatures of last SLOPE_INTERVAL samples (circular buffer) */
+   float    fHistory[SLOPE_INTERVAL];
+
+   /** Times of last SLOPE_INTERVAL samples */
+   int      fHistoryTimes[SLOPE_INTERVAL];
+
+   /** Position of oldest sample in fHistory[] */
+   unsigned fHistoryIndex;
+
+public:
+   /**
+    * Constructor
+    *
+    * @param[in] liquidus Liquidus temperature
+    */
+   ReflowMetrics(float liquidus=NAN) {
+      fValues.liquidus = liquidus;
+      reset();
+   }
+
+   /**
+    * Discard accumulated values (liquidus is unchanged)
+    */
+   void reset();
+
+   /**
+    * Set liquidus temperature used for time above liquidus\n
+    * This should be set before samples are added.
+    *
+    * @param[in] liquidus Liquidus temperature
+    */
+   void setLiquidus(float liquidus) {
+      fValues.liquidus = liquidus;
+   }
+
+   /**
+    * Add sample
+    *
+    * @param[in] time  Time of sample (s) - A sample that is not later than the previous sample is ignored
+    * @param[in] point Sample
+    */
+   void addPoint(int time, const DataPoint &point);
+
+   /**
+    * Get metric values
+    *
+    * @return Values accumulated
+    */
+   const Values &getValues() const {
+      return fValues;
+   }
+};
+
+#endif /* SOURCES_REFLOWMETRICS_H_ */
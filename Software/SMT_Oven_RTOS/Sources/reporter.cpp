@@ -10,6 +10,8 @@
 #include <plotting.h>
 #include <reporter.h>
 #include <RemoteInterface.h>
+#include "telemetry.h"
+#include "formatter.h"
 #include "configure.h"
 
 namespace Reporter {
@@ -26,6 +28,9 @@ static DisplayMode usePlot = DisplayTable;
 /** Profile being used */
 static int fProfile;
 
+/** Reflow metrics for current run (updated from control loop) */
+static ReflowMetrics metrics;
+
 /**
  * Get state name as string
  *
@@ -50,10 +55,37 @@ const char *getStateName(State state) {
 }
 
 /**
- * Reset reporting
+ * Reset reporting\n
+ * Clears plot and reflow metrics
  */
 void reset() {
    Draw::reset();
+
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   metrics.reset();
+   __set_PRIMASK(primask);
+}
+
+/**
+ * Set liquidus temperature used for reflow metrics
+ *
+ * @param[in] liquidus Liquidus temperature of profile
+ */
+void setLiquidus(float liquidus) {
+   metrics.setLiquidus(liquidus);
+}
+
+/**
+ * Get snapshot of reflow metrics for current run
+ *
+ * @param[out] values Metric values
+ */
+void getMetrics(ReflowMetrics::Values &values) {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   values = metrics.getValues();
+   __set_PRIMASK(primask);
 }
 
 /**
@@ -68,7 +100,8 @@ static void writePlot() {
 
 /**
  * Record data point for logging.\n
- * Actual temperature information is obtained from the thermocouples.
+ * Actual temperature information is obtained from the thermocouples.\n
+ * The reflow metrics are also updated.
  *
  * @param[in] time  Time for report
  * @param[in] state State for report
@@ -82,6 +115,43 @@ void addLogPoint(int time, State state) {
    dataPoint.setHeater(ovenControl.getHeaterDutycycle());
    dataPoint.setFan(ovenControl.getFanDutycycle());
    Draw::addDataPoint(time, dataPoint);
+   metrics.addPoint(time, dataPoint);
+   Telemetry::publish(time, dataPoint);
+}
+
+/**
+ * Writes reflow metrics to LCD buffer
+ */
+static void writeMetrics() {
+   lcd.setInversion(false);
+   lcd.clearFrameBuffer();
+   lcd.gotoXY(0,0);
+
+   ReflowMetrics::Values values;
+   getMetrics(values);
+
+   FormattedString<24> buff;
+   if (values.samples == 0) {
+      lcd.putString("No data\n");
+   }
+   else {
+      lcd.putString(buff.writeString("Peak   ").writeFixed(values.peakTemperature, 1, 5).writeString("\x7F @")
+            .writeInt(values.peakTime).writeString("s\n").toString());
+      lcd.putString(buff.reset().writeString("TAL    ").writeInt(values.timeAboveLiquidus, 5).writeString("s >")
+            .writeInt((int)round(values.liquidus)).writeString("\x7F\n").toString());
+      lcd.putString(buff.reset().writeString("Slope  ").writeFixed(values.maxRiseSlope, 2, 5).writeChar(' ')
+            .writeFixed(values.maxFallSlope, 2, 5).writeString("\x7F/s\n").toString());
+      lcd.putString(buff.reset().writeString("Soak   ").writeInt(values.soakTime, 5).writeString("s\n").toString());
+      buff.reset().writeString("Spread ").writeFixed(values.maxSpread, 1, 5).writeChar('\x7F');
+      float peakSpread = values.getPeakSpread();
+      if (!isnan(peakSpread)) {
+         buff.writeString(" pk").writeFixed(peakSpread, 1).writeChar('\x7F');
+      }
+      lcd.putString(buff.writeChar('\n').toString());
+   }
+   if (fTextPrompt != nullptr) {
+      fTextPrompt();
+   }
 }
 
 /**
@@ -103,18 +173,22 @@ static void writeThermocoupleStatus() {
       Max31855::ThermocoupleStatus status = dataPoint.getTemperature(t, temperature);
       coldReference = temperatureSensors.getColdReferences(t);
 
-      lcd.printf("T%d:", t+1); lcd.putSpace(2);
+      FormattedString<22> buff;
+      buff.writeChar('T').writeInt(t+1).writeChar(':');
+      lcd.putString(buff.toString()); lcd.putSpace(2);
+      buff.reset().writeString(Max31855::getStatusName(status), 4);
       if (status == Max31855::TH_ENABLED) {
-         lcd.printf("%-4s %5.1f\x7F %5.1f\x7F\n", Max31855::getStatusName(status), temperature, coldReference);
+         buff.writeChar(' ').writeFixed(temperature, 1, 5).writeString("\x7F ").writeFixed(coldReference, 1, 5).writeString("\x7F\n");
       }
       else if (status != Max31855::TH_MISSING) {
          temperature = 0;
-         lcd.printf("%-4s  ----  %5.1f\x7F\n", Max31855::getStatusName(status), coldReference);
+         buff.writeString("  ----  ").writeFixed(coldReference, 1, 5).writeString("\x7F\n");
       }
       else {
          temperature = 0;
-         lcd.printf("%-4s\n", Max31855::getStatusName(status));
+         buff.writeChar('\n');
       }
+      lcd.putString(buff.toString());
    }
    if (fTextPrompt != nullptr) {
       fTextPrompt();
@@ -132,6 +206,9 @@ void displayThermocoupleStatus() {
       case DisplayTable:
          writeThermocoupleStatus();
          break;
+      case DisplayMetrics:
+         writeMetrics();
+         break;
    }
    lcd.refreshImage();
    lcd.setGraphicMode();
@@ -157,7 +234,7 @@ void setPlotPrompt(void (*prompt)()) {
 /**
  * Control whether a text or plot display is used on LCD
  *
- * @param[in] mode Either DisplayPlot or DisplayTable
+ * @param[in] mode DisplayPlot, DisplayTable or DisplayMetrics
  */
 void setDisplayFormat(DisplayMode mode) {
    usePlot = mode;
@@ -10,24 +10,30 @@
 #define REPORTER_H_
 
 #include <dataPoint.h>
+#include "reflowMetrics.h"
 
 namespace Reporter {
 
 /** Indicates format shown on LCD  */
 enum DisplayMode {
-   DisplayPlot,   /** Plot showing temperature and profile hsitory */
-   DisplayTable,  /** Current temperatures in table */
+   DisplayPlot,    /** Plot showing temperature and profile hsitory */
+   DisplayTable,   /** Current temperatures in table */
+   DisplayMetrics, /** Reflow quality metrics */
 };
 
 /**
- * Returns the opposite of the display mode provided
+ * Returns the next display mode in the sequence Table -> Plot -> Metrics
  *
- * @param[in] mode Mode to toggle
+ * @param[in] mode Current mode
  *
- * @return Opposite mode
+ * @return Next mode
  */
-static inline DisplayMode toggle(DisplayMode mode) {
-   return (mode==DisplayPlot)?DisplayTable:DisplayPlot;
+static inline DisplayMode nextMode(DisplayMode mode) {
+   switch(mode) {
+   case DisplayTable : return DisplayPlot;
+   case DisplayPlot  : return DisplayMetrics;
+   default           : return DisplayTable;
+   }
 }
 
 /**
@@ -40,9 +46,24 @@ static inline DisplayMode toggle(DisplayMode mode) {
 const char *getStateName(State state);
 
 /**
- * Reset reporting
+ * Reset reporting\n
+ * Clears plot and reflow metrics
  */
 void reset();
+
+/**
+ * Set liquidus temperature used for reflow metrics
+ *
+ * @param[in] liquidus Liquidus temperature of profile
+ */
+void setLiquidus(float liquidus);
+
+/**
+ * Get snapshot of reflow metrics for current run
+ *
+ * @param[out] values Metric values
+ */
+void getMetrics(ReflowMetrics::Values &values);
 /**
  * Set prompt to print for text display
  *
@@ -85,7 +106,8 @@ void displayThermocoupleStatus();
 
 /**
  * Record data point for logging.\n
- * Actual temperature information is obtained from the thermocouples.
+ * Actual temperature information is obtained from the thermocouples.\n
+ * The reflow metrics are also updated.
  *
  * @param[in] time  Time for report
  * @param[in] state State for report
@@ -0,0 +1,448 @@
+/**
+ * @file    runArchive.cpp
+ * @brief   Archive of completed profile runs stored in program flash
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include "rtc.h"
+#include "runArchive.h"
+#include "reflowMetrics.h"
+
+using namespace USBDM;
+
+/** Start of program flash reserved for run archive (from linker) */
+extern "C" uint8_t __runArchive_start__[];
+
+/** Size of program flash reserved for run archive (from linker - address is size) */
+extern "C" uint8_t __runArchive_size__[];
+
+/** Size of program flash sector (erase unit) */
+static constexpr unsigned SECTOR_SIZE = FtflInfo::programFlashSectorSize;
+
+/** Size of program flash phrase (program unit) */
+static constexpr unsigned PHRASE_SIZE = FtflInfo::programFlashPhraseSize;
+
+/**
+ * Get size of archive
+ *
+ * @return Size in bytes
+ */
+unsigned RunArchive::getArchiveSize() {
+   return (uint32_t)(uintptr_t)__runArchive_size__;
+}
+
+/**
+ * Get entry at offset in archive
+ *
+ * @param[in] offset Offset of entry
+ *
+ * @return Entry header in flash
+ */
+const RunArchive::EntryHeader *RunArchive::getHeader(unsigned offset) {
+   return (const EntryHeader *)(__runArchive_start__+offset);
+}
+
+/**
+ * Get size of entry including padding
+ *
+ * @param[in] length Size of compressed data
+ *
+ * @return Size in bytes
+ */
+unsigned RunArchive::getEntrySize(unsigned length) {
+   return sizeof(EntryHeader)+((length+PHRASE_SIZE-1)&~(PHRASE_SIZE-1));
+}
+
+/**
+ * Check if an entry header is valid
+ *
+ * @param[in] offset Offset of possible entry
+ *
+ * @return true if a valid entry header is present
+ */
+bool RunArchive::isHeaderValid(unsigned offset) {
+   if ((offset+sizeof(EntryHeader))>getArchiveSize()) {
+      return false;
+   }
+   const EntryHeader *header = getHeader(offset);
+   return (header->magic == ENTRY_MAGIC) &&
+          ((offset+getEntrySize(header->length))<=getArchiveSize()) &&
+          (header->headerCrc == ~Flash::updateCrc32(0xFFFFFFFF, header, offsetof(EntryHeader, headerCrc)));
+}
+
+/**
+ * Check if the compressed data of an entry is valid
+ *
+ * @param[in] header Entry to check
+ *
+ * @return true if data CRC is correct
+ */
+bool RunArchive::isDataValid(const EntryHeader *header) {
+   return header->dataCrc == ~Flash::updateCrc32(0xFFFFFFFF, header+1, header->length);
+}
+
+/**
+ * Check if a range of the archive is erased
+ *
+ * @param[in] offset Start of range
+ * @param[in] size   Size of range
+ *
+ * @return true if erased
+ */
+bool RunArchive::isBlank(unsigned offset, unsigned size) {
+   const uint32_t *location = (const uint32_t *)(__runArchive_start__+offset);
+   for (unsigned word=0; word<size/sizeof(uint32_t); word++) {
+      if (location[word] != 0xFFFFFFFF) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Find next valid entry header
+ *
+ * @param[inout] offset Offset to start search - updated to location of entry
+ * @param[in]    end    Offset to end search
+ *
+ * @return true if found
+ */
+bool RunArchive::findEntry(unsigned &offset, unsigned end) {
+   while (offset<end) {
+      if (isHeaderValid(offset)) {
+         return true;
+      }
+      offset += PHRASE_SIZE;
+   }
+   return false;
+}
+
+/**
+ * Get entry for run number (mutex must be held)
+ *
+ * @param[in] run Run number
+ *
+ * @return Entry in flash or nullptr if not found
+ */
+const RunArchive::EntryHeader *RunArchive::findRun(uint32_t run) const {
+   for (unsigned index=0; index<fCount; index++) {
+      const EntryHeader *header = getHeader(fOffsets[index]);
+      if (header->summary.run == run) {
+         return header;
+      }
+   }
+   return nullptr;
+}
+
+/**
+ * Add entry to list in run order discarding the oldest if full
+ *
+ * @param[in] offset Offset of entry
+ */
+void RunArchive::addToList(unsigned offset) {
+   uint32_t run = getHeader(offset)->summary.run;
+   unsigned position = fCount;
+   while ((position>0) && ((int32_t)(getHeader(fOffsets[position-1])->summary.run-run)>0)) {
+      position--;
+   }
+   if (fCount == CAPACITY) {
+      if (position == 0) {
+         // Older than all listed entries
+         return;
+      }
+      // Discard oldest
+      memmove(fOffsets, fOffsets+1, (position-1)*sizeof(fOffsets[0]));
+      position--;
+   }
+   else {
+      memmove(fOffsets+position+1, fOffsets+position, (fCount-position)*sizeof(fOffsets[0]));
+      fCount++;
+   }
+   fOffsets[position] = offset;
+}
+
+/**
+ * Remove entries overlapping a range from list
+ *
+ * @param[in] start Start of range
+ * @param[in] end   End of range
+ */
+void RunArchive::removeFromList(unsigned start, unsigned end) {
+   unsigned count = 0;
+   for (unsigned index=0; index<fCount; index++) {
+      unsigned entryStart = fOffsets[index];
+      unsigned entryEnd   = entryStart+getEntrySize(getHeader(entryStart)->length);
+      if ((entryStart<end) && (entryEnd>start)) {
+         continue;
+      }
+      fOffsets[count++] = fOffsets[index];
+   }
+   fCount = count;
+}
+
+/**
+ * Scan flash and build list of entries
+ */
+void RunArchive::scan() {
+   fCount      = 0;
+   fFreeOffset = 0;
+   fNextRun    = 1;
+
+   // The head of the log follows the newest entry
+   bool     found  = false;
+   unsigned offset = 0;
+   while (findEntry(offset, getArchiveSize())) {
+      const EntryHeader *header = getHeader(offset);
+      if (!found || ((int32_t)(header->summary.run-fNextRun)>=0)) {
+         found       = true;
+         fNextRun    = header->summary.run+1;
+         fFreeOffset = offset+getEntrySize(header->length);
+      }
+      addToList(offset);
+      offset += getEntrySize(header->length);
+   }
+
+   // Remainder of head sector should be erased
+   // If not (e.g. interrupted write of header) continue from next sector
+   fErasedEnd = (fFreeOffset+SECTOR_SIZE-1)&~(SECTOR_SIZE-1);
+   if (!isBlank(fFreeOffset, fErasedEnd-fFreeOffset)) {
+      fFreeOffset = fErasedEnd;
+   }
+   fInitialised = true;
+}
+
+/**
+ * Make space for an entry at the head of the log\n
+ * Erases sectors ahead of the head and discards the runs that were stored there.
+ *
+ * @param[in] size Size of entry including padding
+ *
+ * @return true on success
+ */
+bool RunArchive::reserve(unsigned size) {
+   if (size>(getArchiveSize()-SECTOR_SIZE)) {
+      // Would overwrite itself
+      return false;
+   }
+   if ((fFreeOffset+size)>getArchiveSize()) {
+      // Does not fit before end of archive - continue from start
+      fFreeOffset = 0;
+      fErasedEnd  = 0;
+   }
+   while (fErasedEnd<(fFreeOffset+size)) {
+      // Discard runs stored in sector
+      removeFromList(fErasedEnd, fErasedEnd+SECTOR_SIZE);
+      if (!isBlank(fErasedEnd, SECTOR_SIZE) &&
+          (Flash::eraseRange(__runArchive_start__+fErasedEnd, SECTOR_SIZE) != FLASH_ERR_OK)) {
+         return false;
+      }
+      fErasedEnd += SECTOR_SIZE;
+   }
+   return true;
+}
+
+/**
+ * Calculate summary of run from the measured data
+ *
+ * @param[in]  plot    Plot containing measured data
+ * @param[in]  profile Profile run
+ * @param[out] summary Summary calculated
+ */
+void RunArchive::summarise(const TemperaturePlot &plot, const NvSolderProfile &profile, RunSummary &summary) {
+   summary.points            = plot.getLastValid()+1;
+   summary.liquidus          = profile.liquidus;
+   strncpy(summary.description, profile.description, sizeof(summary.description)-1);
+   summary.description[sizeof(summary.description)-1] = '\0';
+
+   // Same calculation as the live metrics
+   ReflowMetrics metrics(summary.liquidus);
+   TemperaturePlot::Cursor cursor;
+   for (int time=0; time<summary.points; time++) {
+      metrics.addPoint(time, plot.getDataPoint(time, cursor));
+   }
+   const ReflowMetrics::Values &values = metrics.getValues();
+   summary.timeAboveLiquidus = values.timeAboveLiquidus;
+   summary.peakTemperature   = isnan(values.peakTemperature)?0:(uint16_t)roundf(values.peakTemperature*100);
+   summary.maxRampSlope      = (int16_t)roundf(values.maxRiseSlope*100);
+}
+
+/**
+ * Get number of runs in archive
+ *
+ * @return Number of runs listed
+ */
+unsigned RunArchive::getCount() {
+   fMutex.wait();
+   checkInitialised();
+   unsigned count = fCount;
+   fMutex.release();
+   return count;
+}
+
+/**
+ * Get space available before old runs are discarded
+ *
+ * @return Number of bytes
+ */
+unsigned RunArchive::getFreeSpace() {
+   fMutex.wait();
+   checkInitialised();
+   unsigned freeSpace = fErasedEnd-fFreeOffset;
+   fMutex.release();
+   return freeSpace;
+}
+
+/**
+ * Get summary of run
+ *
+ * @param[in]  index   Index of run in archive (0 = oldest)
+ * @param[out] summary Summary of run
+ * @param[out] valid   Indicates the compressed data of the run is intact
+ *
+ * @return true on success, false if index out of range
+ */
+bool RunArchive::getSummary(unsigned index, RunSummary &summary, bool &valid) {
+   fMutex.wait();
+   checkInitialised();
+   bool success = index<fCount;
+   if (success) {
+      const EntryHeader *header = getHeader(fOffsets[index]);
+      memcpy(&summary, &header->summary, sizeof(summary));
+      valid = isDataValid(header);
+   }
+   fMutex.release();
+   return success;
+}
+
+/**
+ * Get summary of run by run number
+ *
+ * @param[in]  run     Run number
+ * @param[out] summary Summary of run
+ * @param[out] valid   Indicates the compressed data of the run is intact
+ *
+ * @return true on success, false if run not found
+ */
+bool RunArchive::findSummary(uint32_t run, RunSummary &summary, bool &valid) {
+   fMutex.wait();
+   checkInitialised();
+   const EntryHeader *header = findRun(run);
+   if (header != nullptr) {
+      memcpy(&summary, &header->summary, sizeof(summary));
+      valid = isDataValid(header);
+   }
+   fMutex.release();
+   return header != nullptr;
+}
+
+/**
+ * Decode the data points of a run\n
+ * Points are decoded in blocks. The archive is only locked while each block is decoded so
+ * the function may block (e.g. on a full transmit buffer) without holding up store().
+ *
+ * @param[in] run      Run number
+ * @param[in] function Function called for each point in time order
+ *
+ * @return true on success, false if run not found, data is corrupt or the run was
+ *         discarded while being reported
+ */
+bool RunArchive::getPoints(uint32_t run, PointFunction function) {
+   DataPoint points[POINTS_PER_BLOCK];
+   TemperaturePlot::ArchiveCursor cursor;
+   int time = 0;
+   int last = 0;
+
+   fMutex.wait();
+   checkInitialised();
+   const EntryHeader *header = findRun(run);
+   bool success = (header != nullptr) && isDataValid(header);
+   if (success) {
+      last = header->summary.points-1;
+   }
+   while (success && (time<=last)) {
+      // Decoded in place from flash
+      const uint8_t *data = (const uint8_t *)(header+1);
+      unsigned count = 0;
+      while ((count<POINTS_PER_BLOCK) && (time+(int)count<=last)) {
+         points[count++] = TemperaturePlot::decodeDataPoint(data, cursor);
+      }
+      fMutex.release();
+
+      for (unsigned index=0; index<count; index++, time++) {
+         function(time, points[index], time == last);
+      }
+
+      // Run may have been discarded by store() while unlocked
+      fMutex.wait();
+      if (time<=last) {
+         success = findRun(run) == header;
+      }
+   }
+   fMutex.release();
+   return success;
+}
+
+/**
+ * Add run to archive
+ *
+ * @param[in] plot         Plot containing measured data of run
+ * @param[in] profile      Profile run
+ * @param[in] profileIndex Index of profile run
+ * @param[in] finalState   State at end of run e.g. s_complete
+ *
+ * @return Run number or 0 on failure (no data or Flash error)
+ */
+uint32_t RunArchive::store(const TemperaturePlot &plot, const NvSolderProfile &profile, unsigned profileIndex, State finalState) {
+   if (!plot.isLiveDataPresent()) {
+      return 0;
+   }
+   EntryHeader header;
+   memset(&header, 0xFF, sizeof(header));
+   header.magic                = ENTRY_MAGIC;
+   header.summary.timestamp    = Rtc::getTime();
+   header.summary.profileIndex = profileIndex;
+   header.summary.finalState   = finalState;
+   summarise(plot, profile, header.summary);
+
+   unsigned       length;
+   const uint8_t *data = plot.getEncodedData(length);
+   header.length  = length;
+   header.dataCrc = ~Flash::updateCrc32(0xFFFFFFFF, data, length);
+
+   fMutex.wait();
+   checkInitialised();
+   header.summary.run = fNextRun;
+   header.headerCrc   = ~Flash::updateCrc32(0xFFFFFFFF, &header, offsetof(EntryHeader, headerCrc));
+
+   unsigned size    = getEntrySize(length);
+   bool     success = reserve(size);
+   if (success) {
+      uint8_t *address = __runArchive_start__+fFreeOffset;
+
+      // Header is written first so an interrupted entry is still located (and found invalid)
+      unsigned whole = length&~(PHRASE_SIZE-1);
+      uint8_t  tail[PHRASE_SIZE];
+      memset(tail, 0xFF, sizeof(tail));
+      memcpy(tail, data+whole, length-whole);
+      success =
+            (Flash::programRange((const uint8_t *)&header, address, sizeof(header)) == FLASH_ERR_OK) &&
+            ((whole == 0) || (Flash::programRange(data, address+sizeof(header), whole) == FLASH_ERR_OK)) &&
+            ((whole == length) || (Flash::programRange(tail, address+sizeof(header)+whole, sizeof(tail)) == FLASH_ERR_OK)) &&
+            isHeaderValid(fFreeOffset) && isDataValid(getHeader(fFreeOffset));
+      if (success) {
+         addToList(fFreeOffset);
+      }
+      // Don't re-use location even on failure
+      fFreeOffset += size;
+      fNextRun++;
+   }
+   fMutex.release();
+   return success?header.summary.run:0;
+}
+
+/** Archive of completed profile runs in program flash */
+RunArchive runArchive;
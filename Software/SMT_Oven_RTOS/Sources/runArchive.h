@@ -0,0 +1,300 @@
+/**
+ * @file    runArchive.h
+ * @brief   Archive of completed profile runs stored in program flash
+ *
+ * Each run is stored as a summary and a copy of the compressed oven results
+ * (see TemperaturePlot::getEncodedData()).
+ *
+ * Storage is a circular log in program flash:
+ * @verbatim
+ *   Archive = | Entry | Entry | ... | erased | ... | Entry |
+ *   Entry   = | EntryHeader | compressed data | padding |
+ * @endverbatim
+ *  - Entries are appended at the head of the log. Sectors ahead of the head are erased
+ *    as needed which discards the oldest runs. Each sector is therefore erased once
+ *    per pass through the archive (wear-levelling).
+ *  - An entry that does not fit before the end of the archive is placed at the start
+ *    so the compressed data of an entry is always contiguous and may be decoded in place.
+ *  - The header has its own CRC so entries may be located by searching the archive on start-up.
+ *    The compressed data has a separate CRC. A run interrupted while being written
+ *    e.g. by power failure is listed but is not valid.
+ *
+ * @note Programming or erasing program flash disables interrupts for the duration
+ *       of each Flash command. Runs should only be archived once the oven is idle and
+ *       not from the control loop (see RunProfile).
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_RUNARCHIVE_H_
+#define SOURCES_RUNARCHIVE_H_
+
+#include <stdint.h>
+#include "cmsis.h"
+#include "dataPoint.h"
+#include "SolderProfile.h"
+#include "temperaturePlot.h"
+
+/**
+ * Summary of an archived run
+ */
+struct RunSummary {
+   uint32_t run;                                        //!< Run number (increments for each run archived)
+   uint32_t timestamp;                                  //!< RTC time at end of run (seconds since epoch)
+   uint16_t points;                                     //!< Number of data points (1 per second)
+   uint8_t  profileIndex;                               //!< Index of profile run
+   uint8_t  finalState;                                 //!< State at end of run e.g. s_complete, s_fail
+   uint16_t peakTemperature;                            //!< Peak oven temperature (Celsius x 100)
+   uint16_t timeAboveLiquidus;                          //!< Time above profile liquidus (s)
+   int16_t  maxRampSlope;                               //!< Maximum rate of rise of oven temperature (Celsius/s x 100, see ReflowMetrics)
+   uint16_t liquidus;                                   //!< Liquidus temperature of profile (Celsius)
+   char     description[sizeof(SolderProfile::description)+1]; //!< Name of profile run
+};
+
+/**
+ * Archive of completed profile runs stored in program flash
+ */
+class RunArchive {
+
+public:
+   /** Maximum number of runs that may be listed */
+   static constexpr unsigned CAPACITY = 64;
+
+   /**
+    * Function used to report archived data points
+    *
+    * @param[in] time      Time of point (index)
+    * @param[in] point     Data point
+    * @param[in] lastEntry Indicates this is the last point of the run
+    */
+   using PointFunction = void (*)(int time, const DataPoint &point, bool lastEntry);
+
+private:
+   /** Identifies an entry */
+   static constexpr uint32_t ENTRY_MAGIC = 0x304E5552; // "RUN0"
+
+   /**
+    * Header at start of each entry
+    */
+   struct EntryHeader {
+      uint32_t   magic;       //!< ENTRY_MAGIC
+      uint32_t   dataCrc;     //!< CRC-32 of compressed data
+      uint32_t   length;      //!< Size of compressed data in bytes (excluding padding)
+      RunSummary summary;     //!< Summary of run
+      uint32_t   headerCrc;   //!< CRC-32 of preceding fields
+   };
+
+   static_assert((sizeof(EntryHeader)%USBDM::FtflInfo::programFlashPhraseSize) == 0, "EntryHeader must be a multiple of phrase size");
+
+   /** Number of points decoded by getPoints() each time the archive is locked */
+   static constexpr unsigned POINTS_PER_BLOCK = 8;
+
+   /** Protects archive */
+   CMSIS::Mutex fMutex;
+
+   /** Indicates archive has been scanned */
+   bool     fInitialised = false;
+
+   /** Offset of next entry */
+   unsigned fFreeOffset = 0;
+
+   /** Offset of end of erased area following fFreeOffset (sector boundary) */
+   unsigned fErasedEnd = 0;
+
+   /** Run number for next entry */
+   uint32_t fNextRun = 1;
+
+   /** Offset of each entry listed (oldest first) */
+   uint16_t fOffsets[CAPACITY];
+
+   /** Number of entries listed */
+   unsigned fCount = 0;
+
+   /**
+    * Get size of archive
+    *
+    * @return Size in bytes
+    */
+   static unsigned getArchiveSize();
+
+   /**
+    * Get entry at offset in archive
+    *
+    * @param[in] offset Offset of entry
+    *
+    * @return Entry header in flash
+    */
+   static const EntryHeader *getHeader(unsigned offset);
+
+   /**
+    * Get size of entry including padding
+    *
+    * @param[in] length Size of compressed data
+    *
+    * @return Size in bytes
+    */
+   static unsigned getEntrySize(unsigned length);
+
+   /**
+    * Check if an entry header is valid
+    *
+    * @param[in] offset Offset of possible entry
+    *
+    * @return true if a valid entry header is present
+    */
+   static bool isHeaderValid(unsigned offset);
+
+   /**
+    * Check if the compressed data of an entry is valid
+    *
+    * @param[in] header Entry to check
+    *
+    * @return true if data CRC is correct
+    */
+   static bool isDataValid(const EntryHeader *header);
+
+   /**
+    * Check if a range of the archive is erased
+    *
+    * @param[in] offset Start of range
+    * @param[in] size   Size of range
+    *
+    * @return true if erased
+    */
+   static bool isBlank(unsigned offset, unsigned size);
+
+   /**
+    * Find next valid entry header
+    *
+    * @param[inout] offset Offset to start search - updated to location of entry
+    * @param[in]    end    Offset to end search
+    *
+    * @return true if found
+    */
+   static bool findEntry(unsigned &offset, unsigned end);
+
+   /**
+    * Get entry for run number (mutex must be held)
+    *
+    * @param[in] run Run number
+    *
+    * @return Entry in flash or nullptr if not found
+    */
+   const EntryHeader *findRun(uint32_t run) const;
+
+   /**
+    * Add entry to list in run order discarding the oldest if full
+    *
+    * @param[in] offset Offset of entry
+    */
+   void addToList(unsigned offset);
+
+   /**
+    * Remove entries overlapping a range from list
+    *
+    * @param[in] start Start of range
+    * @param[in] end   End of range
+    */
+   void removeFromList(unsigned start, unsigned end);
+
+   /**
+    * Scan flash and build list of entries
+    */
+   void scan();
+
+   /**
+    * Scan flash on first use (mutex must be held)
+    */
+   void checkInitialised() {
+      if (!fInitialised) {
+         scan();
+      }
+   }
+
+   /**
+    * Make space for an entry at the head of the log\n
+    * Erases sectors ahead of the head and discards the runs that were stored there.
+    *
+    * @param[in] size Size of entry including padding
+    *
+    * @return true on success
+    */
+   bool reserve(unsigned size);
+
+   /**
+    * Calculate summary of run from the measured data
+    *
+    * @param[in]  plot    Plot containing measured data
+    * @param[in]  profile Profile run
+    * @param[out] summary Summary calculated
+    */
+   static void summarise(const TemperaturePlot &plot, const NvSolderProfile &profile, RunSummary &summary);
+
+public:
+   /**
+    * Get number of runs in archive
+    *
+    * @return Number of runs listed
+    */
+   unsigned getCount();
+
+   /**
+    * Get space available before old runs are discarded
+    *
+    * @return Number of bytes
+    */
+   unsigned getFreeSpace();
+
+   /**
+    * Get summary of run
+    *
+    * @param[in]  index   Index of run in archive (0 = oldest)
+    * @param[out] summary Summary of run
+    * @param[out] valid   Indicates the compressed data of the run is intact
+    *
+    * @return true on success, false if index out of range
+    */
+   bool getSummary(unsigned index, RunSummary &summary, bool &valid);
+
+   /**
+    * Get summary of run by run number
+    *
+    * @param[in]  run     Run number
+    * @param[out] summary Summary of run
+    * @param[out] valid   Indicates the compressed data of the run is intact
+    *
+    * @return true on success, false if run not found
+    */
+   bool findSummary(uint32_t run, RunSummary &summary, bool &valid);
+
+   /**
+    * Decode the data points of a run\n
+    * Points are decoded in blocks. The archive is only locked while each block is decoded so
+    * the function may block (e.g. on a full transmit buffer) without holding up store().
+    *
+    * @param[in] run      Run number
+    * @param[in] function Function called for each point in time order
+    *
+    * @return true on success, false if run not found, data is corrupt or the run was
+    *         discarded while being reported
+    */
+   bool getPoints(uint32_t run, PointFunction function);
+
+   /**
+    * Add run to archive
+    *
+    * @param[in] plot         Plot containing measured data of run
+    * @param[in] profile      Profile run
+    * @param[in] profileIndex Index of profile run
+    * @param[in] finalState   State at end of run e.g. s_complete
+    *
+    * @return Run number or 0 on failure (no data or Flash error)
+    */
+   uint32_t store(const TemperaturePlot &plot, const NvSolderProfile &profile, unsigned profileIndex, State finalState);
+};
+
+/** Archive of completed profile runs in program flash */
+extern RunArchive runArchive;
+
+#endif /* SOURCES_RUNARCHIVE_H_ */
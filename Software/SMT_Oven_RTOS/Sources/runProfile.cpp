@@ -14,11 +14,15 @@
 #include <reporter.h>
 #include <RemoteInterface.h>
 #include <SolderProfile.h>
+#include <profileTrajectory.h>
+#include <controlLoop.h>
+#include <runArchive.h>
 
 #include "hardware.h"
 #include "cmsis.h"
 #include "configure.h"
 #include "messageBox.h"
+#include "formatter.h"
 
 using namespace USBDM;
 using namespace std;
@@ -39,7 +43,8 @@ void monitor() {
       lcd.gotoXY(0, 12+4*lcd.FONT_HEIGHT+2);
       float temp = temperatureSensors.getLastMeasurement().getAverageTemperature();
       if (!isnan(temp)) {
-         lcd.printf("Average T=%0.1f\x7F", temp);
+         FormattedString<22> buff;
+         lcd.putString(buff.writeString("Average T=").writeFixed(temp, 1).writeChar('\x7F').toString());
       }
    };
 
@@ -51,12 +56,10 @@ void monitor() {
    // Time in monitor sequence
    int   time  = 0;
 
-   temperatureSensors.updateMeasurements();
    Reporter::displayThermocoupleStatus();
 
    do {
       // Update display
-      temperatureSensors.updateMeasurements();
       Reporter::addLogPoint(time, s_off);
       Reporter::displayThermocoupleStatus();
 
@@ -94,16 +97,84 @@ static float ambient;
 /** State in the profile sequence */
 static State state = s_off;
 
-/*
- * Call-back from the timer to step through the profile state-machine
+/** Set-point trajectory of profile being run (compiled at start of run) */
+static ProfileTrajectory trajectory;
+
+/** Time at which the current state was entered */
+static int startOfStateTime;
+
+/** Indicates the current run has been added to the run archive */
+static volatile bool archived = true;
+
+/** Final state of the run waiting to be archived (s_off => none) */
+static volatile State pendingState = s_off;
+
+/** Serialises archiving of the current run */
+static CMSIS::Mutex archiveMutex;
+
+/** Signal to archive thread that a run is waiting to be archived */
+static constexpr int32_t ARCHIVE_SIGNAL = 1<<0;
+
+/** Stack size for archive thread (summary calculation and Flash programming) */
+static constexpr uint32_t ARCHIVE_STACK_SIZE = 1024;
+
+/**
+ * Add the run waiting to be archived to the run archive\n
+ * Waits for a run being archived by the archive thread.\n
+ * The heater must be off as programming Flash stalls the processor.
+ * This may block and must not be called from the control loop.
  */
-static void handler(const void *) {
+static void archivePending() {
+   archiveMutex.wait();
+   State finalState = pendingState;
+   if (finalState != s_off) {
+      runArchive.store(Draw::getData(), *currentProfile, currentProfile-profiles, finalState);
+      archived     = true;
+      pendingState = s_off;
+   }
+   archiveMutex.release();
+}
 
-   /* Records start of soak time */
-   static int startOfSoakTime;
+/**
+ * Archives runs once they have ended\n
+ * Runs below the control loop so it is not held up by Flash programming or by
+ * readers of the archive.
+ */
+static void archiveThreadFunction(const void *) {
+   for(;;) {
+      CMSIS::Thread::signalWait(ARCHIVE_SIGNAL);
+      archivePending();
+   }
+}
 
-   /* Records start of dwell time */
-   static int startOfDwellTime;
+/** Thread archiving runs */
+static CMSIS::Thread archiveThread{archiveThreadFunction, osPriorityAboveNormal, ARCHIVE_STACK_SIZE};
+
+/**
+ * Request the run just finished be added to the run archive\n
+ * Only the first request after a run is started has any effect.\n
+ * Does not block so may be called from the control loop.
+ *
+ * @param[in] finalState State at end of run i.e. s_complete or s_fail
+ */
+static void archiveRun(State finalState) {
+   uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+   bool request = !archived && (pendingState == s_off);
+   if (request) {
+      pendingState = finalState;
+   }
+   __set_PRIMASK(primask);
+
+   if (request) {
+      archiveThread.signalSet(ARCHIVE_SIGNAL);
+   }
+}
+
+/*
+ * Called once a second to step through the profile state-machine
+ */
+static void handler() {
 
    /* Used for timeout for profile changes */
    static int timeout;
@@ -112,9 +183,9 @@ static void handler(const void *) {
    constexpr int DELTA = 5;
 
    // Get current temperature (NAN on thermocouple failure)
-   const float currentTemperature = temperatureSensors.getTemperature();
+   const float currentTemperature = ControlLoop::getTemperature();
 
-   if (std::isnan(getTemperature())) {
+   if (std::isnan(currentTemperature)) {
       state = s_fail;
    }
 
@@ -127,6 +198,8 @@ static void handler(const void *) {
       pid.enable(false);
       ovenControl.setHeaterDutycycle(0);
       ovenControl.setFanDutycycle(0);
+      // Catches failure detected above
+      archiveRun(state);
       return;
    case s_off:
    case s_manual:
@@ -137,11 +210,13 @@ static void handler(const void *) {
        */
       ambient  = currentTemperature;   // Use starting temperature as ambient reference
       time     = 0;
+      trajectory.build(*currentProfile, ambient);
       setpoint = ambient;
       pid.setTunings(pidKp, pidKi, pidKd);
       pid.setSetpoint(ambient);
       pid.enable();
       state    = s_preheat;
+      startOfStateTime = 0;
 
       // Calculate timeout for preheat ramp (10% over)
       timeout = (int)round(1.1*currentProfile->preheatTime);
@@ -159,7 +234,7 @@ static void handler(const void *) {
       }
       if (setpoint<currentProfile->soakTemp1) {
          // Still following profile
-         setpoint = ambient + (time/(float)currentProfile->preheatTime)*(currentProfile->soakTemp1-ambient);
+         setpoint = trajectory.getSegment(s_preheat).getSetpoint(time);
          pid.setSetpoint(setpoint);
       }
       else {
@@ -170,7 +245,7 @@ static void handler(const void *) {
                ((timeout>5)&&(currentTemperature>=(currentProfile->soakTemp1-DELTA)))) {
             // Reach soak temperature - move on
             state = s_soak;
-            startOfSoakTime = time;
+            startOfStateTime = time;
 
             // Calculate timeout for soak ramp (10% over)
             timeout = (int)round(1.1*currentProfile->soakTime);
@@ -190,16 +265,17 @@ static void handler(const void *) {
       }
       if (setpoint<currentProfile->soakTemp2) {
          // Follow profile
-         setpoint = currentProfile->soakTemp1 + (time-startOfSoakTime)*(currentProfile->soakTemp2-currentProfile->soakTemp1)/currentProfile->soakTime;
+         setpoint = trajectory.getSegment(s_soak).getSetpoint(time-startOfStateTime);
          pid.setSetpoint(setpoint);
       }
-      if (time >= (startOfSoakTime+currentProfile->soakTime)) {
+      if (time >= (startOfStateTime+currentProfile->soakTime)) {
          // Reached end of soak time
          // Move on if reached soak temperature or been nearly there for a while
          if ((currentTemperature>=currentProfile->soakTemp2) ||
                ((timeout>5)&&(currentTemperature>=(currentProfile->soakTemp2-DELTA)))) {
             // Reach soak temperature 2 - move on
             state = s_ramp_up;
+            startOfStateTime = time;
 
             // Calculate timeout for ramp up to peak ramp (10% over)
             timeout = (int)round(1.1*(currentProfile->peakTemp-setpoint)/currentProfile->rampUpSlope);
@@ -218,13 +294,13 @@ static void handler(const void *) {
          state = s_fail;
       }
       if (setpoint < currentProfile->peakTemp) {
-         setpoint += currentProfile->rampUpSlope;
+         setpoint = trajectory.getSegment(s_ramp_up).getSetpoint(time-startOfStateTime);
          pid.setSetpoint(setpoint);
          timeout = 0;
       }
       if (currentTemperature >= (currentProfile->peakTemp-DELTA)) {
          state = s_dwell;
-         startOfDwellTime = time;
+         startOfStateTime = time;
       }
       else {
          timeout++;
@@ -239,8 +315,9 @@ static void handler(const void *) {
        *
        * peakTemp for peakDwell
        */
-      if (time>(startOfDwellTime+currentProfile->peakDwell)) {
+      if (time>(startOfStateTime+currentProfile->peakDwell)) {
          state = s_ramp_down;
+         startOfStateTime = time;
       }
       break;
    case s_ramp_down:
@@ -249,7 +326,7 @@ static void handler(const void *) {
        * peakTemp -> ambient @ rampDown
        */
       if (setpoint > ambient) {
-         setpoint += currentProfile->rampDownSlope;
+         setpoint = trajectory.getSegment(s_ramp_down).getSetpoint(time-startOfStateTime);
       }
       pid.setSetpoint(setpoint);
       if (currentTemperature<=ambient) {
@@ -257,6 +334,12 @@ static void handler(const void *) {
       }
       break;
    }
+   if ((state == s_complete) || (state == s_fail)) {
+      // Run has just ended - turn off heater so Flash may be programmed
+      pid.enable(false);
+      ovenControl.setHeaterDutycycle(0);
+      archiveRun(state);
+   }
    // Add data point to record
    Reporter::addLogPoint(time, state);
 
@@ -264,8 +347,34 @@ static void handler(const void *) {
    time++;
 };
 
-/** Timer used to run a profile */
-CMSIS::Timer timer{handler};
+/**
+ * Set-point stage of the control loop
+ *
+ * The state-machine is stepped at the start of each second.  On the remaining ticks the
+ * set-point is interpolated along the trajectory segment for the current state so the
+ * PID controller sees a smooth ramp rather than 1 second steps.
+ *
+ * @param[in] tick Tick within the current second
+ */
+static void step(unsigned tick) {
+   if (tick == 0) {
+      handler();
+      return;
+   }
+   switch (state) {
+   case s_preheat:
+   case s_soak:
+   case s_ramp_up:
+   case s_ramp_down:
+      // Following profile - time has already been advanced by handler()
+      setpoint = trajectory.getSegment(state).getSetpoint(
+            (time-1-startOfStateTime)+tick/(float)ControlLoop::getTicksPerSecond());
+      pid.setSetpoint(setpoint);
+      break;
+   default:
+      break;
+   }
+}
 
 /**
  * Start running a profile.
@@ -282,8 +391,12 @@ CMSIS::Timer timer{handler};
  */
 bool startRunProfile(NvSolderProfile &profile) {
 
-   // Clear data
-   Draw::reset();
+   // Previous run must be archived before its data is cleared
+   archivePending();
+
+   // Clear data and metrics
+   Reporter::reset();
+   Reporter::setLiquidus(profile.liquidus);
 
    // Check if thermocouples can measure temperature
    if (std::isnan(getTemperature())) {
@@ -292,10 +405,10 @@ bool startRunProfile(NvSolderProfile &profile) {
    }
    currentProfile = &profile;
    state          = s_init;
+   archived       = false;
 
-   // Start Timer callback
-   timer.create();
-   timer.start(1.0);
+   // Start stepping profile from control loop
+   ControlLoop::setSetpointFunction(step);
 
    return true;
 }
@@ -304,20 +417,35 @@ bool startRunProfile(NvSolderProfile &profile) {
  * Abort the current sequence
  */
 void abortRunProfile() {
-   // Stop timer callback
-   timer.stop();
-   timer.destroy();
+   // Stop stepping profile
+   ControlLoop::setSetpointFunction(nullptr);
 
    // Stop PID controller
    pid.enable(false);
    pid.setSetpoint(0);
 
+   ovenControl.setHeaterDutycycle(0);
+
+   // A run that has already ended is archived with its final state
+   // before the abort is logged
+   archivePending();
+
    state = s_fail;
 
    Reporter::addLogPoint(time, state);
 
-   ovenControl.setHeaterDutycycle(0);
    ovenControl.setFanDutycycle(100);
+
+   // Heater is off so Flash may be programmed.
+   archiveRun(s_fail);
+   archivePending();
+}
+
+/**
+ * Start the thread archiving runs
+ */
+void initialise() {
+   archiveThread.run();
 }
 
 /**
@@ -339,6 +467,25 @@ State remoteCheckRunProfile() {
    return (state);
 }
 
+/**
+ * Check that no profile is being run
+ *
+ * @return true if state is s_off, s_complete or s_fail
+ */
+bool isIdle() {
+   State currentState = state;
+   return (currentState == s_off) || (currentState == s_complete) || (currentState == s_fail);
+}
+
+/**
+ * Get time in the current profile sequence
+ *
+ * @return Time in seconds since the profile was started
+ */
+int getRunTime() {
+   return time;
+}
+
 /**
  * Run the current profile
  */
@@ -348,9 +495,9 @@ void runProfile() {
       return;
    }
 
-   char buff[100];
-   snprintf(buff, sizeof(buff), "%d:%s\n\nRun Profile?", (int)currentProfileIndex, (const volatile char *)profiles[currentProfileIndex].description);
-   MessageBoxResult rc = messageBox("Run Profile", buff, MSG_YES_NO);
+   FormattedString<100> buff;
+   buff.writeInt(currentProfileIndex).writeChar(':').writeString(profiles[currentProfileIndex].description).writeString("\n\nRun Profile?");
+   MessageBoxResult rc = messageBox("Run Profile", buff.toString(), MSG_YES_NO);
    if (rc != MSG_IS_YES) {
       return;
    }
@@ -360,15 +507,16 @@ void runProfile() {
    // Menu for thermocouple screen
    static auto textPrompt = []() {
       lcd.gotoXY(lcd.LCD_WIDTH-lcd.FONT_WIDTH*10-6, lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
-      lcd.setInversion(true); lcd.putSpace(3); lcd.putString("Plot");  lcd.putSpace(3); lcd.setInversion(false); lcd.putSpace(6);
+      lcd.setInversion(true); lcd.putSpace(3); lcd.putString("View");  lcd.putSpace(3); lcd.setInversion(false); lcd.putSpace(6);
       lcd.setInversion(true); lcd.putSpace(3); lcd.putString("Stop");  lcd.putSpace(3); lcd.setInversion(false);
 
+      FormattedString<22> buff;
       lcd.gotoXY(0, 12+4*lcd.FONT_HEIGHT+2);
-      lcd.printf("%2ds", (int)round(pid.getElapsedTime()));
+      lcd.putString(buff.writeInt((int)round(pid.getElapsedTime()), 2).writeChar('s').toString());
       lcd.gotoXY(5*lcd.FONT_WIDTH+1, 12+4*lcd.FONT_HEIGHT+2);
-      lcd.printf("T=%5.1f\x7F", pid.getInput());
+      lcd.putString(buff.reset().writeString("T=").writeFixed(pid.getInput(), 1, 5).writeChar('\x7F').toString());
       lcd.gotoXY(13*lcd.FONT_WIDTH+2, 12+4*lcd.FONT_HEIGHT+2);
-      lcd.printf("Set=%3d\x7F", (int)round(pid.getSetpoint()));
+      lcd.putString(buff.reset().writeString("Set=").writeInt((int)round(pid.getSetpoint()), 3).writeChar('\x7F').toString());
 
       lcd.gotoXY(0, lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
       lcd.putString(Reporter::getStateName(state));
@@ -383,9 +531,10 @@ void runProfile() {
 
       lcd.setInversion(true);
       lcd.gotoXY(xTimeOffset, yTimeOffset);
-      lcd.printf("%3ds", (int)round(pid.getElapsedTime()));
+      FormattedString<8> buff;
+      lcd.putString(buff.writeInt((int)round(pid.getElapsedTime()), 3).writeChar('s').toString());
       lcd.gotoXY(xMenuOffset, yMenuOffset);
-      lcd.putSpace(1); lcd.putString("F4"); lcd.putSpace(1); lcd.putString("Th");
+      lcd.putSpace(1); lcd.putString("F4"); lcd.putSpace(1); lcd.putString("QA");
       lcd.gotoXY(xMenuOffset, yMenuOffset+lcd.FONT_HEIGHT*1);
       lcd.putSpace(1); lcd.putString("S");  lcd.putSpace(1); lcd.putString("Stp");
       lcd.setInversion(false);
@@ -393,6 +542,8 @@ void runProfile() {
 
    Reporter::DisplayMode plotDisplay = Reporter::DisplayTable;
 
+   // Previous run must be archived before its data is cleared
+   archivePending();
    Reporter::reset();
    Reporter::setTextPrompt(textPrompt);
    Reporter::setPlotPrompt(graphicPrompt);
@@ -404,7 +555,6 @@ void runProfile() {
    for(;;) {
       uint32_t now = osKernelSysTick();
       if ((uint32_t)(now - last) >= osKernelSysTickMicroSec(1000000U)) {
-         temperatureSensors.updateMeasurements();
          last += osKernelSysTickMicroSec(1000000U);
 //         Reporter::addLogPoint(time, state);
       }
@@ -419,11 +569,12 @@ void runProfile() {
          break;
       }
       if (key == SwitchValue::SW_F4) {
-         plotDisplay = Reporter::toggle(plotDisplay);
+         plotDisplay = Reporter::nextMode(plotDisplay);
          Reporter::setDisplayFormat(plotDisplay);
       }
    }
 
+   // Stopped by user or ended (already archived)
    abortRunProfile();
 
    Reporter::setDisplayFormat(Reporter::DisplayTable);
@@ -431,10 +582,12 @@ void runProfile() {
    // Sound buzzer
    Buzzer::play();
    static auto completedPrompt = []() {
+      FormattedString<22> buff;
       lcd.gotoXY(0, 12+4*lcd.FONT_HEIGHT+2);
-      lcd.printf("%4ds", (int)round(pid.getElapsedTime()));
+      lcd.putString(buff.writeInt((int)round(pid.getElapsedTime()), 4).writeChar('s').toString());
       lcd.gotoXY(5*lcd.FONT_WIDTH+2, 12+4*lcd.FONT_HEIGHT+2);
-      lcd.printf("T=%0.1f\x7F Set=%3d\x7F", pid.getInput(), (int)round(pid.getSetpoint()));
+      buff.reset().writeString("T=").writeFixed(pid.getInput(), 1).writeString("\x7F Set=").writeInt((int)round(pid.getSetpoint()), 3).writeChar('\x7F');
+      lcd.putString(buff.toString());
 
       lcd.gotoXY(128-4-lcd.FONT_WIDTH*17+2*4, lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
       lcd.setInversion(true); lcd.putSpace(3);
@@ -462,23 +615,25 @@ void drawManualScreen() {
 
    lcd.setInversion(true); lcd.putString("  Manual Mode\n"); lcd.setInversion(false);
 
-   lcd.printf("On Time   = %5.1fs\n", pid.getElapsedTime());
+   FormattedString<22> buff;
+
+   lcd.putString(buff.writeString("On Time   = ").writeFixed(pid.getElapsedTime(), 1, 5).writeString("s\n").toString());
 
-   lcd.printf("Set Temp  = %5.1f\x7F\n", pid.getSetpoint());
+   lcd.putString(buff.reset().writeString("Set Temp  = ").writeFixed(pid.getSetpoint(), 1, 5).writeString("\x7F\n").toString());
 
-   lcd.printf("Oven Temp = %5.1f\x7F\n", temperatureSensors.getTemperature());
+   lcd.putString(buff.reset().writeString("Oven Temp = ").writeFixed(temperatureSensors.getTemperature(), 1, 5).writeString("\x7F\n").toString());
 
    if (ovenControl.getHeaterDutycycle() == 0) {
-      lcd.printf("Heater = off\n");
+      lcd.putString("Heater = off\n");
    }
    else {
-      lcd.printf("Heater = on (%d%%)\n", ovenControl.getHeaterDutycycle());
+      lcd.putString(buff.reset().writeString("Heater = on (").writeInt(ovenControl.getHeaterDutycycle()).writeString("%)\n").toString());
    }
    if (ovenControl.getFanDutycycle() == 0) {
-      lcd.printf("Fan    = off\n");
+      lcd.putString("Fan    = off\n");
    }
    else {
-      lcd.printf("Fan    = on (%d%%) \n", ovenControl.getFanDutycycle());
+      lcd.putString(buff.reset().writeString("Fan    = on (").writeInt(ovenControl.getFanDutycycle()).writeString("%) \n").toString());
    }
    lcd.gotoXY(7*lcd.FONT_WIDTH+22, lcd.LCD_HEIGHT-2*lcd.FONT_HEIGHT);
    if (state == s_manual) {
@@ -534,7 +689,6 @@ void manualMode() {
       }
       uint32_t now = osKernelSysTick();
       if ((uint32_t)(now - last) >= osKernelSysTickMicroSec(1000000U)) {
-         temperatureSensors.updateMeasurements();
          last += osKernelSysTickMicroSec(1000000U);
 //         logger(++time);
          Reporter::addLogPoint(++time, state);
@@ -22,6 +22,11 @@ extern void monitor();
 
 namespace RunProfile {
 
+/**
+ * Start the thread archiving runs once they have ended
+ */
+extern void initialise();
+
 /**
  * Draw profile to LCD
  *
@@ -35,7 +40,8 @@ extern void drawProfile(const NvSolderProfile &profile);
 bool remoteStartRunProfile();
 
 /**
- * Abort the current profile sequence
+ * Abort the current profile sequence\n
+ * A run that has not ended is archived as failed
  */
 extern void abortRunProfile();
 
@@ -44,6 +50,21 @@ extern void abortRunProfile();
  */
 extern State remoteCheckRunProfile();
 
+/**
+ * Check that no profile is being run\n
+ * Flash (library/archive) is only changed when idle as programming stalls the processor
+ *
+ * @return true if state is s_off, s_complete or s_fail
+ */
+extern bool isIdle();
+
+/**
+ * Get time in the current profile sequence
+ *
+ * @return Time in seconds since the profile was started
+ */
+extern int getRunTime();
+
 /**
  * Run profile interactively\n
  * Doesn't return until complete
@@ -6,10 +6,10 @@
  *  Created on: 25 Sep 2016
  *      Author: podonoghue
  */
-#include <stdio.h>
 #include "settings.h"
 #include "lcd_st7920.h"
 #include "configure.h"
+#include "thermocoupleFilter.h"
 
 /** Priority of the FlexRAM initialisation (Settings constructor) */
 #define FLEX_RAM_INIT_PRIORITY  (1000)
@@ -70,6 +70,19 @@ USBDM::Nonvolatile<float> pidKi;
 __attribute__ ((section(".flexRAM")))
 USBDM::Nonvolatile<float> pidKd;
 
+/*
+ * Variables added after the original release follow here so existing FlexRAM
+ * contents keep their locations. They are validated when loaded (see Settings::Settings()).
+ */
+__attribute__ ((section(".flexRAM")))
+Nonvolatile<int> thermocoupleFilter;
+
+__attribute__ ((section(".flexRAM")))
+Nonvolatile<int> thermocoupleFilterLength;
+
+__attribute__ ((section(".flexRAM")))
+USBDM::Nonvolatile<float> thermocoupleFilterAlpha;
+
 extern const Setting_T<int> fanSetting;
 extern const Setting_T<int> kickSetting;
 extern const Setting_T<int> heaterSetting;
@@ -78,10 +91,231 @@ extern const Setting_T<int> thermo2Setting;
 extern const Setting_T<int> thermo3Setting;
 extern const Setting_T<int> thermo4Setting;
 extern const Setting_T<int> beepSetting;
+extern const Setting_T<int> filterLengthSetting;
 
 extern const Setting_T<float> pidKpSetting;
 extern const Setting_T<float> pidKiSetting;
 extern const Setting_T<float> pidKdSetting;
+extern const Setting_T<float> filterAlphaSetting;
+
+/**
+ * Setting for thermocouple filter type\n
+ * Displays the name of the filter rather than the value
+ */
+class FilterTypeSetting : public Setting_T<int> {
+public:
+   using Setting_T<int>::Setting_T;
+
+   /**
+    * Get description of variable including filter name
+    *
+    * @return Description
+    *
+    * @note This uses an internal static buffer that is shared by all Settings objects
+    */
+   virtual const char* getDescription() const override {
+      Formatter buff(getBuff(), BUF_SIZE);
+      buff.writeString(description).writeString(ThermocoupleFilter::getFilterName((FilterType)(int)nvVariable)).writeString(units);
+      return buff.toString();
+   }
+};
+
+extern const FilterTypeSetting filterTypeSetting;
+
+/**
+ * Non-volatile variables reported for Flash wear\n
+ * Profiles are appended to this list
+ */
+static const NonvolatileVariable nonvolatileVariables[] = {
+      {"beepTime",                 -1, &beepTime,                 sizeof(beepTime)},
+      {"minimumFanSpeed",          -1, &minimumFanSpeed,          sizeof(minimumFanSpeed)},
+      {"t1Offset",                 -1, &t1Offset,                 sizeof(t1Offset)},
+      {"t2Offset",                 -1, &t2Offset,                 sizeof(t2Offset)},
+      {"t3Offset",                 -1, &t3Offset,                 sizeof(t3Offset)},
+      {"t4Offset",                 -1, &t4Offset,                 sizeof(t4Offset)},
+      {"t1Enable",                 -1, &t1Enable,                 sizeof(t1Enable)},
+      {"t2Enable",                 -1, &t2Enable,                 sizeof(t2Enable)},
+      {"t3Enable",                 -1, &t3Enable,                 sizeof(t3Enable)},
+      {"t4Enable",                 -1, &t4Enable,                 sizeof(t4Enable)},
+      {"currentProfileIndex",      -1, &currentProfileIndex,      sizeof(currentProfileIndex)},
+      {"fanKickTime",              -1, &fanKickTime,              sizeof(fanKickTime)},
+      {"maxHeaterTime",            -1, &maxHeaterTime,            sizeof(maxHeaterTime)},
+      {"thermocoupleFilter",       -1, &thermocoupleFilter,       sizeof(thermocoupleFilter)},
+      {"thermocoupleFilterLength", -1, &thermocoupleFilterLength, sizeof(thermocoupleFilterLength)},
+      {"thermocoupleFilterAlpha",  -1, &thermocoupleFilterAlpha,  sizeof(thermocoupleFilterAlpha)},
+      {"pidKp",                    -1, &pidKp,                    sizeof(pidKp)},
+      {"pidKi",                    -1, &pidKi,                    sizeof(pidKi)},
+      {"pidKd",                    -1, &pidKd,                    sizeof(pidKd)},
+};
+
+/** Number of non-volatile variables excluding profiles */
+static constexpr unsigned NUM_NONVOLATILE_VARIABLES = sizeof(nonvolatileVariables)/sizeof(nonvolatileVariables[0]);
+
+/** Write counter for each non-volatile variable reported for Flash wear (including profiles) */
+static NonvolatileWriteCounter writeCounters[NUM_NONVOLATILE_VARIABLES+MAX_PROFILES];
+
+/**
+ * Get description of a non-volatile variable for reporting Flash wear
+ *
+ * @param[in]  index    Index of variable [0..]
+ * @param[out] variable Description of variable
+ *
+ * @return false if index is out of range
+ */
+bool Settings::getNonvolatileVariable(unsigned index, NonvolatileVariable &variable) {
+   if (index<NUM_NONVOLATILE_VARIABLES) {
+      variable = nonvolatileVariables[index];
+      return true;
+   }
+   index -= NUM_NONVOLATILE_VARIABLES;
+   if (index<MAX_PROFILES) {
+      variable = {"profile", (int)index, &profiles[index], sizeof(profiles[index])};
+      return true;
+   }
+   return false;
+}
+
+/**
+ * Find the non-volatile variable with the most writes
+ *
+ * @param[out] variable Description of variable
+ * @param[out] writes   Number of writes to variable
+ */
+void Settings::getMostWritten(NonvolatileVariable &variable, uint32_t &writes) {
+   NonvolatileVariable candidate;
+   writes = 0;
+   getNonvolatileVariable(0, variable);
+   for (unsigned index=0; getNonvolatileVariable(index, candidate); index++) {
+      unsigned maxWordWrites;
+      uint32_t count = NonvolatileShadow::getWriteCount(candidate.address, candidate.size, maxWordWrites);
+      if (count>writes) {
+         writes   = count;
+         variable = candidate;
+      }
+   }
+}
+
+/**
+ * Settings menu entry giving access to Flash wear statistics\n
+ * '+' or '-' displays the statistics page, restore default clears the statistics
+ */
+class FlashStatisticsSetting : public Setting {
+
+private:
+   /**
+    * Draw statistics page
+    */
+   static void drawScreen() {
+      NonvolatileStatistics statistics;
+      NonvolatileShadow::getStatistics(statistics);
+      NonvolatileVariable hotSpot;
+      uint32_t            hotSpotWrites;
+      Settings::getMostWritten(hotSpot, hotSpotWrites);
+
+      lcd.setInversion(false);
+      lcd.clearFrameBuffer();
+
+      lcd.setInversion(true);
+      lcd.putSpace(3); lcd.putString("Flash Statistics"); lcd.putSpace(3);
+      lcd.setInversion(false);
+
+      FormattedString<22> buff;
+      lcd.gotoXY(0, 1*lcd.FONT_HEIGHT);
+      lcd.putString(buff.writeString("Writes   ").writeInt(statistics.writes).toString());
+      lcd.gotoXY(0, 2*lcd.FONT_HEIGHT);
+      lcd.putString(buff.reset().writeString("Bytes    ").writeInt(statistics.bytesWritten).toString());
+      lcd.gotoXY(0, 3*lcd.FONT_HEIGHT);
+      lcd.putString(buff.reset().writeString("Commits  ").writeInt(statistics.commits)
+                        .writeString(" Same ").writeInt(statistics.unchanged).toString());
+      lcd.gotoXY(0, 4*lcd.FONT_HEIGHT);
+      lcd.putString(buff.reset().writeString("Stalls   ").writeInt(statistics.stalls).toString());
+      lcd.gotoXY(0, 5*lcd.FONT_HEIGHT);
+      lcd.putString(buff.reset().writeString("Stall ").writeInt(statistics.stallTime/1000)
+                        .writeString("ms max ").writeInt(statistics.maxStall).writeString("us").toString());
+      lcd.gotoXY(0, 6*lcd.FONT_HEIGHT);
+      buff.reset().writeString("Hot ").writeString(hotSpot.name);
+      if (hotSpot.index>=0) {
+         buff.writeInt(hotSpot.index);
+      }
+      lcd.putString(buff.writeChar(' ').writeInt(hotSpotWrites).toString());
+
+      lcd.gotoXY(3, lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
+      lcd.setInversion(true);  lcd.putSpace(3); lcd.putString("Clr");  lcd.putSpace(2);
+      lcd.setInversion(false);
+      lcd.gotoXY(lcd.LCD_WIDTH-28, lcd.LCD_HEIGHT-lcd.FONT_HEIGHT);
+      lcd.setInversion(true);  lcd.putSpace(3); lcd.putString("Exit"); lcd.putSpace(2);
+      lcd.setInversion(false);
+
+      lcd.refreshImage();
+      lcd.setGraphicMode();
+   }
+
+public:
+   constexpr FlashStatisticsSetting() {
+   }
+
+   /**
+    * Get description including total writes
+    *
+    * @return Description
+    *
+    * @note This uses an internal static buffer that is shared by all Settings objects
+    */
+   virtual const char* getDescription() const override {
+      NonvolatileStatistics statistics;
+      NonvolatileShadow::getStatistics(statistics);
+      Formatter buff(getBuff(), BUF_SIZE);
+      buff.writeString("Flash writes ").writeInt(statistics.writes, 5);
+      return buff.toString();
+   }
+
+   /**
+    * Statistics may not be changed
+    */
+   virtual void increment() const override {
+   }
+
+   /**
+    * Statistics may not be changed
+    */
+   virtual void decrement() const override {
+   }
+
+   /**
+    * Clear statistics
+    */
+   virtual void reset() const override {
+      NonvolatileShadow::resetStatistics();
+   }
+
+   /**
+    * Display statistics page until exit is pressed\n
+    * The page is refreshed when the statistics are cleared
+    */
+   virtual void action() const override {
+      bool changed = true;
+      for(;;) {
+         if (changed) {
+            drawScreen();
+            changed = false;
+         }
+         switch(buttons.getButton()) {
+         case SwitchValue::SW_F1:
+            NonvolatileShadow::resetStatistics();
+            changed = true;
+            break;
+         case SwitchValue::SW_S:
+            return;
+         default:
+            break;
+         }
+         __WFI();
+      }
+   }
+};
+
+/** Settings menu entry for Flash wear statistics */
+static const FlashStatisticsSetting flashStatisticsSetting;
 
 /**
  * Constructor - initialises the non-volatile storage\n
@@ -90,7 +324,20 @@ extern const Setting_T<float> pidKdSetting;
 Settings::Settings() : Flash() {
    // Initialise EEPROM
    USBDM::FlashDriverError_t rc = initialiseEeprom();
+
+   // Load RAM copy of non-volatile variables
+   USBDM::NonvolatileShadow::load();
+
+   // Count writes to each variable reported for Flash wear
+   NonvolatileVariable variable;
+   for (unsigned index=0; getNonvolatileVariable(index, variable); index++) {
+      writeCounters[index] = {variable.address, variable.size, 0};
+   }
+   USBDM::NonvolatileShadow::setWriteCounters(writeCounters, sizeof(writeCounters)/sizeof(writeCounters[0]));
+
    if (rc == USBDM::FLASH_ERR_OK) {
+      // Settings added by later firmware may not be initialised
+      validateSettings();
       return;
    }
    /*
@@ -105,7 +352,9 @@ Settings::Settings() : Flash() {
  */
 void Settings::initialiseSettings() {
 
-   // Write initial value for non-volatile variables
+   // Write initial value for non-volatile variables as a single transaction
+   USBDM::NonvolatileTransaction transaction;
+
    unsigned i=0;
    profiles[i++] = am4300profileA;
    profiles[i++] = am4300profileB;
@@ -127,6 +376,13 @@ void Settings::initialiseSettings() {
    beepTime        = beepSetting.getDefaultValue();
    maxHeaterTime   = heaterSetting.getDefaultValue();
 
+   /**
+    * Thermocouple filter
+    */
+   thermocoupleFilter       = filterTypeSetting.getDefaultValue();
+   thermocoupleFilterLength = filterLengthSetting.getDefaultValue();
+   thermocoupleFilterAlpha  = filterAlphaSetting.getDefaultValue();
+
    /**
     * PID controller parameters
     */
@@ -137,6 +393,19 @@ void Settings::initialiseSettings() {
    currentProfileIndex    = 0;
 }
 
+/**
+ * Resets any setting that is outside its limits to the default value\n
+ * This initialises settings added since the FlexRAM was initialised.
+ */
+void Settings::validateSettings() {
+
+   USBDM::NonvolatileTransaction transaction;
+
+   filterTypeSetting.validate();
+   filterLengthSetting.validate();
+   filterAlphaSetting.validate();
+}
+
 /**
  * Test Beeper
  */
@@ -163,8 +432,9 @@ private:
 
       lcd.gotoXY(0, 2*lcd.FONT_HEIGHT);
       lcd.setInversion(false);
-      lcd.putSpace(3); lcd.printf("Speed = %d%%\n\n",  (int)minimumFanSpeed);
-      lcd.putSpace(3); lcd.printf("Kick  = %d cycles", (int)fanKickTime);
+      FormattedString<22> buff;
+      lcd.putSpace(3); lcd.putString(buff.writeString("Speed = ").writeInt(minimumFanSpeed).writeString("%\n\n").toString());
+      lcd.putSpace(3); lcd.putString(buff.reset().writeString("Kick  = ").writeInt(fanKickTime).writeString(" cycles").toString());
 
       lcd.gotoXY(55, lcd.LCD_HEIGHT-2*lcd.FONT_HEIGHT);
       if (kickMode) {
@@ -270,19 +540,23 @@ public:
  * Controls range and default values etc.
  * Also used by the Settings object to initialise FlexRAM objects
  */
-//                                      nvVariable        description                min   max  incr  default  test function
-const Setting_T<int> fanSetting      = {minimumFanSpeed, "Reflow fan speed %3d%%",     5,  100,  5,   30,      FanTest::testFan};
-const Setting_T<int> kickSetting     = {fanKickTime,     "Fan Kick Cycles  %3d",       0,   50,  1,   10,      FanTest::testFan};
-const Setting_T<int> thermo1Setting  = {t1Offset,        "Thermo 1 Offset  %3d\x7F", -30,   30,  1,   0,       nullptr};
-const Setting_T<int> thermo2Setting  = {t2Offset,        "Thermo 2 Offset  %3d\x7F", -30,   30,  1,   0,       nullptr};
-const Setting_T<int> thermo3Setting  = {t3Offset,        "Thermo 3 Offset  %3d\x7F", -30,   30,  1,   0,       nullptr};
-const Setting_T<int> thermo4Setting  = {t4Offset,        "Thermo 4 Offset  %3d\x7F", -30,   30,  1,   0,       nullptr};
-const Setting_T<int> heaterSetting   = {maxHeaterTime,   "Max heater time %4d",       10, 1000, 10, 600,       nullptr};
-const Setting_T<int> beepSetting     = {beepTime,        "Beep time        %3ds",      0,   30,  1,   0,       Settings::testBeep};
-
-const Setting_T<float> pidKpSetting  = {pidKp,           "PID Kp      %6.1f",        0.5,  40.00,  0.1,  20.0f,   nullptr};
-const Setting_T<float> pidKiSetting  = {pidKi,           "PID Ki        %6.3f",      0.0,   1.00,  0.001, 0.016f, nullptr};
-const Setting_T<float> pidKdSetting  = {pidKd,           "PID Kd      %6.1f",        0.0, 200.00,  0.1,  62.5f,   nullptr};
+//                                      nvVariable        description          format  units   min   max  incr  default  test function
+const Setting_T<int> fanSetting      = {minimumFanSpeed, "Reflow fan speed ", {3},    "%",      5,  100,  5,   30,      FanTest::testFan};
+const Setting_T<int> kickSetting     = {fanKickTime,     "Fan Kick Cycles  ", {3},    "",       0,   50,  1,   10,      FanTest::testFan};
+const Setting_T<int> thermo1Setting  = {t1Offset,        "Thermo 1 Offset  ", {3},    "\x7F", -30,   30,  1,   0,       nullptr};
+const Setting_T<int> thermo2Setting  = {t2Offset,        "Thermo 2 Offset  ", {3},    "\x7F", -30,   30,  1,   0,       nullptr};
+const Setting_T<int> thermo3Setting  = {t3Offset,        "Thermo 3 Offset  ", {3},    "\x7F", -30,   30,  1,   0,       nullptr};
+const Setting_T<int> thermo4Setting  = {t4Offset,        "Thermo 4 Offset  ", {3},    "\x7F", -30,   30,  1,   0,       nullptr};
+const Setting_T<int> heaterSetting   = {maxHeaterTime,   "Max heater time ",  {4},    "",      10, 1000, 10, 600,       nullptr};
+const Setting_T<int> beepSetting     = {beepTime,        "Beep time        ", {3},    "s",      0,   30,  1,   0,       Settings::testBeep};
+
+const FilterTypeSetting filterTypeSetting   = {thermocoupleFilter,       "Thermo filter ",    {0},    "", Filter_None, Filter_Last, 1, Filter_Median, nullptr};
+const Setting_T<int>    filterLengthSetting = {thermocoupleFilterLength, "Filter length    ", {3},    "", 1, ThermocoupleFilter::MAX_LENGTH, 1, 5, nullptr};
+const Setting_T<float>  filterAlphaSetting  = {thermocoupleFilterAlpha,  "Filter IIR alpha ", {4,2},  "", ThermocoupleFilter::MIN_ALPHA, 1.00, 0.05, 0.30f, nullptr};
+
+const Setting_T<float> pidKpSetting  = {pidKp,           "PID Kp      ",      {6,1},  "",     0.5,  40.00,  0.1,  20.0f,   nullptr};
+const Setting_T<float> pidKiSetting  = {pidKi,           "PID Ki        ",    {6,3},  "",     0.0,   1.00,  0.001, 0.016f, nullptr};
+const Setting_T<float> pidKdSetting  = {pidKd,           "PID Kd      ",      {6,1},  "",     0.0, 200.00,  0.1,  62.5f,   nullptr};
 
 /**
  * Describes the settings and limits for same
@@ -296,9 +570,13 @@ static const Setting * const menu[] = {
       &thermo4Setting,
       &heaterSetting,
       &beepSetting,
+      &filterTypeSetting,
+      &filterLengthSetting,
+      &filterAlphaSetting,
       &pidKpSetting,
       &pidKiSetting,
       &pidKdSetting,
+      &flashStatisticsSetting,
 };
 
 static constexpr int NUM_ITEMS         = sizeof(menu)/sizeof(menu[0]);
@@ -11,6 +11,7 @@
 
 #include "flash.h"
 #include <SolderProfile.h>
+#include "formatter.h"
 
 /** Length of beep in seconds */
 extern USBDM::Nonvolatile<int> beepTime;
@@ -51,6 +52,15 @@ extern USBDM::Nonvolatile<int> currentProfileIndex;
 /** Maximum on time for heater in manual mode */
 extern USBDM::Nonvolatile<int> maxHeaterTime;
 
+/** Type of filter applied to thermocouple readings (FilterType) */
+extern USBDM::Nonvolatile<int> thermocoupleFilter;
+
+/** Number of readings used by moving average and median thermocouple filters */
+extern USBDM::Nonvolatile<int> thermocoupleFilterLength;
+
+/** Weight given to new reading by IIR thermocouple filter */
+extern USBDM::Nonvolatile<float> thermocoupleFilterAlpha;
+
 /** PID controller parameter - proportional */
 extern USBDM::Nonvolatile<float> pidKp;
 
@@ -60,6 +70,16 @@ extern USBDM::Nonvolatile<float> pidKi;
 /** PID controller parameters - differential */
 extern USBDM::Nonvolatile<float> pidKd;
 
+/**
+ * Describes a non-volatile variable for reporting Flash wear
+ */
+struct NonvolatileVariable {
+   const char *name;     //!< Name of variable
+   int         index;    //!< Index of array entry e.g. profile number (-1 if not an array entry)
+   const void *address;  //!< Location in FlexRAM
+   unsigned    size;     //!< Size in bytes
+};
+
 class Setting {
 
 protected:
@@ -129,6 +149,12 @@ protected:
    /** Description of variable */
    const char *description;
 
+   /** Format used to display value */
+   const NumberFormat format;
+
+   /** Units displayed after value */
+   const char *units;
+
    /** Minimum allowed value */
    const T min;
 
@@ -154,14 +180,16 @@ public:
     *
     * @param[in] nvVariable   Non-volatile variable to manipulate
     * @param[in] desc         Description of setting
+    * @param[in] format       Format used to display value
+    * @param[in] units        Units displayed after value
     * @param[in] min          Minimum value
     * @param[in] max          Maximum value
     * @param[in] delta        Change size for +/-
     * @param[in] defaultValue Default value for restore default
     * @param[in] func         Action function
     */
-   constexpr Setting_T(USBDM::Nonvolatile<T> &nvVariable, const char *desc, T min, T max, T delta, T defaultValue, void (*func)(const Setting *setting) ) :
-      nvVariable(nvVariable), description(desc), min(min), max(max), delta(delta), defaultValue(defaultValue), func(func)
+   constexpr Setting_T(USBDM::Nonvolatile<T> &nvVariable, const char *desc, NumberFormat format, const char *units, T min, T max, T delta, T defaultValue, void (*func)(const Setting *setting) ) :
+      nvVariable(nvVariable), description(desc), format(format), units(units), min(min), max(max), delta(delta), defaultValue(defaultValue), func(func)
    {}
 
    /**
@@ -172,8 +200,9 @@ public:
     * @note This uses an internal static buffer that is shared by all Settings objects
     */
    virtual const char* getDescription() const {
-      snprintf(getBuff(), BUF_SIZE, description, (T)nvVariable);
-      return getBuff();
+      Formatter buff(getBuff(), BUF_SIZE);
+      buff.writeString(description).writeNumber((T)nvVariable, format).writeString(units);
+      return buff.toString();
    }
 
    /**
@@ -221,6 +250,20 @@ public:
       set(defaultValue);
    }
 
+   /**
+    * Reset variable to default value if outside limits (or NAN)
+    *
+    * @return true if the variable was reset
+    */
+   bool validate() const {
+      T value = nvVariable;
+      if ((value >= min) && (value <= max)) {
+         return false;
+      }
+      reset();
+      return true;
+   }
+
    /**
     * Carry out action associated with variable (if any)\n
     * e.g. Sound beeper
@@ -272,6 +315,11 @@ public:
     */
    static void initialiseSettings();
 
+   /*
+    * Reset settings that are outside their limits to default values
+    */
+   static void validateSettings();
+
    /**
     * Test Fan operation
     *
@@ -293,6 +341,24 @@ public:
     * @param[in] params  Parameter values to display
     */
    static void testingScreen(const char *title, const char *params);
+
+   /**
+    * Get description of a non-volatile variable for reporting Flash wear
+    *
+    * @param[in]  index    Index of variable [0..]
+    * @param[out] variable Description of variable
+    *
+    * @return false if index is out of range
+    */
+   static bool getNonvolatileVariable(unsigned index, NonvolatileVariable &variable);
+
+   /**
+    * Find the non-volatile variable with the most writes
+    *
+    * @param[out] variable Description of variable
+    * @param[out] writes   Number of writes to variable
+    */
+   static void getMostWritten(NonvolatileVariable &variable, uint32_t &writes);
 };
 
 extern Settings settings;
@@ -8,6 +8,7 @@
 #include <math.h>
 #include <stdio.h>
 #include "configure.h"
+#include "formatter.h"
 
 class StepResponse {
 public:
@@ -28,7 +29,10 @@ public:
          temperature       = getTemperature();
          fan               = ovenControl.getFanDutycycle();
          heater            = ovenControl.getHeaterDutycycle();
-         printf("%4d, %4d, %4d, %5.1f\n", time, fan, heater, temperature);
+         FormattedString<30> buff;
+         buff.writeInt(time, 4).writeString(", ").writeInt(fan, 4).writeString(", ")
+             .writeInt(heater, 4).writeString(", ").writeFixed(temperature, 1, 5).writeChar('\n');
+         fputs(buff.toString(), stdout);
       }
       return (buttons.getButton() == SwitchValue::SW_S);
    }
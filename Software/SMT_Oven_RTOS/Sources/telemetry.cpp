@@ -0,0 +1,224 @@
+/**
+ * @file    telemetry.cpp
+ * @brief   Binary telemetry over the remote (CDC) interface
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#include <string.h>
+#include "telemetry.h"
+#include "plotting.h"
+
+namespace Telemetry {
+
+/** Start of frame marker */
+static constexpr uint8_t  SYNC           = 0xA5;
+
+/** Frame size excluding payload {sync, type, seq16, len, crc16} */
+static constexpr unsigned FRAME_OVERHEAD = 7;
+
+/** Maximum frame size */
+static constexpr unsigned MAX_FRAME_SIZE = FRAME_OVERHEAD+RECORDS_PER_FRAME*RECORD_SIZE;
+
+/** Number of live records held while the remote is busy */
+static constexpr unsigned LIVE_QUEUE_SIZE = 16;
+
+/** Frame types */
+enum FrameType : uint8_t {
+   Frame_Header = 'H',
+   Frame_Data   = 'D',
+   Frame_End    = 'E',
+   Frame_Live   = 'L',
+};
+
+/** Sequence number of plot frames - used by remote thread only */
+static uint16_t plotSequence = 0;
+
+/** Sequence number of live frames - used by publish() only */
+static uint16_t liveSequence = 0;
+
+/** Indicates live records are being pushed */
+static volatile bool live = false;
+
+/** Live records waiting to be sent */
+static uint8_t  liveQueue[LIVE_QUEUE_SIZE][RECORD_SIZE];
+
+/** Index of oldest waiting live record */
+static unsigned liveHead = 0;
+
+/** Number of waiting live records */
+static unsigned liveCount = 0;
+
+/**
+ * Update CRC-16/CCITT-FALSE
+ *
+ * @param[in] crc    Current CRC value
+ * @param[in] data   Data to add
+ * @param[in] length Number of bytes
+ *
+ * @return Updated CRC
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t *data, unsigned length) {
+   while (length-->0) {
+      crc ^= (uint16_t)(*data++)<<8;
+      for (unsigned bit=0; bit<8; bit++) {
+         crc = (crc&0x8000)?(crc<<1)^0x1021:(crc<<1);
+      }
+   }
+   return crc;
+}
+
+/**
+ * Write 16-bit value little-endian
+ *
+ * @param[out] buffer Where to write
+ * @param[in]  value  Value to write
+ */
+static void put16(uint8_t *buffer, uint16_t value) {
+   buffer[0] = (uint8_t)value;
+   buffer[1] = (uint8_t)(value>>8);
+}
+
+/**
+ * Pack data point into record
+ *
+ * @param[out] record    Record to fill
+ * @param[in]  time      Time index of point
+ * @param[in]  dataPoint Point to pack
+ */
+static void packRecord(uint8_t record[RECORD_SIZE], int time, const DataPoint &dataPoint) {
+   DataPoint::FieldArray fields;
+   dataPoint.getFields(fields);
+   put16(record, (uint16_t)time);
+   for (unsigned field=0; field<DataPoint::NUM_FIELDS; field++) {
+      put16(record+2+2*field, fields[field]);
+   }
+}
+
+/**
+ * Build frame
+ *
+ * @param[out]   frame    Buffer for frame (at least FRAME_OVERHEAD+length bytes)
+ * @param[in]    type     Type of frame
+ * @param[inout] sequence Sequence number for frame (incremented)
+ * @param[in]    payload  Frame payload
+ * @param[in]    length   Size of payload
+ *
+ * @return Size of frame
+ */
+static unsigned buildFrame(
+      uint8_t       *frame,
+      FrameType      type,
+      uint16_t      &sequence,
+      const uint8_t *payload,
+      unsigned       length) {
+
+   frame[0] = SYNC;
+   frame[1] = type;
+   put16(frame+2, sequence++);
+   frame[4] = (uint8_t)length;
+   memcpy(frame+5, payload, length);
+   put16(frame+5+length, crc16(0xFFFF, frame+1, 4+length));
+   return FRAME_OVERHEAD+length;
+}
+
+/**
+ * Send frame to remote\n
+ * This blocks while the remote is busy
+ *
+ * @param[in]    type     Type of frame
+ * @param[inout] sequence Sequence number for frame (incremented)
+ * @param[in]    payload  Frame payload
+ * @param[in]    length   Size of payload
+ */
+static void sendFrame(FrameType type, uint16_t &sequence, const uint8_t *payload, unsigned length) {
+   uint8_t frame[MAX_FRAME_SIZE];
+   RemoteInterface::send(frame, buildFrame(frame, type, sequence, payload, length));
+}
+
+/**
+ * Send entire plot as binary frames
+ */
+void sendPlot() {
+   const TemperaturePlot &plot = Draw::getData();
+   int count = plot.getLastValid()+1;
+
+   uint8_t payload[RECORDS_PER_FRAME*RECORD_SIZE];
+
+   put16(payload, (uint16_t)count);
+   payload[2] = DataPoint::NUM_FIELDS;
+   payload[3] = DataPoint::NUM_THERMOCOUPLES;
+   sendFrame(Frame_Header, plotSequence, payload, 4);
+
+   TemperaturePlot::Cursor cursor;
+   int time = 0;
+   while (time<count) {
+      unsigned records = 0;
+      while ((time<count) && (records<RECORDS_PER_FRAME)) {
+         packRecord(payload+records*RECORD_SIZE, time, plot.getDataPoint(time, cursor));
+         records++;
+         time++;
+      }
+      sendFrame(Frame_Data, plotSequence, payload, records*RECORD_SIZE);
+   }
+   put16(payload, (uint16_t)count);
+   sendFrame(Frame_End, plotSequence, payload, 2);
+}
+
+/**
+ * Enable/disable pushing of data points as they are recorded
+ *
+ * @param[in] enable True to enable
+ */
+void setLive(bool enable) {
+   live = enable;
+}
+
+/**
+ * Push data point to remote if live telemetry is enabled.\n
+ * This does not block. Points are held if the remote falls behind.
+ *
+ * @param[in] time      Time index of point
+ * @param[in] dataPoint Point to send
+ */
+void publish(int time, const DataPoint &dataPoint) {
+   if (!live) {
+      liveCount = 0;
+      return;
+   }
+   if (liveCount>=LIVE_QUEUE_SIZE) {
+      // Discard oldest - host sees the gap in time values
+      liveHead = (liveHead+1)%LIVE_QUEUE_SIZE;
+      liveCount--;
+   }
+   packRecord(liveQueue[(liveHead+liveCount)%LIVE_QUEUE_SIZE], time, dataPoint);
+   liveCount++;
+
+   // Don't wait for the remote - try again with next point
+   if (!RemoteInterface::lockResponse(0)) {
+      return;
+   }
+   while (liveCount>0) {
+      uint8_t  payload[RECORDS_PER_FRAME*RECORD_SIZE];
+      unsigned records = 0;
+      unsigned index   = liveHead;
+      while ((records<liveCount) && (records<RECORDS_PER_FRAME)) {
+         memcpy(payload+records*RECORD_SIZE, liveQueue[index], RECORD_SIZE);
+         index = (index+1)%LIVE_QUEUE_SIZE;
+         records++;
+      }
+      // Sequence number is only consumed if the frame is sent
+      uint16_t sequence = liveSequence;
+      uint8_t  frame[MAX_FRAME_SIZE];
+      unsigned size = buildFrame(frame, Frame_Live, sequence, payload, records*RECORD_SIZE);
+      if (!RemoteInterface::trySend(frame, size)) {
+         break;
+      }
+      liveSequence = sequence;
+      liveHead     = index;
+      liveCount   -= records;
+   }
+   RemoteInterface::unlockResponse();
+}
+
+}; // end namespace Telemetry
@@ -0,0 +1,68 @@
+/**
+ * @file    telemetry.h
+ * @brief   Binary telemetry over the remote (CDC) interface
+ *
+ * Frame format (multi-byte values are little-endian):
+ * @verbatim
+ *   +------+------+-------+-----+--------------+-------+
+ *   | 0xA5 | Type | Seq16 | Len | Payload[Len] | CRC16 |
+ *   +------+------+-------+-----+--------------+-------+
+ *   CRC16 = CRC-16/CCITT-FALSE over Type..Payload
+ *
+ *   Type 'H' Plot header   Payload = Count16, NumFields8, NumThermocouples8
+ *   Type 'D' Plot records  Payload = Record[1..RECORDS_PER_FRAME]
+ *   Type 'E' Plot end      Payload = Count16
+ *   Type 'L' Live records  Payload = Record[1..RECORDS_PER_FRAME]
+ *
+ *   Record = Time16, Field16[DataPoint::NUM_FIELDS] (see DataPoint::getFields())
+ * @endverbatim
+ *
+ * Plot frames and live frames have independent sequence numbers so the host
+ * may detect lost frames in either stream.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_TELEMETRY_H_
+#define SOURCES_TELEMETRY_H_
+
+#include <stdint.h>
+#include "dataPoint.h"
+#include "RemoteInterface.h"
+
+namespace Telemetry {
+
+/** Protocol version reported by TELEM? */
+static constexpr int      VERSION           = 1;
+
+/** Size of a packed record */
+static constexpr unsigned RECORD_SIZE       = 2+2*DataPoint::NUM_FIELDS;
+
+/** Maximum records in a frame - chosen so a frame fits in a single USB packet */
+static constexpr unsigned RECORDS_PER_FRAME = 3;
+
+/**
+ * Send entire plot as binary frames
+ */
+void sendPlot();
+
+/**
+ * Enable/disable pushing of data points as they are recorded
+ *
+ * @param[in] enable True to enable
+ */
+void setLive(bool enable);
+
+/**
+ * Push data point to remote if live telemetry is enabled.\n
+ * This does not block. Points are held if the remote falls behind.
+ *
+ * @param[in] time      Time index of point
+ * @param[in] dataPoint Point to send
+ */
+void publish(int time, const DataPoint &dataPoint);
+
+}; // end namespace Telemetry
+
+#endif /* SOURCES_TELEMETRY_H_ */
@@ -12,16 +12,21 @@
 #include <string.h>
 #include <dataPoint.h>
 #include <Max31855.h>
+#include "compressedLog.h"
 #include <algorithm>    // std::max
 
 
 /**
  * Represents an entire plot of a profile and profile run
+ *
+ * The measured points and profile are held in compressed logs so that long
+ * sessions may be recorded in a modest amount of RAM.
+ * Points must be added in time order (the last point may be replaced).
  */
 class TemperaturePlot {
 
 public:
-   static constexpr int MAX_PROFILE_TIME   = 9*60; // Maximum time for profile
+   static constexpr int MAX_PROFILE_TIME   = 60*60; // Maximum time for profile
 
 private:
    using ThermocoupleStatus = Max31855::ThermocoupleStatus;
@@ -29,14 +34,47 @@ private:
    /** Value used to scale float to scaled integer values => 2 decimal places */
    static constexpr float FIXED_POINT_SCALE    = 100.0;
 
-   DataPoint fThermocouple[MAX_PROFILE_TIME];  // Measured oven results
-   uint16_t  fProfile[MAX_PROFILE_TIME];       // Profile being attempted
-   int       fLastValid;                       // Index of last valid point
-   int       fLastProfile;                     // Index of last profile point
+public:
+   /**
+    * Size of pool for measured oven results (bytes)\n
+    * Worst hour long session measured by HostTests/compressedLogBench with margin
+    */
+   static constexpr unsigned DATA_POOL_SIZE    = 13*1024;
 
+   /** Size of pool for profile (bytes) */
+   static constexpr unsigned PROFILE_POOL_SIZE = 512;
+
+private:
+   /** Log of measured oven results */
+   using DataLog    = CompressedLog<DataPoint::NUM_FIELDS, DataPoint::SMOOTH_FIELDS, MAX_PROFILE_TIME, DATA_POOL_SIZE>;
+
+   /** Log of profile being attempted */
+   using ProfileLog = CompressedLog<1, 0b1, MAX_PROFILE_TIME, PROFILE_POOL_SIZE>;
+
+   DataLog    fThermocouple;                   // Measured oven results
+   ProfileLog fProfile;                        // Profile being attempted
+   int        fLastValid;                      // Index of last valid point
+   int        fLastProfile;                    // Index of last profile point
+   unsigned   fGeneration;                     // Incremented each time the plot is cleared
+   bool       fLogFull;                        // A point has been discarded as the plot is full
 
 public:
-   TemperaturePlot() : fLastValid(0), fLastProfile(0) {
+   /**
+    * Position for sequential access to plot.\n
+    * Use a new cursor for each pass over the plot.
+    */
+   struct Cursor {
+      DataLog::Cursor    data;
+      ProfileLog::Cursor profile;
+   };
+
+   /**
+    * Position for sequential decoding of an archived copy of the oven results.\n
+    * Use a new cursor for each pass over the copy.
+    */
+   using ArchiveCursor = DataLog::Cursor;
+
+   TemperaturePlot() : fLastValid(0), fLastProfile(0), fGeneration(0), fLogFull(false) {
       reset();
    }
    virtual ~TemperaturePlot() {
@@ -46,10 +84,12 @@ public:
     * Clear plot points
     */
    void reset() {
-      memset(fThermocouple, 0, sizeof(fThermocouple));
-      memset(fThermocouple, 0, sizeof(fProfile));
+      fThermocouple.reset();
+      fProfile.reset();
       fLastValid       = -1;
       fLastProfile     = -1;
+      fLogFull         = false;
+      fGeneration++;
    }
 
 public:
@@ -61,26 +101,54 @@ public:
     */
    void addProfilePoint(int time, float temp) {
       if (time>=MAX_PROFILE_TIME) {
+         fLogFull = true;
+         return;
+      }
+      if (time<fLastProfile) {
+         return;
+      }
+      ProfileLog::Record record = {(uint16_t)round(temp*FIXED_POINT_SCALE)};
+      if (time==fLastProfile) {
+         fProfile.replaceLast(record);
          return;
       }
-      if (time>fLastProfile) {
-         fLastProfile = time;
+      // Fill any gap with the new value
+      while (fLastProfile<time) {
+         if (!fProfile.append(record)) {
+            // Log full
+            fLogFull = true;
+            return;
+         }
+         fLastProfile++;
       }
-      fProfile[time] = round(temp*FIXED_POINT_SCALE);
    }
 
    /**
     * Get profile temperature point
     *
-    * @param time Time index for point
+    * @param[in]    time   Time index for point
+    * @param[inout] cursor Cursor used for sequential access
     *
     * @return Profile target temperature for above time index or NAN is out of range
     */
-   float getProfilePoint(int time) {
-      if (time>=fLastProfile) {
+   float getProfilePoint(int time, Cursor &cursor) const {
+      ProfileLog::Record record;
+      if ((time<0)||(time>fLastProfile)||!fProfile.get(time, record, cursor.profile)) {
          return NAN;
       }
-      return fProfile[time]/FIXED_POINT_SCALE;
+      return record[0]/FIXED_POINT_SCALE;
+   }
+
+   /**
+    * Get profile temperature point
+    *
+    * @param time Time index for point
+    *
+    * @return Profile target temperature for above time index or NAN is out of range
+    */
+   float getProfilePoint(int time) const {
+      Cursor cursor;
+      return getProfilePoint(time, cursor);
    }
 
    /**
@@ -91,27 +159,84 @@ public:
     */
    void addDataPoint(int time, DataPoint const &dataPoint) {
       if (time>=MAX_PROFILE_TIME) {
+         fLogFull = true;
+         return;
+      }
+      if (time<fLastValid) {
+         return;
+      }
+      DataPoint::FieldArray fields;
+      dataPoint.getFields(fields);
+      if (time==fLastValid) {
+         fThermocouple.replaceLast(fields);
          return;
       }
-      if (time>fLastValid) {
-         fLastValid = time;
+      // Fill any gap with the new value
+      while (fLastValid<time) {
+         if (!fThermocouple.append(fields)) {
+            // Log full
+            fLogFull = true;
+            return;
+         }
+         fLastValid++;
       }
-      fThermocouple[time] = dataPoint;
    }
 
    /**
     * Return data point
     *
-    * @param index Index of point to retrieve
+    * @param[in]    index  Index of point to retrieve
+    * @param[inout] cursor Cursor used for sequential access
     *
     * @return Point retrieved.
     */
-   const DataPoint &getDataPoint(int index) const {
-      static const DataPoint dummy;
-      if (index>fLastValid) {
-         return dummy;
+   DataPoint getDataPoint(int index, Cursor &cursor) const {
+      DataPoint dataPoint;
+      DataPoint::FieldArray fields;
+      if ((index>=0) && (index<=fLastValid) && fThermocouple.get(index, fields, cursor.data)) {
+         dataPoint.setFields(fields);
       }
-      return fThermocouple[index];
+      return dataPoint;
+   }
+
+   /**
+    * Return data point
+    *
+    * @param index Index of point to retrieve
+    *
+    * @return Point retrieved.
+    */
+   DataPoint getDataPoint(int index) const {
+      Cursor cursor;
+      return getDataPoint(index, cursor);
+   }
+
+   /**
+    * Get compressed oven results e.g. to archive a copy
+    *
+    * @param[out] size Size of compressed data in bytes
+    *
+    * @return Pointer to compressed data (getLastValid()+1 points)
+    */
+   const uint8_t *getEncodedData(unsigned &size) const {
+      size = fThermocouple.bytesUsed();
+      return fThermocouple.getEncodedData();
+   }
+
+   /**
+    * Return next data point from an archived copy of the compressed oven results
+    *
+    * @param[in]    data   Copy of data obtained from getEncodedData()
+    * @param[inout] cursor Cursor used for sequential access
+    *
+    * @return Point retrieved.
+    */
+   static DataPoint decodeDataPoint(const uint8_t *data, ArchiveCursor &cursor) {
+      DataPoint dataPoint;
+      DataPoint::FieldArray fields;
+      DataLog::getNext(data, fields, cursor);
+      dataPoint.setFields(fields);
+      return dataPoint;
    }
 
    /**
@@ -133,6 +258,27 @@ public:
       return fLastValid;
    }
 
+   /**
+    * Get generation of plot\n
+    * This changes whenever the plot is cleared so a reader can tell that
+    * indices it obtained earlier no longer refer to the same points.
+    *
+    * @return Generation number
+    */
+   unsigned getGeneration() const {
+      return fGeneration;
+   }
+
+   /**
+    * Indicates points have been discarded since the plot was cleared because it is full\n
+    * i.e. the run exceeded MAX_PROFILE_TIME or the compressed data exceeded the pool.
+    *
+    * @return true if points have been discarded
+    */
+   bool isLogFull() const {
+      return fLogFull;
+   }
+
    /**
     * Get index of last profile value
     *
@@ -152,23 +298,12 @@ public:
    }
 
    /**
-    * Get data points
-    *
-    * @return Data points
-    */
-   const DataPoint *getData() const {
-      return fThermocouple;
-   }
-
-   /**
-    * Get data points
-    *
-    * @param index Index of value to retrieve
+    * Get memory used by compressed data
     *
-    * @return Data points
+    * @return Bytes used
     */
-   const DataPoint &getDataPoint(unsigned index) const {
-      return fThermocouple[index];
+   unsigned getBytesUsed() const {
+      return fThermocouple.bytesUsed()+fProfile.bytesUsed();
    }
 };
 
@@ -10,6 +10,11 @@
 
 #include <dataPoint.h>
 #include <Max31855.h>
+#include "max31855Batch.h"
+#include "thermocoupleFilter.h"
+#if defined(OVEN_SIMULATION)
+#include "ovenModel.h"
+#endif
 #include "cmsis.h"
 
 class TemperatureSensors {
@@ -28,61 +33,87 @@ private:
       Max31855(spi, t4_cs_num, t4Offset, t4Enable),
    };
 
-   /** The thermocouples are averaged this many times on reading. */
-   static constexpr int OVERSAMPLES = 4;
+   /** Used to read all the temperature sensors in a single DMA transfer */
+   Max31855Batch fBatchReader{spi, fTemperatureSensors, NUM_THERMOCOUPLES};
 
-   /** Last measurement */
-   DataPoint fCurrentMeasurements;
+   /** Filter applied to each thermocouple */
+   ThermocoupleFilter fFilters[NUM_THERMOCOUPLES];
 
-   /** Cold junction references from last measurement */
-   float fColdReferences[4];
-
-   /** Mutex used to protect accesses */
-   CMSIS::Mutex fMutex;
+   /**
+    * Interval between samples taken by the sampler thread (ms).\n
+    * This matches the conversion rate of the MAX31855.
+    */
+   static constexpr uint32_t SAMPLE_INTERVAL_MS = 100;
 
-   /** Average of temperatures */
-   float fAverageTemperature = 0;
+   /** Stack size for sampler thread (bytes) */
+   static constexpr uint32_t SAMPLER_STACK_SIZE = 768;
 
 public:
    /**
-    * Constructor
+    * A complete set of measurements from all thermocouples
     */
-   TemperatureSensors() {
-   }
+   struct Snapshot {
+      /** Thermocouple temperatures and status */
+      DataPoint measurements;
+
+      /** Cold junction references */
+      float     coldReferences[NUM_THERMOCOUPLES];
+
+      /** Average of temperatures of enabled thermocouples (NAN if none) */
+      float     averageTemperature;
+   };
+
+private:
 
    /**
-    * Destructor
+    * Double buffer of snapshots.\n
+    * The sampler writes into fSnapshots[(fSequence+1)&1] while consumers read fSnapshots[fSequence&1]
     */
-   virtual ~TemperatureSensors() {}
+   Snapshot fSnapshots[2];
+
+   /** Incremented each time a new snapshot is published */
+   volatile uint32_t fSequence = 0;
+
+   /** Thread doing the sampling */
+   CMSIS::Thread fSamplerThread{samplerThread, osPriorityAboveNormal, SAMPLER_STACK_SIZE};
 
    /**
-    * Update current readings from thermocouples
+    * Take a new set of measurements from thermocouples.\n
+    * The temperatures are passed through the per-channel filters.
+    *
+    * @param[out] snapshot Where to place the measurements
     */
-   void updateMeasurements() {
-      // Lock while changes made
-      fMutex.wait();
+   void sample(Snapshot &snapshot) {
       float temperatures[NUM_THERMOCOUPLES];
       ThermocoupleStatus status[NUM_THERMOCOUPLES];
+#if defined(OVEN_SIMULATION)
+      // Frames are generated by oven model
+      uint8_t frames[NUM_THERMOCOUPLES][OvenModel::FRAME_SIZE];
+      OvenModel::getFrames(frames);
+      for (unsigned t=0; t<NUM_THERMOCOUPLES; t++) {
+         status[t] = fTemperatureSensors[t].decode(frames[t], temperatures[t], snapshot.coldReferences[t]);
+      }
+#else
+      if (!fBatchReader.read(status, temperatures, snapshot.coldReferences)) {
+         // Fall back to reading sensors individually
+         for (unsigned t=0; t<NUM_THERMOCOUPLES; t++) {
+            status[t] = fTemperatureSensors[t].getReading(temperatures[t], snapshot.coldReferences[t]);
+         }
+      }
+#endif
+      // Filter settings are shared by all channels
+      FilterType filterType   = (FilterType)(int)thermocoupleFilter;
+      unsigned   filterLength = thermocoupleFilterLength;
+      float      filterAlpha  = thermocoupleFilterAlpha;
+
       int   foundSensorCount   = 0;
       float averageTemperature = 0;
       for (unsigned t=0; t<NUM_THERMOCOUPLES; t++) {
-         // Average each thermocouple
-         temperatures[t]    = 0;
-         fColdReferences[t] = 0;
-         for (int overSample=0; overSample<OVERSAMPLES; overSample++) {
-            float temperature;
-            float coldReference;
-            status[t] = fTemperatureSensors[t].getReading(temperature, coldReference);
-            temperatures[t]   += temperature;
-            fColdReferences[t] += coldReference;
-            if (status[t] == Max31855::TH_ENABLED) {
-               foundSensorCount++;
-               averageTemperature +=temperature;
-            }
+         temperatures[t] = fFilters[t].filter(temperatures[t], filterType, filterLength, filterAlpha);
+         if (status[t] == Max31855::TH_ENABLED) {
+            foundSensorCount++;
+            averageTemperature += temperatures[t];
          }
-         // Scale for average
-         temperatures[t]    /= OVERSAMPLES;
-         fColdReferences[t]  /= OVERSAMPLES;
       }
       if (foundSensorCount==0) {
          // Safe value to return!
@@ -91,45 +122,120 @@ public:
       else {
          averageTemperature /= foundSensorCount;
       }
-      fAverageTemperature = averageTemperature;
-      fCurrentMeasurements.setState(s_off);
-      fCurrentMeasurements.setTargetTemperature(0);
-      fCurrentMeasurements.setFan(0);
-      fCurrentMeasurements.setHeater(0);
-      fCurrentMeasurements.setThermocouplePoint(temperatures, status);
-      fMutex.release();
+      snapshot.averageTemperature = averageTemperature;
+      snapshot.measurements.setState(s_off);
+      snapshot.measurements.setTargetTemperature(0);
+      snapshot.measurements.setFan(0);
+      snapshot.measurements.setHeater(0);
+      snapshot.measurements.setThermocouplePoint(temperatures, status);
+   }
+
+   /**
+    * Thread periodically sampling the thermocouples.\n
+    * This is the only code that accesses the thermocouples over SPI.
+    *
+    * @param[in] arg The TemperatureSensors object
+    */
+   static void samplerThread(const void *arg) {
+      TemperatureSensors &This = *(TemperatureSensors *)arg;
+
+      uint32_t last = osKernelSysTick();
+      for(;;) {
+         // Fill unused buffer
+         This.sample(This.fSnapshots[(This.fSequence+1)&1]);
+
+         // Publish new snapshot
+         __DMB();
+         This.fSequence = This.fSequence + 1;
+
+         // Wait for next sample time
+         last += osKernelSysTickMicroSec(SAMPLE_INTERVAL_MS*1000);
+         int32_t remaining = (int32_t)(last - osKernelSysTick());
+         if (remaining <= 0) {
+            // Overran - re-synchronise
+            last = osKernelSysTick();
+            continue;
+         }
+         osDelay((remaining+osKernelSysTickMicroSec(1000)-1)/osKernelSysTickMicroSec(1000));
+      }
+   }
+
+public:
+   /**
+    * Constructor
+    */
+   TemperatureSensors() {
+      for (Snapshot &snapshot:fSnapshots) {
+         snapshot.averageTemperature = NAN;
+      }
    }
+
+   /**
+    * Destructor
+    */
+   virtual ~TemperatureSensors() {}
+
+   /**
+    * Start the sampler thread
+    */
+   void initialise() {
+      fBatchReader.initialise();
+      fSamplerThread.run(this);
+   }
+
+   /**
+    * Get a consistent copy of the latest measurements\n
+    * This does not access the thermocouples.
+    *
+    * @param[out] snapshot Where to return the measurements
+    */
+   void getSnapshot(Snapshot &snapshot) const {
+      uint32_t sequence;
+      do {
+         sequence = fSequence;
+         __DMB();
+         snapshot = fSnapshots[sequence&1];
+         __DMB();
+         // Retry if the sampler may have started overwriting this buffer
+      } while (sequence != fSequence);
+   }
+
    /**
     * Get current temperature\n
-    * This is an average of the active thermocouples\n
-    * This does a new set of measurements
+    * This is an average of the active thermocouples from the latest sample.\n
+    * This does not access the thermocouples.
     *
-    * @return Averaged oven temperature
+    * @return Averaged oven temperature (NAN if no active thermocouples)
     */
-   float getTemperature() {
-      updateMeasurements();
-      return fAverageTemperature;
+   float getTemperature() const {
+      Snapshot snapshot;
+      getSnapshot(snapshot);
+      return snapshot.averageTemperature;
    }
    /**
     * Get last measured thermocouple values
     *
-    * @return Reference to set of measurements (DataPoint)
+    * @return Copy of latest set of measurements (DataPoint)
     * @return This will be incomplete as only the thermocouple information is present e.g.
     *         state etc is not valid.
     */
-   const DataPoint &getLastMeasurement() {
-      return fCurrentMeasurements;
+   DataPoint getLastMeasurement() const {
+      Snapshot snapshot;
+      getSnapshot(snapshot);
+      return snapshot.measurements;
    }
    /**
-    * Return the cold reference temperature from the last call
-    * to measureNewDataPoint for given thermocouple
+    * Return the cold reference temperature from the latest sample
+    * for given thermocouple
     *
     * @param[in] index Index of thermocouple
     *
     * @return Cold reference temperature
     */
-   float getColdReferences(int index) {
-      return fColdReferences[index];
+   float getColdReferences(int index) const {
+      Snapshot snapshot;
+      getSnapshot(snapshot);
+      return snapshot.coldReferences[index];
    }
    /**
     * Get the thermocouple sensor
@@ -144,15 +250,17 @@ public:
    /**
     * Get case temperature \n
     * This is actually the cold reference temperature for one of the internal Max31855s
+    * from the latest sample.
     */
-   float getCaseTemperature() {
-      float temperature, coldReference;
-      ThermocoupleStatus status = fTemperatureSensors[0].getReading(temperature, coldReference);
-      if (status == Max31855::TH_MISSING) {
+   float getCaseTemperature() const {
+      Snapshot snapshot;
+      getSnapshot(snapshot);
+      float temperature;
+      if (snapshot.measurements.getTemperature(0, temperature) == Max31855::TH_MISSING) {
          // No MAX31855!
          return 50.0;
       }
-      return coldReference;
+      return snapshot.coldReferences[0];
    }
 };
 
@@ -0,0 +1,174 @@
+/**
+ * @file    thermocoupleFilter.h
+ * @brief   Filtering applied to successive thermocouple readings
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_THERMOCOUPLEFILTER_H_
+#define SOURCES_THERMOCOUPLEFILTER_H_
+
+#include <math.h>
+
+/**
+ * Type of filter applied to thermocouple readings
+ */
+enum FilterType {
+   Filter_None,            //!< Raw readings
+   Filter_MovingAverage,   //!< Average of last N readings
+   Filter_Median,          //!< Median of last N readings (spike rejection)
+   Filter_Iir,             //!< First-order IIR (exponential smoothing)
+   Filter_Last = Filter_Iir,
+};
+
+/**
+ * Filter for a single thermocouple channel.\n
+ * It is fed a new reading each time the thermocouple is sampled.
+ *
+ * The history is retained independently of the filter type and length so these
+ * may be changed at any time.
+ */
+class ThermocoupleFilter {
+
+public:
+   /** Maximum number of readings retained for moving average and median filters */
+   static constexpr unsigned MAX_LENGTH = 9;
+
+   /** Smallest weight used by IIR filter (0 would freeze the output) */
+   static constexpr float    MIN_ALPHA  = 0.05f;
+
+private:
+   /** Circular buffer of recent readings */
+   float    fHistory[MAX_LENGTH];
+
+   /** Index of next entry in fHistory */
+   unsigned fIndex = 0;
+
+   /** Number of valid entries in fHistory */
+   unsigned fCount = 0;
+
+   /** Output of IIR filter */
+   float    fIirValue = 0;
+
+   /**
+    * Get average of recent readings
+    *
+    * @param[in] length Number of readings to use
+    */
+   float average(unsigned length) const {
+      float sum = 0;
+      unsigned index = fIndex;
+      for (unsigned count=0; count<length; count++) {
+         index = (index==0)?MAX_LENGTH-1:index-1;
+         sum += fHistory[index];
+      }
+      return sum/length;
+   }
+
+   /**
+    * Get median of recent readings
+    *
+    * @param[in] length Number of readings to use
+    */
+   float median(unsigned length) const {
+      float sorted[MAX_LENGTH];
+      unsigned index = fIndex;
+      for (unsigned count=0; count<length; count++) {
+         index = (index==0)?MAX_LENGTH-1:index-1;
+         // Insertion sort
+         float value = fHistory[index];
+         unsigned position = count;
+         while ((position>0) && (sorted[position-1]>value)) {
+            sorted[position] = sorted[position-1];
+            position--;
+         }
+         sorted[position] = value;
+      }
+      if (length&1) {
+         return sorted[length/2];
+      }
+      return (sorted[length/2-1]+sorted[length/2])/2;
+   }
+
+public:
+   /**
+    * Get name of filter type
+    *
+    * @param[in] type Filter type
+    *
+    * @return Short string describing filter
+    */
+   static const char *getFilterName(FilterType type) {
+      switch(type) {
+      case Filter_None          : return "None";
+      case Filter_MovingAverage : return "Average";
+      case Filter_Median        : return "Median";
+      case Filter_Iir           : return "IIR";
+      default                   : return "????";
+      }
+   }
+
+   /**
+    * Discard history.\n
+    * Used when a reading is invalid e.g. open thermocouple.
+    */
+   void reset() {
+      fIndex = 0;
+      fCount = 0;
+   }
+
+   /**
+    * Add reading and obtain filtered value
+    *
+    * @param[in] value  New reading (NAN if invalid)
+    * @param[in] type   Type of filter to apply
+    * @param[in] length Number of readings to use for moving average and median [1..MAX_LENGTH]
+    * @param[in] alpha  Weight applied to new reading by IIR filter [MIN_ALPHA..1]
+    *
+    * @return Filtered value (NAN if value is NAN)
+    */
+   float filter(float value, FilterType type, unsigned length, float alpha) {
+      if (isnan(value)) {
+         reset();
+         return value;
+      }
+      fHistory[fIndex++] = value;
+      if (fIndex>=MAX_LENGTH) {
+         fIndex = 0;
+      }
+      if (fCount<MAX_LENGTH) {
+         fCount++;
+      }
+      // Limit parameters as they come from non-volatile settings
+      if (!(alpha >= MIN_ALPHA)) {
+         // Includes NAN
+         alpha = MIN_ALPHA;
+      }
+      if (alpha > 1.0f) {
+         alpha = 1.0f;
+      }
+      // IIR is always updated so it is primed if selected
+      if (fCount==1) {
+         fIirValue = value;
+      }
+      else {
+         fIirValue += alpha*(value-fIirValue);
+      }
+      if (length<1) {
+         length = 1;
+      }
+      if (length>fCount) {
+         length = fCount;
+      }
+      switch(type) {
+      default:
+      case Filter_None          : return value;
+      case Filter_MovingAverage : return average(length);
+      case Filter_Median        : return median(length);
+      case Filter_Iir           : return fIirValue;
+      }
+   }
+};
+
+#endif /* SOURCES_THERMOCOUPLEFILTER_H_ */
@@ -0,0 +1,206 @@
+/**
+ * @file    tokenizer.h
+ * @brief   Reentrant tokenizer for remote commands
+ *
+ * Parses a command in place e.g.
+ * @verbatim
+ *   PROF 4,My Profile,FF,140,...;\n
+ *   ^^^^ ^ ^^^^^^^^^^ ^^ ^^^
+ *   word field...
+ * @endverbatim
+ * Fields are separated by ',' and the list is terminated by ';', '\\r', '\\n' or end of string.\n
+ * Unlike strtok() the string is not modified and there is no hidden state.
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+
+#ifndef SOURCES_TOKENIZER_H_
+#define SOURCES_TOKENIZER_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+class Tokenizer {
+
+private:
+   /** Current position in string */
+   const char *fPtr;
+
+   /** Indicates the field list terminator has been consumed */
+   bool fEnd = false;
+
+   /**
+    * Check for end of field list
+    */
+   static bool isTerminator(char ch) {
+      return (ch == ';')||(ch == '\n')||(ch == '\r')||(ch == '\0');
+   }
+
+   /**
+    * Check for end of word
+    */
+   static bool isWordEnd(char ch) {
+      return (ch == ' ')||(ch == '\n')||(ch == '\r')||(ch == '\0');
+   }
+
+   /**
+    * Skip spaces
+    */
+   void skipSpaces() {
+      while (*fPtr == ' ') {
+         fPtr++;
+      }
+   }
+
+   /**
+    * Check that only spaces remain in a field after a number
+    *
+    * @param[in] end   End of number
+    * @param[in] limit End of field
+    */
+   static bool onlySpaces(const char *end, const char *limit) {
+      while (end<limit) {
+         if (*end++ != ' ') {
+            return false;
+         }
+      }
+      return true;
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param[in] str String to tokenize (not modified)
+    */
+   Tokenizer(const char *str) : fPtr(str) {
+   }
+
+   /**
+    * Get next word delimited by spaces or end of line
+    *
+    * @param[out] word   Start of word
+    * @param[out] length Length of word (0 if none)
+    *
+    * @return true  Word found
+    * @return false No word found
+    */
+   bool getWord(const char *&word, unsigned &length) {
+      skipSpaces();
+      word = fPtr;
+      while (!isWordEnd(*fPtr)) {
+         fPtr++;
+      }
+      length = fPtr-word;
+      skipSpaces();
+      return length>0;
+   }
+
+   /**
+    * Get next field
+    *
+    * @param[out] field  Start of field
+    * @param[out] length Length of field (may be 0 for empty field)
+    *
+    * @return true  Field found
+    * @return false No more fields
+    */
+   bool getField(const char *&field, unsigned &length) {
+      if (fEnd) {
+         return false;
+      }
+      field = fPtr;
+      while ((*fPtr != ',') && !isTerminator(*fPtr)) {
+         fPtr++;
+      }
+      length = fPtr-field;
+      if (*fPtr == ',') {
+         fPtr++;
+      }
+      else {
+         fEnd = true;
+         if (*fPtr != '\0') {
+            fPtr++;
+         }
+      }
+      return true;
+   }
+
+   /**
+    * Get next field as integer
+    *
+    * @param[out] value Value parsed
+    * @param[in]  radix Radix of number e.g. 10 or 16
+    *
+    * @return true  Valid number
+    * @return false Missing field or invalid number
+    */
+   bool getInt(int &value, int radix=10) {
+      const char *field;
+      unsigned    length;
+      if (!getField(field, length) || (length == 0)) {
+         return false;
+      }
+      char *end;
+      value = strtol(field, &end, radix);
+      return (end != field) && onlySpaces(end, field+length);
+   }
+
+   /**
+    * Get next field as float
+    *
+    * @param[out] value Value parsed
+    *
+    * @return true  Valid number
+    * @return false Missing field or invalid number
+    */
+   bool getFloat(float &value) {
+      const char *field;
+      unsigned    length;
+      if (!getField(field, length) || (length == 0)) {
+         return false;
+      }
+      char *end;
+      value = strtof(field, &end);
+      return (end != field) && onlySpaces(end, field+length);
+   }
+
+   /**
+    * Get next field as string
+    *
+    * @param[out] buffer Buffer for string (always terminated)
+    * @param[in]  size   Size of buffer (field is truncated to fit)
+    *
+    * @return true  Field found
+    * @return false No more fields
+    */
+   bool getString(char *buffer, unsigned size) {
+      const char *field;
+      unsigned    length;
+      if (!getField(field, length)) {
+         return false;
+      }
+      if (length>=size) {
+         length = size-1;
+      }
+      memcpy(buffer, field, length);
+      buffer[length] = '\0';
+      return true;
+   }
+
+   /**
+    * Check if only spaces and terminators remain
+    *
+    * @return true if nothing left to parse
+    */
+   bool atEnd() const {
+      const char *ptr = fPtr;
+      while ((*ptr == ' ') || ((*ptr != '\0') && isTerminator(*ptr))) {
+         ptr++;
+      }
+      return *ptr == '\0';
+   }
+};
+
+#endif /* SOURCES_TOKENIZER_H_ */
@@ -44,6 +44,7 @@ Change History
 #include <stdio.h>
 #include "derivative.h"
 #include "usb.h"
+#include "formatter.h"
 
 namespace USBDM {
 
@@ -233,15 +234,13 @@ void reportLineCoding(const LineCodingStructure *lineCodingStructure) {
  * @return Pointer to static buffer
  */
 const char *UsbBase::reportSetupPacket(SetupPacket *p) {
-   static char buff[100];
-   snprintf(buff, sizeof(buff), "[%2X,%s,%d,%d,%d]",
-         p->bmRequestType,
-         getRequestName(p->bRequest),
-         (int)(p->wValue),
-         (int)(p->wIndex),
-         (int)(p->wLength)
-   );
-   return buff;
+   static FormattedString<100> buff;
+   buff.reset().writeChar('[').writeHex(p->bmRequestType, 2).writeChar(',')
+       .writeString(getRequestName(p->bRequest)).writeChar(',')
+       .writeInt(p->wValue).writeChar(',')
+       .writeInt(p->wIndex).writeChar(',')
+       .writeInt(p->wLength).writeChar(']');
+   return buff.toString();
 }
 
 void reportLineState(uint8_t value) {
@@ -57,6 +57,26 @@ protected:
       }
    }
 
+   /**
+    * Wrapper for initialised static variable
+    *
+    * @return Reference to notifyUsbOut function pointer
+    */
+   static simpleCallbak &notifyUsbOutPtr() {
+      static simpleCallbak cb = nullptr;
+      return cb;
+   }
+
+   /**
+    * Notify USB Out interface that space is available for data
+    */
+   static void notifyUsbOut() {
+      simpleCallbak cb = notifyUsbOutPtr();
+      if (cb != nullptr) {
+         cb();
+      }
+   }
+
 protected:
    CDC_Interface() {}
    virtual ~CDC_Interface() {}
@@ -77,6 +97,15 @@ public:
       notifyUsbInPtr() = cb;
    }
 
+   /**
+    * Set USB notify function
+    *
+    * @param cb The function to call to notify the USB Out interface that space is available for data
+    */
+   static void setUsbOutNotifyCallback(simpleCallbak cb) {
+      notifyUsbOutPtr() = cb;
+   }
+
    /**
     * Get state of serial interface
     *
@@ -195,13 +195,11 @@ InEndpoint  <Usb0Info, Usb0::CDC_NOTIFICATION_ENDPOINT, CDC_NOTIFICATION_EP_MAXS
 OutEndpoint <Usb0Info, Usb0::CDC_DATA_OUT_ENDPOINT,     CDC_DATA_OUT_EP_MAXSIZE>      Usb0::epCdcDataOut;
 
 /** In end-point for CDC data in */
-InEndpoint  <Usb0Info, Usb0::CDC_DATA_IN_ENDPOINT,      CDC_DATA_IN_EP_MAXSIZE>       Usb0::epCdcDataIn;
+StreamingInEndpoint<Usb0Info, Usb0::CDC_DATA_IN_ENDPOINT, CDC_DATA_IN_EP_MAXSIZE>  Usb0::epCdcDataIn;
 /*
  * TODO Add additional end-points here
  */
 
-RemoteInterface::Response  *Usb0::response = nullptr;
-
 /**
  * Handler for Start of Frame Token interrupt (~1ms interval)
  */
@@ -271,22 +269,6 @@ void Usb0::epCdcSendNotification() {
    epCdcNotification.startTxTransaction(EPDataIn, sizeof(cdcNotification)+2);
 }
 
-static uint8_t cdcOutBuff[10] = "Welcome\n";
-static int cdcOutByteCount    = 8;
-
-/**
- * Start CDC IN transaction\n
- * A packet is only sent if data is available
- */
-void Usb0::startCdcIn() {
-   if ((epCdcDataIn.getState() == EPIdle) && (cdcOutByteCount>0)) {
-      static_assert(epCdcDataIn.BUFFER_SIZE>sizeof(cdcOutBuff), "Buffer too small");
-      memcpy(epCdcDataIn.getBuffer(), cdcOutBuff, cdcOutByteCount);
-      epCdcDataIn.setNeedZLP();
-      epCdcDataIn.startTxTransaction(EPDataIn, cdcOutByteCount);
-      cdcOutByteCount = 0;
-   }
-}
 /**
  * Handler for Token Complete USB interrupts for
  * end-points other than EP0
@@ -321,7 +303,9 @@ void Usb0::handleTokenComplete() {
 
 /**
  * Call-back handling CDC-OUT transaction complete\n
- * Data received is passed to the cdcInterface
+ * Data received is passed to the cdcInterface\n
+ * The end-point is only re-armed if the cdcInterface can accept another packet.
+ * Otherwise the host is NAKed until notifyOut() is called.
  *
  * @param state Current end-point state
  */
@@ -330,45 +314,42 @@ void Usb0::cdcOutTransactionCallback(EndpointState state) {
    if (state == EPDataOut) {
       cdcInterface::putData(epCdcDataOut.getDataTransferredSize(), epCdcDataOut.getBuffer());
    }
-   // Set up for next transfer
-   epCdcDataOut.startRxTransaction(EPDataOut, epCdcDataOut.BUFFER_SIZE);
+   if (cdcInterface::getRxSpace() >= (unsigned)epCdcDataOut.BUFFER_SIZE) {
+      // Set up for next transfer
+      epCdcDataOut.startRxTransaction(EPDataOut, epCdcDataOut.BUFFER_SIZE);
+   }
 }
 
 /**
- * Call-back handling CDC-IN transaction complete\n
- * Checks for data and schedules transfer as necessary\n
- * Each transfer will have a ZLP as necessary.
+ * Notify IN (device->host) endpoint that data is available\n
+ * Any free BDT banks are filled from the cdcInterface
  *
- * @param state Current end-point state
+ * @return Not used
  */
-void Usb0::cdcInTransactionCallback(EndpointState state) {
-   if ((state == EPDataIn)||(state == EPIdle)) {
-      if (response != nullptr) {
-         // Free last buffer as transfer is now complete
-         RemoteInterface::freeResponseBuffer(response);
-      }
-      // Set up new message
-      response = RemoteInterface::getResponse();
-      if (response == nullptr) {
-         // No messages waiting
-         return;
-      }
-      // Schedules transfer
-      epCdcDataIn.setNeedZLP();
-      epCdcDataIn.startTxTransaction(EPDataIn, response->size, response->data);
+bool Usb0::notify() {
+   // Prevent USB interrupt also filling the BDTs
+   enableNvicInterrupts(false);
+   if (connectionState == USBconfigured) {
+      epCdcDataIn.prime();
    }
+   enableNvicInterrupts(true);
+   return true;
 }
 
 /**
- * Notify IN (device->host) endpoint that data is available
+ * Notify OUT (host->device) endpoint that space is available for data
  *
  * @return Not used
  */
-bool Usb0::notify() {
-   if (epCdcDataIn.getState() == EPIdle) {
-      // Have to restart IN transactions
-      cdcInTransactionCallback(EPDataIn);
+bool Usb0::notifyOut() {
+   // Prevent USB interrupt also restarting the transfer
+   enableNvicInterrupts(false);
+   if ((connectionState == USBconfigured) && (epCdcDataOut.getState() == EPIdle) &&
+       (cdcInterface::getRxSpace() >= (unsigned)epCdcDataOut.BUFFER_SIZE)) {
+      // Have to restart OUT transactions
+      epCdcDataOut.startRxTransaction(EPDataOut, epCdcDataOut.BUFFER_SIZE);
    }
+   enableNvicInterrupts(true);
    return true;
 }
 
@@ -387,7 +368,7 @@ void Usb0::initialise() {
 
    cdcInterface::initialise();
    cdcInterface::setUsbInNotifyCallback(notify);
-   response = nullptr;
+   cdcInterface::setUsbOutNotifyCallback(notifyOut);
 }
 
 /**
@@ -30,6 +30,7 @@
  */
 //#define MS_COMPATIBLE_ID_FEATURE
 #include "RemoteInterface.h"
+#include "usb_streaming_endpoint.h"
 
 #define UNIQUE_ID
 //#include "configure.h"
@@ -65,7 +66,7 @@ static constexpr uint  CONTROL_EP_MAXSIZE           = 64; //!< Control in/out
  */
 static constexpr uint  CDC_NOTIFICATION_EP_MAXSIZE  = 16; //!< CDC notification
 static constexpr uint  CDC_DATA_OUT_EP_MAXSIZE      = 16; //!< CDC data out
-static constexpr uint  CDC_DATA_IN_EP_MAXSIZE       = 16; //!< CDC data in
+static constexpr uint  CDC_DATA_IN_EP_MAXSIZE       = 64; //!< CDC data in (full-speed bulk maximum)
 
 #ifdef USBDM_USB0_IS_DEFINED
 /**
@@ -157,13 +158,12 @@ protected:
    static OutEndpoint <Usb0Info, Usb0::CDC_DATA_OUT_ENDPOINT,     CDC_DATA_OUT_EP_MAXSIZE>      epCdcDataOut;
    
    /** In end-point for CDC data in */
-   static InEndpoint  <Usb0Info, Usb0::CDC_DATA_IN_ENDPOINT,      CDC_DATA_IN_EP_MAXSIZE>       epCdcDataIn;
+   static StreamingInEndpoint<Usb0Info, Usb0::CDC_DATA_IN_ENDPOINT, CDC_DATA_IN_EP_MAXSIZE>  epCdcDataIn;
    /*
     * TODO Add additional End-points here
     */
 	
    using cdcInterface = RemoteInterface;
-   static cdcInterface::Response  *response;
 
 public:
 
@@ -199,6 +199,13 @@ public:
     */
    static bool notify();
 
+   /**
+    * Notify OUT (host->device) endpoint that space is available for data
+    *
+    * @return Not used
+    */
+   static bool notifyOut();
+
    /**
     * Device Descriptor
     */
@@ -247,13 +254,14 @@ protected:
 
       epCdcDataIn.initialise();
       addEndpoint(&epCdcDataIn);
-      epCdcDataIn.setCallback(cdcInTransactionCallback);
+      epCdcDataIn.setFillFunction(cdcInterface::getTxData);
 
       // Start CDC status transmission
       epCdcSendNotification();
 
       // Connect notify callback
       cdcInterface::setUsbInNotifyCallback(notify);
+      cdcInterface::setUsbOutNotifyCallback(notifyOut);
       /*
        * TODO Initialise additional End-points here
        */
@@ -264,15 +272,6 @@ protected:
     */
    static void sofCallback();
 
-   /**
-    * Call-back handling CDC-IN transaction complete\n
-    * Checks for data and schedules transfer as necessary\n
-    * Each transfer will have a ZLP as necessary.
-    *
-    * @param state Current end-point state
-    */
-   static void cdcInTransactionCallback(EndpointState state);
-
    /**
     * Call-back handling CDC-OUT transaction complete\n
     * Data received is passed to the cdcInterface
@@ -287,12 +286,6 @@ protected:
     */
    static void handleTokenComplete(void);
 
-   /**
-    * Start CDC IN transaction\n
-    * A packet is only sent if data is available
-    */
-   static void startCdcIn();
-
    /**
     * Configure epCdcNotification for an IN transaction [Tx, device -> host, DATA0/1]
     */
@@ -0,0 +1,146 @@
+/**
+ * @file     usb_streaming_endpoint.h
+ * @brief    Double-buffered USB IN endpoint for streaming
+ *
+ *  Created on: 16 Oct 2017
+ *      Author: podonoghue
+ */
+#ifndef SOURCES_USB_STREAMING_ENDPOINT_H_
+#define SOURCES_USB_STREAMING_ENDPOINT_H_
+
+#include "usb_endpoint.h"
+
+namespace USBDM {
+
+/**
+ * Class for streaming IN endpoint
+ *
+ * Each BDT bank (even/odd) has its own buffer so that while the USB module sends
+ * one packet the next is already owned by the USB module.  Packets are obtained from
+ * a fill function (e.g. a transmit ring buffer) whenever a bank becomes free.\n
+ * A ZLP is sent if the data stops after a full packet so the host sees the end of the transfer.
+ *
+ * @tparam Info         Class describing associated USB hardware
+ * @tparam ENDPOINT_NUM Endpoint number
+ * @tparam EP_MAXSIZE   Maximum size of packet
+ */
+template<class Info, int ENDPOINT_NUM, int EP_MAXSIZE>
+class StreamingInEndpoint : public Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE> {
+
+public:
+   /**
+    * Function used to obtain data to send
+    *
+    * @param[out] buffer  Buffer for data
+    * @param[in]  maxSize Maximum number of bytes
+    *
+    * @return Number of bytes placed in buffer (0 => none available)
+    */
+   using FillFunction = unsigned (*)(uint8_t *buffer, unsigned maxSize);
+
+protected:
+   using Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::usb;
+   using Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::state;
+   using Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::txData1;
+   using Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::txOdd;
+
+private:
+   // Make private - transfers are driven by the fill function
+   using Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::startRxTransaction;
+   using Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::startTxTransaction;
+
+   /** Buffers for even and odd BDTs */
+   uint8_t fBuffers[2][EP_MAXSIZE];
+
+   /** Number of BDTs owned by USB module [0..2] */
+   volatile unsigned fInFlight;
+
+   /** Indicates the last packet queued was full so a ZLP is needed if data stops */
+   bool fLastFull;
+
+   /** Source of data */
+   FillFunction fFill;
+
+public:
+   /**
+    * Constructor
+    */
+   StreamingInEndpoint() : fInFlight(0), fLastFull(false), fFill(nullptr) {
+   }
+
+   /**
+    * Initialise endpoint
+    *  - Internal state
+    *  - BDTs
+    *  - usb->ENDPOINT[].ENDPT
+    */
+   void initialise() {
+      Endpoint_T<Info, ENDPOINT_NUM, EP_MAXSIZE>::initialise();
+      fInFlight = 0;
+      fLastFull = false;
+      endPointBdts[ENDPOINT_NUM].txEven.addr = nativeToLe32((uint32_t)fBuffers[EVEN]);
+      endPointBdts[ENDPOINT_NUM].txOdd.addr  = nativeToLe32((uint32_t)fBuffers[ODD]);
+      // Transmit only
+      usb->ENDPOINT[ENDPOINT_NUM].ENDPT = USB_ENDPT_EPTXEN_MASK|USB_ENDPT_EPHSHK_MASK;
+   }
+
+   /**
+    * Set function used to obtain data to send
+    *
+    * @param[in] fill Fill function
+    */
+   void setFillFunction(FillFunction fill) {
+      fFill = fill;
+   }
+
+   /**
+    * Give free BDTs to USB module while data is available\n
+    * Must be called with USB interrupts masked if not called from the USB ISR
+    */
+   void prime() {
+      while ((fInFlight<2) && (fFill != nullptr)) {
+         // Next free bank follows the bank the USB module will use next
+         EvenOdd   bank = (fInFlight==0)?txOdd:(EvenOdd)!txOdd;
+         BdtEntry *bdt  = (bank==ODD)?&endPointBdts[ENDPOINT_NUM].txOdd:&endPointBdts[ENDPOINT_NUM].txEven;
+
+         unsigned size = fFill(fBuffers[bank], EP_MAXSIZE);
+         if (size == 0) {
+            if (!fLastFull) {
+               // Nothing to send
+               break;
+            }
+            // Terminate transfer with ZLP
+         }
+         fLastFull = (size == EP_MAXSIZE);
+
+         bdt->bc = (uint8_t)size;
+         if (txData1) {
+            bdt->u.bits = BDTEntry_OWN_MASK|BDTEntry_DATA1_MASK|BDTEntry_DTS_MASK;
+         }
+         else {
+            bdt->u.bits = BDTEntry_OWN_MASK|BDTEntry_DATA0_MASK|BDTEntry_DTS_MASK;
+         }
+         txData1 = !txData1;
+         fInFlight++;
+         state = EPDataIn;
+      }
+   }
+
+   /**
+    * Handle IN token [Transmit, device -> host]\n
+    * Refills the completed bank
+    */
+   void handleInToken() {
+      if (fInFlight>0) {
+         fInFlight--;
+      }
+      if (fInFlight == 0) {
+         state = EPIdle;
+      }
+      prime();
+   }
+};
+
+}; // end namespace
+
+#endif /* SOURCES_USB_STREAMING_ENDPOINT_H_ */